@@ -74,6 +74,14 @@
  *******************************************************************************
  *     Version        0.64       Remove deprecated VC API
  * ------------------------------------------------------------------------------
+ *******************************************************************************
+ *     Version        0.65       Add API camera_get_latency_histograms() to query
+                                 the latency of the pipeline stages
+ * ------------------------------------------------------------------------------
+ *******************************************************************************
+ *     Version        0.66       Add the latency stages LATENCY_SENSOR_CTRL,
+                                 LATENCY_FRAME_SYNC_WAIT and LATENCY_FRAME_SYNC_DROP
+ * ------------------------------------------------------------------------------
  *
  */
 
@@ -577,5 +585,75 @@ int camera_get_parameters(int camera_id, Parameters& param, int64_t sequence = -
  **/
 int get_frame_size(int camera_id, int format, int width, int height, int field, int* bpp);
 
+/**
+ * \enum camera_latency_stage_t: The pipeline stages of which the latency is measured
+ *
+ * New stages are only added before LATENCY_STAGE_MAX, so the values of the existing ones
+ * never change. LATENCY_STAGE_MAX grows with the HAL version, the callers should skip the
+ * histograms of the stages they don't know.
+ */
+typedef enum {
+    LATENCY_SOF_TO_ISYS_FRAME = 0, /**< From SOF to the ISYS frame dequeued */
+    LATENCY_SOF_TO_PSYS_TASK,      /**< From SOF to the frame queued to PSys as a task */
+    LATENCY_PG_ITERATE,            /**< One PG iteration */
+    LATENCY_ISP_ADAPT,             /**< Converting the 3A results to the ISP parameters */
+    LATENCY_AIQ_RUN,               /**< One 3A run */
+    LATENCY_REQUEST,               /**< From qbuf to the buffer ready to dqbuf */
+    LATENCY_SENSOR_CTRL,           /**< Writing the sensor controls of one frame */
+    LATENCY_FRAME_SYNC_WAIT,       /**< Waiting for the frame synced with the other cameras */
+    LATENCY_FRAME_SYNC_DROP,       /**< Waiting until timeout, then the frame is dropped */
+    LATENCY_STAGE_MAX
+} camera_latency_stage_t;
+
+#define CAMERA_LATENCY_BUCKET_NUM 16
+/**
+ * The upper bound of bucket i is (CAMERA_LATENCY_BUCKET_BASE_US << i) us,
+ * the last bucket has no upper bound.
+ */
+#define CAMERA_LATENCY_BUCKET_BASE_US 250
+
+/**
+ * \struct camera_latency_histogram_t: The latency histogram of one stage of one stream
+ */
+typedef struct {
+    int stage;     /**< camera_latency_stage_t */
+    int stream_id; /**< -1 for the stages which are not bound to a stream */
+    uint64_t count;
+    uint64_t total_us;
+    uint64_t max_us;
+    uint64_t buckets[CAMERA_LATENCY_BUCKET_NUM];
+} camera_latency_histogram_t;
+
+/**
+ * \brief
+ *   Get the latency histograms of the pipeline stages.
+ *
+ * \note
+ *   The histograms are always collected, it doesn't require the camera device to be opened.
+ *   The stream id of the request latency is the user stream id, and the one of the PSys
+ *   stages is the stream id of the graph.
+ *
+ * \param[in]
+ *   int camera_id: The camera device index
+ * \param[out]
+ *   camera_latency_histogram_t* histograms: The array to fill the histograms with data
+ * \param[in]
+ *   int count: The size of the histograms array
+ * \param[in]
+ *   bool reset: Clear the histograms after they're read
+ *
+ * \return
+ *   The number of the filled histograms, < 0 if the parameters are invalid.
+ *
+ * \par Sample code:
+ *
+ * \code
+ *   camera_latency_histogram_t histograms[32];
+ *   int num = camera_get_latency_histograms(camera_id, histograms, 32, false);
+ * \endcode
+ **/
+int camera_get_latency_histograms(int camera_id, camera_latency_histogram_t* histograms,
+                                  int count, bool reset);
+
 }  // namespace icamera
 }  // extern "C"
@@ -160,6 +160,14 @@ ia_err IntelCca::runDVS(uint32_t streamId, uint64_t frameId) {
     return ret;
 }
 
+ia_err IntelCca::runDVS(uint32_t streamId, uint64_t frameId, const cca::cca_dvs_zoom& zoom) {
+    // Run DVS even if the zoom fails, with the previous zoom
+    ia_err ret = updateZoom(streamId, zoom);
+    CheckWarningNoReturn(ret != ia_err_none, "@%s, updateZoom fails, ret:%d", __func__, ret);
+
+    return runDVS(streamId, frameId);
+}
+
 ia_err IntelCca::runAIC(uint64_t frameId, const cca::cca_pal_input_params* params,
                         ia_binary_data* pal) {
     CheckAndLogError(!params, ia_err_argument, "@%s, params is nullptr", __func__);
@@ -55,6 +55,9 @@ class IntelCca {
 
     ia_err runDVS(uint32_t streamId, uint64_t frameId);
 
+    // Update the zoom and run DVS with it, which is done per frame
+    ia_err runDVS(uint32_t streamId, uint64_t frameId, const cca::cca_dvs_zoom& zoom);
+
     ia_err runAIC(uint64_t frameId, const cca::cca_pal_input_params* params, ia_binary_data* pal);
 
     ia_err getCMC(cca::cca_cmc* cmc, const cca::cca_cpf* cpf = nullptr);
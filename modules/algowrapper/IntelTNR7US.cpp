@@ -18,8 +18,10 @@
 
 #include "modules/algowrapper/IntelTNR7US.h"
 
+#ifdef TNR7_CM
 #include <base/functional/bind.h>
 #include <base/threading/thread.h>
+#endif
 
 #include <string>
 
@@ -35,6 +37,7 @@ IntelTNR7US* IntelTNR7US::createIntelTNR(int cameraId) {
 #ifdef TNR7_CM
     return new IntelC4mTNR(cameraId);
 #endif
+    return nullptr;
 }
 
 Tnr7Param* IntelTNR7US::allocTnr7ParamBuf() {
@@ -16,7 +16,6 @@
 
 #pragma once
 
-#include <base/threading/thread.h>
 #include <pthread.h>
 
 #include <memory>
@@ -30,6 +29,8 @@ extern "C" {
 #include "TNRCommon.h"
 
 #ifdef TNR7_CM
+#include <base/threading/thread.h>
+
 /* the cm_rt.h has some build error with current clang build flags
  * use the ignored setting to ignore these errors, and use
  * push/pop to make the ignore only take effect on this file */
@@ -19,7 +19,13 @@
 #include "modules/algowrapper/graph/GraphConfigImpl.h"
 
 #include <GCSSParser.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <graph_query_manager.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <unordered_map>
@@ -42,13 +48,13 @@ namespace icamera {
 
 Mutex GraphConfigImpl::sLock;
 std::unordered_map<int32_t, GraphConfigNodes*> GraphConfigImpl::mGraphNode;
+std::unordered_map<uint64_t, std::weak_ptr<GCSS::IGraphConfig>> GraphConfigImpl::sGraphTrees;
+std::unordered_set<uint64_t> GraphConfigImpl::sParsingTrees;
+Condition GraphConfigImpl::sTreeParsedCondition;
 
-GraphConfigNodes::GraphConfigNodes() : mDesc(nullptr), mSettings(nullptr) {}
+GraphConfigNodes::GraphConfigNodes() {}
 
-GraphConfigNodes::~GraphConfigNodes() {
-    delete mDesc;
-    delete mSettings;
-}
+GraphConfigNodes::~GraphConfigNodes() {}
 
 GraphConfigImpl::GraphConfigImpl()
         : mCameraId(-1),
@@ -71,8 +77,8 @@ GraphConfigImpl::GraphConfigImpl(int32_t camId, ConfigMode mode, GraphSettingTyp
     CheckAndLogError(!nodes, VOID_VALUE, "Failed to allocate Graph Query Manager");
 
     mGraphQueryManager = std::unique_ptr<GCSS::GraphQueryManager>(new GraphQueryManager());
-    mGraphQueryManager->setGraphDescriptor(nodes->mDesc);
-    mGraphQueryManager->setGraphSettings(nodes->mSettings);
+    mGraphQueryManager->setGraphDescriptor(nodes->mDesc.get());
+    mGraphQueryManager->setGraphSettings(nodes->mSettings.get());
 }
 
 GraphConfigImpl::~GraphConfigImpl() {}
@@ -105,6 +111,88 @@ void GraphConfigImpl::addCustomKeyMap() {
     ItemUID::addCustomKeyMap(CUSTOM_GRAPH_KEYS);
 }
 
+/**
+ * FNV-1a hash of the xml content, used as the key of the parsed graph tree cache.
+ */
+static uint64_t graphContentHash(const char* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 0x100000001b3ULL;
+    }
+    // Mix the size in to make collisions between different files even less likely
+    return hash ^ (static_cast<uint64_t>(size) << 32);
+}
+
+/**
+ * Get the GCSS tree of the xml data, parse it only if the same content isn't parsed yet.
+ *
+ * All cameras use the same graph descriptor, and the sensors of the same model use
+ * the same graph settings, so each distinct xml is parsed once per process and the
+ * read-only tree is shared by the GraphConfigNodes of these cameras.
+ */
+std::shared_ptr<GCSS::IGraphConfig> GraphConfigImpl::getGraphTree(char* data, size_t size) {
+    uint64_t hash = graphContentHash(data, size);
+
+    ConditionLock lock(sLock);
+    while (true) {
+        auto it = sGraphTrees.find(hash);
+        if (it != sGraphTrees.end()) {
+            std::shared_ptr<GCSS::IGraphConfig> tree = it->second.lock();
+            if (tree) {
+                LOG2("Reuse the parsed graph tree, hash 0x%lx, size %zu", hash, size);
+                return tree;
+            }
+        }
+        // Wait for the thread which is parsing the same xml instead of parsing it again
+        if (sParsingTrees.find(hash) == sParsingTrees.end()) break;
+        sTreeParsedCondition.wait(lock);
+    }
+    sParsingTrees.insert(hash);
+    lock.unlock();
+
+    // The parsing takes long for the big graph descriptor, don't block other cameras
+    GCSSParser parser;
+    GCSS::IGraphConfig* node = nullptr;
+    parser.parseGCSSXmlData(data, size, &node);
+
+    lock.lock();
+    sParsingTrees.erase(hash);
+    sTreeParsedCondition.broadcast();
+    CheckAndLogError(!node, nullptr, "Failed to parse graph xml addr: %p, size: %zu", data, size);
+
+    std::shared_ptr<GCSS::IGraphConfig> tree(node);
+    sGraphTrees[hash] = tree;
+    return tree;
+}
+
+/**
+ * Map the xml file and get its GCSS tree from getGraphTree().
+ */
+std::shared_ptr<GCSS::IGraphConfig> GraphConfigImpl::getGraphTree(const char* fileName) {
+    int fd = ::open(fileName, O_RDONLY);
+    CheckAndLogError(fd < 0, nullptr, "Failed to open %s, error %s", fileName, strerror(errno));
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+        LOGE("Invalid graph file %s", fileName);
+        ::close(fd);
+        return nullptr;
+    }
+
+    size_t size = st.st_size;
+    // Private writable mapping since the parser API takes non-const data
+    void* addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    CheckAndLogError(addr == MAP_FAILED, nullptr, "Failed to mmap %s, error %s", fileName,
+                     strerror(errno));
+
+    std::shared_ptr<GCSS::IGraphConfig> tree = getGraphTree(static_cast<char*>(addr), size);
+    ::munmap(addr, size);
+
+    return tree;
+}
+
 /**
  * Method to parse the XML graph configurations and settings
  *
@@ -127,18 +215,17 @@ status_t GraphConfigImpl::parse(int cameraId, const char* graphDescFile, const c
         }
     }
 
-    GCSSParser parser;
     GraphConfigNodes* nodes = new GraphConfigNodes;
     LOG2("<id%d>, Start to parse graph config file", cameraId);
 
-    parser.parseGCSSXmlFile(graphDescFile, &nodes->mDesc);
+    nodes->mDesc = getGraphTree(graphDescFile);
     if (!nodes->mDesc) {
         LOGE("Failed to parse graph descriptor from %s", graphDescFile);
         delete nodes;
         return UNKNOWN_ERROR;
     }
 
-    parser.parseGCSSXmlFile(settingsFile, &nodes->mSettings);
+    nodes->mSettings = getGraphTree(settingsFile);
     if (!nodes->mSettings) {
         LOGE("Failed to parse graph settings from %s", settingsFile);
         delete nodes;
@@ -176,18 +263,17 @@ status_t GraphConfigImpl::parse(int cameraId, char* graphDescData, size_t descDa
         }
     }
 
-    GCSSParser parser;
     GraphConfigNodes* nodes = new GraphConfigNodes;
     LOG2("<id%d>, Start to parse graph config data", cameraId);
 
-    parser.parseGCSSXmlData(graphDescData, descDataSize, &nodes->mDesc);
+    nodes->mDesc = getGraphTree(graphDescData, descDataSize);
     if (!nodes->mDesc) {
         LOGE("Failed to parse graph descriptor addr: %p, size: %zu", graphDescData, descDataSize);
         delete nodes;
         return UNKNOWN_ERROR;
     }
 
-    parser.parseGCSSXmlData(settingsData, settingsDataSize, &nodes->mSettings);
+    nodes->mSettings = getGraphTree(settingsData, settingsDataSize);
     if (!nodes->mSettings) {
         LOGE("Failed to parse graph settings addr: %p, size: %zu", settingsData, settingsDataSize);
         delete nodes;
@@ -210,6 +296,7 @@ void GraphConfigImpl::releaseGraphNodes() {
         delete nodes.second;
     }
     mGraphNode.clear();
+    sGraphTrees.clear();
 }
 
 /**
@@ -22,6 +22,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -50,6 +51,7 @@ enum AndroidGraphConfigKey {
 
 /**
  * Static data for graph settings for given sensor. Used to initialize GraphConfigImpl.
+ * The trees may be shared with other cameras which use the same xml files.
  */
 class GraphConfigNodes {
  public:
@@ -57,8 +59,8 @@ class GraphConfigNodes {
     ~GraphConfigNodes();
 
  public:
-    GCSS::IGraphConfig* mDesc;
-    GCSS::IGraphConfig* mSettings;
+    std::shared_ptr<GCSS::IGraphConfig> mDesc;
+    std::shared_ptr<GCSS::IGraphConfig> mSettings;
 
  private:
     // Disable copy constructor and assignment operator
@@ -135,9 +137,17 @@ class GraphConfigImpl {
     // Debug helper
     void dumpQuery(int useCase, const std::map<GCSS::ItemUID, std::string>& query);
 
+    static std::shared_ptr<GCSS::IGraphConfig> getGraphTree(const char* fileName);
+    static std::shared_ptr<GCSS::IGraphConfig> getGraphTree(char* data, size_t size);
+
  private:
     static Mutex sLock;
     static std::unordered_map<int32_t, GraphConfigNodes*> mGraphNode;
+    // Parsed GCSS trees keyed by xml content hash, shared by GraphConfigNodes
+    static std::unordered_map<uint64_t, std::weak_ptr<GCSS::IGraphConfig>> sGraphTrees;
+    // The hashes of the trees being parsed without sLock, and their completion
+    static std::unordered_set<uint64_t> sParsingTrees;
+    static Condition sTreeParsedCondition;
     /**
      * Pair of ItemUIDs to store the width and height of a stream
      * first item is for width, second for height
@@ -38,7 +38,13 @@ class Context : public MemoryOper {
     Result migrate(MemoryDesc* mem) final;
     Result getMemory(MemoryDesc* mem, MemoryDesc* out) final;
     Result destroy(MemoryDesc* mem) final;
-    Result doIoctl(int request, void* ptr);
+    // The ioctls go through SysCall, so the PSys can be replaced, e.g. by the virtual IPU
+    Result doIoctl(int request, struct ipu_psys_capability* arg);
+    Result doIoctl(int request, struct ipu_psys_manifest* arg);
+    Result doIoctl(int request, struct ipu_psys_buffer* arg);
+    Result doIoctl(int request, struct ipu_psys_command* arg);
+    Result doIoctl(int request, struct ipu_psys_event* arg);
+    Result doIoctl(int request, int arg);
     ContextPoller getPoller(int event, int timeout);
 
  private:
@@ -49,6 +55,7 @@ class Context : public MemoryOper {
     Result registerBuffer(MemoryDesc* mem);
     Result unregisterBuffer(MemoryDesc* mem);
     static Result psysClose(int fd);
+    static Result toResult(int ioctlRet);
 
     DISALLOW_COPY_AND_ASSIGN(Context);
 };
@@ -191,7 +191,7 @@ Result Command::grokBuffers(const PSysCommandConfig& cfg) {
 Result Command::enqueue(Context* ctx) {
     CheckAndLogError(!ctx, Result::InvaildArg, "Context is nullptr");
 
-    return ctx->doIoctl(static_cast<int>(IPU_IOC_QCMD), mCmd);
+    return ctx->doIoctl(static_cast<int>(IPU_IOC_QCMD), &mCmd->iocCmd);
 }
 
 }  // namespace CIPR
@@ -35,6 +35,7 @@ using icamera::CAMERA_DEBUG_LOG_WARNING;
 
 #include "modules/ia_cipr/include/Context.h"
 #include "modules/ia_cipr/include/ipu-psys.h"
+#include "v4l2/SysCall.h"
 
 const char* DRIVER_NAME = "/dev/ipu-psys0";
 
@@ -97,7 +98,7 @@ Result Context::destroy(MemoryDesc* mem) {
 Context::Context() {
     mInitialized = false;
 
-    mFd = open(DRIVER_NAME, 0, O_RDWR | O_NONBLOCK);
+    mFd = SysCall::getInstance()->open(DRIVER_NAME, O_RDWR | O_NONBLOCK);
     CheckAndLogError(mFd < 0, VOID_VALUE, "Failed to open PSYS, error: %s", strerror(errno));
 
     mInitialized = true;
@@ -106,7 +107,7 @@ Context::Context() {
 Context::~Context() {
     if (!mInitialized) return;
 
-    int rv = ::close(mFd);
+    int rv = SysCall::getInstance()->close(mFd);
     CheckAndLogError(rv < 0, VOID_VALUE, "Close returned error: %s", strerror(errno));
 }
 
@@ -148,13 +149,32 @@ Result Context::getManifest(uint32_t index, uint32_t* mainfestSize, void* manife
     return Result::OK;
 }
 
-Result Context::doIoctl(int request, void* ptr) {
-#ifdef ANDROID
-    int res = ::ioctl(mFd, request, ptr);
-#else
-    int res = ::ioctl(mFd, (unsigned int)request, ptr);
-#endif
-    if (res < 0) {
+Result Context::doIoctl(int request, struct ipu_psys_capability* arg) {
+    return toResult(SysCall::getInstance()->ioctl(mFd, request, arg));
+}
+
+Result Context::doIoctl(int request, struct ipu_psys_manifest* arg) {
+    return toResult(SysCall::getInstance()->ioctl(mFd, request, arg));
+}
+
+Result Context::doIoctl(int request, struct ipu_psys_buffer* arg) {
+    return toResult(SysCall::getInstance()->ioctl(mFd, request, arg));
+}
+
+Result Context::doIoctl(int request, struct ipu_psys_command* arg) {
+    return toResult(SysCall::getInstance()->ioctl(mFd, request, arg));
+}
+
+Result Context::doIoctl(int request, struct ipu_psys_event* arg) {
+    return toResult(SysCall::getInstance()->ioctl(mFd, request, arg));
+}
+
+Result Context::doIoctl(int request, int arg) {
+    return toResult(SysCall::getInstance()->ioctl(mFd, request, arg));
+}
+
+Result Context::toResult(int ioctlRet) {
+    if (ioctlRet < 0) {
         int errnoCopy = errno;
         // Some are not real errors, so don't print error here
         LOG2("Ioctl returned error: %s", strerror(errnoCopy));
@@ -218,8 +238,7 @@ Result Context::registerBuffer(MemoryDesc* mem) {
     }
 #endif
 
-    res = doIoctl(static_cast<int>(IPU_IOC_MAPBUF),
-                  reinterpret_cast<void*>((intptr_t)ioc_buffer->base.fd));
+    res = doIoctl(static_cast<int>(IPU_IOC_MAPBUF), ioc_buffer->base.fd);
 
     if (res != Result::OK) {
         CIPR::freeMemory(ioc_buffer);
@@ -246,8 +265,7 @@ Result Context::unregisterBuffer(MemoryDesc* mem) {
     CheckAndLogError(!(ioc_buffer->flags & IPU_BUFFER_FLAG_DMA_HANDLE), Result::GeneralError,
                      "Wrong flag and not a DMA handle");
 
-    Result res = doIoctl(static_cast<int>(IPU_IOC_UNMAPBUF),
-                         reinterpret_cast<void*>((intptr_t)ioc_buffer->base.fd));
+    Result res = doIoctl(static_cast<int>(IPU_IOC_UNMAPBUF), ioc_buffer->base.fd);
     if (res != Result::OK) {
         LOG2("%s: cannot unmap buffer fd %d, possibly already unmapped", __func__,
              ioc_buffer->base.fd);
@@ -265,7 +283,7 @@ Result Context::unregisterBuffer(MemoryDesc* mem) {
 }
 
 Result Context::psysClose(int fd) {
-    int res = close(fd);
+    int res = SysCall::getInstance()->close(fd);
     if (res < 0) {
         int errnoCopy = errno;
 
@@ -298,7 +316,7 @@ int ContextPoller::poll() {
     fds.fd = mFd;
     fds.events = mEvents;
 
-    return ::poll(&fds, 1, mTimeout);
+    return SysCall::getInstance()->poll(&fds, 1, mTimeout);
 }
 
 }  // namespace CIPR
@@ -94,7 +94,7 @@ Result Event::wait(Context* ctx) {
     auto poller = ctx->getPoller(POLLIN | POLLHUP | POLLERR, mEvent->timeout);
     int res = poller.poll();
     if (res == 1) {
-        return ctx->doIoctl(static_cast<int>(IPU_IOC_DQEVENT), mEvent);
+        return ctx->doIoctl(static_cast<int>(IPU_IOC_DQEVENT), &mEvent->event);
     } else if (res == 0) {
         return Result::TimeOut;
     }
@@ -20,6 +20,7 @@
 #include <string>
 
 namespace icamera {
+
 const char* IntelAlgoIpcCmdToString(IPC_CMD cmd) {
     static const char* gIpcCmdMapping[] = {
         "IPC_FD_INIT", "IPC_FD_RUN", "IPC_FD_DEINIT", "IPC_GRAPH_ADD_KEY", "IPC_GRAPH_PARSE",
@@ -16,11 +16,14 @@
 
 #pragma once
 
+#include <stdint.h>
+
 #include <ia_aiq_types.h>
 #include <ia_cmc_types.h>
 #include <ia_types.h>
 
 #include "iutils/Errors.h"
+#include "modules/sandboxing/IPCShmRef.h"
 
 namespace icamera {
 #define IPC_MATCHING_KEY 0x56  // the value is randomly chosen
@@ -85,6 +88,17 @@ struct ia_binary_data_mod {
     char data[MAX_IA_BINARY_DATA_SIZE];
 };
 
+/*
+ * The request id is made of the command in the low bits and a sequence in the high bits,
+ * so the requests of the same command can be in flight at the same time.
+ */
+#define IPC_REQ_ID_CMD_BITS 16
+#define IPC_REQ_ID_CMD_MASK ((1U << IPC_REQ_ID_CMD_BITS) - 1)
+
+inline IPC_CMD IntelAlgoIpcReqIdToCmd(uint32_t reqId) {
+    return static_cast<IPC_CMD>(reqId & IPC_REQ_ID_CMD_MASK);
+}
+
 const char* IntelAlgoIpcCmdToString(IPC_CMD cmd);
 
 enum IPC_GROUP {
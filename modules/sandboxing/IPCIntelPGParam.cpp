@@ -338,89 +338,82 @@ bool IPCIntelPGParam::assignPayloads(void* pData, int dataSize, int payloadCount
     return true;
 }
 
+bool IPCIntelPGParam::getPayloadRegion(void* pData, int dataSize, ipc_shm_region* region) {
+    CheckAndLogError(!pData || !region || dataSize < sizeof(pg_param_register_payloads_params),
+                     false, "@%s, Wrong parameters, pData: %p, region: %p, dataSize: %d",
+                     __func__, pData, region, dataSize);
+
+    region->addr = reinterpret_cast<uintptr_t>(pData);
+    region->size = dataSize - sizeof(pg_param_register_payloads_params);
+    return true;
+}
+
 bool IPCIntelPGParam::clientFlattenRegisterPayloads(void* pData, int dataSize, uintptr_t client,
-                                                    int payloadCount,
-                                                    const ia_binary_data* payloads) {
-    CheckAndLogError(!pData || !payloads || dataSize < sizeof(pg_param_register_payloads_params) ||
-                         payloadCount > IPU_MAX_TERMINAL_COUNT,
-                     false,
-                     "@%s, Wrong parameters, pData: %p, payloads: %p, dataSize: %d, count: %d",
-                     __func__, pData, payloads, dataSize, payloadCount);
+                                                    int32_t region) {
+    CheckAndLogError(!pData || dataSize < sizeof(pg_param_register_payloads_params), false,
+                     "@%s, Wrong parameters, pData: %p, dataSize: %d", __func__, pData, dataSize);
 
     uintptr_t paramAddr =
         reinterpret_cast<uintptr_t>(pData) + dataSize - sizeof(pg_param_register_payloads_params);
     pg_param_register_payloads_params* params =
         reinterpret_cast<pg_param_register_payloads_params*>(paramAddr);
     params->client = client;
-    params->payloadCount = payloadCount;
-    MEMCPY_S(params->cPayloads, sizeof(params->cPayloads), payloads,
-             sizeof(ia_binary_data) * payloadCount);
-    getPayloadOffsets(pData, dataSize, payloadCount, payloads, params->payloadOffsets);
+    params->region = region;
     return true;
 }
 
 bool IPCIntelPGParam::serverUnflattenRegisterPayloads(void* pData, int dataSize, uintptr_t* client,
-                                                      int* payloadCount, ia_binary_data** cPayloads,
-                                                      ia_binary_data** sPayloads) {
-    CheckAndLogError(!pData || !client || !payloadCount || !cPayloads || !sPayloads ||
+                                                      int32_t* region) {
+    CheckAndLogError(!pData || !client || !region ||
                          dataSize < sizeof(pg_param_register_payloads_params),
-                     false,
-                     "@%s, Wrong parameters, pData: %p, client: %p, payloadCount: %p, "
-                     "cPayloads: %p, sPayloads: %p, dataSize: %d",
-                     __func__, pData, client, payloadCount, cPayloads, sPayloads, dataSize);
+                     false, "@%s, Wrong parameters, pData: %p, client: %p, region: %p, size: %d",
+                     __func__, pData, client, region, dataSize);
 
     uintptr_t paramAddr =
         reinterpret_cast<uintptr_t>(pData) + dataSize - sizeof(pg_param_register_payloads_params);
     pg_param_register_payloads_params* params =
         reinterpret_cast<pg_param_register_payloads_params*>(paramAddr);
     *client = params->client;
-    MEMCPY_S(params->sPayloads, sizeof(params->sPayloads), params->cPayloads,
-             sizeof(params->cPayloads));  // save size to sPayloads
-    *payloadCount = params->payloadCount;
-    getPayloadData(pData, dataSize, *payloadCount, params->payloadOffsets, params->sPayloads);
-    *cPayloads = params->cPayloads;
-    *sPayloads = params->sPayloads;
+    *region = params->region;
     return true;
 }
 
-bool IPCIntelPGParam::getPayloadOffsets(const void* pData, int dataSize, int payloadCount,
-                                        const ia_binary_data* payloads, int32_t* payloadOffsets) {
-    CheckAndLogError(!pData || !payloads || !payloadOffsets, false,
-                     "@%s, pData: %p, payloads: %p, payloadOffsets: %p is nullptr", __func__, pData,
-                     payloads);
-
-    uintptr_t startAddr = reinterpret_cast<uintptr_t>(pData);
+bool IPCIntelPGParam::flattenPayloadRefs(int32_t payloadCount, const ia_binary_data* payloads,
+                                         const ipc_shm_region* regions, int regionCount,
+                                         ipc_shm_ref* refs) {
     for (int i = 0; i < payloadCount; i++) {
-        if (payloads[i].size <= 0) continue;
-
-        int32_t offset = reinterpret_cast<uintptr_t>(payloads[i].data) - startAddr;
-        CheckAndLogError((offset > (dataSize - payloads[i].size) || offset < 0), false,
-                         "@%s, error offset %d", __func__, offset);
-        payloadOffsets[i] = offset;
+        bool ret = ipcShmRefFromAddr(regions, regionCount, payloads[i].data, payloads[i].size,
+                                     &refs[i]);
+        CheckAndLogError(!ret, false, "@%s, payload %p of term %d isn't registered", __func__,
+                         payloads[i].data, i);
     }
-    return 0;
+    return true;
 }
 
-bool IPCIntelPGParam::getPayloadData(void* pData, int dataSize, int payloadCount,
-                                     const int32_t* payloadOffsets, ia_binary_data* payloads) {
-    CheckAndLogError(!pData || !payloads || !payloadOffsets, false,
-                     "@%s, pData: %p, payloads: %p, payloadOffsets: %p is nullptr", __func__, pData,
-                     payloads, payloadOffsets);
+bool IPCIntelPGParam::serverResolvePayloads(int32_t payloadCount, const ipc_shm_ref* refs,
+                                            const ipc_shm_region* regions, int regionCount,
+                                            ia_binary_data* payloads) {
+    CheckAndLogError(!refs || !payloads || payloadCount > IPU_MAX_TERMINAL_COUNT, false,
+                     "@%s, Wrong parameters, refs: %p, payloads: %p, count: %d", __func__, refs,
+                     payloads, payloadCount);
 
-    unsigned char* startAddr = reinterpret_cast<unsigned char*>(pData);
     for (int i = 0; i < payloadCount; i++) {
-        if (payloads[i].size <= 0) continue;
+        payloads[i].size = refs[i].size;
+        payloads[i].data = nullptr;
+        if (refs[i].region < 0) continue;
 
-        CheckAndLogError(payloadOffsets[i] > dataSize - payloads[i].size, false,
-                         "@%s, error offset %d", __func__, payloadOffsets[i]);
-        payloads[i].data = startAddr + payloadOffsets[i];
+        payloads[i].data = ipcShmRefToAddr(regions, regionCount, refs[i]);
+        CheckAndLogError(!payloads[i].data, false,
+                         "@%s, invalid payload ref of term %d, region %d, offset %u, size %u",
+                         __func__, i, refs[i].region, refs[i].offset, refs[i].size);
     }
     return true;
 }
 
 bool IPCIntelPGParam::clientFlattenEncode(void* pData, int dataSize, uintptr_t client,
                                           unsigned int ipuParamSize, int32_t ipuParamHandle,
-                                          int32_t payloadCount, const ia_binary_data* payloads) {
+                                          int32_t payloadCount, const ia_binary_data* payloads,
+                                          const ipc_shm_region* regions, int regionCount) {
     CheckAndLogError(!pData || !payloads || dataSize < sizeof(pg_param_encode_params) ||
                          payloadCount > IPU_MAX_TERMINAL_COUNT,
                      false,
@@ -432,14 +425,12 @@ bool IPCIntelPGParam::clientFlattenEncode(void* pData, int dataSize, uintptr_t c
     params->ipuParamSize = ipuParamSize;
     params->ipuParamHandle = ipuParamHandle;
     params->payloadCount = payloadCount;
-    MEMCPY_S(params->payloads, sizeof(params->payloads), payloads,
-             sizeof(ia_binary_data) * payloadCount);
-    return true;
+    return flattenPayloadRefs(payloadCount, payloads, regions, regionCount, params->payloads);
 }
 
 bool IPCIntelPGParam::serverUnflattenEncode(void* pData, int dataSize, uintptr_t* client,
                                             void* palDataAddr, ia_binary_data* ipuParameters,
-                                            int32_t* payloadCount, ia_binary_data** payloads) {
+                                            int32_t* payloadCount, ipc_shm_ref** payloads) {
     CheckAndLogError(!pData || !client || !ipuParameters || !palDataAddr || !payloadCount ||
                          !payloads || dataSize < sizeof(pg_param_encode_params),
                      false,
@@ -459,6 +450,7 @@ bool IPCIntelPGParam::serverUnflattenEncode(void* pData, int dataSize, uintptr_t
 
 bool IPCIntelPGParam::clientFlattenDecode(void* pData, int dataSize, uintptr_t client,
                                           int32_t payloadCount, const ia_binary_data* payloads,
+                                          const ipc_shm_region* regions, int regionCount,
                                           int32_t statsHandle) {
     CheckAndLogError(!pData || !payloads || dataSize < sizeof(pg_param_decode_params) ||
                          payloadCount > IPU_MAX_TERMINAL_COUNT,
@@ -469,14 +461,12 @@ bool IPCIntelPGParam::clientFlattenDecode(void* pData, int dataSize, uintptr_t c
     pg_param_decode_params* params = static_cast<pg_param_decode_params*>(pData);
     params->client = client;
     params->payloadCount = payloadCount;
-    MEMCPY_S(params->payloads, sizeof(params->payloads), payloads,
-             sizeof(ia_binary_data) * payloadCount);
     params->clientStatsHandle = statsHandle;
-    return true;
+    return flattenPayloadRefs(payloadCount, payloads, regions, regionCount, params->payloads);
 }
 
 bool IPCIntelPGParam::serverUnflattenDecode(void* pData, int dataSize, uintptr_t* client,
-                                            int32_t* payloadCount, ia_binary_data** payloads) {
+                                            int32_t* payloadCount, ipc_shm_ref** payloads) {
     CheckAndLogError(!pData || !client || !payloadCount || !payloads ||
                          dataSize < sizeof(pg_param_decode_params),
                      false,
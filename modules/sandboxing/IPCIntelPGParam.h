@@ -29,6 +29,7 @@ namespace icamera {
 #define MAX_PROCESS_GROUP_SIZE 8192
 #define MAX_PAL_SIZE 0x800000  // 8M
 #define MAX_STATISTICS_SIZE MAX_IA_BINARY_DATA_SIZE
+#define IPC_MAX_PAYLOAD_REGIONS 32
 
 struct pg_param_init_params {
     int pgId;
@@ -78,13 +79,10 @@ struct pg_param_prepare_program_params {
 
 // Shared memory: payloads + struct
 // as payload memory addr should be page size aligned
+// The payloads are referred by offset in the region at encoding and decoding
 struct pg_param_register_payloads_params {
     uintptr_t client;
-    int payloadCount;
-    ia_binary_data cPayloads[IPU_MAX_TERMINAL_COUNT];  // save payloads of client
-    ia_binary_data sPayloads[IPU_MAX_TERMINAL_COUNT];  // save payloads of server
-
-    int32_t payloadOffsets[IPU_MAX_TERMINAL_COUNT];
+    int32_t region;  // index in the payload regions of the client
 };
 
 struct pg_param_encode_params {
@@ -92,13 +90,13 @@ struct pg_param_encode_params {
     uint32_t ipuParamSize;
     int32_t ipuParamHandle;
     int32_t payloadCount;
-    ia_binary_data payloads[IPU_MAX_TERMINAL_COUNT];  // save payloads of client
+    ipc_shm_ref payloads[IPU_MAX_TERMINAL_COUNT];
 };
 
 struct pg_param_decode_params {
     uintptr_t client;
     int32_t payloadCount;
-    ia_binary_data payloads[IPU_MAX_TERMINAL_COUNT];  // save payloads of client
+    ipc_shm_ref payloads[IPU_MAX_TERMINAL_COUNT];
     int32_t clientStatsHandle;
 
     // Output
@@ -154,23 +152,31 @@ class IPCIntelPGParam {
 
     int getTotalPayloadSize(int payloadCount, const ia_binary_data* payloads);
     bool assignPayloads(void* pData, int dataSize, int payloadCount, ia_binary_data* payloads);
+    // The payloads are at the beginning of the shared memory, followed by the params
+    bool getPayloadRegion(void* pData, int dataSize, ipc_shm_region* region);
     bool clientFlattenRegisterPayloads(void* pData, int dataSize, uintptr_t client,
-                                       int payloadCount, const ia_binary_data* payloads);
+                                       int32_t region);
     bool serverUnflattenRegisterPayloads(void* pData, int dataSize, uintptr_t* client,
-                                         int* payloadCount, ia_binary_data** cPayloads,
-                                         ia_binary_data** sPayloads);
+                                         int32_t* region);
 
     bool clientFlattenEncode(void* pData, int dataSize, uintptr_t client, unsigned int ipuParamSize,
                              int32_t ipuParamHandle, int32_t payloadCount,
-                             const ia_binary_data* payloads);
+                             const ia_binary_data* payloads, const ipc_shm_region* regions,
+                             int regionCount);
     bool serverUnflattenEncode(void* pData, int dataSize, uintptr_t* client, void* palDataAddr,
                                ia_binary_data* ipuParameters, int32_t* payloadCount,
-                               ia_binary_data** payloads);
+                               ipc_shm_ref** payloads);
 
     bool clientFlattenDecode(void* pData, int dataSize, uintptr_t client, int32_t payloadCount,
-                             const ia_binary_data* payloads, int32_t statsHandle);
+                             const ia_binary_data* payloads, const ipc_shm_region* regions,
+                             int regionCount, int32_t statsHandle);
     bool serverUnflattenDecode(void* pData, int dataSize, uintptr_t* client, int32_t* payloadCount,
-                               ia_binary_data** payloads);
+                               ipc_shm_ref** payloads);
+
+    // Get the payloads in the server regions from the references
+    bool serverResolvePayloads(int32_t payloadCount, const ipc_shm_ref* refs,
+                               const ipc_shm_region* regions, int regionCount,
+                               ia_binary_data* payloads);
     bool serverFlattenDecode(void* pData, int dataSize, const ia_binary_data& statistics);
     bool clientUnflattenDecode(void* pData, int dataSize, ia_binary_data* statistics);
 
@@ -178,10 +184,8 @@ class IPCIntelPGParam {
     bool serverUnflattenDeinit(const void* pData, int dataSize, uintptr_t* client);
 
  private:
-    bool getPayloadOffsets(const void* pData, int dataSize, int payloadCount,
-                           const ia_binary_data* payloads, int32_t* payloadOffsets);
-    bool getPayloadData(void* pData, int dataSize, int payloadCount, const int32_t* payloadOffsets,
-                        ia_binary_data* payloads);
+    bool flattenPayloadRefs(int32_t payloadCount, const ia_binary_data* payloads,
+                            const ipc_shm_region* regions, int regionCount, ipc_shm_ref* refs);
 };
 
 }  // namespace icamera
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "modules/sandboxing/IPCShmRef.h"
+
+namespace icamera {
+
+bool ipcShmRefFromAddr(const ipc_shm_region* regions, int regionCount, const void* data,
+                       uint32_t size, ipc_shm_ref* ref) {
+    if (!data || !size) {
+        ref->region = -1;
+        ref->offset = 0;
+        ref->size = 0;
+        return true;
+    }
+
+    uintptr_t addr = reinterpret_cast<uintptr_t>(data);
+    for (int i = 0; i < regionCount; i++) {
+        if (addr >= regions[i].addr && size <= regions[i].size &&
+            addr - regions[i].addr <= regions[i].size - size) {
+            ref->region = i;
+            ref->offset = addr - regions[i].addr;
+            ref->size = size;
+            return true;
+        }
+    }
+    return false;
+}
+
+void* ipcShmRefToAddr(const ipc_shm_region* regions, int regionCount, const ipc_shm_ref& ref) {
+    if (ref.region < 0 || ref.region >= regionCount) return nullptr;
+
+    const ipc_shm_region& region = regions[ref.region];
+    if (!region.addr || ref.size > region.size || ref.offset > region.size - ref.size) {
+        return nullptr;
+    }
+    return reinterpret_cast<void*>(region.addr + ref.offset);
+}
+
+}  // namespace icamera
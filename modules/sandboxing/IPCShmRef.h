@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace icamera {
+
+/*
+ * A shared memory region which is mapped at different addresses in the client and the server,
+ * both sides keep a table of the regions indexed in the order of registration.
+ */
+struct ipc_shm_region {
+    uintptr_t addr;
+    uint32_t size;
+};
+
+/*
+ * Position independent reference to the data in a registered region, which is used in place
+ * by both sides instead of the pointer of either side.
+ */
+struct ipc_shm_ref {
+    int32_t region;  // -1 for no data
+    uint32_t offset;
+    uint32_t size;
+};
+
+// Get the reference of the data, return false if it isn't in any of the regions
+bool ipcShmRefFromAddr(const ipc_shm_region* regions, int regionCount, const void* data,
+                       uint32_t size, ipc_shm_ref* ref);
+// Get the local address of the reference, nullptr if it's out of the region
+void* ipcShmRefToAddr(const ipc_shm_region* regions, int regionCount, const ipc_shm_ref& ref);
+
+}  // namespace icamera
@@ -35,6 +35,9 @@
 
 namespace icamera {
 
+static const size_t kMaxPooledShmPerSize = 4;
+static const int64_t kMaxPooledShmBytes = 64 * 1024 * 1024;
+
 IntelAlgoClient* IntelAlgoClient::sInstance = nullptr;
 Mutex IntelAlgoClient::sLock;
 
@@ -63,6 +66,7 @@ IntelAlgoClient::IntelAlgoClient()
         : mErrCb(nullptr),
           mGpuBridge(nullptr),
           mIPCStatus(true),
+          mPooledShmBytes(0),
           mMojoManagerToken(nullptr),
           mInitialized(false) {
     LOG1("%s, Construct", __func__);
@@ -70,6 +74,7 @@ IntelAlgoClient::IntelAlgoClient()
 
 IntelAlgoClient::~IntelAlgoClient() {
     LOG1("%s, Destroy", __func__);
+    clearShmPool();
 }
 
 int IntelAlgoClient::initialize() {
@@ -182,6 +187,78 @@ void IntelAlgoClient::releaseShmMem(const std::string& name, int size, int fd, v
     shm_unlink(name.c_str());
 }
 
+int IntelAlgoClient::acquireShmMem(const std::string& name, int size, ShmMemUsage usage, int* fd,
+                                   void** addr, int32_t* handle) {
+    CheckAndLogError(usage >= MAX_ALGO_SHM, UNKNOWN_ERROR, "usage: %d isn't supported", usage);
+    {
+        std::lock_guard<std::mutex> l(mShmPoolMutex);
+        auto it = mShmPool[usage].find(size);
+        if (it != mShmPool[usage].end() && !it->second.empty()) {
+            PooledShm shm = it->second.back();
+            it->second.pop_back();
+            mPooledShmBytes -= size;
+
+            LOG2("%s, reuse %s, size: %d, handle: %d", __func__, name.c_str(), size, shm.handle);
+            memset(shm.addr, 0, size);
+            *fd = shm.fd;
+            *addr = shm.addr;
+            *handle = shm.handle;
+            return OK;
+        }
+    }
+
+    int ret = allocateShmMem(name, size, fd, addr);
+    CheckAndLogError(ret != OK, ret, "@%s, allocateShmMem fails, name: %s", __func__,
+                     name.c_str());
+
+    *handle = registerBuffer(*fd, *addr, usage);
+    if (*handle < 0) {
+        LOGE("@%s, registerBuffer fails, name: %s", __func__, name.c_str());
+        releaseShmMem(name, size, *fd, *addr);
+        return UNKNOWN_ERROR;
+    }
+
+    // The name isn't needed any more, and may be allocated again when it's pooled
+    shm_unlink(name.c_str());
+    return OK;
+}
+
+void IntelAlgoClient::recycleShmMem(const std::string& name, int size, int fd, void* addr,
+                                    int32_t handle, ShmMemUsage usage) {
+    CheckAndLogError(usage >= MAX_ALGO_SHM, VOID_VALUE, "usage: %d isn't supported", usage);
+
+    if (isIPCFine()) {
+        std::lock_guard<std::mutex> l(mShmPoolMutex);
+        std::vector<PooledShm>& shms = mShmPool[usage][size];
+        if (shms.size() < kMaxPooledShmPerSize && mPooledShmBytes + size <= kMaxPooledShmBytes) {
+            LOG2("%s, pool %s, size: %d, handle: %d", __func__, name.c_str(), size, handle);
+            shms.push_back({fd, addr, handle});
+            mPooledShmBytes += size;
+            return;
+        }
+    }
+
+    // The name was unlinked in acquireShmMem()
+    deregisterBuffer(handle, usage);
+    munmap(addr, size);
+    close(fd);
+}
+
+void IntelAlgoClient::clearShmPool() {
+    std::lock_guard<std::mutex> l(mShmPoolMutex);
+    for (int usage = 0; usage < MAX_ALGO_SHM; usage++) {
+        for (auto& item : mShmPool[usage]) {
+            for (auto& shm : item.second) {
+                if (mInitialized) deregisterBuffer(shm.handle, static_cast<ShmMemUsage>(usage));
+                munmap(shm.addr, item.first);
+                close(shm.fd);
+            }
+        }
+        mShmPool[usage].clear();
+    }
+    mPooledShmBytes = 0;
+}
+
 int IntelAlgoClient::requestSync(IPC_CMD cmd, int32_t bufferHandle) {
     LOG2("requestSync cmd:%d:%s, bufferHandle:%d, mInitialized:%d", cmd,
          IntelAlgoIpcCmdToString(cmd), bufferHandle, mInitialized);
@@ -197,6 +274,37 @@ int IntelAlgoClient::requestSync(IPC_CMD cmd) {
     return requestSync(cmd, -1);
 }
 
+int IntelAlgoClient::requestBatchSync(const std::vector<IpcRequest>& requests) {
+    LOG2("requestBatchSync %zu requests", requests.size());
+    CheckAndLogError(!mInitialized, UNKNOWN_ERROR, " mInitialized is false");
+    CheckAndLogError(!isIPCFine(), UNKNOWN_ERROR, "IPC error happens");
+
+    for (const auto& req : requests) {
+        IPC_GROUP group = IntelAlgoIpcCmdToGroup(req.cmd);
+        CheckAndLogError(!mRunner[group], UNKNOWN_ERROR, "no runner for cmd:%d", req.cmd);
+    }
+
+    int result = OK;
+    std::vector<uint32_t> reqIds;
+    reqIds.reserve(requests.size());
+    for (const auto& req : requests) {
+        IPC_GROUP group = IntelAlgoIpcCmdToGroup(req.cmd);
+        uint32_t reqId = 0;
+        result = mRunner[group]->sendRequest(req.cmd, req.bufferHandle, &reqId);
+        if (result != OK) break;
+        reqIds.push_back(reqId);
+    }
+
+    // Wait for all the sent ones even if one fails, since they are all in flight
+    for (size_t i = 0; i < reqIds.size(); i++) {
+        IPC_GROUP group = IntelAlgoIpcCmdToGroup(requests[i].cmd);
+        int ret = mRunner[group]->waitRequest(reqIds[i]);
+        if (ret != OK && ret != ia_err_not_run && result == OK) result = ret;
+    }
+
+    return result;
+}
+
 int32_t IntelAlgoClient::registerBuffer(int bufferFd, void* addr, ShmMemUsage usage) {
     LOG2("%s bufferFd: %d, mInitialized: %d, addr: %p, usage: %d", __func__, bufferFd, mInitialized,
          addr, usage);
@@ -286,8 +394,9 @@ int32_t IntelAlgoClient::getBufferHandle(void* addr, ShmMemUsage usage) {
 }
 
 void IntelAlgoClient::callbackHandler(uint32_t req_id, uint32_t status, int32_t buffer_handle) {
-    IPC_GROUP group = IntelAlgoIpcCmdToGroup(static_cast<IPC_CMD>(req_id));
-    mRunner[group]->callbackHandler(status, buffer_handle);
+    IPC_GROUP group = IntelAlgoIpcCmdToGroup(IntelAlgoIpcReqIdToCmd(req_id));
+    CheckAndLogError(!mRunner[group], VOID_VALUE, "no runner for req_id:0x%x", req_id);
+    mRunner[group]->callbackHandler(req_id, status, buffer_handle);
 }
 
 void IntelAlgoClient::notifyHandler(uint32_t msg) {
@@ -296,9 +405,19 @@ void IntelAlgoClient::notifyHandler(uint32_t msg) {
         return;
     }
 
-    std::lock_guard<std::mutex> l(mIPCStatusMutex);
-    mIPCStatus = false;
+    {
+        std::lock_guard<std::mutex> l(mIPCStatusMutex);
+        mIPCStatus = false;
+    }
+
+    // No callback will come for the requests in flight
+    for (int i = 0; i < IPC_GROUP_NUM; i++) {
+        if (mRunner[i]) mRunner[i]->abortRequests();
+    }
+    // The server doesn't hold the pooled shared memories any more
+    clearShmPool();
 
+    std::lock_guard<std::mutex> l(mIPCStatusMutex);
     if (mErrCb) {
         camera_msg_data_t data = {CAMERA_IPC_ERROR, {}};
         mErrCb->notify(mErrCb, data);
@@ -327,121 +446,121 @@ void IntelAlgoClient::notifyCallback(const struct camera_algorithm_callback_ops*
 IntelAlgoClient::Runner::Runner(IPC_GROUP group, cros::CameraAlgorithmBridge* bridge)
         : mGroup(group),
           mBridge(bridge),
-          mIsCallbacked(false),
-          mCbStatus(OK),
-          mInitialized(false) {
+          mSequence(0) {
     LOG1("Runner Construct group:%d", mGroup);
-
-    pthread_condattr_t attr;
-    int ret = pthread_condattr_init(&attr);
-    if (ret != 0) {
-        LOGE("call pthread_condattr_init fails, ret:%d", ret);
-        pthread_condattr_destroy(&attr);
-        return;
-    }
-
-    ret = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
-    if (ret != 0) {
-        LOGE("call pthread_condattr_setclock fails, ret:%d", ret);
-        pthread_condattr_destroy(&attr);
-        return;
-    }
-
-    ret = pthread_cond_init(&mCbCond, &attr);
-    if (ret != 0) {
-        LOGE("call pthread_cond_init fails, ret:%d", ret);
-        pthread_condattr_destroy(&attr);
-        return;
-    }
-
-    pthread_condattr_destroy(&attr);
-
-    ret = pthread_mutex_init(&mCbLock, nullptr);
-    CheckAndLogError(ret != 0, VOID_VALUE, "call pthread_mutex_init fails, ret:%d", ret);
-
-    mInitialized = true;
 }
 
 IntelAlgoClient::Runner::~Runner() {
     LOG1("Runner Destroy, group:%d", mGroup);
-
-    int ret = pthread_cond_destroy(&mCbCond);
-    if (ret != 0) {
-        LOGE("call pthread_cond_destroy fails, ret:%d", ret);
-    }
-
-    ret = pthread_mutex_destroy(&mCbLock);
-    if (ret != 0) {
-        LOGE("call pthread_mutex_destroy fails, ret:%d", ret);
-    }
+    abortRequests();
 }
 
 int IntelAlgoClient::Runner::requestSync(IPC_CMD cmd, int32_t bufferHandle) {
-    CheckAndLogError(!mInitialized, UNKNOWN_ERROR, "mInitialized is false, cmd:%d:%s", cmd,
-                     IntelAlgoIpcCmdToString(cmd));
+    uint32_t reqId = 0;
+    int ret = sendRequest(cmd, bufferHandle, &reqId);
+    CheckAndLogError(ret != OK, ret, "failed to send cmd:%d:%s", cmd, IntelAlgoIpcCmdToString(cmd));
+
+    ret = waitRequest(reqId);
+
+    // check callback result
+    CheckAndLogError((ret != OK && ret != ia_err_not_run), ret,
+                     "request fails, cmd:%d:%s, status:%d", cmd, IntelAlgoIpcCmdToString(cmd), ret);
+
+    return ret;
+}
 
-    std::lock_guard<std::mutex> lck(mMutex);
+int IntelAlgoClient::Runner::sendRequest(IPC_CMD cmd, int32_t bufferHandle, uint32_t* reqId) {
+    // The sequence in the high bits tells the requests of the same cmd apart
+    const uint32_t kSequenceCount = 1U << (32 - IPC_REQ_ID_CMD_BITS);
+    uint32_t id = 0;
+    {
+        AutoMutex l(mLock);
+        // The sequence wraps around, skip the ids of the requests which are in flight, not
+        // waited yet or timed out, otherwise their callbacks would be mixed up.
+        uint32_t tries = 0;
+        do {
+            id = (mSequence++ << IPC_REQ_ID_CMD_BITS) | (cmd & IPC_REQ_ID_CMD_MASK);
+        } while (mPendingRequests.find(id) != mPendingRequests.end() && ++tries < kSequenceCount);
+        CheckAndLogError(tries == kSequenceCount, UNKNOWN_ERROR,
+                         "group:%d, no free req id for cmd:%d", mGroup, cmd);
+        mPendingRequests[id] = {cmd, CameraUtils::systemTime(), false, false, OK};
+    }
 
     std::vector<uint8_t> reqHeader(IPC_REQUEST_HEADER_USED_NUM);
     reqHeader[0] = IPC_MATCHING_KEY;
 
-    // cmd is for request id, no duplicate command will be issued at any given time.
-    mBridge->Request(cmd, reqHeader, bufferHandle);
-    int ret = waitCallback();
-    CheckAndLogError((ret != OK), UNKNOWN_ERROR, "waitCallback fails, cmd:%d:%s", cmd,
-                     IntelAlgoIpcCmdToString(cmd));
+    // The bridge keeps the order of the requests, and the server runs a group in one thread
+    mBridge->Request(id, reqHeader, bufferHandle);
+    *reqId = id;
+    return OK;
+}
 
-    // check callback result
-    CheckAndLogError((mCbStatus != OK && mCbStatus != ia_err_not_run), mCbStatus,
-                     "callback fails, cmd:%d:%s, mCbStatus:%d", cmd, IntelAlgoIpcCmdToString(cmd),
-                     mCbStatus);
+int IntelAlgoClient::Runner::waitRequest(uint32_t reqId) {
+    ConditionLock lock(mLock);
+    auto it = mPendingRequests.find(reqId);
+    CheckAndLogError(it == mPendingRequests.end(), UNKNOWN_ERROR,
+                     "group:%d, req_id:0x%x isn't sent", mGroup, reqId);
+
+    const int64_t kWaitDuration = 5000000000LL;  // 5s timeout
+    // The condition is shared by all the requests of the group, so the wait is bounded by
+    // one deadline instead of restarting on each completion.
+    const int64_t deadline = CameraUtils::systemTime() + kWaitDuration;
+    while (!it->second.done) {
+        int64_t remaining = deadline - CameraUtils::systemTime();
+        if (remaining <= 0 ||
+            (mRequestDone.waitRelative(lock, remaining) == TIMED_OUT && !it->second.done)) {
+            LOGE("%s, group:%d, cmd:%d:%s times out, it takes %" PRId64 " ms", __func__, mGroup,
+                 it->second.cmd, IntelAlgoIpcCmdToString(it->second.cmd),
+                 (CameraUtils::systemTime() - it->second.startTime) / 1000000);
+            // Keep its id reserved until the late callback of it is dropped
+            it->second.timedOut = true;
+            return UNKNOWN_ERROR;
+        }
+    }
 
-    return mCbStatus;
+    int status = it->second.status;
+    LOG2("%s, group:%d, cmd:%d IPC call takes %" PRId64 " ms", __func__, mGroup, it->second.cmd,
+         (CameraUtils::systemTime() - it->second.startTime) / 1000000);
+    mPendingRequests.erase(it);
+
+    return status;
 }
 
-void IntelAlgoClient::Runner::callbackHandler(uint32_t status, int32_t buffer_handle) {
+void IntelAlgoClient::Runner::callbackHandler(uint32_t reqId, uint32_t status,
+                                              int32_t buffer_handle) {
     if (status != 0 && status != ia_err_not_run) {
-        LOGE("Runner callbackHandler group:%d, status:%d, buffer_handle:%d", mGroup, status,
-             buffer_handle);
+        LOGE("Runner callbackHandler group:%d, req_id:0x%x, status:%d, buffer_handle:%d", mGroup,
+             reqId, status, buffer_handle);
     }
-    mCbStatus = status;
 
-    pthread_mutex_lock(&mCbLock);
-    mIsCallbacked = true;
-    int ret = pthread_cond_signal(&mCbCond);
-    pthread_mutex_unlock(&mCbLock);
+    AutoMutex l(mLock);
+    auto it = mPendingRequests.find(reqId);
+    CheckAndLogError(it == mPendingRequests.end(), VOID_VALUE,
+                     "group:%d, req_id:0x%x isn't in flight", mGroup, reqId);
+    if (it->second.timedOut) {
+        LOGW("group:%d, drop the late callback of req_id:0x%x", mGroup, reqId);
+        mPendingRequests.erase(it);
+        return;
+    }
 
-    CheckAndLogError(ret != 0, VOID_VALUE, "group:%d, call pthread_cond_signal fails, ret:%d",
-                     mGroup, ret);
+    it->second.done = true;
+    it->second.status = status;
+    mRequestDone.broadcast();
 }
 
-int IntelAlgoClient::Runner::waitCallback() {
-    nsecs_t startTime = CameraUtils::systemTime();
-
-    pthread_mutex_lock(&mCbLock);
-    if (!mIsCallbacked) {
-        int ret = 0;
-        struct timespec ts = {0, 0};
-        clock_gettime(CLOCK_MONOTONIC, &ts);
-        ts.tv_sec += 5;  // 5s timeout
-
-        while (!mIsCallbacked && !ret) {
-            ret = pthread_cond_timedwait(&mCbCond, &mCbLock, &ts);
-        }
-        if (ret != 0) {
-            LOGE("%s, group:%d, call pthread_cond_timedwait fail, ret:%d, it takes %" PRId64 " ms",
-                 __func__, mGroup, ret, (CameraUtils::systemTime() - startTime) / 1000000);
-            pthread_mutex_unlock(&mCbLock);
-            return UNKNOWN_ERROR;
+void IntelAlgoClient::Runner::abortRequests() {
+    AutoMutex l(mLock);
+    for (auto it = mPendingRequests.begin(); it != mPendingRequests.end();) {
+        // No callback will come for the timed out ones
+        if (it->second.timedOut) {
+            it = mPendingRequests.erase(it);
+            continue;
         }
+        it->second.done = true;
+        it->second.status = UNKNOWN_ERROR;
+        ++it;
     }
-    mIsCallbacked = false;
-    pthread_mutex_unlock(&mCbLock);
-
-    LOG2("%s, group:%d IPC call takes %" PRId64 " ms", __func__, mGroup,
-         (CameraUtils::systemTime() - startTime) / 1000000);
-
-    return OK;
+    mRequestDone.broadcast();
 }
 
 } /* namespace icamera */
@@ -16,12 +16,12 @@
 
 #pragma once
 
-#include <pthread.h>
-
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "CameraLog.h"
 #include "Parameters.h"
@@ -29,6 +29,7 @@
 #include "base/functional/callback.h"
 #include "cros-camera/camera_algorithm_bridge.h"
 #include "iutils/Thread.h"
+#include "iutils/Utils.h"
 #include "modules/sandboxing/IPCCommon.h"
 
 namespace icamera {
@@ -39,6 +40,11 @@ typedef enum {
     MAX_ALGO_SHM,
 } ShmMemUsage;
 
+struct IpcRequest {
+    IPC_CMD cmd;
+    int32_t bufferHandle;
+};
+
 class IntelAlgoClient : public camera_algorithm_callback_ops_t {
  public:
     static IntelAlgoClient* getInstance();
@@ -65,9 +71,28 @@ class IntelAlgoClient : public camera_algorithm_callback_ops_t {
     int allocateShmMem(const std::string& name, int size, int* fd, void** addr);
     void releaseShmMem(const std::string& name, int size, int fd, void* addr);
 
+    /*
+     * Get a shared memory registered to the server. The ones recycled with the same size and
+     * usage are reused without allocating and registering again, and they are cleared.
+     */
+    int acquireShmMem(const std::string& name, int size, ShmMemUsage usage, int* fd, void** addr,
+                      int32_t* handle);
+    // Keep the shared memory registered in the pool for acquireShmMem(), or release it if full
+    void recycleShmMem(const std::string& name, int size, int fd, void* addr, int32_t handle,
+                       ShmMemUsage usage);
+
     int requestSync(IPC_CMD cmd, int32_t bufferHandle);
     int requestSync(IPC_CMD cmd);
 
+    /*
+     * Send all the requests before waiting for them, to save the round trips of the requests
+     * of the same frame. The requests of the same group are run in order by the server, while
+     * the ones of different groups are run concurrently, so a request mustn't depend on the
+     * result of another group in the batch.
+     * Return the first error of the requests.
+     */
+    int requestBatchSync(const std::vector<IpcRequest>& requests);
+
     int32_t registerBuffer(int bufferFd, void* addr, ShmMemUsage usage = CPU_ALGO_SHM);
     void deregisterBuffer(int32_t bufferHandle, ShmMemUsage usage = CPU_ALGO_SHM);
     int32_t registerGbmBuffer(int bufferFd, ShmMemUsage usage = CPU_ALGO_SHM);
@@ -75,8 +100,6 @@ class IntelAlgoClient : public camera_algorithm_callback_ops_t {
     int32_t getBufferHandle(void* addr, ShmMemUsage usage = CPU_ALGO_SHM);
 
  private:
-    int waitCallback();
-
     void callbackHandler(uint32_t req_id, uint32_t status, int32_t buffer_handle);
     void notifyHandler(uint32_t msg);
 
@@ -108,6 +131,19 @@ class IntelAlgoClient : public camera_algorithm_callback_ops_t {
     std::unordered_map<void*, int32_t> mShmMap[MAX_ALGO_SHM];
     std::mutex mShmMapMutex;  // the mutex for mShmMap
 
+    struct PooledShm {
+        int fd;
+        void* addr;
+        int32_t handle;
+    };
+    void clearShmPool();
+
+    // <size, registered shared memories>, the size is exact since the server gets the size of
+    // the request from the shared memory
+    std::map<int, std::vector<PooledShm>> mShmPool[MAX_ALGO_SHM];
+    int64_t mPooledShmBytes;
+    std::mutex mShmPoolMutex;  // the mutex for mShmPool
+
     cros::CameraMojoChannelManagerToken* mMojoManagerToken;
     bool mInitialized;
 
@@ -117,22 +153,33 @@ class IntelAlgoClient : public camera_algorithm_callback_ops_t {
         Runner(IPC_GROUP group, cros::CameraAlgorithmBridge* bridge);
         virtual ~Runner();
         int requestSync(IPC_CMD cmd, int32_t bufferHandle);
-        void callbackHandler(uint32_t status, int32_t buffer_handle);
 
-     private:
-        int waitCallback();
+        // Send the request and return its id in reqId, which must be waited by waitRequest()
+        int sendRequest(IPC_CMD cmd, int32_t bufferHandle, uint32_t* reqId);
+        int waitRequest(uint32_t reqId);
+
+        void callbackHandler(uint32_t reqId, uint32_t status, int32_t buffer_handle);
+        // Fail all the requests in flight when the IPC is broken
+        void abortRequests();
 
      private:
+        struct PendingRequest {
+            IPC_CMD cmd;
+            nsecs_t startTime;
+            bool timedOut;  // Nobody waits for it, but its id is reserved until the callback
+            bool done;
+            int status;
+        };
+
         IPC_GROUP mGroup;
         cros::CameraAlgorithmBridge* mBridge;
-        pthread_mutex_t mCbLock;
-        pthread_cond_t mCbCond;
-        bool mIsCallbacked;
-        int mCbStatus;
-
-        bool mInitialized;
 
-        std::mutex mMutex;  // the mutex for the public method
+        Mutex mLock;  // guard for below
+        Condition mRequestDone;
+        // Only the low bits of it are in the req id, so it wraps around
+        uint32_t mSequence;
+        // <req id, request>, the requests in flight and the done ones to be waited
+        std::map<uint32_t, PendingRequest> mPendingRequests;
     };
 
     std::unique_ptr<Runner> mRunner[IPC_GROUP_NUM];
@@ -40,15 +40,9 @@ bool IntelAlgoCommon::allocShmMem(const std::string& name, int size, ShmMemInfo*
 
     shm->mName = name;
     shm->mSize = size;
-    int ret = mClient->allocateShmMem(shm->mName, shm->mSize, &shm->mFd, &shm->mAddr);
-    CheckAndLogError((ret != OK), false, "@%s, call allocateShmMem fail", __func__);
-
-    shm->mHandle = mClient->registerBuffer(shm->mFd, shm->mAddr, usage);
-    if (shm->mHandle < 0) {
-        LOGE("@%s, call mBridge->RegisterBuffer fail", __func__);
-        mClient->releaseShmMem(shm->mName, shm->mSize, shm->mFd, shm->mAddr);
-        return false;
-    }
+    int ret = mClient->acquireShmMem(shm->mName, shm->mSize, usage, &shm->mFd, &shm->mAddr,
+                                     &shm->mHandle);
+    CheckAndLogError((ret != OK), false, "@%s, call acquireShmMem fail", __func__);
 
     return true;
 }
@@ -89,6 +83,12 @@ ia_err IntelAlgoCommon::requestSyncCca(IPC_CMD cmd) {
     return (ia_err)(mClient->requestSync(cmd));
 }
 
+ia_err IntelAlgoCommon::requestBatchSyncCca(const std::vector<IpcRequest>& requests) {
+    CheckAndLogError(mClient == nullptr, ia_err_argument, "@%s, mClient is nullptr", __func__);
+
+    return (ia_err)(mClient->requestBatchSync(requests));
+}
+
 void IntelAlgoCommon::freeShmMem(const ShmMemInfo& shm, ShmMemUsage usage) {
     CheckAndLogError(mClient == nullptr, VOID_VALUE, "@%s, mClient is nullptr", __func__);
     if (shm.mHandle < 0 || shm.mFd < 0) {
@@ -96,8 +96,7 @@ void IntelAlgoCommon::freeShmMem(const ShmMemInfo& shm, ShmMemUsage usage) {
         return;
     }
 
-    mClient->deregisterBuffer(shm.mHandle, usage);
-    mClient->releaseShmMem(shm.mName, shm.mSize, shm.mFd, shm.mAddr);
+    mClient->recycleShmMem(shm.mName, shm.mSize, shm.mFd, shm.mAddr, shm.mHandle, usage);
 }
 
 bool IntelAlgoCommon::allocateAllShmMems(std::vector<ShmMem>* mems) {
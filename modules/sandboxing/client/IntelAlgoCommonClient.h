@@ -51,6 +51,7 @@ class IntelAlgoCommon {
     bool requestSync(IPC_CMD cmd);
     ia_err requestSyncCca(IPC_CMD cmd, int32_t handle);
     ia_err requestSyncCca(IPC_CMD cmd);
+    ia_err requestBatchSyncCca(const std::vector<IpcRequest>& requests);
     void freeShmMem(const ShmMemInfo& shm, ShmMemUsage usage = CPU_ALGO_SHM);
 
     bool allocateAllShmMems(std::vector<ShmMem>* mems);
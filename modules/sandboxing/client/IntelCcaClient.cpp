@@ -277,12 +277,7 @@ ia_err IntelCca::runLTM(uint64_t frameId, const cca::cca_ltm_input_params& param
 ia_err IntelCca::updateZoom(uint32_t streamId, const cca::cca_dvs_zoom& params) {
     LOG1("<id%d> @%s, tuningMode:%d, streamId: %u", mCameraId, __func__, mTuningMode, streamId);
 
-    intel_cca_update_zoom_data* zoomParams =
-        static_cast<intel_cca_update_zoom_data*>(mMemZoom.mAddr);
-    zoomParams->cameraId = mCameraId;
-    zoomParams->tuningMode = mTuningMode;
-    zoomParams->inParams = params;
-    zoomParams->streamId = streamId;
+    fillZoomParams(streamId, params);
 
     ia_err ret = mCommon.requestSyncCca(IPC_CCA_UPDATE_ZOOM, mMemZoom.mHandle);
     CheckAndLogError(ret != ia_err_none, ia_err_general, "@%s, requestSyncCca fails", __func__);
@@ -294,11 +289,7 @@ ia_err IntelCca::runDVS(uint32_t streamId, uint64_t frameId) {
     LOG2("<id%d:req%ld> @%s, tuningMode:%d, streamId: %u", mCameraId, frameId, __func__,
          mTuningMode, streamId);
 
-    intel_cca_run_dvs_data* params = static_cast<intel_cca_run_dvs_data*>(mMemDVS.mAddr);
-    params->cameraId = mCameraId;
-    params->tuningMode = mTuningMode;
-    params->frameId = frameId;
-    params->streamId = streamId;
+    fillDvsParams(streamId, frameId);
 
     ia_err ret = mCommon.requestSyncCca(IPC_CCA_RUN_DVS, mMemDVS.mHandle);
     CheckAndLogError(ret != ia_err_none, ia_err_general, "@%s, requestSyncCca fails", __func__);
@@ -306,6 +297,40 @@ ia_err IntelCca::runDVS(uint32_t streamId, uint64_t frameId) {
     return ret;
 }
 
+ia_err IntelCca::runDVS(uint32_t streamId, uint64_t frameId, const cca::cca_dvs_zoom& zoom) {
+    LOG2("<id%d:req%ld> @%s, tuningMode:%d, streamId: %u", mCameraId, frameId, __func__,
+         mTuningMode, streamId);
+
+    fillZoomParams(streamId, zoom);
+    fillDvsParams(streamId, frameId);
+
+    // Both are in the same group, so the server runs them in order with one round trip
+    std::vector<IpcRequest> requests = {{IPC_CCA_UPDATE_ZOOM, mMemZoom.mHandle},
+                                        {IPC_CCA_RUN_DVS, mMemDVS.mHandle}};
+    ia_err ret = mCommon.requestBatchSyncCca(requests);
+    CheckAndLogError(ret != ia_err_none, ia_err_general, "@%s, requestBatchSyncCca fails",
+                     __func__);
+
+    return ret;
+}
+
+void IntelCca::fillZoomParams(uint32_t streamId, const cca::cca_dvs_zoom& params) {
+    intel_cca_update_zoom_data* zoomParams =
+        static_cast<intel_cca_update_zoom_data*>(mMemZoom.mAddr);
+    zoomParams->cameraId = mCameraId;
+    zoomParams->tuningMode = mTuningMode;
+    zoomParams->inParams = params;
+    zoomParams->streamId = streamId;
+}
+
+void IntelCca::fillDvsParams(uint32_t streamId, uint64_t frameId) {
+    intel_cca_run_dvs_data* params = static_cast<intel_cca_run_dvs_data*>(mMemDVS.mAddr);
+    params->cameraId = mCameraId;
+    params->tuningMode = mTuningMode;
+    params->frameId = frameId;
+    params->streamId = streamId;
+}
+
 ia_err IntelCca::runAIC(uint64_t frameId, cca::cca_pal_input_params* params, ia_binary_data* pal) {
     CheckAndLogError(!params, ia_err_argument, "@%s, params is nullptr", __func__);
     CheckAndLogError(!pal, ia_err_argument, "@%s, pal is nullptr", __func__);
@@ -222,6 +222,8 @@ int IntelPGParam::allocatePayloads(int payloadCount, ia_binary_data* payloads) {
     CheckAndLogError(payloadCount > IPU_MAX_TERMINAL_COUNT, UNKNOWN_ERROR,
                      "@%s, payloadCount: %d exceeded max count", __func__, payloadCount);
     CheckAndLogError(!payloads, UNKNOWN_ERROR, "@%s, payloads is nullptr", __func__);
+    CheckAndLogError(mPayloadRegions.size() >= IPC_MAX_PAYLOAD_REGIONS, NO_MEMORY,
+                     "@%s, too many payload regions", __func__);
 
     // Allocate memory
     int size = mIpc.getTotalPayloadSize(payloadCount, payloads);
@@ -240,14 +242,21 @@ int IntelPGParam::allocatePayloads(int payloadCount, ia_binary_data* payloads) {
     ret = mIpc.assignPayloads(info.mAddr, info.mSize, payloadCount, payloads);
     CheckAndLogError(ret == false, UNKNOWN_ERROR, "@%s, allocatePayloads fails", __func__);
 
-    ret =
-        mIpc.clientFlattenRegisterPayloads(info.mAddr, info.mSize, mClient, payloadCount, payloads);
+    ipc_shm_region region = {0, 0};
+    ret = mIpc.getPayloadRegion(info.mAddr, info.mSize, &region);
+    CheckAndLogError(ret == false, UNKNOWN_ERROR, "@%s, getPayloadRegion fails", __func__);
+
+    ret = mIpc.clientFlattenRegisterPayloads(info.mAddr, info.mSize, mClient,
+                                             mPayloadRegions.size());
     CheckAndLogError(ret == false, UNKNOWN_ERROR, "@%s, clientFlattenRegisterPayloads fails",
                      __func__);
 
     ret = mCommon.requestSync(IPC_PG_PARAM_REGISTER_PAYLOADS, info.mHandle);
     CheckAndLogError(ret == false, UNKNOWN_ERROR, "@%s, requestSync fails", __func__);
 
+    // The payloads are sent as the offsets in the regions in encoding and decoding
+    mPayloadRegions.push_back(region);
+
     return OK;
 }
 
@@ -263,7 +272,8 @@ int IntelPGParam::updatePALAndEncode(const ia_binary_data* ipuParameters, int pa
 
     int32_t palHandle = mCommon.getShmMemHandle(ipuParameters->data);
     bool ret = mIpc.clientFlattenEncode(mMemEncode.mAddr, mMemEncode.mSize, mClient,
-                                        ipuParameters->size, palHandle, payloadCount, payloads);
+                                        ipuParameters->size, palHandle, payloadCount, payloads,
+                                        mPayloadRegions.data(), mPayloadRegions.size());
     CheckAndLogError(ret == false, UNKNOWN_ERROR, "@%s, clientFlattenEncode fails", __func__);
 
     ret = mCommon.requestSync(IPC_PG_PARAM_ENCODE, mMemEncode.mHandle);
@@ -299,7 +309,9 @@ int IntelPGParam::decode(int payloadCount, ia_binary_data* payloads, ia_binary_d
         statsHandle = mCommon.getShmMemHandle(statistics->data);
     }
 
-    cca::cca_out_stats* outStats = fetchOutStats(sequence);
+    // The stats are decoded into the aiq result, keep it pinned until then
+    AiqResultStorage::AiqResultRef aiqResultRef;
+    cca::cca_out_stats* outStats = fetchOutStats(sequence, &aiqResultRef);
     pg_param_decode_params* params = static_cast<pg_param_decode_params*>(mMemDecode.mAddr);
     intel_cca_decode_stats_data& decodeStatsParams = params->decodeStatsParams;
     if (outStats && mIntelCca) {
@@ -318,7 +330,8 @@ int IntelPGParam::decode(int payloadCount, ia_binary_data* payloads, ia_binary_d
     }
 
     ret = mIpc.clientFlattenDecode(mMemDecode.mAddr, mMemDecode.mSize, mClient, payloadCount,
-                                   payloads, statsHandle);
+                                   payloads, mPayloadRegions.data(), mPayloadRegions.size(),
+                                   statsHandle);
     CheckAndLogError(ret == false, UNKNOWN_ERROR, "@%s, clientFlattenDecode fails", __func__);
 
     ret = mCommon.requestSync(IPC_PG_PARAM_DECODE, mMemDecode.mHandle);
@@ -353,11 +366,12 @@ void IntelPGParam::deinit() {
     CheckAndLogError(ret == false, VOID_VALUE, "@%s, requestSync fails", __func__);
 }
 
-cca::cca_out_stats* IntelPGParam::fetchOutStats(int64_t sequence) {
+cca::cca_out_stats* IntelPGParam::fetchOutStats(int64_t sequence,
+                                                AiqResultStorage::AiqResultRef* aiqResultRef) {
     if (sequence < 0) return nullptr;
 
-    AiqResult* aiqResult =
-        const_cast<AiqResult*>(AiqResultStorage::getInstance(mCameraId)->getAiqResult(sequence));
+    *aiqResultRef = AiqResultStorage::getInstance(mCameraId)->getAiqResultRef(sequence);
+    AiqResult* aiqResult = const_cast<AiqResult*>(aiqResultRef->get());
     // Check if the frame needs stats decoding together
     if (aiqResult && aiqResult->mAiqParam.callbackRgbs) {
         // Request decodeStats together when rgbCallback is enabled
@@ -19,6 +19,7 @@
 #include <memory>
 #include <vector>
 
+#include "AiqResultStorage.h"
 #include "CameraTypes.h"
 #include "IntelAlgoCommonClient.h"
 #include "modules/sandboxing/IPCIntelPGParam.h"
@@ -47,7 +48,8 @@ class IntelPGParam {
     void deinit();
 
 private:
-    cca::cca_out_stats* fetchOutStats(int64_t sequence);
+    cca::cca_out_stats* fetchOutStats(int64_t sequence,
+                                      AiqResultStorage::AiqResultRef* aiqResultRef);
 
  private:
     IPCIntelPGParam mIpc;
@@ -66,6 +68,8 @@ private:
     std::vector<ShmMem> mMems;
 
     std::vector<ShmMemInfo> mMemAllocatePayloads;
+    // The registered regions of mMemAllocatePayloads, the index is known by the server
+    std::vector<ipc_shm_region> mPayloadRegions;
 
     int mPgId;
     uintptr_t mClient;
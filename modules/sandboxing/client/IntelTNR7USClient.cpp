@@ -26,11 +26,14 @@
 namespace icamera {
 
 IntelTNR7US* IntelTNR7US::createIntelTNR(int cameraId) {
-    if (!PlatformData::isGpuTnrEnabled()) return nullptr;
+    if (!PlatformData::isGpuTnrEnabled(cameraId)) return nullptr;
 #ifdef TNR7_CM
     return new IntelC4mTNR(cameraId);
-#else
+#elif defined(TNR7_LEVEL0)
     return new IntelLevel0TNR(cameraId);
+#else
+    // GPUExecutor runs the TNR on the CPU then
+    return nullptr;
 #endif
 }
 
@@ -138,7 +138,8 @@ void IntelAlgoServer::handleRequest(const MsgReq& msg) {
 
 void IntelAlgoServer::request(uint32_t req_id, const uint8_t req_header[], uint32_t size,
                               int32_t buffer_handle) {
-    IPC_GROUP group = IntelAlgoIpcCmdToGroup(static_cast<IPC_CMD>(req_id));
+    IPC_CMD cmd = IntelAlgoIpcReqIdToCmd(req_id);
+    IPC_GROUP group = IntelAlgoIpcCmdToGroup(cmd);
 
     int ret = parseReqHeader(req_header, size);
     if (ret != 0) {
@@ -146,7 +147,7 @@ void IntelAlgoServer::request(uint32_t req_id, const uint8_t req_header[], uint3
         return;
     }
 
-    MsgReq msg = {req_id, buffer_handle};
+    MsgReq msg = {req_id, cmd, buffer_handle};
 
 #ifndef GPU_ALGO_SERVER
     int threadId = group;
@@ -35,7 +35,8 @@ namespace icamera {
 
 #define HANDLE_INDEX_MAX_VALUE 1024
 struct MsgReq {
-    uint32_t req_id;
+    uint32_t req_id;  // returned as it is in the callback
+    IPC_CMD cmd;
     int32_t buffer_handle;
 };
 
@@ -31,12 +31,12 @@
 namespace icamera {
 
 // Common check before the function call
-#define FUNCTION_PREPARED_RETURN                                           \
-    uint16_t key = getKey(p->cameraId, p->tuningMode);                     \
-    if (mCcas.find(key) == mCcas.end()) {                                  \
-        LOGE("@%s, req_id:%d, it doesn't find the cca", __func__, req_id); \
-        status = UNKNOWN_ERROR;                                            \
-        break;                                                             \
+#define FUNCTION_PREPARED_RETURN                                     \
+    uint16_t key = getKey(p->cameraId, p->tuningMode);               \
+    if (mCcas.find(key) == mCcas.end()) {                            \
+        LOGE("@%s, cmd:%d, it doesn't find the cca", __func__, cmd); \
+        status = UNKNOWN_ERROR;                                      \
+        break;                                                       \
     }
 
 IntelCPUAlgoServer::~IntelCPUAlgoServer() {
@@ -47,6 +47,7 @@ IntelCPUAlgoServer::~IntelCPUAlgoServer() {
 
 void IntelCPUAlgoServer::handleRequest(const MsgReq& msg) {
     uint32_t req_id = msg.req_id;
+    IPC_CMD cmd = msg.cmd;
     int32_t buffer_handle = msg.buffer_handle;
 
     ShmInfo info = {};
@@ -60,7 +61,7 @@ void IntelCPUAlgoServer::handleRequest(const MsgReq& msg) {
     size_t requestSize = info.size;
     void* addr = info.addr;
 
-    switch (req_id) {
+    switch (cmd) {
         case IPC_FD_INIT:
             status = mFaceDetection.init(addr, requestSize);
             break;
@@ -122,7 +123,7 @@ void IntelCPUAlgoServer::handleRequest(const MsgReq& msg) {
             intel_cca_struct_data* p = static_cast<intel_cca_struct_data*>(addr);
             uint16_t key = getKey(p->cameraId, p->tuningMode);
             if (mCcas.find(key) == mCcas.end()) {
-                LOGE("@%s, req_id:%d, it doesn't find the cca", __func__, req_id);
+                LOGE("@%s, cmd:%d, it doesn't find the cca", __func__, cmd);
                 status = UNKNOWN_ERROR;
                 break;
             }
@@ -325,13 +326,13 @@ void IntelCPUAlgoServer::handleRequest(const MsgReq& msg) {
             mPGParam.deinit(addr, requestSize);
             break;
         default:
-            LOGE("@%s, req_id:%d is not defined", __func__, req_id);
+            LOGE("@%s, cmd:%d is not defined", __func__, cmd);
             status = UNKNOWN_ERROR;
             break;
     }
 
-    LOG2("@%s, req_id:%d:%s, status:%d", __func__, req_id,
-         IntelAlgoIpcCmdToString(static_cast<IPC_CMD>(req_id)), status);
+    LOG2("@%s, req_id:0x%x:%s, status:%d", __func__, req_id,
+         IntelAlgoIpcCmdToString(cmd), status);
     getIntelAlgoServer()->returnCallback(req_id, status, buffer_handle);
 }
 
@@ -32,6 +32,7 @@ namespace icamera {
 
 void IntelGPUAlgoServer::handleRequest(const MsgReq& msg) {
     uint32_t req_id = msg.req_id;
+    IPC_CMD cmd = msg.cmd;
     int32_t buffer_handle = msg.buffer_handle;
 
     ShmInfo info = {};
@@ -45,7 +46,7 @@ void IntelGPUAlgoServer::handleRequest(const MsgReq& msg) {
     size_t requestSize = info.size;
     void* addr = info.addr;
 
-    switch (req_id) {
+    switch (cmd) {
 #ifdef TNR7_CM
         case IPC_GPU_TNR_INIT:
             status = mTNR.init(addr, requestSize);
@@ -164,12 +165,12 @@ void IntelGPUAlgoServer::handleRequest(const MsgReq& msg) {
         }
         // LEVEL0_ICBM_E
         default:
-            LOGE("@%s, req_id:%d is not defined", __func__, req_id);
+            LOGE("@%s, cmd:%d is not defined", __func__, cmd);
             status = UNKNOWN_ERROR;
             break;
     }
-    LOG1("@%s, req_id:%d:%s, status:%d", __func__, req_id,
-         IntelAlgoIpcCmdToString(static_cast<IPC_CMD>(req_id)), status);
+    LOG1("@%s, req_id:0x%x:%s, status:%d", __func__, req_id,
+         IntelAlgoIpcCmdToString(cmd), status);
 
     (void)requestSize;
     (void)addr;
@@ -137,24 +137,25 @@ int IntelPGParamServer::setPGAndPrepareProgram(void* pData, int dataSize) {
 
 int IntelPGParamServer::registerPayloads(void* pData, int dataSize) {
     uintptr_t client = 0;
-    int payloadCount = 0;
-    ia_binary_data* cPayloads = nullptr;
-    ia_binary_data* sPayloads = nullptr;
-    bool ret = mIpc.serverUnflattenRegisterPayloads(pData, dataSize, &client, &payloadCount,
-                                                    &cPayloads, &sPayloads);
+    int32_t regionIndex = -1;
+    ipc_shm_region region = {0, 0};
+    bool ret = mIpc.serverUnflattenRegisterPayloads(pData, dataSize, &client, &regionIndex);
     CheckAndLogError(ret == false, UNKNOWN_ERROR, "@%s, serverUnflattenRegisterPayloads fails",
                      __func__);
+    ret = mIpc.getPayloadRegion(pData, dataSize, &region);
+    CheckAndLogError(ret == false, UNKNOWN_ERROR, "@%s, getPayloadRegion fails", __func__);
+    CheckAndLogError(regionIndex < 0 || regionIndex >= IPC_MAX_PAYLOAD_REGIONS, BAD_VALUE,
+                     "@%s, invalid payload region %d", __func__, regionIndex);
 
     CheckAndLogError((mPGParamPackages.find(client) == mPGParamPackages.end()), UNKNOWN_ERROR,
                      "%s, the pg doesn't exist in the table", __func__);
     PGParamPackage& package = mPGParamPackages[client];
 
-    // Save <client addr, server addr>
-    for (int i = 0; i < payloadCount; i++) {
-        if (cPayloads[i].size > 0) {
-            package.mAllocatedPayloads[cPayloads[i].data] = sPayloads[i];
-        }
+    // The client refers to the payloads by the offsets in this region
+    if (package.mPayloadRegions.size() <= static_cast<size_t>(regionIndex)) {
+        package.mPayloadRegions.resize(regionIndex + 1, {0, 0});
     }
+    package.mPayloadRegions[regionIndex] = region;
 
     return OK;
 }
@@ -164,7 +165,7 @@ int IntelPGParamServer::updatePALAndEncode(void* pData, int dataSize, void* palD
     TRACE_LOG_PROCESS("IntelPGParamServer", "updatePALAndEncode");
     uintptr_t client = 0;
     ia_binary_data ipuParameters = {nullptr, 0};
-    ia_binary_data* payloads = nullptr;
+    ipc_shm_ref* payloads = nullptr;
     int32_t payloadCount = 0;
 
     bool ret = mIpc.serverUnflattenEncode(pData, dataSize, &client, palDataAddr, &ipuParameters,
@@ -177,9 +178,8 @@ int IntelPGParamServer::updatePALAndEncode(void* pData, int dataSize, void* palD
     CheckAndLogError(payloadCount != package.mPayloadCount, UNKNOWN_ERROR,
                      "@%s, wrong payloadCount", __func__);
 
-    int result = findPayloads(package.mPayloadCount, payloads, &package.mAllocatedPayloads,
-                              package.mPayloads);
-    CheckAndLogError(result != OK, result, "@%s, findPayloads fails", __func__);
+    int result = resolvePayloads(&package, package.mPayloadCount, payloads);
+    CheckAndLogError(result != OK, result, "@%s, resolvePayloads fails", __func__);
 
     result = package.mPGParamAdapt->updatePALAndEncode(&ipuParameters, package.mPayloadCount,
                                                        package.mPayloads);
@@ -193,7 +193,7 @@ int IntelPGParamServer::decode(void* pData, int dataSize, void* statsAddr) {
     TRACE_LOG_PROCESS("IntelPGParamServer", "decode");
     uintptr_t client = 0;
     ia_binary_data statistics = {statsAddr, 0};
-    ia_binary_data* payloads = nullptr;
+    ipc_shm_ref* payloads = nullptr;
     int32_t payloadCount = 0;
 
     bool ret = mIpc.serverUnflattenDecode(pData, dataSize, &client, &payloadCount, &payloads);
@@ -205,9 +205,8 @@ int IntelPGParamServer::decode(void* pData, int dataSize, void* statsAddr) {
     CheckAndLogError(payloadCount != package.mPayloadCount, UNKNOWN_ERROR,
                      "@%s, wrong payloadCount", __func__);
 
-    int result = findPayloads(package.mPayloadCount, payloads, &package.mAllocatedPayloads,
-                              package.mPayloads);
-    CheckAndLogError(result != OK, result, "@%s, findPayloads fails", __func__);
+    int result = resolvePayloads(&package, package.mPayloadCount, payloads);
+    CheckAndLogError(result != OK, result, "@%s, resolvePayloads fails", __func__);
 
     result = package.mPGParamAdapt->decode(package.mPayloadCount, package.mPayloads, &statistics);
     CheckAndLogError(result != OK, result, "@%s, decode fails", __func__);
@@ -231,22 +230,13 @@ void IntelPGParamServer::deinit(void* pData, int dataSize) {
     mPGParamPackages.erase(client);
 }
 
-int IntelPGParamServer::findPayloads(int32_t payloadCount, ia_binary_data* clientPayloads,
-                                     std::unordered_map<void*, ia_binary_data>* allocated,
-                                     ia_binary_data* serverPayloads) {
-    CheckAndLogError(!clientPayloads, BAD_VALUE, "@%s, payloads is nullptr", __func__);
-    CLEAR(*serverPayloads);
-    for (size_t i = 0; i < payloadCount; i++) {
-        if (!clientPayloads[i].size) continue;
-
-        CheckAndLogError(allocated->find(clientPayloads[i].data) == allocated->end(), UNKNOWN_ERROR,
-                         "%s: can't find client payload %p for term %zu", __func__,
-                         clientPayloads[i].data, i);
-        ia_binary_data& alloc = allocated->at(clientPayloads[i].data);
-        CheckAndLogError(alloc.size != clientPayloads[i].size, UNKNOWN_ERROR,
-                         "%s: payload size mismatch for term %zu", __func__, i);
-        serverPayloads[i] = alloc;
-    }
+int IntelPGParamServer::resolvePayloads(PGParamPackage* package, int32_t payloadCount,
+                                        const ipc_shm_ref* refs) {
+    CheckAndLogError(!refs, BAD_VALUE, "@%s, payloads is nullptr", __func__);
+    CLEAR(package->mPayloads);
+    bool ret = mIpc.serverResolvePayloads(payloadCount, refs, package->mPayloadRegions.data(),
+                                          package->mPayloadRegions.size(), package->mPayloads);
+    CheckAndLogError(ret == false, UNKNOWN_ERROR, "@%s, serverResolvePayloads fails", __func__);
     return OK;
 }
 
@@ -18,6 +18,7 @@
 
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "modules/algowrapper/IntelPGParam.h"
 #include "modules/sandboxing/IPCIntelPGParam.h"
@@ -47,14 +48,12 @@ class IntelPGParamServer {
         int mPayloadCount;
         ia_css_process_group_t* mPGBuffer;
 
-        // <client addr, server payload>
-        std::unordered_map<void*, ia_binary_data> mAllocatedPayloads;
+        // The payload regions in server side, indexed by the region of the client
+        std::vector<ipc_shm_region> mPayloadRegions;
     };
 
  private:
-    int findPayloads(int32_t payloadCount, ia_binary_data* clientPayloads,
-                     std::unordered_map<void*, ia_binary_data>* allocated,
-                     ia_binary_data* serverPayloads);
+    int resolvePayloads(PGParamPackage* package, int32_t payloadCount, const ipc_shm_ref* refs);
 
     IPCIntelPGParam mIpc;
     std::unordered_map<uintptr_t, PGParamPackage> mPGParamPackages;
@@ -171,6 +171,17 @@ class CROS_CAMERA_EXPORT V4L2Device {
     int SetControl(int id, const std::string& value);
     int SetControl(struct v4l2_control* control);
 
+    // This method sets several controls of V4L2 device with one ioctl, so the
+    // driver applies them together. The controls may be of different classes.
+    //
+    // Args:
+    //    |ext_controls|: the controls to set.
+    //    |count|: the number of the controls.
+    //
+    // Returns:
+    //    0 on success; corresponding error code on failure.
+    int SetControls(struct v4l2_ext_control* ext_controls, uint32_t count);
+
     // These methods gets the control of V4L2 device.
     //
     // Args:
@@ -238,6 +249,12 @@ class CROS_CAMERA_EXPORT V4L2Device {
     //    True if it is opened.
     bool IsOpened() { return fd_ != -1; }
 
+    // This method gets the file descriptor, e.g. to wait on it with epoll.
+    //
+    // Returns:
+    //    The file descriptor, -1 if it isn't opened.
+    int Fd() const { return fd_; }
+
     int Poll(int timeout);
 
     // This method gets the name of V4L2 device.
@@ -24,6 +24,7 @@
 #include "iutils/CameraLog.h"
 #include "iutils/Errors.h"
 #include "iutils/Utils.h"
+#include "v4l2/SysCall.h"
 
 using namespace icamera::Log;
 using namespace icamera;
@@ -69,7 +70,8 @@ int V4L2Subdevice::SetFormat(const struct v4l2_subdev_format& format) {
         return -EINVAL;
     }
 
-    int ret = ::ioctl(fd_, VIDIOC_SUBDEV_S_FMT, &format);
+    int ret = SysCall::getInstance()->ioctl(
+        fd_, VIDIOC_SUBDEV_S_FMT, const_cast<struct v4l2_subdev_format*>(&format));
     if (ret < 0) {
         LOGE("%s: Device node %s IOCTL VIDIOC_SUBDEV_S_FMT error: %s", __func__, name_.c_str(),
              strerror(errno));
@@ -88,7 +90,7 @@ int V4L2Subdevice::GetFormat(struct v4l2_subdev_format* format) {
         return -EINVAL;
     }
 
-    int ret = ::ioctl(fd_, VIDIOC_SUBDEV_G_FMT, format);
+    int ret = SysCall::getInstance()->ioctl(fd_, VIDIOC_SUBDEV_G_FMT, format);
     if (ret < 0) {
         LOGE("%s: Device node %s IOCTL VIDIOC_SUBDEV_G_FMT error: %s", __func__, name_.c_str(),
              strerror(errno));
@@ -126,7 +128,8 @@ int V4L2Subdevice::SetSelection(const struct v4l2_subdev_selection& selection) {
         return -EINVAL;
     }
 
-    int ret = ::ioctl(fd_, VIDIOC_SUBDEV_S_SELECTION, &selection);
+    int ret = SysCall::getInstance()->ioctl(
+        fd_, VIDIOC_SUBDEV_S_SELECTION, const_cast<struct v4l2_subdev_selection*>(&selection));
     if (ret < 0) {
         LOGE("%s: Device node %s IOCTL VIDIOC_SUBDEV_S_SELECTION error: %s", __func__,
              name_.c_str(), strerror(errno));
@@ -144,7 +147,7 @@ int V4L2Subdevice::SetRouting(v4l2_subdev_route* routes, uint32_t numRoutes) {
 
     v4l2_subdev_routing r = {routes, numRoutes};
 
-    int ret = ::ioctl(fd_, VIDIOC_SUBDEV_S_ROUTING, &r);
+    int ret = SysCall::getInstance()->ioctl(fd_, VIDIOC_SUBDEV_S_ROUTING, &r);
     if (ret < 0) {
         LOG1("%s: Device node %s IOCTL VIDIOC_SUBDEV_S_ROUTING error: %s", __func__, name_.c_str(),
              strerror(errno));
@@ -164,7 +167,7 @@ int V4L2Subdevice::GetRouting(v4l2_subdev_route* routes, uint32_t* numRoutes) {
 
     v4l2_subdev_routing r = {routes, *numRoutes};
 
-    int ret = ::ioctl(fd_, VIDIOC_SUBDEV_G_ROUTING, &r);
+    int ret = SysCall::getInstance()->ioctl(fd_, VIDIOC_SUBDEV_G_ROUTING, &r);
     if (ret < 0) {
         LOG1("%s: Device node %s IOCTL VIDIOC_SUBDEV_G_ROUTING error: %s", __func__, name_.c_str(),
              strerror(errno));
@@ -24,6 +24,7 @@
 #include "iutils/CameraLog.h"
 #include "iutils/Errors.h"
 #include "iutils/Utils.h"
+#include "v4l2/SysCall.h"
 
 using namespace icamera::Log;
 using namespace icamera;
@@ -481,7 +482,7 @@ int V4L2VideoNode::StopLocked(bool releaseBuffers) {
     LOG1("@%s", __func__);
 
     if (state_ == VideoNodeState::STARTED) {
-        int ret = ::ioctl(fd_, VIDIOC_STREAMOFF, &buffer_type_);
+        int ret = SysCall::getInstance()->ioctl(fd_, VIDIOC_STREAMOFF, &buffer_type_);
         if (ret < 0) {
             LOGE("%s: Device node %s IOCTL VIDIOC_STREAMOFF error: %s", __func__, name_.c_str(),
                  strerror(errno));
@@ -509,7 +510,7 @@ int V4L2VideoNode::Start() {
         return -1;
     }
 
-    int ret = ::ioctl(fd_, VIDIOC_STREAMON, &buffer_type_);
+    int ret = SysCall::getInstance()->ioctl(fd_, VIDIOC_STREAMON, &buffer_type_);
     if (ret < 0) {
         LOGE("%s: Device node %s IOCTL VIDIOC_STREAMON error: %s", __func__, name_.c_str(),
              strerror(errno));
@@ -536,7 +537,7 @@ int V4L2VideoNode::SetFormat(const V4L2Format& format) {
         fmt.SetSizeImage(0, 0);
     }
 
-    int ret = ::ioctl(fd_, VIDIOC_S_FMT, fmt.Get());
+    int ret = SysCall::getInstance()->ioctl(fd_, VIDIOC_S_FMT, fmt.Get());
     if (ret < 0) {
         LOGE("%s: Device node %s IOCTL VIDIOC_S_FMT error: %s", __func__, name_.c_str(),
              strerror(errno));
@@ -561,7 +562,7 @@ int V4L2VideoNode::SetSelection(const struct v4l2_selection& selection) {
     struct v4l2_selection* sel = const_cast<struct v4l2_selection*>(&selection);
     sel->type = buffer_type_;
 
-    int ret = ::ioctl(fd_, VIDIOC_S_SELECTION, sel);
+    int ret = SysCall::getInstance()->ioctl(fd_, VIDIOC_S_SELECTION, sel);
 
     return ret;
 }
@@ -592,7 +593,8 @@ int V4L2VideoNode::MapMemory(unsigned int index, int prot, int flags, std::vecto
     }
     uint32_t num_planes = V4L2_TYPE_IS_MULTIPLANAR(buffer.Type()) ? buffer.Get()->length : 1;
     for (uint32_t i = 0; i < num_planes; i++) {
-        void* res = ::mmap(nullptr, buffer.Length(i), prot, flags, fd_, buffer.Offset(i));
+        void* res = SysCall::getInstance()->mmap(nullptr, buffer.Length(i), prot, flags, fd_,
+                                                 buffer.Offset(i));
         if (res == MAP_FAILED) {
             LOGE("%s: MMAP error. %d", __func__, strerror(errno));
             return -EINVAL;
@@ -658,7 +660,7 @@ int V4L2VideoNode::ExportFrame(unsigned int index, std::vector<int>* fds) {
     ebuf.index = index;
     ebuf.flags = O_RDWR;
     for (uint32_t i = 0; i < num_planes; i++) {
-        ret = ::ioctl(fd_, VIDIOC_EXPBUF, &ebuf);
+        ret = SysCall::getInstance()->ioctl(fd_, VIDIOC_EXPBUF, &ebuf);
         if (ret < 0) {
             LOGE("%s: Device node %s IOCTL VIDIOC_EXPBUF error: %s", __func__, name_.c_str(),
                  strerror(errno));
@@ -710,7 +712,7 @@ int V4L2VideoNode::SetupBuffers(size_t num_buffers, bool is_cached, enum v4l2_me
 int V4L2VideoNode::QueryCap(struct v4l2_capability* cap) {
     LOG1("@%s", __func__);
 
-    int ret = ::ioctl(fd_, VIDIOC_QUERYCAP, cap);
+    int ret = SysCall::getInstance()->ioctl(fd_, VIDIOC_QUERYCAP, cap);
 
     if (ret < 0) {
         LOGE("%s: Device node %s IOCTL VIDIOC_QUERYCAP error: %s", __func__, name_.c_str(),
@@ -731,7 +733,7 @@ int V4L2VideoNode::RequestBuffers(size_t num_buffers, enum v4l2_memory memory_ty
     req_buf.count = num_buffers;
     req_buf.type = buffer_type_;
 
-    int ret = ::ioctl(fd_, VIDIOC_REQBUFS, &req_buf);
+    int ret = SysCall::getInstance()->ioctl(fd_, VIDIOC_REQBUFS, &req_buf);
 
     if (ret < 0) {
         LOGE("%s: Device node %s IOCTL VIDIOC_REQBUFS error: %s", __func__, name_.c_str(),
@@ -765,7 +767,8 @@ void V4L2VideoNode::PrintBufferInfo(const std::string& func, const V4L2Buffer& b
 int V4L2VideoNode::Qbuf(V4L2Buffer* buf) {
     LOG1("@%s", __func__);
 
-    int ret = ::ioctl(fd_, VIDIOC_QBUF, buf->Get());
+    int ret = SysCall::getInstance()->ioctl(fd_, VIDIOC_QBUF,
+                                            const_cast<struct v4l2_buffer*>(buf->Get()));
     if (ret < 0) {
         LOGE("%s: Device node %s IOCTL VIDIOC_QBUF error: %s", __func__, name_.c_str(),
              strerror(errno));
@@ -779,7 +782,8 @@ int V4L2VideoNode::Dqbuf(V4L2Buffer* buf) {
     buf->SetMemory(memory_type_);
     buf->SetType(buffer_type_);
 
-    int ret = ::ioctl(fd_, VIDIOC_DQBUF, buf->Get());
+    int ret = SysCall::getInstance()->ioctl(fd_, VIDIOC_DQBUF,
+                                            const_cast<struct v4l2_buffer*>(buf->Get()));
     if (ret < 0) {
         LOGE("%s: Device node %s IOCTL VIDIOC_DQBUF error: %s", __func__, name_.c_str(),
              strerror(errno));
@@ -794,7 +798,8 @@ int V4L2VideoNode::QueryBuffer(int index, enum v4l2_memory memory_type, V4L2Buff
     buf->SetMemory(memory_type);
     buf->SetType(buffer_type_);
     buf->SetIndex(index);
-    int ret = ::ioctl(fd_, VIDIOC_QUERYBUF, buf->Get());
+    int ret = SysCall::getInstance()->ioctl(fd_, VIDIOC_QUERYBUF,
+                                            const_cast<struct v4l2_buffer*>(buf->Get()));
 
     if (ret < 0) {
         LOGE("%s: Device node %s IOCTL VIDIOC_QUERYBUF error: %s", __func__, name_.c_str(),
@@ -828,7 +833,7 @@ int V4L2VideoNode::GetFormat(V4L2Format* format) {
 
     v4l2_format fmt;
     fmt.type = buffer_type_;
-    int ret = ::ioctl(fd_, VIDIOC_G_FMT, &fmt);
+    int ret = SysCall::getInstance()->ioctl(fd_, VIDIOC_G_FMT, &fmt);
 
     if (ret < 0) {
         LOGE("%s: Device node %s IOCTL VIDIOC_G_FMT error: %s", __func__, name_.c_str(),
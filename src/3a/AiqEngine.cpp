@@ -24,6 +24,7 @@
 #include "PlatformData.h"
 #include "iutils/CameraLog.h"
 #include "iutils/Errors.h"
+#include "iutils/LatencyStats.h"
 #include "iutils/Utils.h"
 
 #include "gc/IGraphConfigManager.h"
@@ -114,6 +115,7 @@ int AiqEngine::run3A(long requestId, int64_t applyingSeq, int64_t* effectSeq) {
 
     // Run 3A in call thread
     AutoMutex l(mEngineLock);
+    LatencyStats::ScopedLatency latency(mCameraId, -1, LATENCY_AIQ_RUN);
 
     AiqStatistics* aiqStats =
         mFirstAiqRunning ? nullptr :
@@ -36,18 +36,15 @@ void AiqResultStorage::releaseAiqResultStorage(int cameraId) {
     delete storage;
 }
 
-AiqResultStorage::AiqResultStorage(int cameraId) : mCameraId(cameraId) {
-    for (int i = 0; i < kStorageSize; i++) {
-        mAiqResults[i] = new AiqResult(mCameraId);
-        mAiqResults[i]->init();
-    }
-}
+AiqResultStorage::AiqResultStorage(int cameraId)
+        : mCameraId(cameraId),
+          mAiqResults([cameraId]() {
+              AiqResult* result = new AiqResult(cameraId);
+              result->init();
+              return result;
+          }) {}
 
-AiqResultStorage::~AiqResultStorage() {
-    for (int i = 0; i < kStorageSize; i++) {
-        delete mAiqResults[i];
-    }
-}
+AiqResultStorage::~AiqResultStorage() {}
 
 AiqStatistics* AiqResultStorage::acquireAiqStatistics() {
     AutoWMutex rlock(mDataLock);
@@ -98,42 +95,27 @@ void AiqResultStorage::unLockAiqStatistics() {
 }
 
 AiqResult* AiqResultStorage::acquireAiqResult() {
-    AutoWMutex rlock(mDataLock);
-
-    int index = mCurrentIndex + 1;
-    index %= kStorageSize;
-    mAiqResults[index]->mSequence = -1;
+    AiqResult* aiqResult = mAiqResults.acquire();
+    aiqResult->mSequence = -1;
 
-    return mAiqResults[index];
+    return aiqResult;
 }
 
 void AiqResultStorage::updateAiqResult(int64_t sequence) {
-    AutoWMutex wlock(mDataLock);
-
-    mCurrentIndex++;
-    mCurrentIndex %= kStorageSize;
-    mAiqResults[mCurrentIndex]->mSequence = sequence;
+    AiqResult* aiqResult = mAiqResults.pending();
+    aiqResult->mSequence = sequence;
+    if (!mAiqResults.publish(sequence)) {
+        LOGW("<seq%ld>%s: all the aiq results are in use, the result is dropped", sequence,
+             __func__);
+    }
 }
 
 const AiqResult* AiqResultStorage::getAiqResult(int64_t sequence) {
-    AutoRMutex rlock(mDataLock);
-
-    // Sequence id is -1 means user wants get the latest result.
-    if (sequence == -1) {
-        // If mCurrentIndex is -1, that means no result is saved to the storage yet,
-        // just return the first one in this case.
-        return mAiqResults[(mCurrentIndex == -1) ? 0 : mCurrentIndex];
-    }
-
-    for (int i = 0; i < kStorageSize; i++) {
-        // Search from the newest result
-        int tmpIdx = (mCurrentIndex + kStorageSize - i) % kStorageSize;
-        if (mAiqResults[tmpIdx]->mSequence >= 0 && sequence >= mAiqResults[tmpIdx]->mSequence) {
-            return mAiqResults[tmpIdx];
-        }
-    }
+    return mAiqResults.get(sequence);
+}
 
-    return nullptr;
+AiqResultStorage::AiqResultRef AiqResultStorage::getAiqResultRef(int64_t sequence) {
+    return mAiqResults.getRef(sequence);
 }
 
 void AiqResultStorage::updateDvsRunMap(int64_t sequence) {
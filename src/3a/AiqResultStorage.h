@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <map>
 
 #include "AiqResult.h"
@@ -30,6 +31,7 @@
 #include "iutils/Utils.h"
 #include "iutils/Thread.h"
 #include "iutils/RWLock.h"
+#include "iutils/SequenceRing.h"
 
 namespace icamera {
 
@@ -41,9 +43,16 @@ namespace icamera {
  *
  * It's a singleton based on camera id, and its life cycle can be maintained by
  * its static methods getInstance and releaseAiqResultStorage.
+ *
+ * The AiqResults are written by the 3A thread only, and kept in a SequenceRing, so they're read
+ * without lock. The readers which hold the result for a while pin it with AiqResultRef, and
+ * acquireAiqResult() never recycles a pinned result.
  */
 class AiqResultStorage {
  public:
+    // Keep one AiqResult pinned in the storage until it's destroyed or reassigned.
+    typedef SequenceRing<AiqResult, MAX_SETTING_COUNT>::Ref AiqResultRef;
+
     /**
      * \brief Get internal instance for cameraId.
      *
@@ -76,10 +85,9 @@ class AiqResultStorage {
     /**
      * \brief Get the pointer of aiq result to internal storage by given sequence id.
      *
-     * The function will return the internal pointer of AiqResult, the caller MUST use this
-     * pointer quickly, let's say less than 10ms. For any time-consuming operations, it's
-     * the caller's responsibility to do a deep-copy, otherwise the data in returned AiqResult
-     * may not be consistent.
+     * The function will return the internal pointer of AiqResult, which isn't pinned and may
+     * be overwritten by the next acquireAiqResult(). So it's only for the 3A thread which
+     * writes the results, the other threads MUST use getAiqResultRef().
      *
      * param[in] int64_t sequence: specify which aiq result is needed.
      *
@@ -92,6 +100,15 @@ class AiqResultStorage {
      */
     const AiqResult* getAiqResult(int64_t sequence = -1);
 
+    /**
+     * \brief Get the aiq result like getAiqResult(), and pin it in the storage.
+     *
+     * The result isn't overwritten until the returned AiqResultRef is released, so it's safe
+     * to be used for long time. Note the storage space is limited, so DON'T hold it for more
+     * than several frames.
+     */
+    AiqResultRef getAiqResultRef(int64_t sequence = -1);
+
     /**
      * \brief Acquire AIQ statistics.
      *
@@ -142,11 +159,12 @@ class AiqResultStorage {
     static Mutex sLock;
 
     int mCameraId;
-    RWLock mDataLock;  // lock for all the data storage below
 
     static const int kStorageSize = MAX_SETTING_COUNT;  // Should > MAX_BUFFER_COUNT + sensorLag
-    int mCurrentIndex = -1;
-    AiqResult* mAiqResults[kStorageSize];
+    // The aiq results are lock free, and only written by the 3A thread.
+    SequenceRing<AiqResult, kStorageSize> mAiqResults;
+
+    RWLock mDataLock;  // lock for all the data storage below
 
     static const int kAiqStatsStorageSize = 3;  // Always use the latest, but may hold for long time
     int mCurrentAiqStatsIndex = -1;
@@ -205,9 +205,9 @@ void Dvs::handleEvent(EventData eventData) {
         (eventData.data.dvsRunReady.region.bottom == mZoomRegion.bottom)) return;
 
     int64_t sequence = eventData.data.dvsRunReady.sequence;
-    AiqResult* aiqResults = const_cast<AiqResult*>(
-        AiqResultStorage::getInstance(mCameraId)->getAiqResult(sequence));
-    if (aiqResults == nullptr) return;
+    AiqResultStorage::AiqResultRef aiqResults =
+        AiqResultStorage::getInstance(mCameraId)->getAiqResultRef(sequence);
+    if (!aiqResults) return;
 
     setParameter(eventData.data.dvsRunReady.region);
 
@@ -239,9 +239,7 @@ void Dvs::handleEvent(EventData eventData) {
     } else {
         zp.zoom_region = {ptzRegion.left, ptzRegion.top, ptzRegion.right, ptzRegion.bottom};
     }
-    intelCcaHandle->updateZoom(streamId, zp);
-
-    ia_err iaErr = intelCcaHandle->runDVS(streamId, aiqResults->mFrameId);
+    ia_err iaErr = intelCcaHandle->runDVS(streamId, aiqResults->mFrameId, zp);
     int ret = AiqUtils::convertError(iaErr);
     CheckAndLogError(ret != OK, VOID_VALUE, "Error running DVS: %d", ret);
 
@@ -34,6 +34,25 @@
 
 namespace icamera {
 
+// Pin the aiq result of the sequence, the ltm thread may use it after the 3A thread moves on
+static AiqResultStorage::AiqResultRef getFeedbackResult(int cameraId, int64_t sequence) {
+    int64_t ltmSequence = sequence;
+    AiqResultStorage* resultStorage = AiqResultStorage::getInstance(cameraId);
+    if (ltmSequence > 0) {
+        ltmSequence += PlatformData::getLtmGainLag(cameraId);
+    }
+
+    LOG2("<seq%ld>%s, ltmSequence %ld", sequence, __func__, ltmSequence);
+    AiqResultStorage::AiqResultRef feedback = resultStorage->getAiqResultRef(ltmSequence);
+    if (!feedback) {
+        LOGW("%s: no feed back result for sequence %ld! use the latest instead", __func__,
+             ltmSequence);
+        feedback = resultStorage->getAiqResultRef();
+    }
+
+    return feedback;
+}
+
 Ltm::Ltm(int cameraId)
         : mCameraId(cameraId),
           mTuningMode(TUNING_MODE_MAX),
@@ -182,24 +201,6 @@ void Ltm::handleEvent(EventData eventData) {
     handleSisLtm(eventData.buffer);
 }
 
-AiqResult* Ltm::getAiqResult(int64_t sequence) {
-    int64_t ltmSequence = sequence;
-    AiqResultStorage* resultStorage = AiqResultStorage::getInstance(mCameraId);
-    if (ltmSequence > 0) {
-        ltmSequence += PlatformData::getLtmGainLag(mCameraId);
-    }
-
-    LOG2("<seq%ld>%s, ltmSequence %ld", sequence, __func__, ltmSequence);
-    AiqResult* feedback = const_cast<AiqResult*>(resultStorage->getAiqResult(ltmSequence));
-    if (feedback == nullptr) {
-        LOGW("%s: no feed back result for sequence %ld! use the latest instead", __func__,
-             ltmSequence);
-        feedback = const_cast<AiqResult*>(resultStorage->getAiqResult());
-    }
-
-    return feedback;
-}
-
 int Ltm::handleSisLtm(const std::shared_ptr<CameraBuffer>& cameraBuffer) {
     AutoMutex l(mLtmLock);
 
@@ -215,7 +216,8 @@ int Ltm::handleSisLtm(const std::shared_ptr<CameraBuffer>& cameraBuffer) {
 
     int sequence = cameraBuffer->getSequence();
     mLtmParams[mInputParamIndex]->sequence = sequence;
-    AiqResult* feedback = getAiqResult(sequence);
+    AiqResultStorage::AiqResultRef feedback = getFeedbackResult(mCameraId, sequence);
+    CheckAndLogError(!feedback, UNKNOWN_ERROR, "<seq%d>no aiq result for ltm", sequence);
     mLtmParams[mInputParamIndex]->ltmParams.ev_shift = feedback->mAiqParam.evShift;
     mLtmParams[mInputParamIndex]->ltmParams.ltm_strength_manual = feedback->mAiqParam.ltmStrength;
     mLtmParams[mInputParamIndex]->ltmParams.frame_width = mFrameResolution.width;
@@ -75,8 +75,6 @@ class Ltm : public EventListener {
     int runLtmAsync();
     int runLtm(const LtmInputParams& ltmInputParams);
 
-    AiqResult* getAiqResult(int64_t sequence);
-
  private:
     /**
      * \brief The ltm thread
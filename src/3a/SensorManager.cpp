@@ -78,7 +78,9 @@ void SensorManager::handleSofEvent(EventData eventData) {
         LOG2("<seq%ld> SOF timestamp = %ld", eventData.data.sync.sequence,
              TIMEVAL2USECS(eventData.data.sync.timestamp));
         mLastSofSequence = eventData.data.sync.sequence;
-        handleSensorExposure();
+        int ret = handleSensorExposure();
+        CheckWarningNoReturn(ret != OK, "<seq%ld>the sensor exposure isn't applied",
+                             mLastSofSequence);
 
         // HDR_FEATURE_S
         handleSensorModeSwitch(eventData.data.sync.sequence);
@@ -166,7 +168,10 @@ int SensorManager::setAWB(float r_per_g, float b_per_g) {
 }
 // HDR_FEATURE_E
 
-void SensorManager::handleSensorExposure() {
+int SensorManager::handleSensorExposure() {
+    // The controls of the frame are written together, the frame duration ahead of the others
+    mSensorHwCtrl->beginControls();
+
     if (mExposureDataMap.find(mLastSofSequence) != mExposureDataMap.end()) {
         const ExposureData& exposureData = mExposureDataMap[mLastSofSequence];
         mSensorHwCtrl->setFrameDuration(exposureData.lineLengthPixels,
@@ -184,6 +189,8 @@ void SensorManager::handleSensorExposure() {
         mSensorHwCtrl->setDigitalGains(mDigitalGainMap[mLastSofSequence]);
         mDigitalGainMap.erase(mLastSofSequence);
     }
+
+    return mSensorHwCtrl->commitControls(mLastSofSequence);
 }
 
 int SensorManager::getCurrentExposureAppliedDelay() {
@@ -220,6 +227,7 @@ uint32_t SensorManager::updateSensorExposure(SensorExpGroup sensorExposures, int
         digitalGains.push_back(digitalGain);
     }
 
+    mSensorHwCtrl->beginControls();
     if (effectSeq > 0) {
         int sensorSeq = mLastSofSequence + mExposureDataMap.size() + 1;
         if (applyingSeq > 0 && applyingSeq == mLastSofSequence) {
@@ -249,6 +257,10 @@ uint32_t SensorManager::updateSensorExposure(SensorExpGroup sensorExposures, int
         mSensorHwCtrl->setAnalogGains(analogGains);
         mSensorHwCtrl->setDigitalGains(digitalGains);
     }
+    int ret = mSensorHwCtrl->commitControls(mLastSofSequence);
+    // The queued ones are written at the next SOFs, only the controls of this call are lost
+    CheckWarningNoReturn(ret != OK, "<seq%ld>@%s: the sensor exposure isn't applied",
+                         mLastSofSequence, __func__);
 
     LOG2("<seq%ld>@%s: effectSeq %ld, applyingSeq %ld", mLastSofSequence, __func__, effectSeq,
          applyingSeq);
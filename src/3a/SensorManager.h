@@ -79,7 +79,7 @@ class SensorManager {
  private:
     DISALLOW_COPY_AND_ASSIGN(SensorManager);
 
-    void handleSensorExposure();
+    int handleSensorExposure();
     // HDR_FEATURE_S
     void handleSensorModeSwitch(int64_t sequence);
     int convertTuningModeToWdrMode(TuningMode tuningMode);
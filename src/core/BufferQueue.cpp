@@ -18,11 +18,15 @@
 
 #include "BufferQueue.h"
 
+#include <tuple>
+
 #include "PlatformData.h"
 #include "iutils/CameraLog.h"
 
 namespace icamera {
 
+const size_t BufferQueue::kBufferRingSize;
+
 BufferProducer::BufferProducer(int memType) : mMemType(memType) {
     LOG1("@%s BufferProducer %p created mMemType: %d", __func__, this, mMemType);
 }
@@ -38,25 +42,22 @@ BufferQueue::~BufferQueue() {}
 
 int BufferQueue::queueInputBuffer(Port port, const std::shared_ptr<CameraBuffer>& camBuffer) {
     // If it's not in mInputQueue, then it's not for this processor.
-    if (mInputQueue.find(port) == mInputQueue.end()) {
+    auto it = mInputQueue.find(port);
+    if (it == mInputQueue.end()) {
         return OK;
     }
 
     LOG2("%s CameraBuffer %p for port:%d", __func__, camBuffer.get(), port);
 
-    CameraBufQ& input = mInputQueue[port];
-    bool needSignal = input.empty();
-    input.push(camBuffer);
-    if (needSignal) {
-        mFrameAvailableSignal.signal();
-    }
+    CheckAndLogError(!it->second.push(camBuffer), NO_MEMORY, "Input ring of port:%d is full",
+                     port);
+    mFrameAvailableSignal.signal();
 
     return OK;
 }
 
 int BufferQueue::onFrameAvailable(Port port, const std::shared_ptr<CameraBuffer>& camBuffer) {
-    AutoMutex l(mBufferQueueLock);
-
+    // Lock free, the rings are only re-created in clearBufferQueues() before streaming
     return queueInputBuffer(port, camBuffer);
 }
 
@@ -105,20 +106,16 @@ int BufferQueue::qbuf(Port port, const std::shared_ptr<CameraBuffer>& camBuffer)
     LOG2("%s CameraBuffer %p for port:%d", __func__, camBuffer.get(), port);
 
     // Enqueue buffer to internal pool
-    AutoMutex l(mBufferQueueLock);
     if (camBuffer != nullptr && camBuffer->getStreamType() == CAMERA_STREAM_INPUT) {
         return queueInputBuffer(port, camBuffer);
     }
 
-    CheckAndLogError(mOutputQueue.find(port) == mOutputQueue.end(), BAD_VALUE,
-                     "Not supported port:%d", port);
+    auto it = mOutputQueue.find(port);
+    CheckAndLogError(it == mOutputQueue.end(), BAD_VALUE, "Not supported port:%d", port);
 
-    CameraBufQ& output = mOutputQueue[port];
-    bool needSignal = output.empty();
-    output.push(camBuffer);
-    if (needSignal) {
-        mOutputAvailableSignal.signal();
-    }
+    CheckAndLogError(!it->second.push(camBuffer), NO_MEMORY, "Output ring of port:%d is full",
+                     port);
+    mOutputAvailableSignal.signal();
 
     return OK;
 }
@@ -128,12 +125,14 @@ void BufferQueue::clearBufferQueues() {
 
     mInputQueue.clear();
     for (const auto& input : mInputFrameInfo) {
-        mInputQueue[input.first] = CameraBufQ();
+        mInputQueue.emplace(std::piecewise_construct, std::forward_as_tuple(input.first),
+                            std::forward_as_tuple(kBufferRingSize));
     }
 
     mOutputQueue.clear();
     for (const auto& output : mOutputFrameInfo) {
-        mOutputQueue[output.first] = CameraBufQ();
+        mOutputQueue.emplace(std::piecewise_construct, std::forward_as_tuple(output.first),
+                             std::forward_as_tuple(kBufferRingSize));
     }
 }
 
@@ -151,17 +150,19 @@ void BufferQueue::getFrameInfo(std::map<Port, stream_t>& inputInfo,
     outputInfo = mOutputFrameInfo;
 }
 
-bool BufferQueue::waitBufferQueue(ConditionLock& lock, std::map<Port, CameraBufQ>& queue,
+bool BufferQueue::waitBufferQueue(ConditionLock& lock, std::map<Port, CameraBufRing>& queue,
                                   int64_t timeout) {
     LOG2("@%s waiting buffers", __func__);
     for (auto& bufQ : queue) {
+        // Take the key before checking the ring, so a push in between wakes us up at once.
+        uint32_t key = mFrameAvailableSignal.key();
         if (bufQ.second.empty() && timeout > 0) {
             // Thread was stopped during wait
             if (!mThreadRunning) {
                 LOG1("@%s: inactive while waiting for buffers", __func__);
                 return false;
             }
-            mFrameAvailableSignal.waitRelative(lock, timeout * SLOWLY_MULTIPLIER);
+            mFrameAvailableSignal.waitRelative(lock, key, timeout * SLOWLY_MULTIPLIER);
         }
         if (bufQ.second.empty()) return false;
     }
@@ -184,10 +185,13 @@ int BufferQueue::waitFreeBuffersInQueue(ConditionLock& lock,
     LOG2("@%s start waiting the input and output buffers", __func__);
     for (auto& input : mInputQueue) {
         Port port = input.first;
-        CameraBufQ& inputQueue = input.second;
-        while (inputQueue.empty()) {
+        CameraBufRing& inputQueue = input.second;
+        while (true) {
+            uint32_t key = mFrameAvailableSignal.key();
+            if (!inputQueue.empty()) break;
+
             LOG2("%s: wait input port %d", __func__, port);
-            ret = mFrameAvailableSignal.waitRelative(lock, timeout);
+            ret = mFrameAvailableSignal.waitRelative(lock, key, timeout);
 
             // Thread was stopped during wait
             if (!mThreadRunning) {
@@ -205,10 +209,13 @@ int BufferQueue::waitFreeBuffersInQueue(ConditionLock& lock,
 
     for (auto& output : mOutputQueue) {
         Port port = output.first;
-        CameraBufQ& outputQueue = output.second;
-        while (outputQueue.empty()) {
+        CameraBufRing& outputQueue = output.second;
+        while (true) {
+            uint32_t key = mOutputAvailableSignal.key();
+            if (!outputQueue.empty()) break;
+
             LOG2("%s: wait output port %d", __func__, port);
-            ret = mOutputAvailableSignal.waitRelative(lock, timeout);
+            ret = mOutputAvailableSignal.waitRelative(lock, key, timeout);
 
             // Thread was stopped during wait
             if (!mThreadRunning) {
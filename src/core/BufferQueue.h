@@ -22,6 +22,7 @@
 #include "CameraBuffer.h"
 #include "CameraEvent.h"
 #include "iutils/Errors.h"
+#include "iutils/LockFreeRing.h"
 #include "iutils/Thread.h"
 
 /**
@@ -29,6 +30,13 @@
  */
 namespace icamera {
 
+/**
+ * Buffer ring for each port of BufferQueue.
+ * Producers (onFrameAvailable/qbuf) push without lock, the processor thread consumes
+ * it with mBufferQueueLock held.
+ */
+typedef LockFreeRing<std::shared_ptr<CameraBuffer> > CameraBufRing;
+
 class BufferProducer;
 
 /**
@@ -154,7 +162,8 @@ class BufferQueue : public BufferConsumer, public BufferProducer, public EventLi
      *
      * No waiting if timeout value is zero
      */
-    bool waitBufferQueue(ConditionLock& lock, std::map<Port, CameraBufQ>& queue, int64_t timeout);
+    bool waitBufferQueue(ConditionLock& lock, std::map<Port, CameraBufRing>& queue,
+                         int64_t timeout);
     /**
      * \brief Wait for available input and output buffers.
      *
@@ -189,6 +198,8 @@ class BufferQueue : public BufferConsumer, public BufferProducer, public EventLi
         }
     };
     static const nsecs_t kWaitDuration = 10000000000;  // 10000ms
+    // Max buffers in flight for each port, much more than MAX_BUFFER_COUNT
+    static const size_t kBufferRingSize = 64;
 
     BufferProducer* mBufferProducer;
     std::vector<BufferConsumer*> mBufferConsumerList;
@@ -196,16 +207,16 @@ class BufferQueue : public BufferConsumer, public BufferProducer, public EventLi
     std::map<Port, stream_t> mInputFrameInfo;
     std::map<Port, stream_t> mOutputFrameInfo;
 
-    std::map<Port, CameraBufQ> mInputQueue;
-    std::map<Port, CameraBufQ> mOutputQueue;
+    std::map<Port, CameraBufRing> mInputQueue;
+    std::map<Port, CameraBufRing> mOutputQueue;
 
     // For internal buffers allocation for producer
     std::map<Port, CameraBufVector> mInternalBuffers;
 
-    // Guard for BufferQueue public API
+    // Guard for BufferQueue public API, the buffer rings are pushed without it
     Mutex mBufferQueueLock;
-    Condition mFrameAvailableSignal;
-    Condition mOutputAvailableSignal;
+    FutexSignal mFrameAvailableSignal;
+    FutexSignal mOutputAvailableSignal;
 
     // for the thread loop
     ProcessThread* mProcessThread;
@@ -28,7 +28,9 @@
 
 #include "PlatformData.h"
 #include "iutils/CameraLog.h"
+#include "iutils/DmaBufMapCache.h"
 #include "iutils/Utils.h"
+#include "v4l2/SysCall.h"
 
 namespace icamera {
 CameraBuffer::CameraBuffer(int cameraId, int usage, int memory, uint32_t size, int index,
@@ -310,7 +312,7 @@ void CameraBuffer::freeMmap() {
             setFd(-1, i);
         }
         if (mMmapAddrs[i]) {
-            ret = ::munmap(mMmapAddrs[i], mV.Length(i));
+            ret = SysCall::getInstance()->munmap(mMmapAddrs[i], mV.Length(i));
             CheckAndLogError(ret != 0, VOID_VALUE, "failed to munmap buffer %d", i);
             mMmapAddrs[i] = nullptr;
         }
@@ -321,14 +323,14 @@ void* CameraBuffer::mapDmaBufferAddr(int fd, unsigned int bufferSize) {
     CheckAndLogError(fd < 0 || !bufferSize, nullptr, "%s, fd:0x%x, bufferSize:%u", __func__, fd,
                      bufferSize);
 
-    return ::mmap(nullptr, bufferSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return DmaBufMapCache::map(fd, bufferSize);
 }
 
 void CameraBuffer::unmapDmaBufferAddr(void* addr, unsigned int bufferSize) {
     CheckAndLogError(addr == nullptr || !bufferSize, VOID_VALUE, "%s, addr:%p, bufferSize:%u",
                      __func__, addr, bufferSize);
 
-    munmap(addr, bufferSize);
+    DmaBufMapCache::unmap(addr, bufferSize);
 }
 
 void CameraBuffer::freeMemory() {
@@ -405,6 +407,8 @@ void* ScopeMapping::getUserPtr() {
 
     if (!mUserPtr) {
         mUserPtr = CameraBuffer::mapDmaBufferAddr(mCameraBuf->getFd(), mCameraBuf->getBufferSize());
+        CheckAndLogError(!mUserPtr, nullptr, "%s, failed to map the buffer of fd %d", __func__,
+                         mCameraBuf->getFd());
     }
 
     return mUserPtr;
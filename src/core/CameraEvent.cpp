@@ -18,54 +18,205 @@
 
 #include "CameraEvent.h"
 
+#include <algorithm>
+#include <utility>
+
 #include "iutils/CameraLog.h"
 
 namespace icamera {
 
+// The sources whose events are being delivered on the current thread, the listeners removed
+// from inside a delivery of the same source can't wait for its running deliveries.
+static thread_local std::vector<const EventSource*> sDeliveringSources;
+static const size_t kDispatchQueueWarningSize = 64;
+
+static bool isDeliveringOnThisThread(const EventSource* source) {
+    return std::find(sDeliveringSources.begin(), sDeliveringSources.end(), source) !=
+           sDeliveringSources.end();
+}
+
+class ScopedDelivery {
+ public:
+    explicit ScopedDelivery(const EventSource* source) { sDeliveringSources.push_back(source); }
+    ~ScopedDelivery() { sDeliveringSources.pop_back(); }
+};
+
+/**
+ * Deliver the events of the async listeners in order on its own thread.
+ */
+class EventSource::EventDispatcher : public Thread {
+ public:
+    explicit EventDispatcher(const EventSource* source)
+            : mSource(source),
+              mDelivering(nullptr),
+              mExiting(false) {
+        run("EventDispatcher", PRIORITY_NORMAL);
+    }
+    ~EventDispatcher() {
+        requestExit();
+        requestExitAndWait();
+    }
+
+    void requestExit() {
+        AutoMutex l(mLock);
+        mExiting = true;
+        Thread::requestExit();
+        mEventSignal.signal();
+    }
+
+    void post(EventListener* listener, const EventData& eventData) {
+        AutoMutex l(mLock);
+        mEvents.push_back(std::make_pair(listener, eventData));
+        if (mEvents.size() == kDispatchQueueWarningSize) {
+            LOGW("%s: %zu events are pending, a listener is too slow", __func__, mEvents.size());
+        }
+        mEventSignal.signal();
+    }
+
+    // Drop the pending events of the listener, and wait for its running delivery if required
+    void cancel(EventListener* listener, bool wait) {
+        ConditionLock lock(mLock);
+        mEvents.erase(std::remove_if(mEvents.begin(), mEvents.end(),
+                                     [listener](const std::pair<EventListener*, EventData>& e) {
+                                         return e.first == listener;
+                                     }),
+                      mEvents.end());
+        while (wait && mDelivering == listener) {
+            mDeliveredSignal.wait(lock);
+        }
+    }
+
+    bool threadLoop() {
+        std::pair<EventListener*, EventData> event;
+        {
+            ConditionLock lock(mLock);
+            while (mEvents.empty() && !mExiting) {
+                mEventSignal.wait(lock);
+            }
+            if (mExiting) return false;
+
+            event = mEvents.front();
+            mEvents.pop_front();
+            mDelivering = event.first;
+        }
+
+        {
+            ScopedDelivery delivery(mSource);
+            event.first->handleEvent(event.second);
+        }
+
+        AutoMutex l(mLock);
+        mDelivering = nullptr;
+        mDeliveredSignal.broadcast();
+        return true;
+    }
+
+ private:
+    const EventSource* mSource;
+
+    Mutex mLock;  // Guard the fields below
+    Condition mEventSignal;
+    Condition mDeliveredSignal;
+    std::deque<std::pair<EventListener*, EventData>> mEvents;
+    EventListener* mDelivering;
+    bool mExiting;
+};
+
+EventSource::EventSource()
+        : mListeners(std::make_shared<const ListenerMap>()),
+          mGraceWaiters(0) {}
+
+EventSource::~EventSource() {}
+
+void EventSource::updateListeners(EventType eventType, EventListener* eventListener, bool add) {
+    std::shared_ptr<const ListenerMap> oldListeners;
+    EventDispatcher* dispatcher = nullptr;
+    {
+        AutoMutex l(mListenersLock);
+
+        std::shared_ptr<ListenerMap> listeners = std::make_shared<ListenerMap>(*mListeners);
+        std::vector<EventListener*>& listenersOfType = (*listeners)[eventType];
+        auto it = std::find(listenersOfType.begin(), listenersOfType.end(), eventListener);
+        if (add) {
+            if (it != listenersOfType.end()) return;
+            if (eventListener->isAsyncDelivery() && !mDispatcher) {
+                mDispatcher.reset(new EventDispatcher(this));
+            }
+            listenersOfType.push_back(eventListener);
+        } else {
+            if (it == listenersOfType.end()) {
+                LOG1("%s: no listener found for event type %d", __func__, eventType);
+                return;
+            }
+            listenersOfType.erase(it);
+            if (listenersOfType.empty()) listeners->erase(eventType);
+        }
+
+        oldListeners =
+            std::atomic_exchange(&mListeners, std::shared_ptr<const ListenerMap>(listeners));
+        if (add) return;
+        dispatcher = mDispatcher.get();
+    }
+
+    // Grace period: wait for the deliveries which may still use the old snapshot, so the
+    // listener isn't called after it's removed. It's done without mListenersLock, so the
+    // other updaters aren't blocked by a slow delivery.
+    bool nested = isDeliveringOnThisThread(this);
+    if (!nested) {
+        ConditionLock lock(mGraceLock);
+        mGraceWaiters.fetch_add(1, std::memory_order_seq_cst);
+        // Pairs with the fence in notifyListeners(), so either it sees the waiter or we see
+        // its reference released.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (oldListeners.use_count() > 1) {
+            mSnapshotReleased.wait(lock);
+        }
+        mGraceWaiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+    if (dispatcher) dispatcher->cancel(eventListener, !nested);
+}
+
 void EventSource::registerListener(EventType eventType, EventListener* eventListener) {
     LOG1("@%s eventType: %d, listener: %p", __func__, eventType, eventListener);
 
     CheckAndLogError(eventListener == nullptr, VOID_VALUE,
                      "%s: event listener is nullptr, skip registration.", __func__);
 
-    AutoMutex l(mListenersLock);
-
-    std::set<EventListener*> listenersOfType;
-    if (mListeners.find(eventType) != mListeners.end()) {
-        listenersOfType = mListeners[eventType];
-    }
-
-    listenersOfType.insert(eventListener);
-    mListeners[eventType] = listenersOfType;
+    updateListeners(eventType, eventListener, true);
 }
 
 void EventSource::removeListener(EventType eventType, EventListener* eventListener) {
     LOG1("@%s eventType: %d, listener: %p", __func__, eventType, eventListener);
-    AutoMutex l(mListenersLock);
-
-    if (mListeners.find(eventType) == mListeners.end()) {
-        LOG1("%s: no listener found for event type %d", __func__, eventType);
-        return;
-    }
 
-    std::set<EventListener*> listenersOfType = mListeners[eventType];
-    listenersOfType.erase(eventListener);
-    mListeners[eventType] = listenersOfType;
+    updateListeners(eventType, eventListener, false);
 }
 
 void EventSource::notifyListeners(EventData eventData) {
     LOG2("@%s eventType: %d", __func__, eventData.type);
-    AutoMutex l(mListenersLock);
+    std::shared_ptr<const ListenerMap> listeners = std::atomic_load(&mListeners);
 
-    if (mListeners.find(eventData.type) == mListeners.end()) {
+    auto it = listeners->find(eventData.type);
+    if (it == listeners->end()) {
         LOG2("%s: no listener found for event type %d", __func__, eventData.type);
-        return;
+    } else {
+        ScopedDelivery delivery(this);
+        for (auto listener : it->second) {
+            LOG2("%s: send event data to listener %p for event type %d", __func__, listener,
+                 eventData.type);
+            if (listener->isAsyncDelivery()) {
+                mDispatcher->post(listener, eventData);
+            } else {
+                listener->handleEvent(eventData);
+            }
+        }
     }
 
-    for (auto listener : mListeners[eventData.type]) {
-        LOG2("%s: send event data to listener %p for event type %d", __func__, listener,
-             eventData.type);
-        listener->handleEvent(eventData);
+    // Release the snapshot, and wake up the removers waiting for it only if there are any
+    listeners.reset();
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mGraceWaiters.load(std::memory_order_relaxed) > 0) {
+        AutoMutex l(mGraceLock);
+        mSnapshotReleased.broadcast();
     }
 }
 
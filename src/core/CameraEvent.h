@@ -16,8 +16,11 @@
 
 #pragma once
 
+#include <atomic>
+#include <deque>
 #include <map>
-#include <set>
+#include <memory>
+#include <vector>
 
 #include "CameraEventType.h"
 #include "iutils/Thread.h"
@@ -26,21 +29,48 @@ namespace icamera {
 
 class EventListener {
  public:
-    EventListener() {}
+    EventListener() : mAsyncDelivery(false) {}
     virtual ~EventListener() {}
     virtual void handleEvent(EventData eventData) {}
+
+    /**
+     * Deliver the events from the dispatch thread of the source instead of the notifying
+     * thread, so a slow listener doesn't delay the others. MUST be set before registration.
+     * The pointers in the event data must stay valid until the event is handled.
+     */
+    void setAsyncDelivery(bool async) { mAsyncDelivery = async; }
+    bool isAsyncDelivery() const { return mAsyncDelivery; }
+
+ private:
+    bool mAsyncDelivery;
 };
 
 class EventSource {
  private:
-    std::map<EventType, std::set<EventListener*>> mListeners;
+    typedef std::map<EventType, std::vector<EventListener*>> ListenerMap;
+
+    /**
+     * The listeners are published as immutable snapshots: notifyListeners() reads the
+     * current one without holding mListenersLock, and the updaters replace it.
+     */
+    std::shared_ptr<const ListenerMap> mListeners;
 
-    // Guard for EventSource public API to protect mListeners.
+    // Serialize the updaters of mListeners.
     Mutex mListenersLock;
 
+    // The removers wait on it for the deliveries holding the old snapshot to finish
+    Mutex mGraceLock;
+    Condition mSnapshotReleased;
+    std::atomic<int> mGraceWaiters;
+
+    class EventDispatcher;
+    std::unique_ptr<EventDispatcher> mDispatcher;  // Created for the first async listener
+
+    void updateListeners(EventType eventType, EventListener* eventListener, bool add);
+
  public:
-    EventSource() {}
-    virtual ~EventSource() {}
+    EventSource();
+    virtual ~EventSource();
     virtual void registerListener(EventType eventType, EventListener* eventListener);
     virtual void removeListener(EventType eventType, EventListener* eventListener);
     virtual void notifyListeners(EventData eventData);
@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG CaptureReactor
+
+#include "CaptureReactor.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "iutils/CameraLog.h"
+#include "iutils/Errors.h"
+
+namespace icamera {
+
+static const uint32_t kDeviceEvents = EPOLLPRI | EPOLLIN | EPOLLOUT | EPOLLONESHOT;
+
+CaptureReactor* CaptureReactor::getInstance() {
+    static CaptureReactor* sInstance = [] {
+        const char* threads = getenv("cameraCaptureReactor");
+        int threadCount = threads ? atoi(threads) : 0;
+        if (threadCount <= 0) return static_cast<CaptureReactor*>(nullptr);
+
+        std::vector<int> cpus;
+        const char* cpuList = getenv("cameraCaptureReactorCpus");
+        while (cpuList && *cpuList) {
+            char* end = nullptr;
+            long cpu = strtol(cpuList, &end, 0);
+            if (end == cpuList) break;
+            if (cpu >= 0 && cpu < CPU_SETSIZE) cpus.push_back(static_cast<int>(cpu));
+            cpuList = (*end == ',') ? end + 1 : end;
+        }
+        // Never released since the clients may be in any camera of the process
+        return new CaptureReactor(threadCount, cpus);
+    }();
+    return sInstance;
+}
+
+CaptureReactor::CaptureReactor(int threadCount, const std::vector<int>& cpus)
+        : mCpus(cpus),
+          mStarted(false) {
+    LOG1("%s, %d threads on %zu cpus", __func__, threadCount, cpus.size());
+    mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (mEpollFd < 0) LOGE("%s, epoll_create1 fails: %s", __func__, strerror(errno));
+
+    for (int i = 0; i < threadCount; i++) {
+        mThreads.push_back(std::unique_ptr<ReactorThread>(new ReactorThread(this)));
+    }
+}
+
+CaptureReactor::~CaptureReactor() {
+    for (auto& thread : mThreads) thread->requestExitAndWait();
+    if (mEpollFd >= 0) close(mEpollFd);
+}
+
+int CaptureReactor::armDevice(int fd, int op) {
+    struct epoll_event event;
+    CLEAR(event);
+    event.events = kDeviceEvents;
+    event.data.fd = fd;
+    return epoll_ctl(mEpollFd, op, fd, &event);
+}
+
+int CaptureReactor::addClient(Client* client, const std::vector<V4L2Device*>& devices,
+                              int timeoutMs) {
+    CheckAndLogError(!client || devices.empty(), BAD_VALUE, "%s, invalid client", __func__);
+    CheckAndLogError(mEpollFd < 0, NO_INIT, "%s, no epoll fd", __func__);
+
+    AutoMutex l(mLock);
+    CheckAndLogError(mClients.find(client) != mClients.end(), INVALID_OPERATION,
+                     "%s, client %p is added", __func__, client);
+
+    ClientState& state = mClients[client];
+    state.timeout = static_cast<nsecs_t>(timeoutMs) * 1000000;
+    state.lastActiveTime = CameraUtils::systemTime();
+    state.timedOut = false;
+    state.busy = false;
+    state.removed = false;
+
+    int deviceCount = 0;
+    for (auto device : devices) {
+        int fd = device->Fd();
+        if (fd < 0 || armDevice(fd, EPOLL_CTL_ADD) != 0) {
+            LOGE("%s, can't wait on %s: %s", __func__, device->Name().c_str(), strerror(errno));
+            continue;
+        }
+        mDevices[fd] = {client, device, 0};
+        deviceCount++;
+        LOG1("%s, client %p device %s fd %d", __func__, client, device->Name().c_str(), fd);
+    }
+    if (deviceCount == 0) {
+        mClients.erase(client);
+        LOGE("%s, client %p has no device to wait on", __func__, client);
+        return UNKNOWN_ERROR;
+    }
+
+    if (!mStarted) {
+        for (size_t i = 0; i < mThreads.size(); i++) {
+            std::string name = "CaptureReactor" + std::to_string(i);
+            mThreads[i]->run(name, PRIORITY_URGENT_AUDIO);
+        }
+        mStarted = true;
+    }
+    return OK;
+}
+
+void CaptureReactor::removeClient(Client* client) {
+    ConditionLock lock(mLock);
+    auto it = mClients.find(client);
+    if (it == mClients.end()) return;
+
+    for (auto entry = mDevices.begin(); entry != mDevices.end();) {
+        if (entry->second.client == client) {
+            epoll_ctl(mEpollFd, EPOLL_CTL_DEL, entry->first, nullptr);
+            entry = mDevices.erase(entry);
+        } else {
+            entry++;
+        }
+    }
+
+    it->second.removed = true;
+    while (it->second.busy) mClientIdle.wait(lock);
+    mClients.erase(it);
+    LOG1("%s, client %p", __func__, client);
+}
+
+bool CaptureReactor::ReactorThread::threadLoop() {
+    if (!mBound && !mReactor->mCpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (auto cpu : mReactor->mCpus) CPU_SET(cpu, &set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+            LOGW("%s, can't set the affinity", __func__);
+        }
+        mBound = true;
+    }
+    return mReactor->waitEvents();
+}
+
+bool CaptureReactor::waitEvents() {
+    struct epoll_event events[kMaxEvents];
+    int num = epoll_wait(mEpollFd, events, kMaxEvents, kTickMs);
+    if (num < 0 && errno != EINTR) {
+        LOGE("%s, epoll_wait fails: %s", __func__, strerror(errno));
+        return false;
+    }
+
+    for (int i = 0; i < num; i++) {
+        int fd = events[i].data.fd;
+        Client* client = nullptr;
+        {
+            AutoMutex l(mLock);
+            auto entry = mDevices.find(fd);
+            if (entry == mDevices.end()) continue;
+            client = entry->second.client;
+
+            if (!(events[i].events & (EPOLLPRI | EPOLLIN | EPOLLOUT))) {
+                // Still reported to the client like the poll thread does, but not counted as
+                // active, so the client also gets onDeviceTimeout() if the error stays.
+                LOGE("%s, fd %d error, events 0x%x", __func__, fd, events[i].events);
+                entry->second.errorTime = CameraUtils::systemTime();
+            }
+        }
+        dispatch(client, fd);
+    }
+
+    checkTimeouts();
+    return true;
+}
+
+// The fds of one client may be ready on several threads, they're queued to the one which
+// runs the callbacks of the client.
+void CaptureReactor::dispatch(Client* client, int fd) {
+    ConditionLock lock(mLock);
+    auto it = mClients.find(client);
+    if (it == mClients.end()) return;
+
+    ClientState& state = it->second;
+    if (fd >= 0) {
+        state.readyFds.push_back(fd);
+    } else {
+        state.timedOut = true;
+    }
+    if (state.busy) return;
+
+    state.busy = true;
+    while (!state.removed && (state.timedOut || !state.readyFds.empty())) {
+        if (state.timedOut) {
+            state.timedOut = false;
+            lock.unlock();
+            client->onDeviceTimeout();
+            lock.lock();
+            continue;
+        }
+
+        int readyFd = state.readyFds.front();
+        state.readyFds.pop_front();
+        auto entry = mDevices.find(readyFd);
+        if (entry == mDevices.end() || entry->second.client != client) continue;
+
+        V4L2Device* device = entry->second.device;
+        lock.unlock();
+        client->onDeviceReady(device);
+        lock.lock();
+
+        // Wait on it again if it isn't removed during the callback, the one with an error is
+        // waited again by rearmErrorDevices().
+        entry = mDevices.find(readyFd);
+        if (state.removed || entry == mDevices.end() || entry->second.errorTime != 0) continue;
+
+        state.lastActiveTime = CameraUtils::systemTime();
+        if (armDevice(readyFd, EPOLL_CTL_MOD) != 0) {
+            LOGE("%s, can't wait on fd %d again: %s", __func__, readyFd, strerror(errno));
+        }
+    }
+    state.busy = false;
+    mClientIdle.broadcast();
+}
+
+void CaptureReactor::checkTimeouts() {
+    std::vector<Client*> timedOut;
+    {
+        AutoMutex l(mLock);
+        nsecs_t now = CameraUtils::systemTime();
+        rearmErrorDevices(now);
+        for (auto& client : mClients) {
+            ClientState& state = client.second;
+            if (state.busy || state.removed || now - state.lastActiveTime < state.timeout) {
+                continue;
+            }
+            state.lastActiveTime = now;
+            timedOut.push_back(client.first);
+        }
+    }
+
+    for (auto client : timedOut) dispatch(client, -1);
+}
+
+void CaptureReactor::rearmErrorDevices(nsecs_t now) {
+    for (auto& entry : mDevices) {
+        DeviceEntry& device = entry.second;
+        if (device.errorTime == 0 || now - device.errorTime < kTickMs * 1000000LL) continue;
+
+        // The callback of the error may still be running or queued
+        auto client = mClients.find(device.client);
+        if (client == mClients.end() || client->second.busy) continue;
+
+        device.errorTime = 0;
+        if (armDevice(entry.first, EPOLL_CTL_MOD) != 0) {
+            LOGE("%s, can't wait on fd %d again: %s", __func__, entry.first, strerror(errno));
+        }
+    }
+}
+
+}  // namespace icamera
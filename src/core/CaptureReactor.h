@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "iutils/Thread.h"
+#include "iutils/Utils.h"
+
+namespace icamera {
+
+/**
+ * \class CaptureReactor
+ *
+ * CaptureReactor waits on the video nodes of all the cameras with one epoll set, and runs the
+ * callbacks of the owners when the nodes are ready, instead of one poll thread per camera.
+ *
+ * It's enabled by setting cameraCaptureReactor to the number of the reactor threads, and
+ * cameraCaptureReactorCpus to the cpu list (e.g. "2,3") the threads are bound to.
+ * The callbacks of one client are serialized, and one node is waited again only after its
+ * callback returns, so a node with several buffers done is handled once per buffer.
+ * The callbacks run on the threads shared by all the clients, so they must not wait for
+ * the other clients, e.g. the frame sync check between cameras.
+ */
+class CaptureReactor {
+ public:
+    class Client {
+     public:
+        virtual ~Client() {}
+
+        /**
+         * Called when the device has buffers done or events pending, or when it has an error
+         * (EPOLLERR or EPOLLHUP), which the dequeue in the callback finds out.
+         */
+        virtual void onDeviceReady(V4L2Device* device) = 0;
+
+        /**
+         * Called when none of the devices is ready within the timeout of addClient().
+         */
+        virtual void onDeviceTimeout() = 0;
+    };
+
+    /**
+     * Return the process-wide reactor, nullptr if it isn't enabled.
+     */
+    static CaptureReactor* getInstance();
+
+    /**
+     * Wait on the devices of the client, onDeviceTimeout() is called if none of them is ready
+     * within timeoutMs.
+     *
+     * \return OK if at least one device is waited on.
+     */
+    int addClient(Client* client, const std::vector<V4L2Device*>& devices, int timeoutMs);
+
+    /**
+     * Stop waiting on the devices of the client, and wait until its callback returns.
+     */
+    void removeClient(Client* client);
+
+ private:
+    CaptureReactor(int threadCount, const std::vector<int>& cpus);
+    ~CaptureReactor();
+    DISALLOW_COPY_AND_ASSIGN(CaptureReactor);
+
+    class ReactorThread : public Thread {
+     public:
+        explicit ReactorThread(CaptureReactor* reactor) : mReactor(reactor), mBound(false) {}
+        virtual bool threadLoop();
+
+     private:
+        CaptureReactor* mReactor;
+        bool mBound;  // If the affinity is set
+    };
+
+    struct ClientState {
+        nsecs_t timeout;
+        nsecs_t lastActiveTime;
+        std::deque<int> readyFds;
+        bool timedOut;
+        bool busy;     // One thread is running the callbacks
+        bool removed;
+    };
+
+    struct DeviceEntry {
+        Client* client;
+        V4L2Device* device;
+        // When the device had an error, it's waited again after kTickMs instead of at once
+        // since the error may still be there. 0 if no error.
+        nsecs_t errorTime;
+    };
+
+    bool waitEvents();
+    void dispatch(Client* client, int fd);
+    void checkTimeouts();
+    // Wait again on the devices with an error since kTickMs, MUST be called with mLock held.
+    void rearmErrorDevices(nsecs_t now);
+    int armDevice(int fd, int op);
+
+ private:
+    static const int kMaxEvents = 16;
+    static const int kTickMs = 100;  // The timeouts are checked at least once per tick
+
+    int mEpollFd;
+    std::vector<int> mCpus;
+    std::vector<std::unique_ptr<ReactorThread>> mThreads;
+    bool mStarted;
+
+    Mutex mLock;  // Guard the fields below
+    Condition mClientIdle;
+    std::map<Client*, ClientState> mClients;
+    std::map<int, DeviceEntry> mDevices;  // fd -> the device and its owner
+};
+
+}  // namespace icamera
@@ -32,6 +32,16 @@ using std::vector;
 
 namespace icamera {
 
+static const int kPollTimeoutCount = 10;
+
+// The time without any frame before reporting the timeout, normally 10s
+static int getPollTimeoutMs() {
+    const int pollTimeout = gSlowlyRunRatio ? (gSlowlyRunRatio * 100000) : 1000;
+    int timeOutCount = (PlatformData::getMaxIsysTimeout() > 0) ? PlatformData::getMaxIsysTimeout() :
+                                                                 kPollTimeoutCount;
+    return pollTimeout * timeOutCount;
+}
+
 CaptureUnit::CaptureUnit(int cameraId, int memType)
         : StreamSource(memType),
           mCameraId(cameraId),
@@ -42,6 +52,16 @@ CaptureUnit::CaptureUnit(int cameraId, int memType)
     LOG1("<id%d>%s", mCameraId, __func__);
 
     mPollThread = new PollThread(this);
+    mReactor = CaptureReactor::getInstance();
+    // FRAME_SYNC_S
+    if (mReactor && PlatformData::isEnableFrameSyncCheck(mCameraId)) {
+        // The frame sync check waits for the other cameras in the dequeue, which would block
+        // the reactor threads shared with them, so the camera keeps its own poll thread.
+        LOG1("<id%d>%s, frame sync check is enabled, don't use the capture reactor", mCameraId,
+             __func__);
+        mReactor = nullptr;
+    }
+    // FRAME_SYNC_E
     mFlushFd[0] = -1;
     mFlushFd[1] = -1;
 
@@ -199,7 +219,18 @@ int CaptureUnit::start() {
         int readSize = read(mFlushFd[0], reinterpret_cast<void*>(&readBuf), sizeof(char));
         LOG1("%s, readSize %d", __func__, readSize);
     }
-    mPollThread->run("CaptureUnit", PRIORITY_URGENT_AUDIO);
+    if (mReactor) {
+        vector<V4L2Device*> devices;
+        for (auto device : mDevices) devices.push_back(device->getV4l2Device());
+        ret = mReactor->addClient(this, devices, getPollTimeoutMs());
+        if (ret != OK) {
+            streamOff();
+            LOGE("Add devices to capture reactor failed:%d", ret);
+            return ret;
+        }
+    } else {
+        mPollThread->run("CaptureUnit", PRIORITY_URGENT_AUDIO);
+    }
     mState = CAPTURE_START;
     mExitPending = false;
     LOG2("@%s: automation checkpoint: flag: poll_started", __func__);
@@ -228,9 +259,15 @@ int CaptureUnit::stop() {
         LOG1("%s, write size %d", __func__, size);
     }
 
-    mPollThread->requestExit();
-    streamOff();
-    mPollThread->requestExitAndWait();
+    if (mReactor) {
+        // Wait for the running callback before stream off
+        mReactor->removeClient(this);
+        streamOff();
+    } else {
+        mPollThread->requestExit();
+        streamOff();
+        mPollThread->requestExitAndWait();
+    }
 
     AutoMutex l(mLock);
     mState = CAPTURE_STOP;
@@ -378,7 +415,6 @@ int CaptureUnit::processPendingBuffers() {
 int CaptureUnit::poll() {
     PERF_CAMERA_ATRACE();
     int ret = 0;
-    const int poll_timeout_count = 10;
     // Normally set the timeout threshold to 1s
     const int poll_timeout = gSlowlyRunRatio ? (gSlowlyRunRatio * 100000) : 1000;
 
@@ -387,7 +423,7 @@ int CaptureUnit::poll() {
                      "@%s: poll buffer in wrong state %d", __func__, mState);
 
     int timeOutCount = (PlatformData::getMaxIsysTimeout() > 0) ? PlatformData::getMaxIsysTimeout() :
-                                                                 poll_timeout_count;
+                                                                 kPollTimeoutCount;
     std::vector<V4L2Device*> pollDevs, readyDevices;
     for (const auto& device : mDevices) {
         pollDevs.push_back(device->getV4l2Device());
@@ -415,38 +451,46 @@ int CaptureUnit::poll() {
     }
     CheckAndLogError(ret < 0, UNKNOWN_ERROR, "%s: Poll error, ret:%d", __func__, ret);
     if (ret == 0) {
-#ifdef CAL_BUILD
-        LOGI("<id%d>%s, timeout happens, buffer in device: %d. wait recovery", mCameraId, __func__,
-             mDevices.front()->getBufferNumInDevice());
-#else
-        LOG1("<id%d>%s, timeout happens, buffer in device: %d. wait recovery", mCameraId, __func__,
-             mDevices.front()->getBufferNumInDevice());
-#endif
-        if (PlatformData::getMaxIsysTimeout() > 0 && mDevices.front()->getBufferNumInDevice() > 0) {
-            EventData errorData;
-            errorData.type = EVENT_ISYS_ERROR;
-            errorData.buffer = nullptr;
-            notifyListeners(errorData);
-        }
-
+        onDeviceTimeout();
         return OK;
     }
 
     for (const auto& readyDevice : readyDevices) {
-        for (auto device : mDevices) {
-            if (device->getV4l2Device() == readyDevice) {
-                int ret = device->dequeueBuffer();
-                if (mExitPending) return -1;
+        onDeviceReady(readyDevice);
+        if (mExitPending) return -1;
+    }
 
-                if (ret != OK) {
-                    LOGE("Device:%s grab frame failed:%d", device->getName(), ret);
-                }
-                break;
+    return OK;
+}
+
+void CaptureUnit::onDeviceReady(V4L2Device* readyDevice) {
+    for (auto device : mDevices) {
+        if (device->getV4l2Device() == readyDevice) {
+            int ret = device->dequeueBuffer();
+            if (mExitPending) return;
+
+            if (ret != OK) {
+                LOGE("Device:%s grab frame failed:%d", device->getName(), ret);
             }
+            break;
         }
     }
+}
 
-    return OK;
+void CaptureUnit::onDeviceTimeout() {
+#ifdef CAL_BUILD
+    LOGI("<id%d>%s, timeout happens, buffer in device: %d. wait recovery", mCameraId, __func__,
+         mDevices.front()->getBufferNumInDevice());
+#else
+    LOG1("<id%d>%s, timeout happens, buffer in device: %d. wait recovery", mCameraId, __func__,
+         mDevices.front()->getBufferNumInDevice());
+#endif
+    if (PlatformData::getMaxIsysTimeout() > 0 && mDevices.front()->getBufferNumInDevice() > 0) {
+        EventData errorData;
+        errorData.type = EVENT_ISYS_ERROR;
+        errorData.buffer = nullptr;
+        notifyListeners(errorData);
+    }
 }
 
 void CaptureUnit::addFrameAvailableListener(BufferConsumer* listener) {
@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "CameraBuffer.h"
+#include "CaptureReactor.h"
 #include "DeviceBase.h"
 #include "StreamSource.h"
 #include "iutils/Thread.h"
@@ -31,7 +32,7 @@ namespace icamera {
  * It implements the BufferProducer Interface and it is the source of any pipeline
  * It hides the v4l2 and media controller to the upper layer.
  */
-class CaptureUnit : public StreamSource, public DeviceCallback {
+class CaptureUnit : public StreamSource, public DeviceCallback, public CaptureReactor::Client {
  public:
     explicit CaptureUnit(int cameraId, int memType = V4L2_MEMORY_MMAP);
     virtual ~CaptureUnit();
@@ -132,6 +133,10 @@ class CaptureUnit : public StreamSource, public DeviceCallback {
     // Overwrite DeviceCallback API
     void onDequeueBuffer();
 
+    // Overwrite CaptureReactor::Client API
+    void onDeviceReady(V4L2Device* device);
+    void onDeviceTimeout();
+
     int createDevices();
     void destroyDevices();
     DeviceBase* findDeviceByPort(Port port);
@@ -159,6 +164,7 @@ class CaptureUnit : public StreamSource, public DeviceCallback {
 
     PollThread* mPollThread;
     int mFlushFd[2];  // Flush file descriptor
+    CaptureReactor* mReactor;  // Replace mPollThread if it isn't nullptr
 
     // Guard for mCaptureUnit public API except dqbuf and qbuf
     Mutex mLock;
@@ -29,6 +29,7 @@
 #include "V4l2DeviceFactory.h"
 #include "iutils/CameraDump.h"
 #include "iutils/CameraLog.h"
+#include "iutils/LatencyStats.h"
 #include "iutils/Utils.h"
 #include "linux/ipu-isys.h"
 
@@ -236,18 +237,11 @@ shared_ptr<CameraBuffer> DeviceBase::getFirstDeviceBuffer() {
 
 // FRAME_SYNC_S
 bool DeviceBase::skipFrameAfterSyncCheck(int64_t sequence) {
-    // For multi-camera sensor, to check whether the frame synced or not
-    int count = 0;
-    const int timeoutDuration = gSlowlyRunRatio ? (gSlowlyRunRatio * 1000000) : 1000;
+    // For multi-camera sensor, to wait until the frame synced or timeout
+    const int64_t timeoutDuration = gSlowlyRunRatio ? (gSlowlyRunRatio * 1000000) : 1000;
     const int maxCheckTimes = 10;  // 10 times
-    while (!SyncManager::getInstance()->isSynced(mCameraId, sequence)) {
-        usleep(timeoutDuration);
-        count++;
-        if (count > maxCheckTimes) {
-            return true;
-        }
-    }
-    return false;
+    return !SyncManager::getInstance()->waitSynced(mCameraId, sequence,
+                                                   timeoutDuration * (maxCheckTimes + 1));
 }
 // FRAME_SYNC_E
 
@@ -360,6 +354,9 @@ int MainDevice::onDequeueBuffer(shared_ptr<CameraBuffer> buffer) {
 
     LOG2("<seq%ld>@%s, field:%d, timestamp: sec=%ld, usec=%ld", buffer->getSequence(), __func__,
          buffer->getField(), buffer->getTimestamp().tv_sec, buffer->getTimestamp().tv_usec);
+    // The buffer timestamp is the SOF time in CLOCK_MONOTONIC
+    LatencyStats::record(mCameraId, -1, LATENCY_SOF_TO_ISYS_FRAME,
+                         CameraUtils::systemTime() - TIMEVAL2NSECS(buffer->getTimestamp()));
 
     for (auto& consumer : mConsumers) {
         consumer->onFrameAvailable(mPort, buffer);
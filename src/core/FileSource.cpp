@@ -19,9 +19,13 @@
 #include "FileSource.h"
 
 #include <dirent.h>
+#include <errno.h>
 #include <expat.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 
 #include <algorithm>
 #include <fstream>
@@ -38,13 +42,21 @@ using std::vector;
 
 namespace icamera {
 
+static const int64_t kStatsFrameCount = 300;  // Log the achieved fps and jitter per 300 frames
+
 FileSource::FileSource(int cameraId)
         : StreamSource(V4L2_MEMORY_USERPTR),
           mCameraId(cameraId),
           mExitPending(false),
           mFps(30.0),
           mSequence(-1),
-          mOutputPort(INVALID_PORT) {
+          mOutputPort(INVALID_PORT),
+          mFrameInterval(0),
+          mNextFrameTime(0),
+          mStatsStartTime(0),
+          mStatsFrames(0),
+          mJitterSum(0),
+          mMaxJitter(0) {
     LOG1("%s: FileSource is created for debugging.", __func__);
 
     const char* injectedFile = PlatformData::getInjectedFile();
@@ -82,6 +94,7 @@ FileSource::FileSource(int cameraId)
 
 FileSource::~FileSource() {
     delete mProduceThread;
+    unmapFrameFiles();
 }
 
 int FileSource::init() {
@@ -101,12 +114,7 @@ int FileSource::configure(const map<Port, stream_t>& outputFrames,
     return OK;
 }
 
-int FileSource::allocateSourceBuffer() {
-    int fmt = mStreamConfig.format;
-    int width = mStreamConfig.width;
-    int height = mStreamConfig.height;
-    // Get frame size with aligned height taking in count for internal buffers.
-    uint32_t size = CameraUtils::getFrameSize(fmt, width, height, true);
+int FileSource::loadFrameFiles() {
     map<int, string> frameFileName;
     if (mInjectionWay == USING_CONFIG_FILE) {
         FileSourceProfile profile(mInjectedFile);
@@ -114,6 +122,7 @@ int FileSource::allocateSourceBuffer() {
         CheckAndLogError(ret != OK, BAD_VALUE, "Cannot find the frame files");
         for (const auto& item : frameFileName)
             frameFileName[item.first] = profile.getFrameFile(mCameraId, item.first);
+        mFps = profile.getFps(mCameraId);
     } else if (mInjectionWay == USING_INJECTION_PATH) {
         int ret = access(mInjectedFile.c_str(), 0);
         CheckAndLogError(ret != OK, BAD_VALUE, "Cannot access: %s", mInjectedFile.c_str());
@@ -128,25 +137,68 @@ int FileSource::allocateSourceBuffer() {
             "Invalid Injected Way");
     }
 
+    // Map the files once, the frames are read from the page cache without any file io later
     for (const auto& item : frameFileName) {
-        string fileName = item.second;
-        // Prepare the buffers to read the files for frame
-        shared_ptr<CameraBuffer> buf = CameraBuffer::create(
-            mCameraId, BUFFER_USAGE_GENERAL, V4L2_MEMORY_USERPTR, size, 0, fmt, width, height);
-        CheckAndLogError(!buf, BAD_VALUE, "@%s: Allocate producer buffer failed", __func__);
-        fillFrameBuffer(fileName, buf);
-        mFrameFileBuffers[fileName] = buf;
+        const string& fileName = item.second;
+        if (mFrameData.find(fileName) == mFrameData.end() && mapFrameFile(fileName) != OK) {
+            continue;
+        }
+        mFrameFiles[item.first] = &mFrameData[fileName];
     }
+    CheckAndLogError(mFrameFiles.empty(), BAD_VALUE, "No frame file is loaded");
+
+    // cameraFileSourceFps overrides the fps of the profile, 0 for as fast as possible
+    const char* fps = getenv("cameraFileSourceFps");
+    if (fps) mFps = strtof(fps, nullptr);
+    mFrameInterval = mFps > 0 ? static_cast<int64_t>(1000000000.0 / mFps) : 0;
+    LOG1("<id%d>%s, %zu frame files, fps %f", mCameraId, __func__, mFrameData.size(), mFps);
     return OK;
 }
 
+int FileSource::mapFrameFile(const string& fileName) {
+    int fd = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    CheckAndLogError(fd < 0, BAD_VALUE, "Cannot open frame file:%s", fileName.c_str());
+
+    struct stat statBuf;
+    if (fstat(fd, &statBuf) != 0 || statBuf.st_size <= 0) {
+        LOGE("Invalid frame file:%s", fileName.c_str());
+        close(fd);
+        return BAD_VALUE;
+    }
+
+    size_t size = statBuf.st_size;
+    void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    CheckAndLogError(addr == MAP_FAILED, NO_MEMORY, "Cannot map frame file:%s, size %zu",
+                     fileName.c_str(), size);
+
+    int bufferSize = CameraUtils::getFrameSize(mStreamConfig.format, mStreamConfig.width,
+                                               mStreamConfig.height, true);
+    CheckWarningNoReturn(size < static_cast<size_t>(bufferSize),
+                         "The size of file:%s is less than buffer's requirement.",
+                         fileName.c_str());
+    mFrameData[fileName] = {addr, size};
+    return OK;
+}
+
+void FileSource::unmapFrameFiles() {
+    for (auto& item : mFrameData) {
+        munmap(item.second.addr, item.second.size);
+    }
+    mFrameData.clear();
+    mFrameFiles.clear();
+}
+
 int FileSource::start() {
     LOG1("%s", __func__);
 
     AutoMutex l(mLock);
 
-    allocateSourceBuffer();
+    unmapFrameFiles();
+    loadFrameFiles();
     mSequence = -1;
+    mNextFrameTime = 0;
+    mStatsStartTime = 0;
     mExitPending = false;
     mProduceThread->run("FileSource", PRIORITY_URGENT_AUDIO);
 
@@ -164,7 +216,7 @@ int FileSource::stop() {
     }
 
     mProduceThread->requestExitAndWait();
-    mFrameFileBuffers.clear();
+    unmapFrameFiles();
 
     return OK;
 }
@@ -190,8 +242,6 @@ bool FileSource::produce() {
     LOG2("%s", __func__);
 
     mSequence++;
-    struct timespec start, end;
-    clock_gettime(CLOCK_MONOTONIC, &start);
 
     static const nsecs_t kWaitDuration = 40000000000;  // 40s
     shared_ptr<CameraBuffer> qBuffer;
@@ -213,23 +263,14 @@ bool FileSource::produce() {
         mBufferQueue.pop();
     }
 
+    waitFrameTime();
     notifySofEvent();
 
     fillFrameBuffer(qBuffer);
 
-    clock_gettime(CLOCK_MONOTONIC, &end);
-    long seconds = end.tv_sec - start.tv_sec;
-    long nSeconds = end.tv_nsec - start.tv_nsec;
-    // Check how long to sleep to meet the specified FPS requirement.
-    long sleepTime = static_cast<long>(1000000.0 / mFps) - (seconds * 1000000 + nSeconds / 1000);
-    LOG2("Need to sleep: %ld us", sleepTime);
-    // No need sleep if it takes too long to prepare the buffer.
-    if (sleepTime > 0) {
-        usleep(sleepTime);
-    }
-
     struct timespec stampTime;
     clock_gettime(CLOCK_MONOTONIC, &stampTime);
+    updateFrameStats(stampTime.tv_sec * 1000000000LL + stampTime.tv_nsec);
 
     timeval stamp;
     stamp.tv_sec = stampTime.tv_sec;
@@ -243,59 +284,63 @@ bool FileSource::produce() {
     return !mExitPending;
 }
 
-void FileSource::fillFrameBuffer(string fileName, shared_ptr<CameraBuffer>& buffer) {
-    CheckAndLogError(fileName.empty(), VOID_VALUE, "Invalid frame file.");
-    LOG2("Read frame from frame file:%s", fileName.c_str());
-
-    std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
-    CheckAndLogError(!file.is_open(), VOID_VALUE, "Cannot open frame file:%s", fileName.c_str());
-
-    size_t fileSize = file.tellg();
-    file.seekg(0, std::ios::beg);
-
-    CheckWarningNoReturn(fileSize < buffer->getBufferSize(),
-                         "The size of file:%s is less than buffer's requirement.",
-                         fileName.c_str());
-    file.read(reinterpret_cast<char*>(buffer->getBufferAddr()),
-              std::min(fileSize, (size_t)buffer->getBufferSize()));
-}
-
-void FileSource::fillFrameBuffer(shared_ptr<CameraBuffer>& buffer) {
-    string fileName;
-
-    if (mInjectionWay == USING_CONFIG_FILE) {
-        FileSourceProfile profile(mInjectedFile);
-        fileName = profile.getFrameFile(mCameraId, mSequence);
-        mFps = profile.getFps(mCameraId);
-    } else if (mInjectionWay == USING_INJECTION_PATH) {
-        if (access(mInjectedFile.c_str(), 0) != 0) {
-            LOGE("Cannot access:  %s for fillFrameBuffer", mInjectedFile.c_str());
-        }
-        map<int, string> frameFileName;
-        FileSourceFromDir fSource(mInjectedFile);
-        int ret = fSource.getInjectionFileInfo(&frameFileName);
-        if (ret != OK) {
-            LOGE("Cannot find the frame files for fillFrameBuffer");
-        }
-        fileName = fSource.getFrameFile(frameFileName, mSequence);
-    } else if (mInjectionWay == USING_FRAME_FILE) {
-        fileName = mInjectedFile;
+/**
+ * Sleep until the absolute time of the frame, so the time spent on preparing the frames
+ * doesn't accumulate to the frame interval.
+ */
+void FileSource::waitFrameTime() {
+    if (mFrameInterval <= 0) return;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t nowNs = now.tv_sec * 1000000000LL + now.tv_nsec;
+    if (mNextFrameTime == 0 || nowNs - mNextFrameTime > mFrameInterval) {
+        // The first frame, or it's late more than one frame, restart without burst
+        mNextFrameTime = nowNs;
     } else {
-        LOGE("Invalid Injected Way for fillFrameBuffer");
+        struct timespec deadline;
+        deadline.tv_sec = mNextFrameTime / 1000000000LL;
+        deadline.tv_nsec = mNextFrameTime % 1000000000LL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+        }
     }
+}
 
-    CheckAndLogError(fileName.empty(), VOID_VALUE, "Invalid frame file.");
-    LOG2("<seq%ld>Frame uses frame file:%s, buffer %p", mSequence, fileName.c_str(),
-         buffer->getBufferAddr());
+void FileSource::updateFrameStats(int64_t frameTime) {
+    if (mStatsStartTime == 0) {
+        mStatsStartTime = frameTime;
+        mStatsFrames = 0;
+        mJitterSum = 0;
+        mMaxJitter = 0;
+    }
 
-    for (auto& item : mFrameFileBuffers) {
-        if (fileName.compare(item.first) == 0) {
-            MEMCPY_S((buffer->getBufferAddr()), buffer->getBufferSize(),
-                     (item.second->getBufferAddr()), item.second->getBufferSize());
-            return;
-        }
+    if (mFrameInterval > 0) {
+        int64_t jitter = frameTime - mNextFrameTime;
+        mJitterSum += jitter;
+        mMaxJitter = std::max(mMaxJitter, jitter);
+        mNextFrameTime += mFrameInterval;
+    }
+    mStatsFrames++;
+
+    if (mStatsFrames == kStatsFrameCount) {
+        int64_t duration = frameTime - mStatsStartTime;
+        LOG1("<id%d>%s: fps %.2f (target %.2f), jitter avg %ld us, max %ld us", mCameraId,
+             __func__, duration > 0 ? (mStatsFrames - 1) * 1000000000.0 / duration : 0.0, mFps,
+             mJitterSum / mStatsFrames / 1000, mMaxJitter / 1000);
+        mStatsStartTime = 0;
     }
-    LOGE("Not find the framefile: %s", fileName.c_str());
+}
+
+void FileSource::fillFrameBuffer(shared_ptr<CameraBuffer>& buffer) {
+    // The frame of the equal or the closest smaller sequence
+    auto it = mFrameFiles.upper_bound(mSequence);
+    CheckAndLogError(it == mFrameFiles.begin(), VOID_VALUE,
+                     "Cannot find the frame file for sequence:%ld", mSequence);
+    const FrameData* frame = (--it)->second;
+
+    void* addr = buffer->getBufferAddr();
+    LOG2("<seq%ld>Frame uses frame file of seq %ld, buffer %p", mSequence, it->first, addr);
+    MEMCPY_S(addr, buffer->getBufferSize(), frame->addr, frame->size);
 }
 
 void FileSource::notifyFrame(const shared_ptr<CameraBuffer>& buffer) {
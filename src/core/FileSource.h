@@ -62,9 +62,12 @@ class FileSource : public StreamSource {
 
  private:
     bool produce();
-    int allocateSourceBuffer();
+    int loadFrameFiles();
+    int mapFrameFile(const std::string& fileName);
+    void unmapFrameFiles();
     void fillFrameBuffer(std::shared_ptr<CameraBuffer>& buffer);
-    void fillFrameBuffer(std::string fileName, std::shared_ptr<CameraBuffer>& buffer);
+    void waitFrameTime();
+    void updateFrameStats(int64_t frameTime);
     void notifyFrame(const std::shared_ptr<CameraBuffer>& buffer);
     void notifySofEvent();
 
@@ -98,7 +101,22 @@ class FileSource : public StreamSource {
     Port mOutputPort;
 
     std::vector<BufferConsumer*> mBufferConsumerList;
-    std::map<std::string, std::shared_ptr<CameraBuffer>> mFrameFileBuffers;
+
+    // The frame files are mapped in start(), and the sequence of a frame uses the file of
+    // the equal or the closest smaller sequence in mFrameFiles.
+    struct FrameData {
+        void* addr;
+        size_t size;
+    };
+    std::map<std::string, FrameData> mFrameData;
+    std::map<int64_t, const FrameData*> mFrameFiles;
+
+    int64_t mFrameInterval;  // In ns, 0 to produce frames as fast as possible
+    int64_t mNextFrameTime;
+    int64_t mStatsStartTime;
+    int64_t mStatsFrames;
+    int64_t mJitterSum;  // In ns
+    int64_t mMaxJitter;
     CameraBufQ mBufferQueue;
     Condition mBufferSignal;
     // Guard for FileSource Public API
@@ -19,6 +19,7 @@
 #include "IspParamAdaptor.h"
 
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <utility>
 #include <memory>
@@ -27,6 +28,7 @@
 #include "iutils/Utils.h"
 #include "iutils/CameraLog.h"
 #include "iutils/CameraDump.h"
+#include "iutils/LatencyStats.h"
 #include "iutils/Errors.h"
 #include "PlatformData.h"
 #include "IGraphConfig.h"
@@ -42,21 +44,18 @@ IspParamAdaptor::IspParamAdaptor(int cameraId)
           mCameraId(cameraId),
           mTuningMode(TUNING_MODE_VIDEO),
           mIpuOutputFormat(V4L2_PIX_FMT_NV12),
+          mLastPalDataSequence(-1),
           mLastLscSequece(-1),
           mLastGdcSequence(-1),
           mGraphConfig(nullptr),
           mIntelCca(nullptr),
-          mGammaTmOffset(-1) {
+          mGammaTmOffset(-1),
+          mPalRecordIndex({ia_pal_uuid_isp_call_info, ia_pal_uuid_isp_bnlm_3_2,
+                           ia_pal_uuid_isp_lsc_1_1, ia_pal_uuid_isp_gdc5}),
+          mPalCopiedBytes(0),
+          mPalCopyCount(0) {
     LOG1("<id%d>@%s", mCameraId, __func__);
     CLEAR(mLastPalDataForVideoPipe);
-
-    PalRecord palRecordArray[] = {{ia_pal_uuid_isp_call_info, -1},
-                                  {ia_pal_uuid_isp_bnlm_3_2, -1},
-                                  {ia_pal_uuid_isp_lsc_1_1, -1},
-                                  {ia_pal_uuid_isp_gdc5, -1}};
-    for (uint32_t i = 0; i < sizeof(palRecordArray) / sizeof(PalRecord); i++) {
-        mPalRecords.push_back(palRecordArray[i]);
-    }
 }
 
 IspParamAdaptor::~IspParamAdaptor() {}
@@ -80,10 +79,12 @@ int IspParamAdaptor::deinit() {
     }
 
     CLEAR(mLastPalDataForVideoPipe);
-    for (uint32_t i = 0; i < mPalRecords.size(); i++) {
-        mPalRecords[i].offset = -1;
-    }
+    mPalRecordIndex.reset();
     mGammaTmOffset = -1;
+    if (mPalCopyCount > 0) {
+        LOG1("<id%d>@%s, PAL records copied %lu bytes per frame", mCameraId, __func__,
+             mPalCopiedBytes / mPalCopyCount);
+    }
 
     mIspAdaptorState = ISP_ADAPTOR_NOT_INIT;
     return OK;
@@ -211,11 +212,14 @@ int IspParamAdaptor::configure(const stream_t& stream, ConfigMode configMode, Tu
     LOG2("%s, configMode: %x, PSys output format 0x%x", __func__, configMode, mIpuOutputFormat);
     mTuningMode = tuningMode;
     CLEAR(mLastPalDataForVideoPipe);
+    mLastPalDataSequence = -1;
     mLastLscSequece = -1;
     mLastGdcSequence = -1;
-    for (uint32_t i = 0; i < mPalRecords.size(); i++) {
-        mPalRecords[i].offset = -1;
-    }
+    mSeqIdToLscSeqIdMap.clear();
+    mSeqIdToGdcSeqIdMap.clear();
+    mPalRecordIndex.reset();
+    mPalCopiedBytes = 0;
+    mPalCopyCount = 0;
     mGammaTmOffset = -1;
 
     mIntelCca = IntelCca::getInstance(mCameraId, tuningMode);
@@ -325,8 +329,10 @@ int IspParamAdaptor::decodeStatsData(TuningMode tuningMode,
     cca::cca_out_stats outStatsTemp;
     cca::cca_out_stats* outStats = &outStatsTemp;
     outStats->get_rgbs_stats = false;
-    AiqResult* aiqResult =
-        const_cast<AiqResult*>(AiqResultStorage::getInstance(mCameraId)->getAiqResult(sequence));
+    // Pinned until the stats are decoded into it
+    AiqResultStorage::AiqResultRef aiqResultRef =
+        AiqResultStorage::getInstance(mCameraId)->getAiqResultRef(sequence);
+    AiqResult* aiqResult = const_cast<AiqResult*>(aiqResultRef.get());
     if (aiqResult && aiqResult->mAiqParam.callbackRgbs) {
         outStats = &aiqResult->mOutStats;
         outStats->get_rgbs_stats = true;
@@ -403,6 +409,29 @@ void IspParamAdaptor::updateKernelToggles(cca::cca_program_group* programGroup)
     }
 }
 
+void IspParamAdaptor::SequenceRing::clear() {
+    for (auto& slot : mSlots) {
+        slot.sequence = INT64_MIN;
+        slot.value = -1;
+    }
+}
+
+void IspParamAdaptor::SequenceRing::set(int64_t sequence, int64_t value) {
+    Slot& slot = mSlots[(sequence % ISP_PARAM_QUEUE_SIZE + ISP_PARAM_QUEUE_SIZE) %
+                        ISP_PARAM_QUEUE_SIZE];
+    slot.sequence = sequence;
+    slot.value = value;
+}
+
+bool IspParamAdaptor::SequenceRing::get(int64_t sequence, int64_t* value) const {
+    const Slot& slot = mSlots[(sequence % ISP_PARAM_QUEUE_SIZE + ISP_PARAM_QUEUE_SIZE) %
+                              ISP_PARAM_QUEUE_SIZE];
+    if (slot.sequence != sequence) return false;
+
+    *value = slot.value;
+    return true;
+}
+
 /*
  * PAL output buffer is a reference data for next output buffer,
  * but currently a ring buffer is used in HAL, which caused logic mismatching issue.
@@ -415,70 +444,44 @@ void IspParamAdaptor::updatePalDataForVideoPipe(ia_binary_data dest, int64_t buf
         return;
     }
 
-    if (mPalRecords.empty()) return;
-
-    ia_pal_record_header* header = nullptr;
-    char* src = static_cast<char*>(mLastPalDataForVideoPipe.data);
-    // find uuid offset in saved PAL buffer
-    if (mPalRecords[0].offset < 0) {
-        uint32_t offset = 0;
-        while (offset < mLastPalDataForVideoPipe.size) {
-            ia_pal_record_header* header = reinterpret_cast<ia_pal_record_header*>(src + offset);
-            // check if header is valid or not
-            CheckWarning(header->uuid == 0 || header->size == 0, VOID_VALUE,
-                         "%s, source header info isn't correct", __func__);
-            for (uint32_t i = 0; i < mPalRecords.size(); i++) {
-                if (mPalRecords[i].offset < 0 && mPalRecords[i].uuid == header->uuid) {
-                    mPalRecords[i].offset = offset;
-                    LOG2("find uuid %d, offset %d, size %d", header->uuid, offset, header->size);
-                    break;
-                }
-            }
-            offset += header->size;
-        }
+    const char* src = static_cast<const char*>(mLastPalDataForVideoPipe.data);
+    if (!mPalRecordIndex.isIndexed()) {
+        bool valid = mPalRecordIndex.build(src, mLastPalDataForVideoPipe.size);
+        CheckWarningNoReturn(!valid, "%s, source header info isn't correct", __func__);
+        LOG2("%s, PAL record offsets: call info %d, bnlm %d, lsc %d, gdc %d", __func__,
+             mPalRecordIndex.offsetOf(ia_pal_uuid_isp_call_info),
+             mPalRecordIndex.offsetOf(ia_pal_uuid_isp_bnlm_3_2),
+             mPalRecordIndex.offsetOf(ia_pal_uuid_isp_lsc_1_1),
+             mPalRecordIndex.offsetOf(ia_pal_uuid_isp_gdc5));
     }
 
-    char* destData = static_cast<char*>(dest.data);
-    ia_pal_record_header* headerSrc = nullptr;
-    for (uint32_t i = 0; i < mPalRecords.size(); i++) {
-        if (mPalRecords[i].offset >= 0) {
-            // find source record header
-            header = reinterpret_cast<ia_pal_record_header*>(src + mPalRecords[i].offset);
-            if (header->uuid == mPalRecords[i].uuid) {
-                headerSrc = header;
-            }
-
-            if (ia_pal_uuid_isp_lsc_1_1 == header->uuid) {
-                if (isLscCopy(bufSeq, settingSeq)) {
-                    LOG2("settingSeq %ld, copy LSC for buf %ld", settingSeq, bufSeq);
-                    updateLscSeqMap(bufSeq);
-                } else {
+    uint32_t copiedBytes = 0;
+    int missing = mPalRecordIndex.copy(
+        static_cast<char*>(dest.data), src, mLastPalDataSequence,
+        [&](int uuid) {
+            if (ia_pal_uuid_isp_lsc_1_1 == uuid) {
+                if (!isLscCopy(bufSeq, settingSeq)) {
                     LOG2("settingSeq %ld, not copy LSC for buf %ld", settingSeq, bufSeq);
-                    continue;
+                    return false;
                 }
-            }
-
-            if (ia_pal_uuid_isp_gdc5 == header->uuid) {
-                if (isGdcCopy(bufSeq, settingSeq)) {
-                    LOG2("settingSeq %ld, copy GDC for buf %ld", settingSeq, bufSeq);
-                    updateGdcSeqMap(bufSeq);
-                } else {
+                LOG2("settingSeq %ld, copy LSC for buf %ld", settingSeq, bufSeq);
+                updateLscSeqMap(bufSeq);
+            } else if (ia_pal_uuid_isp_gdc5 == uuid) {
+                if (!isGdcCopy(bufSeq, settingSeq)) {
                     LOG2("settingSeq %ld, not copy GDC for buf %ld", settingSeq, bufSeq);
-                    continue;
+                    return false;
                 }
+                LOG2("settingSeq %ld, copy GDC for buf %ld", settingSeq, bufSeq);
+                updateGdcSeqMap(bufSeq);
             }
-
-            if (!headerSrc) {
-                LOGW("Failed to find PAL recorder header %d", mPalRecords[i].uuid);
-                continue;
-            }
-            header = reinterpret_cast<ia_pal_record_header*>(destData + mPalRecords[i].offset);
-            if (header->uuid == mPalRecords[i].uuid) {
-                MEMCPY_S(header, header->size, headerSrc, headerSrc->size);
-                LOG2("%s, PAL data of kernel uuid %d has been updated", __func__, header->uuid);
-            }
-        }
-    }
+            return true;
+        },
+        &copiedBytes);
+    CheckWarningNoReturn(missing > 0, "%s, %d PAL records aren't found", __func__, missing);
+
+    mPalCopiedBytes += copiedBytes;
+    mPalCopyCount++;
+    LOG2("<seq%ld>%s, copied %u PAL bytes to buf %ld", settingSeq, __func__, copiedBytes, bufSeq);
 }
 
 void IspParamAdaptor::updateIspParameterMap(IspParameter* ispParam, int64_t dataSeq,
@@ -490,24 +493,22 @@ void IspParamAdaptor::updateIspParameterMap(IspParameter* ispParam, int64_t data
         std::pair<int64_t, ia_binary_data> p(settingSeq, binaryData);
         ispParam->mSequenceToDataMap.insert(p);
     }
-    if (ispParam->mSequenceToDataId.size() >= ISP_PARAM_QUEUE_SIZE) {
-        ispParam->mSequenceToDataId.erase(ispParam->mSequenceToDataId.begin());
-    }
-    ispParam->mSequenceToDataId[settingSeq] = dataSeq;
+    ispParam->mSequenceToDataId.set(settingSeq, dataSeq);
 }
 
 bool IspParamAdaptor::isLscCopy(int64_t bufSeq, int64_t settingSeq) {
-    AiqResult* aiqResults = const_cast<AiqResult*>(
-        AiqResultStorage::getInstance(mCameraId)->getAiqResult(settingSeq));
-    if (aiqResults == nullptr) return true;
+    AiqResultStorage::AiqResultRef aiqResults =
+        AiqResultStorage::getInstance(mCameraId)->getAiqResultRef(settingSeq);
+    if (!aiqResults) return true;
 
     if (aiqResults->mLscUpdate) {
         mLastLscSequece = settingSeq;
         LOG2("%s, LSC update %ld", __func__, settingSeq);
         return false;
     } else {
-        if (mSeqIdToLscSeqIdMap.find(bufSeq) != mSeqIdToLscSeqIdMap.end()) {
-            if (mLastLscSequece >= 0 && mSeqIdToLscSeqIdMap[bufSeq] == mLastLscSequece) {
+        int64_t lscSeq = -1;
+        if (mSeqIdToLscSeqIdMap.get(bufSeq, &lscSeq)) {
+            if (mLastLscSequece >= 0 && lscSeq == mLastLscSequece) {
                 return false;
             }
         }
@@ -517,11 +518,7 @@ bool IspParamAdaptor::isLscCopy(int64_t bufSeq, int64_t settingSeq) {
 }
 
 void IspParamAdaptor::updateLscSeqMap(int64_t settingSeq) {
-    mSeqIdToLscSeqIdMap[settingSeq] = mLastLscSequece;
-
-    if (mSeqIdToLscSeqIdMap.size() > ISP_PARAM_QUEUE_SIZE) {
-        mSeqIdToLscSeqIdMap.erase(mSeqIdToLscSeqIdMap.begin());
-    }
+    mSeqIdToLscSeqIdMap.set(settingSeq, mLastLscSequece);
 }
 
 bool IspParamAdaptor::isGdcCopy(int64_t bufSeq, int64_t settingSeq) {
@@ -532,8 +529,9 @@ bool IspParamAdaptor::isGdcCopy(int64_t bufSeq, int64_t settingSeq) {
         LOG2("%s, GDC update %ld", __func__, settingSeq);
         return false;
     } else {
-        if (mSeqIdToGdcSeqIdMap.find(bufSeq) != mSeqIdToGdcSeqIdMap.end()) {
-            if (mLastGdcSequence >= 0 && mSeqIdToGdcSeqIdMap[bufSeq] == mLastGdcSequence) {
+        int64_t gdcSeq = -1;
+        if (mSeqIdToGdcSeqIdMap.get(bufSeq, &gdcSeq)) {
+            if (mLastGdcSequence >= 0 && gdcSeq == mLastGdcSequence) {
                 return false;
             }
         }
@@ -543,11 +541,7 @@ bool IspParamAdaptor::isGdcCopy(int64_t bufSeq, int64_t settingSeq) {
 }
 
 void IspParamAdaptor::updateGdcSeqMap(int64_t settingSeq) {
-    mSeqIdToGdcSeqIdMap[settingSeq] = mLastGdcSequence;
-
-    if (mSeqIdToGdcSeqIdMap.size() > ISP_PARAM_QUEUE_SIZE) {
-        mSeqIdToGdcSeqIdMap.erase(mSeqIdToGdcSeqIdMap.begin());
-    }
+    mSeqIdToGdcSeqIdMap.set(settingSeq, mLastGdcSequence);
 }
 
 /**
@@ -558,6 +552,7 @@ int IspParamAdaptor::runIspAdapt(const IspSettings* ispSettings, int64_t setting
                                  int32_t streamId) {
     PERF_CAMERA_ATRACE();
     HAL_TRACE_CALL(CAMERA_DEBUG_LOG_LEVEL2);
+    LatencyStats::ScopedLatency latency(mCameraId, streamId, LATENCY_ISP_ADAPT);
     AutoMutex l(mIspAdaptorLock);
     CheckAndLogError(mIspAdaptorState != ISP_ADAPTOR_CONFIGURED, INVALID_OPERATION,
                      "%s, wrong state %d", __func__, mIspAdaptorState);
@@ -621,6 +616,7 @@ int IspParamAdaptor::runIspAdapt(const IspSettings* ispSettings, int64_t setting
 
                 if (it.first == VIDEO_STREAM_ID) {
                     mLastPalDataForVideoPipe = binaryData;
+                    mLastPalDataSequence = settingSequence;
                     updateResultFromAlgo(&binaryData, settingSequence);
                     updateLscSeqMap(settingSequence);
                     updateGdcSeqMap(settingSequence);
@@ -654,9 +650,9 @@ ia_binary_data* IspParamAdaptor::getIpuParameter(int64_t sequence, int streamId)
             }
         }
     } else {
-        auto seqIt = ispParam.mSequenceToDataId.find(sequence);
-        if (seqIt != ispParam.mSequenceToDataId.end()) {
-            auto dataIt = ispParam.mSequenceToDataMap.find(seqIt->second);
+        int64_t dataSeq = -1;
+        if (ispParam.mSequenceToDataId.get(sequence, &dataSeq)) {
+            auto dataIt = ispParam.mSequenceToDataMap.find(dataSeq);
             if (dataIt != ispParam.mSequenceToDataMap.end()) binaryData = &(dataIt->second);
         }
     }
@@ -783,14 +779,13 @@ int IspParamAdaptor::runIspAdaptL(ia_isp_bxt_program_group* pgPtr, ia_isp_bxt_gd
     PERF_CAMERA_ATRACE();
     CheckAndLogError(!mIntelCca, UNKNOWN_ERROR, "%s, mIntelCca is nullptr", __func__);
 
-    AiqResult* aiqResults = const_cast<AiqResult*>(
-        AiqResultStorage::getInstance(mCameraId)->getAiqResult(settingSequence));
-    if (aiqResults == nullptr) {
+    // Pin the result since the ISP parameter adaptation takes long time
+    AiqResultStorage::AiqResultRef aiqResults =
+        AiqResultStorage::getInstance(mCameraId)->getAiqResultRef(settingSequence);
+    if (!aiqResults) {
         LOGW("<seq%ld>@%s: no result! use the latest instead", settingSequence, __func__);
-        aiqResults =
-            const_cast<AiqResult*>(AiqResultStorage::getInstance(mCameraId)->getAiqResult());
-        CheckAndLogError((aiqResults == nullptr), INVALID_OPERATION,
-                         "Cannot find available aiq result.");
+        aiqResults = AiqResultStorage::getInstance(mCameraId)->getAiqResultRef();
+        CheckAndLogError(!aiqResults, INVALID_OPERATION, "Cannot find available aiq result.");
     }
     LOG2("<id%d:streamId:%d>@%s: aiq result id %ld", mCameraId, streamId, __func__,
          aiqResults->mFrameId);
@@ -800,7 +795,7 @@ int IspParamAdaptor::runIspAdaptL(ia_isp_bxt_program_group* pgPtr, ia_isp_bxt_gd
 
     bool useLinearGamma = false;
     inputParams->media_format = PlatformData::getMediaFormat(mCameraId);
-    applyMediaFormat(aiqResults, &inputParams->media_format, &useLinearGamma);
+    applyMediaFormat(aiqResults.get(), &inputParams->media_format, &useLinearGamma);
     LOG2("%s, media format: 0x%x, gamma lut size: %d", __func__, inputParams->media_format,
          aiqResults->mGbceResults.gamma_lut_size);
 
@@ -968,14 +963,14 @@ int IspParamAdaptor::runIspAdaptL(ia_isp_bxt_program_group* pgPtr, ia_isp_bxt_gd
 }
 
 void IspParamAdaptor::updateResultFromAlgo(ia_binary_data* binaryData, int64_t sequence) {
-    AiqResult* aiqResults =
-        const_cast<AiqResult*>(AiqResultStorage::getInstance(mCameraId)->getAiqResult(sequence));
-    if (aiqResults == nullptr) {
+    AiqResultStorage::AiqResultRef aiqResultRef =
+        AiqResultStorage::getInstance(mCameraId)->getAiqResultRef(sequence);
+    if (!aiqResultRef) {
         LOGW("<seq%ld>@%s: no result! use the latest instead", sequence, __func__);
-        aiqResults =
-            const_cast<AiqResult*>(AiqResultStorage::getInstance(mCameraId)->getAiqResult());
-        CheckAndLogError((aiqResults == nullptr), VOID_VALUE, "Cannot find available aiq result.");
+        aiqResultRef = AiqResultStorage::getInstance(mCameraId)->getAiqResultRef();
+        CheckAndLogError(!aiqResultRef, VOID_VALUE, "Cannot find available aiq result.");
     }
+    AiqResult* aiqResults = const_cast<AiqResult*>(aiqResultRef.get());
 
     // update tone map result from pal algo
     if (aiqResults->mAiqParam.callbackTmCurve &&
@@ -55,8 +55,10 @@ extern "C" {
 #include "ia_bcomp.h"
 // DOL_FEATURE_E
 #include "ia_bcomp_types.h"
+#include "ia_pal_types_isp.h"
 #include "gc/IGraphConfigManager.h"
 #include "IspSettings.h"
+#include "PalRecordIndex.h"
 
 namespace icamera {
 /**
@@ -94,13 +96,28 @@ class IspParamAdaptor {
 
     void updatePalDataForVideoPipe(ia_binary_data dest, int64_t bufSeq, int64_t settingSeq);
 
+    static const int ISP_PARAM_QUEUE_SIZE = MAX_SETTING_COUNT;
+
+    // The values of the recent sequences, the older ones are overwritten in the ring
+    struct SequenceRing {
+        struct Slot {
+            int64_t sequence;
+            int64_t value;
+        } mSlots[ISP_PARAM_QUEUE_SIZE];
+
+        SequenceRing() { clear(); }
+        void clear();
+        void set(int64_t sequence, int64_t value);
+        bool get(int64_t sequence, int64_t* value) const;
+    };
+
     struct IspParameter {
         /*
          * map from setting sequnce to PAL data sequence to look up PAL data
          * for PAL may not run if no scene changes, so setting sequence will
          * map PAL data sequence with latest PAL data.
          */
-        std::map<int64_t, int64_t> mSequenceToDataId;
+        SequenceRing mSequenceToDataId;
         // map from sequence to ia_binary_data
         std::multimap<int64_t, ia_binary_data> mSequenceToDataMap;
     };
@@ -148,15 +165,15 @@ class IspParamAdaptor {
     Mutex mIspAdaptorLock;
     std::map<int, int> mStreamIdToPGOutSizeMap;
     std::map<int, ia_isp_bxt_gdc_limits> mStreamIdToMbrDataMap;
-    static const int ISP_PARAM_QUEUE_SIZE = MAX_SETTING_COUNT;
     std::map<int, IspParameter> mStreamIdToIspParameterMap;  // map from stream id to IspParameter
     ia_binary_data mLastPalDataForVideoPipe;
+    int64_t mLastPalDataSequence;  // The setting sequence of mLastPalDataForVideoPipe
 
     int64_t mLastLscSequece;
-    std::map<int64_t, int64_t> mSeqIdToLscSeqIdMap;
+    SequenceRing mSeqIdToLscSeqIdMap;
 
     int64_t mLastGdcSequence;
-    std::map<int64_t, int64_t> mSeqIdToGdcSeqIdMap;
+    SequenceRing mSeqIdToGdcSeqIdMap;
 
     // Guard lock for ipu parameter
     Mutex mIpuParamLock;
@@ -165,10 +182,9 @@ class IspParamAdaptor {
     IntelCca* mIntelCca;
     int mGammaTmOffset;
 
-    struct PalRecord {
-        int uuid;
-        int offset;
-    };
-    std::vector<PalRecord> mPalRecords;  // Save PAL offset info for overwriting PAL
+    // The PAL records copied into the video PAL buffers
+    PalRecordIndex<ia_pal_record_header> mPalRecordIndex;
+    uint64_t mPalCopiedBytes;
+    uint64_t mPalCopyCount;
 };
 }  // namespace icamera
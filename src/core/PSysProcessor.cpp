@@ -363,8 +363,9 @@ int64_t PSysProcessor::getSettingSequence(const CameraBufferPortMap& outBuf) {
  */
 bool PSysProcessor::needSkipOutputFrame(int64_t sequence) {
     // Check if need to skip output frame
-    const AiqResult* aiqResults = AiqResultStorage::getInstance(mCameraId)->getAiqResult(sequence);
-    if (aiqResults != nullptr && aiqResults->mSkip) {
+    AiqResultStorage::AiqResultRef aiqResults =
+        AiqResultStorage::getInstance(mCameraId)->getAiqResultRef(sequence);
+    if (aiqResults && aiqResults->mSkip) {
         LOG1("<seq:%ld>@%s", sequence, __func__);
         return true;
     }
@@ -408,8 +409,9 @@ bool PSysProcessor::needHoldOnInputFrame(int64_t settingSequence, int64_t inputS
  * Check if pipe needs to be switched according to AIQ result.
  */
 bool PSysProcessor::needSwitchPipe(int64_t sequence) {
-    const AiqResult* aiqResults = AiqResultStorage::getInstance(mCameraId)->getAiqResult(sequence);
-    if (aiqResults == nullptr) {
+    AiqResultStorage::AiqResultRef aiqResults =
+        AiqResultStorage::getInstance(mCameraId)->getAiqResultRef(sequence);
+    if (!aiqResults) {
         LOG2("%s: not found sequence %ld in AiqResultStorage, no update for active modes", __func__,
              sequence);
         return false;
@@ -935,7 +937,7 @@ status_t PSysProcessor::prepareTask(CameraBufferPortMap* srcBuffers,
 
         bool callbackRgbs = false;
         AiqResultStorage* storage = AiqResultStorage::getInstance(mCameraId);
-        AiqResult* aiqResult = const_cast<AiqResult*>(storage->getAiqResult(inputSequence));
+        AiqResultStorage::AiqResultRef aiqResult = storage->getAiqResultRef(inputSequence);
         if (aiqResult && aiqResult->mAiqParam.callbackRgbs) {
             callbackRgbs = true;
         }
@@ -1061,8 +1063,9 @@ void PSysProcessor::dispatchTask(CameraBufferPortMap& inBuf, CameraBufferPortMap
 
             int ret = params.getHdrRatio(hdrRatio);
             if (ret == OK) {
-                auto* res = AiqResultStorage::getInstance(mCameraId)->getAiqResult(currentSequence);
-                if (res != nullptr) {
+                AiqResultStorage::AiqResultRef res =
+                    AiqResultStorage::getInstance(mCameraId)->getAiqResultRef(currentSequence);
+                if (res) {
                     auto exposure = res->mAeResults.exposures[0].exposure[0];
                     float totalGain = exposure.analog_gain * exposure.digital_gain;
                     PlatformData::getEdgeNrSetting(mCameraId, totalGain, hdrRatio, edgeNrSetting);
@@ -1276,7 +1279,11 @@ void PSysProcessor::outputRawImage(shared_ptr<CameraBuffer>& srcBuf,
     ScopeMapping mapperDst(dstBuf);
     void* pDstBuf = mapperDst.getUserPtr();
 
-    MEMCPY_S(pDstBuf, dstBufferSize, pSrcBuf, srcBufferSize);
+    if (pSrcBuf && pDstBuf) {
+        MEMCPY_S(pDstBuf, dstBufferSize, pSrcBuf, srcBufferSize);
+    } else {
+        LOGE("%s, failed to map the raw buffers, src %p, dst %p", __func__, pSrcBuf, pDstBuf);
+    }
 
     // Send output buffer to its consumer
     for (auto& it : mBufferConsumerList) {
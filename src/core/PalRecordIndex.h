@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "iutils/Utils.h"
+
+namespace icamera {
+
+/**
+ * PalRecordIndex copies some records of one PAL buffer into another one of the same layout.
+ *
+ * The PAL buffer is a list of records, each starts with a Header which has the uuid and the
+ * size of the record. The layout is the same for all the PAL buffers of the stream, so the
+ * offsets of the records are found once after configuration. Each record also remembers the
+ * buffer and the source sequence of its last copy, and it isn't copied again if the buffer
+ * already has it.
+ */
+template <typename Header>
+class PalRecordIndex {
+ public:
+    explicit PalRecordIndex(const std::vector<int>& uuids) : mIndexed(false) {
+        for (int uuid : uuids) mRecords.push_back({uuid, -1, nullptr, -1});
+    }
+
+    // Forget the offsets and the last copies, build() again after the configuration
+    void reset() {
+        for (auto& record : mRecords) record = {record.uuid, -1, nullptr, -1};
+        mIndexed = false;
+    }
+
+    bool isIndexed() const { return mIndexed; }
+
+    // Return the offset of the record, or -1 if it isn't found
+    int offsetOf(int uuid) const {
+        for (auto& record : mRecords) {
+            if (record.uuid == uuid) return record.offset;
+        }
+        return -1;
+    }
+
+    /**
+     * Find the offsets of the records in the PAL data, stop at the first broken header.
+     *
+     * \return false if a broken header is found, the records before it are still indexed.
+     */
+    bool build(const char* data, uint32_t size) {
+        mIndexed = true;
+        uint32_t offset = 0;
+        while (offset + sizeof(Header) <= size) {
+            const Header* header = reinterpret_cast<const Header*>(data + offset);
+            if (header->uuid == 0 || header->size == 0 || header->size > size - offset) {
+                return false;
+            }
+            for (auto& record : mRecords) {
+                if (record.offset < 0 && record.uuid == static_cast<int>(header->uuid)) {
+                    record.offset = offset;
+                    break;
+                }
+            }
+            offset += header->size;
+        }
+        return true;
+    }
+
+    /**
+     * Copy the indexed records from src into dest, build() must be called before.
+     *
+     * \param srcSequence: the sequence of the src data, the records dest already has from the
+     *                     same sequence are skipped.
+     * \param filter: called with the uuid before copying the record, it returns false to skip
+     *                the record this time.
+     * \param copiedBytes: increased by the bytes copied.
+     * \return the number of the records which aren't found in src or dest.
+     */
+    template <typename Filter>
+    int copy(char* dest, const char* src, int64_t srcSequence, Filter filter,
+             uint32_t* copiedBytes) {
+        int missing = 0;
+        for (auto& record : mRecords) {
+            if (record.offset < 0) continue;
+
+            const Header* headerSrc = reinterpret_cast<const Header*>(src + record.offset);
+            if (static_cast<int>(headerSrc->uuid) != record.uuid) {
+                missing++;
+                continue;
+            }
+            if (!filter(record.uuid)) continue;
+
+            // The buffer is reused without PAL run when PAL doesn't output, it has the record
+            if (record.lastDest == dest && record.lastSrcSequence == srcSequence) continue;
+
+            Header* header = reinterpret_cast<Header*>(dest + record.offset);
+            if (static_cast<int>(header->uuid) != record.uuid) {
+                missing++;
+                continue;
+            }
+            MEMCPY_S(header, header->size, headerSrc, headerSrc->size);
+            record.lastDest = dest;
+            record.lastSrcSequence = srcSequence;
+            *copiedBytes += headerSrc->size;
+        }
+        return missing;
+    }
+
+ private:
+    struct Record {
+        int uuid;
+        int offset;
+        // The last copy of the record, skip it if the destination already has the same content
+        const char* lastDest;
+        int64_t lastSrcSequence;
+    };
+
+    std::vector<Record> mRecords;
+    bool mIndexed;
+};
+
+}  // namespace icamera
@@ -18,6 +18,7 @@
 
 #include "iutils/Errors.h"
 #include "iutils/CameraLog.h"
+#include "iutils/LatencyStats.h"
 
 #include "RequestThread.h"
 
@@ -75,6 +76,7 @@ void RequestThread::clearRequests() {
         while (!frameQueue.mFrameQueue.empty()) {
             frameQueue.mFrameQueue.pop();
         }
+        frameQueue.mQueuedTime.clear();
         frameQueue.mFrameAvailableSignal.broadcast();
     }
 
@@ -155,9 +157,16 @@ int RequestThread::processRequest(int bufferNum, camera_buffer_t** ubuffer,
     CameraRequest request;
     request.mBufferNum = bufferNum;
     bool hasVideoBuffer = false;
+    nsecs_t queuedTime = CameraUtils::systemTime();
 
     for (int id = 0; id < bufferNum; id++) {
         request.mBuffer[id] = ubuffer[id];
+        int streamId = ubuffer[id]->s.id;
+        if (streamId >= 0 && streamId < MAX_STREAM_NUMBER) {
+            FrameQueue& frameQueue = mOutputFrames[streamId];
+            AutoMutex lock(frameQueue.mFrameMutex);
+            frameQueue.mQueuedTime[ubuffer[id]] = queuedTime;
+        }
         if (ubuffer[id]->s.usage == CAMERA_STREAM_PREVIEW ||
             ubuffer[id]->s.usage == CAMERA_STREAM_VIDEO_CAPTURE) {
             hasVideoBuffer = true;
@@ -274,6 +283,12 @@ void RequestThread::handleEvent(EventData eventData) {
                 FrameQueue& frameQueue = mOutputFrames[streamId];
 
                 AutoMutex lock(frameQueue.mFrameMutex);
+                auto queued = frameQueue.mQueuedTime.find(eventData.buffer->getUserBuffer());
+                if (queued != frameQueue.mQueuedTime.end()) {
+                    LatencyStats::record(mCameraId, streamId, LATENCY_REQUEST,
+                                         CameraUtils::systemTime() - queued->second);
+                    frameQueue.mQueuedTime.erase(queued);
+                }
                 bool needSignal = frameQueue.mFrameQueue.empty();
                 frameQueue.mFrameQueue.push(eventData.buffer);
                 if (needSignal) {
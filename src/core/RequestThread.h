@@ -18,6 +18,7 @@
 
 #include <atomic>
 #include <deque>
+#include <map>
 
 #include "iutils/Thread.h"
 #include "PlatformData.h"
@@ -115,6 +116,7 @@ class RequestThread : public Thread, public EventSource, public EventListener {
         Mutex mFrameMutex;
         Condition mFrameAvailableSignal;
         CameraBufQ mFrameQueue;
+        std::map<const camera_buffer_t*, nsecs_t> mQueuedTime;  // For the request latency
     };
     FrameQueue mOutputFrames[MAX_STREAM_NUMBER];
     std::atomic<bool> mActive;
@@ -27,6 +27,7 @@
 #include "SensorHwCtrl.h"
 #include "V4l2DeviceFactory.h"
 #include "iutils/CameraLog.h"
+#include "iutils/LatencyStats.h"
 
 using std::vector;
 
@@ -47,7 +48,12 @@ SensorHwCtrl::SensorHwCtrl(int cameraId, V4L2Subdevice* pixelArraySubdev,
           mWdrMode(0),
           // HDR_FEATURE_E
           mCurFll(0),
-          mCalculatingFrameDuration(true) {
+          mCalculatingFrameDuration(true),
+          mBatchingControls(false),
+          mPendingHorzBlank(-1),
+          mPendingFll(-1),
+          mControlCount(0),
+          mControlIoctlCount(0) {
     LOG1("<id%d> @%s", mCameraId, __func__);
     // CRL_MODULE_S
     /**
@@ -176,7 +182,7 @@ int SensorHwCtrl::setExposure(const vector<int>& coarseExposures,
 
     LOG2("%s coarseExposure=%d fineExposure=%d", __func__, coarseExposures[0], fineExposures[0]);
     LOG2("SENSORCTRLINFO: exposure_value=%d", coarseExposures[0]);
-    return mPixelArraySubdev->SetControl(V4L2_CID_EXPOSURE, coarseExposures[0]);
+    return setControl(mPixelArraySubdev, V4L2_CID_EXPOSURE, coarseExposures[0]);
 }
 
 // CRL_MODULE_S
@@ -189,7 +195,7 @@ int SensorHwCtrl::setMultiExposures(const vector<int>& coarseExposures,
     if (coarseExposures.size() > 2) {
         LOG2("coarseExposure[0]=%d fineExposure[0]=%d", coarseExposures[0], fineExposures[0]);
         // The first exposure is very short exposure if larger than 2 exposures.
-        status = mPixelArraySubdev->SetControl(CRL_CID_EXPOSURE_SHS2, coarseExposures[0]);
+        status = setControl(mPixelArraySubdev, CRL_CID_EXPOSURE_SHS2, coarseExposures[0]);
         CheckAndLogError(status != OK, status, "failed to set exposure SHS2 %d.",
                          coarseExposures[0]);
 
@@ -202,10 +208,10 @@ int SensorHwCtrl::setMultiExposures(const vector<int>& coarseExposures,
     }
 
     LOG2("shortExp=%d longExp=%d", shortExp, longExp);
-    status = mPixelArraySubdev->SetControl(CRL_CID_EXPOSURE_SHS1, shortExp);
+    status = setControl(mPixelArraySubdev, CRL_CID_EXPOSURE_SHS1, shortExp);
     CheckAndLogError(status != OK, status, "failed to set exposure SHS1 %d.", shortExp);
 
-    status = mPixelArraySubdev->SetControl(V4L2_CID_EXPOSURE, longExp);
+    status = setControl(mPixelArraySubdev, V4L2_CID_EXPOSURE, longExp);
     CheckAndLogError(status != OK, status, "failed to set long exposure %d.", longExp);
     LOG2("SENSORCTRLINFO: exposure_value=%d", longExp);
 
@@ -220,7 +226,7 @@ int SensorHwCtrl::setDualExposuresDCGAndVS(const vector<int>& coarseExposures,
     if (coarseExposures.size() > 2) {
         LOG2("coarseExposure[0]=%d fineExposure[0]=%d", coarseExposures[0], fineExposures[0]);
         // The first exposure is very short exposure for DCG + VS case.
-        status = mPixelArraySubdev->SetControl(CRL_CID_EXPOSURE_SHS1, coarseExposures[0]);
+        status = setControl(mPixelArraySubdev, CRL_CID_EXPOSURE_SHS1, coarseExposures[0]);
         CheckAndLogError(status != OK, status, "failed to set exposure SHS1 %d.",
                          coarseExposures[0]);
 
@@ -228,7 +234,7 @@ int SensorHwCtrl::setDualExposuresDCGAndVS(const vector<int>& coarseExposures,
         LOG2("SENSORCTRLINFO: exposure_long=%d", coarseExposures[2]);  // long
     }
 
-    status = mPixelArraySubdev->SetControl(V4L2_CID_EXPOSURE, longExp);
+    status = setControl(mPixelArraySubdev, V4L2_CID_EXPOSURE, longExp);
     CheckAndLogError(status != OK, status, "failed to set long exposure %d.", longExp);
     LOG2("SENSORCTRLINFO: exposure_value=%d", longExp);
 
@@ -251,6 +257,9 @@ int SensorHwCtrl::setShutterAndReadoutTiming(const vector<int>& coarseExposures,
     for (auto range : ExpRanges) {
         if (range.Resolution.width == width && range.Resolution.height == height) {
             int shs1, rhs1, shs2 = 0;
+            // The FLL of the same transaction is committed ahead of the exposures, and the
+            // exposures are dropped if it fails, so the FLL of this frame is the pending one.
+            int fll = (mPendingFll >= 0) ? mPendingFll : mCurFll;
 
             if (coarseExposures.size() > 2) {
                 // LEF(coarseExposures[2]) = SHS3.max + SHS3.upperBound - SHS3 - OFFSET
@@ -259,7 +268,7 @@ int SensorHwCtrl::setShutterAndReadoutTiming(const vector<int>& coarseExposures,
                 CheckWarning((shs3 < range.SHS3.min || shs3 > range.SHS3.max), NO_INIT,
                              "%s : SHS3 not match %d [%d ~ %d]", __func__, shs3, range.SHS3.min,
                              range.SHS3.max);
-                status = mPixelArraySubdev->SetControl(CRL_CID_EXPOSURE_SHS3, shs3);
+                status = setControl(mPixelArraySubdev, CRL_CID_EXPOSURE_SHS3, shs3);
                 CheckAndLogError(status != OK, status, "%s failed to set exposure SHS3.", __func__);
 
                 // RHS2 range [SHS2 + upperBound ~ SHS3 - lowerBound] and should = min + n * step
@@ -268,22 +277,22 @@ int SensorHwCtrl::setShutterAndReadoutTiming(const vector<int>& coarseExposures,
                 CheckWarning((rhs2 < range.RHS2.min || rhs2 > range.RHS2.max), NO_INIT,
                              "%s : RHS2 not match %d [%d ~ %d]", __func__, rhs2, range.RHS2.min,
                              range.RHS2.max);
-                status = mPixelArraySubdev->SetControl(CRL_CID_EXPOSURE_RHS2, rhs2);
+                status = setControl(mPixelArraySubdev, CRL_CID_EXPOSURE_RHS2, rhs2);
                 CheckAndLogError(status != OK, status, "%s failed to set exposure RHS2.", __func__);
 
                 // SEF2(coarseExposures[1]) = RHS2 - SHS2 - OFFSET
                 shs2 = rhs2 - coarseExposures[1] - 1;
             } else {
                 // LEF(coarseExposures[2]) = FLL + SHS2.upperBound - SHS2 - OFFSET
-                shs2 = mCurFll + range.SHS2.upperBound - coarseExposures[1] - 1;
+                shs2 = fll + range.SHS2.upperBound - coarseExposures[1] - 1;
             }
 
             // SHS2 range [RHS1 + RHS1.upperBound ~ SHS2.max]
-            CheckWarningNoReturn(shs2 < range.SHS2.min || shs2 > std::max(range.SHS2.max, mCurFll),
+            CheckWarningNoReturn(shs2 < range.SHS2.min || shs2 > std::max(range.SHS2.max, fll),
                                  "%s : SHS2 not match %d [%d ~ %d]", __func__, shs2, range.SHS2.min,
-                                 std::max(range.SHS2.max, mCurFll));
-            shs2 = CLIP(shs2, std::max(range.SHS2.max, mCurFll), range.SHS2.min);
-            status = mPixelArraySubdev->SetControl(CRL_CID_EXPOSURE_SHS2, shs2);
+                                 std::max(range.SHS2.max, fll));
+            shs2 = CLIP(shs2, std::max(range.SHS2.max, fll), range.SHS2.min);
+            status = setControl(mPixelArraySubdev, CRL_CID_EXPOSURE_SHS2, shs2);
             CheckAndLogError(status != OK, status, "%s failed to set exposure SHS2.", __func__);
 
             // RHS1 range [SHS1 + upperBound ~ SHS2 - lowerBound] and should = min + n * step
@@ -299,7 +308,7 @@ int SensorHwCtrl::setShutterAndReadoutTiming(const vector<int>& coarseExposures,
                 rhs1 = CLIP(rhs1, range.RHS1.max, range.RHS1.min);
                 // Set RHS1 if not using fixed VBP
                 LOG2("%s: set dynamic VBP %d", __func__, rhs1);
-                status = mPixelArraySubdev->SetControl(CRL_CID_EXPOSURE_RHS1, rhs1);
+                status = setControl(mPixelArraySubdev, CRL_CID_EXPOSURE_RHS1, rhs1);
                 CheckAndLogError(status != OK, status, "%s failed to set exposure RHS1.", __func__);
             } else {
                 // Use fixed VBP for RHS1 value
@@ -320,7 +329,7 @@ int SensorHwCtrl::setShutterAndReadoutTiming(const vector<int>& coarseExposures,
                                  "%s : SHS1 not match %d [%d ~ %d]", __func__, shs1, range.SHS1.min,
                                  range.SHS1.max);
             shs1 = CLIP(shs1, range.SHS1.max, range.SHS1.min);
-            status = mPixelArraySubdev->SetControl(CRL_CID_EXPOSURE_SHS1, shs1);
+            status = setControl(mPixelArraySubdev, CRL_CID_EXPOSURE_SHS1, shs1);
             CheckAndLogError(status != OK, status, "%s failed to set exposure SHS1.", __func__);
 
             LOG2("%s: set exposures done.", __func__);
@@ -351,14 +360,14 @@ int SensorHwCtrl::setAnalogGains(const vector<int>& analogGains) {
     // CRL_MODULE_E
 
     LOG2("%s analogGain=%d", __func__, analogGains[0]);
-    int status = mPixelArraySubdev->SetControl(V4L2_CID_ANALOGUE_GAIN, analogGains[0]);
+    int status = setControl(mPixelArraySubdev, V4L2_CID_ANALOGUE_GAIN, analogGains[0]);
     CheckAndLogError(status != OK, status, "failed to set analog gain %d.", analogGains[0]);
 #ifdef V4L2_CID_BLC
     int low, high;
     if (PlatformData::getDisableBLCByAGain(mCameraId, low, high)) {
         // Set V4L2_CID_BLC to 0(disable) if analog gain falls into the given range.
-        status = mPixelArraySubdev->SetControl(
-            V4L2_CID_BLC, (analogGains[0] >= low && analogGains[0] <= high) ? 0 : 1);
+        status = setControl(mPixelArraySubdev, V4L2_CID_BLC,
+                            (analogGains[0] >= low && analogGains[0] <= high) ? 0 : 1);
     }
 #endif
     return status;
@@ -382,14 +391,14 @@ int SensorHwCtrl::setDigitalGains(const vector<int>& digitalGains) {
     if (mWdrMode && PlatformData::getSensorGainType(mCameraId) == ISP_DG_AND_SENSOR_DIRECT_AG) {
         LOG2("%s: WDR mode, skip sensor DG, all digital gain is passed to ISP", __func__);
     } else if (PlatformData::isUsingSensorDigitalGain(mCameraId)) {
-        if (mPixelArraySubdev->SetControl(V4L2_CID_GAIN, digitalGains[0]) != OK) {
+        if (setControl(mPixelArraySubdev, V4L2_CID_GAIN, digitalGains[0]) != OK) {
             LOGW("set digital gain failed");
         }
     }
     // CRL_MODULE_E
 
     LOG2("%s digitalGain=%d", __func__, digitalGains[0]);
-    return mPixelArraySubdev->SetControl(V4L2_CID_DIGITAL_GAIN, digitalGains[0]);
+    return setControl(mPixelArraySubdev, V4L2_CID_DIGITAL_GAIN, digitalGains[0]);
 }
 
 // CRL_MODULE_S
@@ -400,7 +409,7 @@ int SensorHwCtrl::setMultiDigitalGain(const vector<int>& digitalGains) {
 
     if (digitalGains.size() > 2) {
         LOG2("digitalGains[0]=%d", digitalGains[0]);
-        status = mPixelArraySubdev->SetControl(CRL_CID_DIGITAL_GAIN_VS, digitalGains[0]);
+        status = setControl(mPixelArraySubdev, CRL_CID_DIGITAL_GAIN_VS, digitalGains[0]);
         CheckAndLogError(status != OK, status, "failed to set very short DG %d.", digitalGains[0]);
 
         shortDg = digitalGains[1];
@@ -408,10 +417,10 @@ int SensorHwCtrl::setMultiDigitalGain(const vector<int>& digitalGains) {
     }
 
     LOG2("shortDg=%d longDg=%d", shortDg, longDg);
-    status = mPixelArraySubdev->SetControl(CRL_CID_DIGITAL_GAIN_S, shortDg);
+    status = setControl(mPixelArraySubdev, CRL_CID_DIGITAL_GAIN_S, shortDg);
     CheckAndLogError(status != OK, status, "failed to set short DG %d.", shortDg);
 
-    status = mPixelArraySubdev->SetControl(V4L2_CID_GAIN, longDg);
+    status = setControl(mPixelArraySubdev, V4L2_CID_GAIN, longDg);
     CheckAndLogError(status != OK, status, "failed to set long DG %d.", longDg);
 
     return status;
@@ -424,7 +433,7 @@ int SensorHwCtrl::setMultiAnalogGain(const vector<int>& analogGains) {
 
     if (analogGains.size() > 2) {
         LOG2("VS AG %d", analogGains[0]);
-        int status = mPixelArraySubdev->SetControl(CRL_CID_ANALOG_GAIN_VS, analogGains[0]);
+        int status = setControl(mPixelArraySubdev, CRL_CID_ANALOG_GAIN_VS, analogGains[0]);
         CheckAndLogError(status != OK, status, "failed to set VS AG %d", analogGains[0]);
 
         shortAg = analogGains[1];
@@ -436,10 +445,10 @@ int SensorHwCtrl::setMultiAnalogGain(const vector<int>& analogGains) {
     }
 
     LOG2("shortAg=%d longAg=%d", shortAg, longAg);
-    status = mPixelArraySubdev->SetControl(CRL_CID_ANALOG_GAIN_S, shortAg);
+    status = setControl(mPixelArraySubdev, CRL_CID_ANALOG_GAIN_S, shortAg);
     CheckAndLogError(status != OK, status, "failed to set short AG %d.", shortAg);
 
-    status = mPixelArraySubdev->SetControl(V4L2_CID_ANALOGUE_GAIN, longAg);
+    status = setControl(mPixelArraySubdev, V4L2_CID_ANALOGUE_GAIN, longAg);
     CheckAndLogError(status != OK, status, "failed to set long AG %d.", longAg);
 
     return status;
@@ -457,7 +466,7 @@ int SensorHwCtrl::setConversionGain(const vector<int>& analogGains) {
     LOG2("very short AG %d, short AG %d, long AG %d, conversion value %d", analogGains[0],
          analogGains[1], analogGains[2], value);
 
-    int status = mPixelArraySubdev->SetControl(V4L2_CID_ANALOGUE_GAIN, value);
+    int status = setControl(mPixelArraySubdev, V4L2_CID_ANALOGUE_GAIN, value);
     CheckAndLogError(status != OK, status, "failed to set AG %d", value);
 
     return OK;
@@ -468,20 +477,25 @@ int SensorHwCtrl::setLineLengthPixels(int llp) {
     int status = OK;
     LOG2("@%s, llp:%d", __func__, llp);
 
+    int horzBlank = llp - mCropWidth;
     if (mCalculatingFrameDuration) {
-        int horzBlank = llp - mCropWidth;
-        if (mHorzBlank != horzBlank) {
-            status = mPixelArraySubdev->SetControl(V4L2_CID_HBLANK, horzBlank);
+        if (horzBlank != ((mPendingHorzBlank >= 0) ? mPendingHorzBlank : mHorzBlank)) {
+            status = setControl(mPixelArraySubdev, V4L2_CID_HBLANK, horzBlank);
         }
         // CRL_MODULE_S
     } else {
-        status = mPixelArraySubdev->SetControl(V4L2_CID_LINE_LENGTH_PIXELS, llp);
+        status = setControl(mPixelArraySubdev, V4L2_CID_LINE_LENGTH_PIXELS, llp);
         // CRL_MODULE_E
     }
 
     CheckAndLogError(status != OK, status, "failed to set llp.");
 
-    mHorzBlank = llp - mCropWidth;
+    // A batched value is only in the sensor after commitControls()
+    if (mBatchingControls) {
+        mPendingHorzBlank = horzBlank;
+    } else {
+        mHorzBlank = horzBlank;
+    }
     return status;
 }
 
@@ -489,22 +503,27 @@ int SensorHwCtrl::setFrameLengthLines(int fll) {
     int status = OK;
     LOG2("@%s, fll:%d", __func__, fll);
 
+    int vertBlank = fll - mCropHeight;
     if (mCalculatingFrameDuration) {
-        int vertBlank = fll - mCropHeight;
-        if (mVertBlank != vertBlank) {
-            status = mPixelArraySubdev->SetControl(V4L2_CID_VBLANK, vertBlank);
+        int curVertBlank = (mPendingFll >= 0) ? mPendingFll - mCropHeight : mVertBlank;
+        if (vertBlank != curVertBlank) {
+            status = setControl(mPixelArraySubdev, V4L2_CID_VBLANK, vertBlank);
         }
         // CRL_MODULE_S
     } else {
-        status = mPixelArraySubdev->SetControl(V4L2_CID_FRAME_LENGTH_LINES, fll);
+        status = setControl(mPixelArraySubdev, V4L2_CID_FRAME_LENGTH_LINES, fll);
         // CRL_MODULE_E
     }
 
-    mCurFll = fll;
-
     CheckAndLogError(status != OK, status, "failed to set fll.");
 
-    mVertBlank = fll - mCropHeight;
+    // A batched value is only in the sensor after commitControls()
+    if (mBatchingControls) {
+        mPendingFll = fll;
+    } else {
+        mCurFll = fll;
+        mVertBlank = vertBlank;
+    }
     return status;
 }
 
@@ -518,10 +537,11 @@ int SensorHwCtrl::setFrameDuration(int llp, int fll) {
     /* only set them to driver when llp or fll is not 0 */
     if (llp) {
         status = setLineLengthPixels(llp);
+        if (status != OK) return status;
     }
 
     if (fll) {
-        status |= setFrameLengthLines(fll);
+        status = setFrameLengthLines(fll);
     }
 
     return status;
@@ -582,8 +602,9 @@ int SensorHwCtrl::getFrameDuration(int& llp, int& fll) {
     CheckAndLogError(!mPixelArraySubdev, NO_INIT, "pixel array sub device is not set");
 
     int status = getLineLengthPixels(llp);
+    if (status != OK) return status;
 
-    status |= getFrameLengthLines(fll);
+    status = getFrameLengthLines(fll);
     LOG2("@%s, llp:%d, fll:%d", __func__, llp, fll);
 
     return status;
@@ -625,6 +646,118 @@ int SensorHwCtrl::getExposureRange(int& exposureMin, int& exposureMax, int& expo
     return status;
 }
 
+int SensorHwCtrl::setControl(V4L2Subdevice* subdev, int id, int value) {
+    if (!mBatchingControls) {
+        mControlCount++;
+        mControlIoctlCount++;
+        return subdev->SetControl(id, value);
+    }
+
+    // The later value wins if the control is set again in the same frame
+    for (auto& pending : mPendingControls) {
+        if (pending.first == subdev && pending.second.id == static_cast<uint32_t>(id)) {
+            pending.second.value = value;
+            return OK;
+        }
+    }
+
+    struct v4l2_ext_control control = {};
+    control.id = id;
+    control.value = value;
+    mPendingControls.push_back(std::make_pair(subdev, control));
+    return OK;
+}
+
+int SensorHwCtrl::writeControls(V4L2Subdevice* subdev, vector<struct v4l2_ext_control>* controls) {
+    mControlCount += controls->size();
+#ifndef CAL_BUILD
+    mControlIoctlCount++;
+    if (subdev->SetControls(controls->data(), controls->size()) == OK) return OK;
+
+    // Some drivers reject the mixed control classes, write them one by one then
+    LOGW("%s: failed to set %zu controls together, set them separately", __func__,
+         controls->size());
+#endif
+    for (auto& control : *controls) {
+        mControlIoctlCount++;
+        int status = subdev->SetControl(control.id, control.value);
+        CheckAndLogError(status != OK, status, "%s: failed to set control 0x%x", __func__,
+                         control.id);
+    }
+    return OK;
+}
+
+bool SensorHwCtrl::isFrameDurationControl(uint32_t id) {
+    return id == V4L2_CID_VBLANK || id == V4L2_CID_HBLANK ||
+           id == V4L2_CID_FRAME_LENGTH_LINES || id == V4L2_CID_LINE_LENGTH_PIXELS;
+}
+
+void SensorHwCtrl::applyPendingFrameDuration() {
+    if (mPendingHorzBlank >= 0) mHorzBlank = mPendingHorzBlank;
+    if (mPendingFll >= 0) {
+        mCurFll = mPendingFll;
+        mVertBlank = mPendingFll - mCropHeight;
+    }
+    mPendingHorzBlank = -1;
+    mPendingFll = -1;
+}
+
+void SensorHwCtrl::beginControls() {
+    mBatchingControls = true;
+    mPendingControls.clear();
+    mPendingHorzBlank = -1;
+    mPendingFll = -1;
+}
+
+int SensorHwCtrl::commitControls(int64_t sequence) {
+    mBatchingControls = false;
+    if (mPendingControls.empty()) {
+        // The frame duration may be set to the values the sensor already has
+        applyPendingFrameDuration();
+        return OK;
+    }
+
+    LatencyStats::ScopedLatency latency(mCameraId, -1, LATENCY_SENSOR_CTRL);
+    int64_t ioctlCount = mControlIoctlCount;
+    int status = OK;
+    vector<struct v4l2_ext_control> controls;
+    // The drivers check the exposure against the range of the current frame length, so the
+    // frame duration is written first on its own, then the exposure and gains together.
+    for (int pass = 0; pass < 2 && status == OK; pass++) {
+        bool frameDuration = (pass == 0);
+        while (true) {
+            // Group the controls by the sub device, the pixel array normally owns all of them
+            V4L2Subdevice* subdev = nullptr;
+            controls.clear();
+            for (auto it = mPendingControls.begin(); it != mPendingControls.end();) {
+                if (isFrameDurationControl(it->second.id) == frameDuration &&
+                    (!subdev || it->first == subdev)) {
+                    subdev = it->first;
+                    controls.push_back(it->second);
+                    it = mPendingControls.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            if (!subdev) break;
+            status = writeControls(subdev, &controls);
+            if (status != OK) break;
+        }
+        if (frameDuration && status == OK) applyPendingFrameDuration();
+    }
+
+    // The exposures are computed against the frame duration of this transaction, so they're
+    // dropped with it when it fails, and the cached frame duration stays the sensor's one.
+    mPendingControls.clear();
+    mPendingHorzBlank = -1;
+    mPendingFll = -1;
+
+    LOG2("<seq%ld>@%s: %ld ioctls, total %ld controls in %ld ioctls", sequence, __func__,
+         mControlIoctlCount - ioctlCount, mControlCount, mControlIoctlCount);
+    CheckAndLogError(status != OK, status, "<seq%ld>failed to set sensor controls", sequence);
+    return OK;
+}
+
 // HDR_FEATURE_S
 int SensorHwCtrl::setWdrMode(int mode) {
     HAL_TRACE_CALL(CAMERA_DEBUG_LOG_LEVEL2);
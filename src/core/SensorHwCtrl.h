@@ -22,6 +22,7 @@
 #include <v4l2_device.h>
 #endif
 
+#include <utility>
 #include <vector>
 
 #include "iutils/Errors.h"
@@ -78,7 +79,32 @@ class SensorHwCtrl {
     // CRL_MODULE_S
     virtual int setFrameRate(float fps);
     // CRL_MODULE_E
+
+    /**
+     * Start a control transaction of one frame: the exposure, gain and frame duration
+     * controls are collected until commitControls() instead of being written one by one.
+     */
+    virtual void beginControls();
+
+    /**
+     * Write the collected controls with one VIDIOC_S_EXT_CTRLS per sub device, so that
+     * they can't straddle a frame boundary. The frame duration controls are written
+     * before the others since they change the valid exposure range.
+     * It stops at the first failure, and the exposures and gains are dropped if the frame
+     * duration fails since they were computed against it.
+     *
+     * \param[IN] sequence: the frame which the controls are applied in, for logging
+     *
+     *\return OK if successfully.
+     */
+    virtual int commitControls(int64_t sequence);
+
  private:
+    int setControl(V4L2Subdevice* subdev, int id, int value);
+    int writeControls(V4L2Subdevice* subdev, std::vector<struct v4l2_ext_control>* controls);
+    static bool isFrameDurationControl(uint32_t id);
+    void applyPendingFrameDuration();
+
     int setLineLengthPixels(int llp);
     int getLineLengthPixels(int& llp);
     int setFrameLengthLines(int fll);
@@ -125,6 +151,17 @@ class SensorHwCtrl {
      * use HBlank/VBlank to calculate it.
      */
     bool mCalculatingFrameDuration;
+
+    // The controls collected between beginControls() and commitControls()
+    bool mBatchingControls;
+    std::vector<std::pair<V4L2Subdevice*, struct v4l2_ext_control>> mPendingControls;
+    // The frame duration set in the transaction, -1 if not set. mHorzBlank, mVertBlank and
+    // mCurFll follow the sensor, so they're updated only when the controls are written.
+    int mPendingHorzBlank;
+    int mPendingFll;
+    // The statistics of the control transactions
+    int64_t mControlCount;
+    int64_t mControlIoctlCount;
 };  // class SensorHwCtrl
 
 /**
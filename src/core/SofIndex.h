@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace icamera {
+
+/**
+ * SofIndex keeps the SOF timestamps (in ms) of the recent Capacity frames of one camera,
+ * sorted in ascending order, so that the closest frame of another camera is found by a
+ * binary search. The oldest frame is dropped when it's full.
+ */
+template <int Capacity>
+class SofIndex {
+ public:
+    SofIndex() : mCount(0) {}
+
+    void reset() { mCount = 0; }
+    int count() const { return mCount; }
+
+    void add(int64_t sequence, long timestampMs) {
+        if (mCount == Capacity) {
+            // Drop the oldest one
+            std::copy(mSequence + 1, mSequence + mCount, mSequence);
+            std::copy(mTimestampMs + 1, mTimestampMs + mCount, mTimestampMs);
+            mCount--;
+        }
+
+        // Insert in order, it's appended in most cases since the SOF timestamps are increasing
+        int pos = mCount;
+        while (pos > 0 && mTimestampMs[pos - 1] > timestampMs) {
+            mSequence[pos] = mSequence[pos - 1];
+            mTimestampMs[pos] = mTimestampMs[pos - 1];
+            pos--;
+        }
+        mSequence[pos] = sequence;
+        mTimestampMs[pos] = timestampMs;
+        mCount++;
+    }
+
+    // Return the timestamp of the frame, -1 if it isn't in the index
+    long timestampOf(int64_t sequence) const {
+        // The frame is the latest one in most cases
+        for (int i = mCount - 1; i >= 0; i--) {
+            if (mSequence[i] == sequence) return mTimestampMs[i];
+        }
+        return -1;
+    }
+
+    // Return the timestamp closest to timestampMs, -1 if there is none
+    long findClosest(long timestampMs) const {
+        if (mCount == 0) return -1;
+
+        const long* begin = mTimestampMs;
+        const long* end = mTimestampMs + mCount;
+        const long* it = std::lower_bound(begin, end, timestampMs);
+        if (it == end) return *(it - 1);
+        if (it == begin) return *it;
+        return (*it - timestampMs < timestampMs - *(it - 1)) ? *it : *(it - 1);
+    }
+
+ private:
+    int64_t mSequence[Capacity];
+    long mTimestampMs[Capacity];
+    int mCount;
+};
+
+}  // namespace icamera
@@ -21,7 +21,10 @@
 #include <math.h>
 #include <sys/sysinfo.h>
 
+#include <algorithm>
+
 #include "iutils/CameraLog.h"
+#include "iutils/LatencyStats.h"
 
 namespace icamera {
 SyncManager* SyncManager::sInstance = nullptr;
@@ -31,6 +34,8 @@ Mutex SyncManager::sLock;
 #define USEC_TO_MS(usec) ((usec) / (1000))
 
 const int max_vc_sync_count = 128;
+// The frames are synced if the difference of their SOF timestamps isn't more than it
+static const long kSyncTimeDiffMs = 2;
 
 SyncManager* SyncManager::getInstance() {
     AutoMutex lock(sLock);
@@ -54,10 +59,7 @@ SyncManager::SyncManager() {
     LOG1("@%s", __func__);
     AutoMutex lock(mLock);
     for (int i = 0; i < MAX_CAMERA_NUMBER; i++) {
-        for (int j = 0; j < MAX_BUFFER_COUNT; j++) {
-            mCameraBufInfo[i][j].sequence = -1;
-            CLEAR(mCameraBufInfo[i][j].sof_ts);
-        }
+        mSofIndex[i].reset();
     }
 
     mTotalSyncCamNum = 0;
@@ -70,67 +72,74 @@ SyncManager::~SyncManager() {
 
 bool SyncManager::isSynced(int cameraId, int64_t sequence) {
     LOG2("@%s", __func__);
-    const int TIME_DIFF_MS = 2;
-    bool sync = true;
-    int index = sequence % MAX_BUFFER_COUNT;
+    CheckAndLogError(cameraId < 0 || cameraId >= MAX_CAMERA_NUMBER, false, "invalid camera id %d",
+                     cameraId);
 
     AutoMutex lock(mLock);
-    camera_buf_info bufInfo = mCameraBufInfo[cameraId][index];
-
-    int syncNum = 0;
-    bool isSync[MAX_CAMERA_NUMBER];
-    long frameSyncedMs[MAX_CAMERA_NUMBER];
-    long curFrameMs = USEC_TO_MS(bufInfo.sof_ts.tv_usec) + SEC_TO_MS(bufInfo.sof_ts.tv_sec);
+    return isSyncedLocked(cameraId, sequence);
+}
 
-    // first step: To check whether the current frame is synced with others camera channel
-    //            if timestamp difference <= 2ms, then think the frame is synced
-    for (int i = 0; i < MAX_CAMERA_NUMBER; i++) {
-        isSync[i] = false;
-        frameSyncedMs[i] = 0;
-        if (mCameraBufInfo[i][0].sequence == -1 || i == cameraId) {
-            continue;
-        }
-        for (int j = 0; j < MAX_BUFFER_COUNT; j++) {
-            if (mCameraBufInfo[i][j].sequence >= 0) {
-                camera_buf_info& temp = mCameraBufInfo[i][j];
-                long tempFrameMs = USEC_TO_MS(temp.sof_ts.tv_usec) + SEC_TO_MS(temp.sof_ts.tv_sec);
-                if (abs(tempFrameMs - curFrameMs) <= TIME_DIFF_MS) {
-                    isSync[syncNum] = true;
-                    frameSyncedMs[syncNum] = tempFrameMs;
-                    syncNum++;
-                    break;
-                }
-            }
+bool SyncManager::waitSynced(int cameraId, int64_t sequence, int64_t timeoutUs) {
+    CheckAndLogError(cameraId < 0 || cameraId >= MAX_CAMERA_NUMBER, false, "invalid camera id %d",
+                     cameraId);
+
+    nsecs_t startTime = CameraUtils::systemTime();
+    nsecs_t timeout = timeoutUs * 1000;
+    bool sync = false;
+    {
+        ConditionLock lock(mLock);
+        sync = isSyncedLocked(cameraId, sequence);
+        nsecs_t waitTime = 0;
+        while (!sync && waitTime < timeout) {
+            mSofSignal.waitRelative(lock, timeout - waitTime);
+            sync = isSyncedLocked(cameraId, sequence);
+            waitTime = CameraUtils::systemTime() - startTime;
         }
     }
-    // second step: if current frame is synced with frames from other cameraID,
-    //             to check whether other 3 channel frames synced or not
-    if (syncNum >= mTotalSyncCamNum - 1) {
-        for (int i = 0; i < mTotalSyncCamNum - 1; i++) {
-            if (isSync[i]) {
-                if ((i + 1 < mTotalSyncCamNum - 1) &&
-                    abs(frameSyncedMs[i] - frameSyncedMs[i + 1]) <= TIME_DIFF_MS) {
-                    sync &= true;
-                } else if ((i + 1 == mTotalSyncCamNum - 1) &&
-                           abs(frameSyncedMs[i] - frameSyncedMs[0]) <= TIME_DIFF_MS) {
-                    sync &= true;
-                } else {
-                    sync &= false;
-                }
-            }
-        }
-    } else {
-        sync = false;
+
+    nsecs_t waitTime = CameraUtils::systemTime() - startTime;
+    LatencyStats::record(cameraId, -1, sync ? LATENCY_FRAME_SYNC_WAIT : LATENCY_FRAME_SYNC_DROP,
+                         waitTime);
+    LOG2("<id%d:seq%ld>@%s: sync %d after %ld us", cameraId, sequence, __func__, sync,
+         waitTime / 1000);
+    return sync;
+}
+
+bool SyncManager::isSyncedLocked(int cameraId, int64_t sequence) {
+    long curFrameMs = mSofIndex[cameraId].timestampOf(sequence);
+    if (curFrameMs < 0) return false;
+
+    // The frame is synced if every other camera has one frame within kSyncTimeDiffMs of it,
+    // and these frames are also within kSyncTimeDiffMs of each other.
+    int syncNum = 0;
+    long minMs = curFrameMs;
+    long maxMs = curFrameMs;
+    for (int i = 0; i < MAX_CAMERA_NUMBER; i++) {
+        if (i == cameraId) continue;
+
+        long frameMs = mSofIndex[i].findClosest(curFrameMs);
+        if (frameMs < 0 || labs(frameMs - curFrameMs) > kSyncTimeDiffMs) continue;
+
+        syncNum++;
+        minMs = std::min(minMs, frameMs);
+        maxMs = std::max(maxMs, frameMs);
     }
+
+    bool sync = syncNum >= mTotalSyncCamNum - 1 && maxMs - minMs <= kSyncTimeDiffMs;
     LOG2("Id:%d, sof_ts:%ldms, sequence:%ld sync %d", cameraId, curFrameMs, sequence, sync);
     return sync;
 }
 
 void SyncManager::updateCameraBufInfo(int cameraId, camera_buf_info* info) {
     LOG2("@%s", __func__);
-    int index = info->sequence % MAX_BUFFER_COUNT;
+    CheckAndLogError(cameraId < 0 || cameraId >= MAX_CAMERA_NUMBER || !info, VOID_VALUE,
+                     "invalid camera id %d or info", cameraId);
+
+    long frameMs = USEC_TO_MS(info->sof_ts.tv_usec) + SEC_TO_MS(info->sof_ts.tv_sec);
     AutoMutex lock(mLock);
-    mCameraBufInfo[cameraId][index] = *info;
+    mSofIndex[cameraId].add(info->sequence, frameMs);
+
+    mSofSignal.broadcast();
 }
 
 void SyncManager::updateSyncCamNum() {
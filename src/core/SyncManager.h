@@ -17,6 +17,7 @@
 #pragma once
 
 #include "PlatformData.h"
+#include "SofIndex.h"
 
 namespace icamera {
 
@@ -40,6 +41,12 @@ class SyncManager {
     static SyncManager* getInstance();
 
     bool isSynced(int cameraId, int64_t sequence);
+    /**
+     * Wait until the frame of sequence is synced with the other cameras or timeout (in us),
+     * it's woken up by updateCameraBufInfo() of the other cameras.
+     * The wait time is recorded in LatencyStats, as LATENCY_FRAME_SYNC_DROP if not synced.
+     */
+    bool waitSynced(int cameraId, int64_t sequence, int64_t timeoutUs);
     void updateCameraBufInfo(int cameraId, camera_buf_info* info);
 
     void updateSyncCamNum();
@@ -48,11 +55,15 @@ class SyncManager {
     void updateVcSyncCount(int vc);
     void printVcSyncCount();
 
+ private:
+    bool isSyncedLocked(int cameraId, int64_t sequence);
+
  private:
     static SyncManager* sInstance;
     static Mutex sLock;
     Mutex mLock;
-    struct camera_buf_info mCameraBufInfo[MAX_CAMERA_NUMBER][MAX_BUFFER_COUNT];
+    Condition mSofSignal;  // Broadcast when any camera has a new SOF
+    SofIndex<MAX_BUFFER_COUNT> mSofIndex[MAX_CAMERA_NUMBER];
 
     int mVcSyncCount[MAX_CAMERA_NUMBER];
     Mutex mVcSyncLock;
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG CpuTNR
+
+#include "CpuTNR.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "image_process/ImageKernels.h"
+#include "iutils/CameraLog.h"
+#include "iutils/Errors.h"
+#include "iutils/WorkerPool.h"
+
+namespace icamera {
+
+static const int kRefFrameCount = 2;
+static const int kStrength = 96;  // The max weight of the reference in Q7
+static const int kBaseNoiseFloor = 3;
+static const int kMaxNoiseFloor = 32;
+static const int kMinLinePairsPerBand = 16;
+
+CpuTNR::CpuTNR(int cameraId)
+        : mCameraId(cameraId),
+          mWidth(0),
+          mHeight(0),
+          mStride(0),
+          mFrameSize(0),
+          mNoiseFloor(kBaseNoiseFloor),
+          mSlope(1),
+          mRefIndex(-1) {
+    paramUpdate(100);
+}
+
+CpuTNR::~CpuTNR() {}
+
+int CpuTNR::init(int width, int height, int stride) {
+    LOG1("<id%d>@%s size %dx%d, stride %d", mCameraId, __func__, width, height, stride);
+    CheckAndLogError(width <= 0 || height <= 0 || (height & 1) || stride < width, BAD_VALUE,
+                     "@%s, invalid size %dx%d, stride %d", __func__, width, height, stride);
+
+    mWidth = width;
+    mHeight = height;
+    mStride = stride;
+    mFrameSize = stride * height * 3 / 2;
+    mRefFrames.assign(kRefFrameCount, std::vector<uint8_t>(mFrameSize));
+    mRefIndex = -1;
+    return OK;
+}
+
+void CpuTNR::paramUpdate(int gain) {
+    // The noise grows with the square root of the gain
+    int noiseFloor = static_cast<int>(kBaseNoiseFloor * sqrt(std::max(gain, 100) / 100.0) + 0.5);
+    mNoiseFloor = std::min(noiseFloor, kMaxNoiseFloor);
+    // The weight of the reference drops to 0 at 3 times of the noise floor
+    mSlope = std::max(1, kStrength / (mNoiseFloor * 2));
+    LOG2("<id%d>@%s gain %d, noise floor %d, slope %d", mCameraId, __func__, gain, mNoiseFloor,
+         mSlope);
+}
+
+void CpuTNR::blendBand(const uint8_t* in, const uint8_t* ref, uint8_t* out, uint8_t* nextRef,
+                       int strength, int startPair, int endPair) {
+    const ImageKernels& kernels = getImageKernels();
+    const int uvOffset = mStride * mHeight;
+
+    for (int line = startPair * 2; line < endPair * 2; line++) {
+        int offset = line * mStride;
+        kernels.temporalBlendRow(in + offset, ref + offset, nextRef + offset, out + offset,
+                                 mWidth, strength, mNoiseFloor, mSlope);
+    }
+    for (int line = startPair; line < endPair; line++) {
+        int offset = uvOffset + line * mStride;
+        kernels.temporalBlendRow(in + offset, ref + offset, nextRef + offset, out + offset,
+                                 mWidth, strength, mNoiseFloor, mSlope);
+    }
+}
+
+int CpuTNR::runTnrFrame(const void* inBufAddr, void* outBufAddr, uint32_t inBufSize,
+                        uint32_t outBufSize, const Tnr7Param* tnrParam) {
+    PERF_CAMERA_ATRACE();
+    CheckAndLogError(!inBufAddr || !outBufAddr || !tnrParam, BAD_VALUE,
+                     "@%s, buffer is nullptr", __func__);
+    CheckAndLogError(mRefFrames.empty(), NO_INIT, "@%s, not initialized", __func__);
+    CheckAndLogError(inBufSize < mFrameSize || outBufSize < mFrameSize, BAD_VALUE,
+                     "@%s, buffer size %u/%u is smaller than %u", __func__, inBufSize, outBufSize,
+                     mFrameSize);
+
+    const uint8_t* in = static_cast<const uint8_t*>(inBufAddr);
+    uint8_t* out = static_cast<uint8_t*>(outBufAddr);
+
+    // Blending with the input itself just copies it when restarting
+    bool restart = mRefIndex < 0 || tnrParam->bc.is_first_frame;
+    const uint8_t* ref = restart ? in : mRefFrames[mRefIndex].data();
+    int strength = restart ? 0 : kStrength;
+    int nextIndex = (mRefIndex + 1) % kRefFrameCount;
+    uint8_t* nextRef = mRefFrames[nextIndex].data();
+
+    const int pairs = mHeight / 2;
+    WorkerPool* pool = WorkerPool::getSharedPool();
+    const int bands =
+        std::max(1, std::min(pool->getConcurrency(), pairs / kMinLinePairsPerBand));
+    pool->parallelFor(bands, [&](int band) {
+        blendBand(in, ref, out, nextRef, strength, pairs * band / bands,
+                  pairs * (band + 1) / bands);
+    });
+
+    mRefIndex = nextIndex;
+    LOG2("<id%d>@%s restart %d, %d bands", mCameraId, __func__, restart, bands);
+    return OK;
+}
+
+}  // namespace icamera
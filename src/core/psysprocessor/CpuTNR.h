@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "TNRCommon.h"
+#include "iutils/Utils.h"
+
+namespace icamera {
+
+/**
+ * \class CpuTNR
+ *
+ * CpuTNR runs the temporal noise reduction of NV12 frames on the CPU, GPUExecutor uses it
+ * when the GPU TNR isn't built in or fails to init, or the GPU is taken by the still TNR.
+ *
+ * Every pixel is blended with the previous output, and the weight of the previous output
+ * drops when the difference goes beyond the noise floor, so the moving areas keep the
+ * current frame. The noise floor follows the total gain given by paramUpdate().
+ * The outputs are also kept in a ring of internal frames which are the references of the
+ * next frames, and the frame is split into row bands run by the shared WorkerPool.
+ */
+class CpuTNR {
+ public:
+    explicit CpuTNR(int cameraId);
+    ~CpuTNR();
+
+    /**
+     * \param stride: the bytes per line of both planes, the UV plane follows the Y plane.
+     */
+    int init(int width, int height, int stride);
+
+    /**
+     * The same as IntelTNR7US::runTnrFrame(), only bc.is_first_frame of tnrParam is used,
+     * which restarts the blending from the input frame.
+     */
+    int runTnrFrame(const void* inBufAddr, void* outBufAddr, uint32_t inBufSize,
+                    uint32_t outBufSize, const Tnr7Param* tnrParam);
+
+    /**
+     * Update the noise floor with the total gain multiplied by 100.
+     */
+    void paramUpdate(int gain);
+
+ private:
+    void blendBand(const uint8_t* in, const uint8_t* ref, uint8_t* out, uint8_t* nextRef,
+                   int strength, int startPair, int endPair);
+
+ private:
+    int mCameraId;
+    int mWidth;
+    int mHeight;
+    int mStride;
+    uint32_t mFrameSize;
+    int mNoiseFloor;
+    int mSlope;
+
+    std::vector<std::vector<uint8_t>> mRefFrames;
+    int mRefIndex;  // The reference of the next frame, -1 if there isn't one
+
+    DISALLOW_COPY_AND_ASSIGN(CpuTNR);
+};
+
+}  // namespace icamera
@@ -55,8 +55,10 @@ GPUExecutor::GPUExecutor(int cameraId, const ExecutorPolicy& policy, vector<stri
           mTnr7usParam(nullptr),
           mIntelTNR(nullptr),
           mLastSequence(UINT32_MAX),
+          mCpuLastSequence(UINT32_MAX),
           mUseInternalTnrBuffer(useTnrOutBuffer),
           mOutBufferSize(0) {
+    CLEAR(mCpuTnrParam);
     CLEAR(mStillTnrTriggerInfo);
     LOG1("Construct %s", mName.c_str());
 }
@@ -132,6 +134,18 @@ int GPUExecutor::start() {
                 LOGW("Executor:%s init tnr failed", mName.c_str());
             }
         }
+
+        // The video frames skipped by the GPU when still TNR is prior run on the CPU
+        if (!mIntelTNR ||
+            (mStreamId == VIDEO_STREAM_ID && icamera::PlatformData::isStillTnrPrior())) {
+            mCpuTNR = std::unique_ptr<CpuTNR>(new CpuTNR(mCameraId));
+            int stride = CameraUtils::getStride(frameInfo.mFormat, frameInfo.mWidth);
+            if (mCpuTNR->init(frameInfo.mWidth, frameInfo.mHeight, stride) != OK) {
+                mCpuTNR = nullptr;
+                LOGW("Executor:%s init cpu tnr failed", mName.c_str());
+            }
+            mCpuLastSequence = UINT32_MAX;
+        }
     }
     AutoMutex l(mBufferQueueLock);
     ret = allocBuffers();
@@ -155,6 +169,7 @@ void GPUExecutor::stop() {
 
     delete mProcessThread;
     mIntelTNR = nullptr;
+    mCpuTNR = nullptr;
 }
 
 int GPUExecutor::allocBuffers() {
@@ -256,14 +271,12 @@ int GPUExecutor::getStillTnrTriggerInfo(TuningMode mode) {
 
 int GPUExecutor::getTotalGain(int64_t seq, float* totalGain) {
     CheckAndLogError(!totalGain, UNKNOWN_ERROR, "Invalid input");
-    AiqResult* aiqResults =
-        const_cast<AiqResult*>(AiqResultStorage::getInstance(mCameraId)->getAiqResult(seq));
-    if (aiqResults == nullptr) {
+    AiqResultStorage::AiqResultRef aiqResults =
+        AiqResultStorage::getInstance(mCameraId)->getAiqResultRef(seq);
+    if (!aiqResults) {
         LOGW("No result for sequence %ld! use the latest instead", seq);
-        aiqResults =
-            const_cast<AiqResult*>(AiqResultStorage::getInstance(mCameraId)->getAiqResult());
-        CheckAndLogError((aiqResults == nullptr), INVALID_OPERATION,
-                         "Cannot find available aiq result.");
+        aiqResults = AiqResultStorage::getInstance(mCameraId)->getAiqResultRef();
+        CheckAndLogError(!aiqResults, INVALID_OPERATION, "Cannot find available aiq result.");
     }
     *totalGain = (aiqResults->mAeResults.exposures[0].exposure->analog_gain *
                   aiqResults->mAeResults.exposures[0].exposure->digital_gain);
@@ -594,6 +607,8 @@ int GPUExecutor::runTnrFrame(const std::shared_ptr<CameraBuffer>& inBuf,
 
     outBuf->setSequence(sequence);
     if (!mIntelTNR) {
+        if (mCpuTNR) return runCpuTnrFrame(inBuf, outPtr, bufferSize);
+
         MEMCPY_S(outPtr, bufferSize, inBuf->getBufferAddr(), inBuf->getBufferSize());
         return OK;
     }
@@ -601,13 +616,19 @@ int GPUExecutor::runTnrFrame(const std::shared_ptr<CameraBuffer>& inBuf,
     if (icamera::PlatformData::isStillTnrPrior()) {
         // when running still stream tnr, should skip video tnr to decrease still capture duration.
         if (mStreamId == VIDEO_STREAM_ID && !mGPULock.try_lock()) {
-            MEMCPY_S(outPtr, bufferSize, inBuf->getBufferAddr(), inBuf->getBufferSize());
+            if (mCpuTNR) {
+                runCpuTnrFrame(inBuf, outPtr, bufferSize);
+            } else {
+                MEMCPY_S(outPtr, bufferSize, inBuf->getBufferAddr(), inBuf->getBufferSize());
+            }
             mLastSequence = UINT32_MAX;
             LOG2("Executor name:%s, skip frame sequence: %ld", mName.c_str(), inBuf->getSequence());
             return OK;
         } else if (mStreamId == STILL_TNR_STREAM_ID) {
             mGPULock.lock();
         }
+        // The frame runs on GPU, so the cpu tnr reference misses it, restart it next time
+        mCpuLastSequence = UINT32_MAX;
     }
 
     if (mLastSequence == UINT32_MAX || sequence - mLastSequence >= TNR7US_RESTART_THRESHOLD) {
@@ -670,6 +691,47 @@ int GPUExecutor::runTnrFrame(const std::shared_ptr<CameraBuffer>& inBuf,
     return ret;
 }
 
+int GPUExecutor::runCpuTnrFrame(const std::shared_ptr<CameraBuffer>& inBuf, void* outPtr,
+                                int outSize) {
+    uint32_t sequence = inBuf->getSequence();
+    if (mCpuLastSequence == UINT32_MAX ||
+        sequence - mCpuLastSequence >= TNR7US_RESTART_THRESHOLD) {
+        mCpuTnrParam.bc.is_first_frame = 1;
+    } else {
+        mCpuTnrParam.bc.is_first_frame = 0;
+    }
+
+    float totalGain = 0.0f;
+    if (getTotalGain(sequence, &totalGain) == OK) {
+        mCpuTNR->paramUpdate(static_cast<int>(totalGain * 100));
+    }
+
+    struct timespec beginTime = {};
+    if (Log::isLogTagEnabled(ST_GPU_TNR, CAMERA_DEBUG_LOG_LEVEL2)) {
+        clock_gettime(CLOCK_MONOTONIC, &beginTime);
+    }
+    int ret = mCpuTNR->runTnrFrame(inBuf->getBufferAddr(), outPtr, inBuf->getBufferSize(),
+                                   outSize, &mCpuTnrParam);
+    if (Log::isLogTagEnabled(ST_GPU_TNR, CAMERA_DEBUG_LOG_LEVEL2)) {
+        struct timespec endTime = {};
+        clock_gettime(CLOCK_MONOTONIC, &endTime);
+        uint64_t timeUsedUs = (endTime.tv_sec - beginTime.tv_sec) * 1000000 +
+                              (endTime.tv_nsec - beginTime.tv_nsec) / 1000;
+        LOG2(ST_GPU_TNR, "%s executor name:%s, sequence: %u run cpu tnr time %lu us", __func__,
+             mName.c_str(), sequence, timeUsedUs);
+    }
+
+    if (ret != OK) {
+        LOGW("Executor:%s, copy source buffer since cpu tnr failed", mName.c_str());
+        MEMCPY_S(outPtr, outSize, inBuf->getBufferAddr(), inBuf->getBufferSize());
+        mCpuLastSequence = UINT32_MAX;
+        return OK;
+    }
+
+    mCpuLastSequence = sequence;
+    return OK;
+}
+
 int GPUExecutor::dumpTnrParameters(uint32_t sequence) {
     const int DUMP_FILE_SIZE = 0x1000;
     std::string dumpFileName =
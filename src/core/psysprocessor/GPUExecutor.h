@@ -21,6 +21,7 @@
 #include <string>
 #include <vector>
 
+#include "CpuTNR.h"
 #include "IntelCCATypes.h"
 #include "PipeLiteExecutor.h"
 #ifdef ENABLE_SANDBOXING
@@ -61,11 +62,17 @@ class GPUExecutor : public PipeLiteExecutor {
     int getStillTnrTriggerInfo(TuningMode mode);
     int runTnrFrame(const std::shared_ptr<CameraBuffer>& inBuf,
                     std::shared_ptr<CameraBuffer> outbuf);
+    // Run the CPU TNR, copy the input if it fails
+    int runCpuTnrFrame(const std::shared_ptr<CameraBuffer>& inBuf, void* outPtr, int outSize);
 
  private:
     Tnr7Param* mTnr7usParam;
     std::unique_ptr<IntelTNR7US> mIntelTNR;
     uint32_t mLastSequence;
+    // Used when the GPU TNR isn't available or the GPU is taken by the still TNR
+    std::unique_ptr<CpuTNR> mCpuTNR;
+    Tnr7Param mCpuTnrParam;
+    uint32_t mCpuLastSequence;
     bool mUseInternalTnrBuffer;
     /* the lock is used for protecting GPU resource, every thread running GPU calculation
      * should require this lock. */
@@ -26,6 +26,7 @@
 
 #include "iutils/CameraDump.h"
 #include "iutils/CameraLog.h"
+#include "iutils/LatencyStats.h"
 #include "iutils/Utils.h"
 
 namespace icamera {
@@ -80,6 +81,9 @@ PGCommon::PGCommon(int cameraId, int pgId, const std::string& pgName, TuningMode
           mPPGProcessGroup(nullptr),
           mToken(0),
           mEvent(nullptr),
+          mCmdInFlight(false),
+          mIterationSequence(-1),
+          mIterationStartTime(0),
           mTerminalBuffers(nullptr),
           mInputMainTerminal(-1),
           mOutputMainTerminal(-1),
@@ -133,6 +137,10 @@ int PGCommon::init() {
 }
 
 void PGCommon::deInit() {
+    if (mCmdInFlight) {
+        waitCmd();
+    }
+    cancelTerminalBuffers(mIterationSequence);
     if (mPPGStarted) {
         stopPPG();
         mPPGStarted = false;
@@ -878,13 +886,40 @@ int PGCommon::iterate(CameraBufferMap& inBufs, CameraBufferMap& outBufs, ia_bina
                       const ia_binary_data* ipuParameters) {
     PERF_CAMERA_ATRACE();
 
+    int ret = prepareIteration(inBufs, outBufs, ipuParameters);
+    if (ret != OK) return ret;
+
+    ret = submit();
+    if (ret != OK) return ret;
+
+    ret = waitDone();
+    if (ret != OK) return ret;
+
+    return finishIteration(statistics);
+}
+
+int PGCommon::prepareIteration(CameraBufferMap& inBufs, CameraBufferMap& outBufs,
+                               const ia_binary_data* ipuParameters) {
+    PERF_CAMERA_ATRACE();
+    if (mCmdInFlight) {
+        // The last iteration was aborted, drain its command before its terminal buffers
+        // and payloads are overwritten.
+        LOGW("%s: the command of the last iteration is still running", getName());
+        waitCmd();
+    }
+    // Return the refer buffers of the aborted iteration
+    cancelTerminalBuffers(mIterationSequence);
+    mIterationStartTime = CameraUtils::systemTime();
+
     int64_t sequence = 0;
     if (!inBufs.empty()) {
         sequence = inBufs.begin()->second->getSequence();
     }
+    mIterationSequence = sequence;
     LOG2("<seq%ld>%s:%s ++", sequence, getName(), __func__);
 
     int ret = prepareTerminalBuffers(ipuParameters, inBufs, outBufs, sequence);
+    if (ret != OK) cancelTerminalBuffers(sequence);
     CheckAndLogError((ret != OK), ret, "%s, prepareTerminalBuffers fail with %d", getName(), ret);
 
     // Create PPG & PPG start/stop commands at the beginning
@@ -907,15 +942,49 @@ int PGCommon::iterate(CameraBufferMap& inBufs, CameraBufferMap& outBufs, ia_bina
         CheckAndLogError((ret != OK), ret, "%s, call createCommands fail", __func__);
     }
 
+    return OK;
+}
+
+int PGCommon::submit() {
+    PERF_CAMERA_ATRACE();
+    CheckAndLogError(mCmdInFlight, INVALID_OPERATION, "%s, the last command is running",
+                     getName());
+
     if (!mPPGStarted) {
-        ret = startPPG();
+        int ret = startPPG();
         CheckAndLogError((ret != OK), ret, "%s, startPPG fail", getName());
         mPPGStarted = true;
     }
 
-    ret = executePG();
+    int ret = executePG();
     CheckAndLogError((ret != OK), ret, "%s, executePG fail", getName());
 
+    return OK;
+}
+
+int PGCommon::waitDone() {
+    PERF_CAMERA_ATRACE();
+    CheckAndLogError(!mCmdInFlight, INVALID_OPERATION, "%s, no command is submitted", getName());
+
+    int ret = waitCmd();
+    CheckAndLogError((ret != OK), ret, "%s, wait command fail", getName());
+
+    // The next fragment runs on the output of the previous one.
+    for (int fragIdx = 1; fragIdx < mFragmentCount; fragIdx++) {
+        ret = enqueueFragment(fragIdx);
+        CheckAndLogError((ret != OK), ret, "%s, enqueue fragment %d fail", getName(), fragIdx);
+        ret = waitCmd();
+        CheckAndLogError((ret != OK), ret, "%s, wait fragment %d fail", getName(), fragIdx);
+    }
+
+    return OK;
+}
+
+int PGCommon::finishIteration(ia_binary_data* statistics) {
+    PERF_CAMERA_ATRACE();
+    int64_t sequence = mIterationSequence;
+    int ret = OK;
+
     if (statistics) {
         bool useCcaBuf = false;
         if (mIntelCca && !statistics->data) {
@@ -930,6 +999,8 @@ int PGCommon::iterate(CameraBufferMap& inBufs, CameraBufferMap& outBufs, ia_bina
     }
 
     postTerminalBuffersDone(sequence);
+    LatencyStats::record(mCameraId, mStreamId, LATENCY_PG_ITERATE,
+                         CameraUtils::systemTime() - mIterationStartTime);
     LOG2("<seq%ld>%s:%s -- ", sequence, getName(), __func__);
     return ret;
 }
@@ -1004,14 +1075,8 @@ int PGCommon::allocateTnrDataBuffers() {
         memset(buffer, 0, PAGE_ALIGN(size));
         mTnrDataBuffers.push_back(buffer);
 
-        CIPR::Buffer* ciprBuf = nullptr;
-        /* use flush mode for still stream tnr buffers, since still stream will copy data buffer
-         * from video stream as its refer buffer.
-         */
-        if (mStreamId == STILL_STREAM_ID)
-            ciprBuf = registerUserBuffer(size, buffer, true);
-        else
-            ciprBuf = registerUserBuffer(size, buffer);
+        // No flush for the still stream either, it shares the video stream buffers without copy
+        CIPR::Buffer* ciprBuf = registerUserBuffer(size, buffer);
         CheckAndLogError(!ciprBuf, NO_MEMORY, "%s, register %d tnr buf %p fails", __func__, i,
                          buffer);
 
@@ -1107,9 +1172,20 @@ int PGCommon::prepareTerminalBuffers(const ia_binary_data* ipuParameters,
 
     if (!mTnrDataBuffers.empty()) {
         if (mShareReferIds[mTnrTerminalPair.inId]) {
-            mShareReferPool->acquireBuffer(mShareReferIds[mTnrTerminalPair.inId],
-                                           &mTerminalBuffers[mTnrTerminalPair.inId],
-                                           &mTerminalBuffers[mTnrTerminalPair.outId], sequence);
+            CIPR::Buffer*& referIn = mTerminalBuffers[mTnrTerminalPair.inId];
+            int ret = mShareReferPool->acquireBuffer(mShareReferIds[mTnrTerminalPair.inId],
+                                                     &referIn,
+                                                     &mTerminalBuffers[mTnrTerminalPair.outId],
+                                                     sequence, true);
+            CheckAndLogError(ret != OK, ret, "%s, acquire tnr refer buffers fails", __func__);
+            mAcquiredReferPairs.push_back(mTnrTerminalPair);
+
+            /* The shared refer buffer may be the producer's one which is registered in another
+             * context, so register its memory in this PG too (cached after the 1st time).
+             */
+            referIn = registerUserBuffer(getCiprBufferSize(referIn), getCiprBufferPtr(referIn));
+            CheckAndLogError(!referIn, NO_MEMORY, "%s, register tnr refer buffer fails",
+                             __func__);
         } else {
             std::swap(mTerminalBuffers[mTnrTerminalPair.inId],
                       mTerminalBuffers[mTnrTerminalPair.outId]);
@@ -1122,8 +1198,11 @@ int PGCommon::prepareTerminalBuffers(const ia_binary_data* ipuParameters,
 
     for (auto& pair : mTnrSimTerminalPairs) {
         if (mShareReferIds[pair.inId]) {
-            mShareReferPool->acquireBuffer(mShareReferIds[pair.inId], &mTerminalBuffers[pair.inId],
-                                           &mTerminalBuffers[pair.outId], sequence);
+            int ret = mShareReferPool->acquireBuffer(mShareReferIds[pair.inId],
+                                                     &mTerminalBuffers[pair.inId],
+                                                     &mTerminalBuffers[pair.outId], sequence);
+            CheckAndLogError(ret != OK, ret, "%s, acquire tnr sim refer buffers fails", __func__);
+            mAcquiredReferPairs.push_back(pair);
         } else {
             std::swap(mTerminalBuffers[pair.inId], mTerminalBuffers[pair.outId]);
         }
@@ -1137,19 +1216,31 @@ int PGCommon::prepareTerminalBuffers(const ia_binary_data* ipuParameters,
 }
 
 void PGCommon::postTerminalBuffersDone(int64_t sequence) {
-    if (!mTnrDataBuffers.empty() && mShareReferIds[mTnrTerminalPair.inId]) {
-        mShareReferPool->releaseBuffer(mShareReferIds[mTnrTerminalPair.inId],
-                                       mTerminalBuffers[mTnrTerminalPair.inId],
-                                       mTerminalBuffers[mTnrTerminalPair.outId], sequence);
+    for (auto& pair : mAcquiredReferPairs) {
+        mShareReferPool->releaseBuffer(mShareReferIds[pair.inId], mTerminalBuffers[pair.inId],
+                                       mTerminalBuffers[pair.outId], sequence);
     }
-    for (auto pair : mTnrSimTerminalPairs) {
-        if (mShareReferIds[pair.inId]) {
-            mShareReferPool->releaseBuffer(mShareReferIds[pair.inId], mTerminalBuffers[pair.inId],
-                                           mTerminalBuffers[pair.outId], sequence);
-        }
+    mAcquiredReferPairs.clear();
+}
+
+/**
+ * The iteration fails or is aborted before finishIteration(), return the acquired refer
+ * buffers, otherwise the pinned producer buffers are never reused.
+ */
+void PGCommon::cancelTerminalBuffers(int64_t sequence) {
+    if (mAcquiredReferPairs.empty()) return;
+
+    LOGW("<seq%ld>%s: cancel %zu refer pairs", sequence, getName(), mAcquiredReferPairs.size());
+    for (auto& pair : mAcquiredReferPairs) {
+        mShareReferPool->cancelBuffer(mShareReferIds[pair.inId], mTerminalBuffers[pair.outId],
+                                      sequence);
     }
+    mAcquiredReferPairs.clear();
 }
 
+/**
+ * Configure the command and enqueue the first fragment, the completion is waited by waitDone().
+ */
 int PGCommon::executePG() {
     PERF_CAMERA_ATRACE();
     TRACE_LOG_PROCESS(mName.c_str(), __func__);
@@ -1174,18 +1265,17 @@ int PGCommon::executePG() {
     }
     ia_css_process_group_set_token(mProcessGroup, mToken);
 
-    for (int fragIdx = 0; fragIdx < mFragmentCount; fragIdx++) {
-        int ret = ia_css_process_group_set_fragment_state(mProcessGroup, (uint16_t)fragIdx);
-        CheckAndLogError((ret != OK), ret, "%s, set fragment count %d fail %p", getName(), fragIdx,
-                         mProcessGroup);
-        ret = ia_css_process_group_set_fragment_limit(mProcessGroup, (uint16_t)(fragIdx + 1));
-        CheckAndLogError((ret != OK), ret, "%s, set fragment limit %d fail", getName(), fragIdx);
+    return enqueueFragment(0);
+}
 
-        ret = handleCmd(&mCmd, &mCmdCfg);
-        CheckAndLogError((ret != OK), ret, "%s, call handleCmd fail", getName());
-    }
+int PGCommon::enqueueFragment(int fragIdx) {
+    int ret = ia_css_process_group_set_fragment_state(mProcessGroup, (uint16_t)fragIdx);
+    CheckAndLogError((ret != OK), ret, "%s, set fragment count %d fail %p", getName(), fragIdx,
+                     mProcessGroup);
+    ret = ia_css_process_group_set_fragment_limit(mProcessGroup, (uint16_t)(fragIdx + 1));
+    CheckAndLogError((ret != OK), ret, "%s, set fragment limit %d fail", getName(), fragIdx);
 
-    return OK;
+    return enqueueCmd(&mCmd, &mCmdCfg);
 }
 
 int PGCommon::startPPG() {
@@ -1230,10 +1320,14 @@ int PGCommon::stopPPG() {
 }
 
 int PGCommon::handleCmd(CIPR::Command** cmd, CIPR::PSysCommandConfig* cmdCfg) {
-    CIPR::PSysEventConfig eventCfg = {};
-    mEvent->getConfig(&eventCfg);
+    int ret = enqueueCmd(cmd, cmdCfg);
+    if (ret != OK) return ret;
+
+    return waitCmd();
+}
+
+int PGCommon::enqueueCmd(CIPR::Command** cmd, CIPR::PSysCommandConfig* cmdCfg) {
     cmdCfg->issueID = reinterpret_cast<uint64_t>(cmd);
-    eventCfg.commandIssueID = cmdCfg->issueID;
 
     CIPR::Result ret = (*cmd)->setConfig(*cmdCfg);
     CheckAndLogError((ret != CIPR::Result::OK), UNKNOWN_ERROR,
@@ -1247,8 +1341,16 @@ int PGCommon::handleCmd(CIPR::Command** cmd, CIPR::PSysCommandConfig* cmdCfg) {
     CheckAndLogError((ret != CIPR::Result::OK), UNKNOWN_ERROR,
                      "%s, call Context::enqueueCommand() fail %d", __func__, ret);
 
+    mCmdInFlight = true;
+    return OK;
+}
+
+int PGCommon::waitCmd() {
+    CIPR::PSysEventConfig eventCfg = {};
+    mCmdInFlight = false;
+
     // Wait event
-    ret = mEvent->wait(mCtx);
+    CIPR::Result ret = mEvent->wait(mCtx);
     CheckAndLogError((ret != CIPR::Result::OK), UNKNOWN_ERROR,
                      "%s, call Context::waitForEvent fail, ret: %d", __func__, ret);
 
@@ -72,11 +72,15 @@ typedef std::map<ia_uid, std::shared_ptr<CameraBuffer>> CameraBufferMap;
  *          allocatePGBuffer();
  *          setPGAndPrepareProgram();
  *          configureFragmentDesc();
- * 5. loop frame: iterate():
- *          encodeTerminals();
- *          handleCmd();
- *          handleEvent();
- *          decode();
+ * 5. loop frame: iterate(), or the split steps to overlap the PGs of one pipe:
+ *          prepareIteration(): encodeTerminals();
+ *          submit(): enqueue the command;
+ *          waitDone(): handleEvent();
+ *          finishIteration(): decode();
+ *    The overlap is only across the PGs of one pipe. Each PG owns one process group buffer,
+ *    token and fragment state, so the command of its next frame can't be submitted before the
+ *    current one is done, and the pipes with a single PG get no overlap at all. The gain of a
+ *    per-PG submit ring is measured with the virtual PSys in test/VirtualIpuTest.
  * 6. deInit();
  */
 class PGCommon {
@@ -135,6 +139,18 @@ class PGCommon {
     virtual int iterate(CameraBufferMap& inBufs, CameraBufferMap& outBufs,
                         ia_binary_data* statistics, const ia_binary_data* ipuParameters);
 
+    /**
+     * The steps of iterate(). The CPU work of prepareIteration() and finishIteration() doesn't
+     * touch the hardware, so it can run while the other PGs are executed by the hardware.
+     * waitDone() should be called once after each successful submit(), if the iteration is
+     * aborted before it, the next prepareIteration() drains the command still running.
+     */
+    virtual int prepareIteration(CameraBufferMap& inBufs, CameraBufferMap& outBufs,
+                                 const ia_binary_data* ipuParameters);
+    virtual int submit();
+    virtual int waitDone();
+    virtual int finishIteration(ia_binary_data* statistics);
+
     const char* getName() { return mName.c_str(); }
 
  private:
@@ -168,11 +184,15 @@ class PGCommon {
                                        const CameraBufferMap& inBufs,
                                        const CameraBufferMap& outBufs, int64_t sequence);
     int executePG();
+    int enqueueFragment(int fragIdx);
     int startPPG();
     int stopPPG();
     int handleCmd(CIPR::Command** cmd, CIPR::PSysCommandConfig* cmdCfg);
+    int enqueueCmd(CIPR::Command** cmd, CIPR::PSysCommandConfig* cmdCfg);
+    int waitCmd();
 
     void postTerminalBuffersDone(int64_t sequence);
+    void cancelTerminalBuffers(int64_t sequence);
 
     // Memory helper
     CIPR::Buffer* createDMACiprBuffer(int size, int fd, bool flush = false);
@@ -240,6 +260,9 @@ class PGCommon {
 
     CIPR::PSysCommandConfig mCmdCfg;
     CIPR::Event* mEvent = nullptr;
+    bool mCmdInFlight;  // One command is enqueued and its event isn't handled yet
+    int64_t mIterationSequence;
+    nsecs_t mIterationStartTime;
 
     CIPR::Buffer** mTerminalBuffers;
 
@@ -254,6 +277,8 @@ class PGCommon {
 
     std::shared_ptr<ShareReferBufferPool> mShareReferPool;
     int64_t mShareReferIds[IPU_MAX_TERMINAL_COUNT];  // 0 is invalid id
+    // The shared refer pairs acquired by the iteration which isn't finished yet
+    std::vector<TerminalPair> mAcquiredReferPairs;
 
     std::vector<TerminalPair> mDvsTerminalPairs;
     std::vector<TerminalPair> mTnrSimTerminalPairs;
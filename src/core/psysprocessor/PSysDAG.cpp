@@ -21,8 +21,9 @@
 #include <algorithm>
 
 #include "iutils/CameraLog.h"
+#include "iutils/LatencyStats.h"
 #include "iutils/Utils.h"
-#if defined(TNR7_CM) || defined(TNR7_LEVEL0)
+#ifdef USE_PG_LITE_PIPE
 #include "GPUExecutor.h"
 #endif
 #include "CameraScheduler.h"
@@ -143,8 +144,10 @@ int PSysDAG::createPipeExecutors(bool useTnrOutBuffer) {
         if (!hasVideoPipe) hasVideoPipe = (streamId == VIDEO_STREAM_ID);
         if (!hasStillPipe)
             hasStillPipe = (streamId == STILL_STREAM_ID || streamId == STILL_TNR_STREAM_ID);
-#if defined(TNR7_CM) || defined(TNR7_LEVEL0)
-        PipeExecutor* executor;
+        PipeExecutor* executor = nullptr;
+#ifdef USE_PG_LITE_PIPE
+        // The TNR executors have no HW PG, GPUExecutor runs the TNR on the CPU when the GPU
+        // TNR isn't built in or fails to init.
         if (strstr(item.exeName.c_str(), "gputnr") != nullptr) {
             executor =
                 new GPUExecutor(mCameraId, item, cfg->exclusivePgs, this, gc, useTnrOutBuffer);
@@ -152,20 +155,24 @@ int PSysDAG::createPipeExecutors(bool useTnrOutBuffer) {
                 mVideoTnrExecutor = executor;
             else if (streamId == STILL_TNR_STREAM_ID)
                 mStillTnrExecutor = executor;
-        } else {
+            // It runs on its own thread, not as a scheduler node
+            executor->setPolicyManager(mPolicyManager);
+        }
+#endif
+        if (!executor) {
             executor = new PipeExecutor(mCameraId, item, cfg->exclusivePgs, this, gc);
             if (streamId == STILL_STREAM_ID) mStillExecutor = executor;
-        }
-        executor->setPolicyManager(mPolicyManager);
-#else
-        PipeExecutor* executor = new PipeExecutor(mCameraId, item, cfg->exclusivePgs, this, gc);
-        if (mScheduler) {
-            mScheduler->registerNode(executor);
-        } else {
-            // Use PolicyManager to sync iteration if no scheduler
+#if defined(TNR7_CM) || defined(TNR7_LEVEL0)
             executor->setPolicyManager(mPolicyManager);
-        }
+#else
+            if (mScheduler) {
+                mScheduler->registerNode(executor);
+            } else {
+                // Use PolicyManager to sync iteration if no scheduler
+                executor->setPolicyManager(mPolicyManager);
+            }
 #endif
+        }
         executor->setIspParamAdaptor(mIspParamAdaptor);
         executor->setStreamId(streamId);
         executor->setNotifyPolicy(item.notifyPolicy);
@@ -605,6 +612,11 @@ void PSysDAG::addTask(PSysTaskData taskParam) {
         }
     }
 
+    const std::shared_ptr<CameraBuffer>& mainInput =
+        taskParam.mInputBuffers.at(mDefaultMainInputPort);
+    LatencyStats::record(mCameraId, -1, LATENCY_SOF_TO_PSYS_TASK,
+                         CameraUtils::systemTime() - TIMEVAL2NSECS(mainInput->getTimestamp()));
+
     TaskInfo task = {};
     {
         // Save the task data into mOngoingTasks
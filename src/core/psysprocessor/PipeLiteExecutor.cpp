@@ -535,7 +535,7 @@ bool PipeLiteExecutor::fetchBuffersInQueue(map<Port, shared_ptr<CameraBuffer>>&
                                            map<Port, shared_ptr<CameraBuffer>>& cOutBuffer) {
     for (auto& input : mInputQueue) {
         Port port = input.first;
-        CameraBufQ& inputQueue = input.second;
+        CameraBufRing& inputQueue = input.second;
         if (inputQueue.empty()) {
             LOG2("%s: No buffer input port %d", __func__, port);
             cInBuffer.clear();
@@ -546,7 +546,7 @@ bool PipeLiteExecutor::fetchBuffersInQueue(map<Port, shared_ptr<CameraBuffer>>&
 
     for (auto& output : mOutputQueue) {
         Port port = output.first;
-        CameraBufQ& outputQueue = output.second;
+        CameraBufRing& outputQueue = output.second;
         if (outputQueue.empty()) {
             LOG2("%s: No buffer output port %d", __func__, port);
             cInBuffer.clear();
@@ -740,12 +740,13 @@ int PipeLiteExecutor::runPipe(map<Port, shared_ptr<CameraBuffer>>& inBuffers,
 
     outStatsBuffers.clear();
     eventType.clear();
-    int statTotalNum = 0;
+    // The 3A stats buffer and the index of the sis stats buffer in outStatsBuffers for each PG
+    vector<ia_binary_data*> pgStatsDatas(mPGExecutors.size(), nullptr);
+    vector<int> sisStatsIndexes(mPGExecutors.size(), -1);
     for (unsigned int pgIndex = 0; pgIndex < mPGExecutors.size(); pgIndex++) {
         ExecutorUnit& unit = mPGExecutors[pgIndex];
 
         // Prepare stats buffers for 3A/sis
-        vector<ia_binary_data*> pgStatsDatas;
         // For 3A stats
         unsigned int statsCount = unit.statKernelUids.size();
         for (unsigned int counter = 0; counter < statsCount; counter++) {
@@ -759,7 +760,8 @@ int PipeLiteExecutor::runPipe(map<Port, shared_ptr<CameraBuffer>>& inBuffers,
             CheckAndLogError(buffer == nullptr, BAD_VALUE, "buffer is null pointer.");
             buffer->size = 0;  // Clear it, then the stats memory is from p2p
             buffer->data = nullptr;
-            pgStatsDatas.push_back(buffer);
+            // Currently PG handles one stats buffer only
+            if (!pgStatsDatas[pgIndex]) pgStatsDatas[pgIndex] = buffer;
             mStatsBuffers.pop();
         }
         unsigned int sisCount = unit.sisKernelUids.size();
@@ -768,19 +770,47 @@ int PipeLiteExecutor::runPipe(map<Port, shared_ptr<CameraBuffer>>& inBuffers,
                 LOGW("No available stats buffer.");
                 break;
             }
+            // Currently handle one sis output only
+            if (sisStatsIndexes[pgIndex] < 0) sisStatsIndexes[pgIndex] = outStatsBuffers.size();
             outStatsBuffers.push_back(mStatsBuffers.front());
             eventType.push_back(EVENT_PSYS_STATS_SIS_BUF_READY);
-            ia_binary_data* buffer = (ia_binary_data*)mStatsBuffers.front()->getBufferAddr();
-            pgStatsDatas.push_back(buffer);
             mStatsBuffers.pop();
         }
 
-        // Run PGs
         // Update sequence only for the 1st input buffer currently
         unit.inputBuffers.begin()->second->setSequence(sequence);
-        // Currently PG handles one stats buffer only
-        ret = unit.pg->iterate(unit.inputBuffers, unit.outputBuffers,
-                               (statsCount > 0) ? pgStatsDatas[0] : nullptr, ipuParameters);
+    }
+
+    // Run PGs. Each PG runs on the output of the previous one, so the PGs are executed by the
+    // hardware one by one, but the encoding of the next PG and the decoding of the previous PG
+    // are done while the current PG is running. Nothing overlaps across the frames, see PGCommon.
+    ExecutorUnit& firstUnit = mPGExecutors.front();
+    ret = firstUnit.pg->prepareIteration(firstUnit.inputBuffers, firstUnit.outputBuffers,
+                                         ipuParameters);
+    CheckAndLogError((ret != OK), ret, "%s: pipe iteration error %d", mName.c_str(), ret);
+    ret = firstUnit.pg->submit();
+    CheckAndLogError((ret != OK), ret, "%s: pipe iteration error %d", mName.c_str(), ret);
+
+    for (unsigned int pgIndex = 0; pgIndex < mPGExecutors.size(); pgIndex++) {
+        ExecutorUnit& unit = mPGExecutors[pgIndex];
+        ExecutorUnit* nextUnit =
+            (pgIndex + 1 < mPGExecutors.size()) ? &mPGExecutors[pgIndex + 1] : nullptr;
+
+        if (nextUnit) {
+            ret = nextUnit->pg->prepareIteration(nextUnit->inputBuffers, nextUnit->outputBuffers,
+                                                 ipuParameters);
+            CheckAndLogError((ret != OK), ret, "%s: pipe iteration error %d", mName.c_str(), ret);
+        }
+
+        ret = unit.pg->waitDone();
+        CheckAndLogError((ret != OK), ret, "%s: pipe iteration error %d", mName.c_str(), ret);
+
+        if (nextUnit) {
+            ret = nextUnit->pg->submit();
+            CheckAndLogError((ret != OK), ret, "%s: pipe iteration error %d", mName.c_str(), ret);
+        }
+
+        ret = unit.pg->finishIteration(pgStatsDatas[pgIndex]);
         CheckAndLogError((ret != OK), ret, "%s: pipe iteration error %d", mName.c_str(), ret);
 
         if (CameraDump::isDumpTypeEnable(DUMP_PSYS_INTERM_BUFFER)) {
@@ -791,12 +821,9 @@ int PipeLiteExecutor::runPipe(map<Port, shared_ptr<CameraBuffer>>& inBuffers,
                 CameraDump::dumpImage(mCameraId, item.second, M_NA, INVALID_PORT, desc);
             }
         }
-        statTotalNum += statsCount;
-        if (sisCount > 0) {
-            // Currently handle one sis output only
-            handleSisStats(unit.outputBuffers, outStatsBuffers[statTotalNum]);
+        if (sisStatsIndexes[pgIndex] >= 0) {
+            handleSisStats(unit.outputBuffers, outStatsBuffers[sisStatsIndexes[pgIndex]]);
         }
-        statTotalNum += sisCount;
     }
 
     return OK;
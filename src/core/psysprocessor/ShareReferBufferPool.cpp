@@ -132,7 +132,8 @@ int32_t ShareReferBufferPool::registerReferBuffers(int64_t id, CIPR::Buffer* buf
  *     front->back:       S7,   S8,   S9,   S10   (push_back S10, new output)
  */
 int32_t ShareReferBufferPool::acquireBuffer(int64_t id, CIPR::Buffer** referIn,
-                                            CIPR::Buffer** referOut, int64_t outSequence) {
+                                            CIPR::Buffer** referOut, int64_t outSequence,
+                                            bool share) {
     CheckAndLogError(!referIn || !referOut, BAD_VALUE, "nullptr input for refer buf pair");
 
     int64_t inSequence = outSequence - 1;
@@ -145,10 +146,14 @@ int32_t ShareReferBufferPool::acquireBuffer(int64_t id, CIPR::Buffer** referIn,
         AutoMutex m(pair->bufferLock);
         std::vector<ReferBuffer>& bufV =
             (id == pair->producerId) ? pair->mProducerBuffers : pair->mConsumerBuffers;
-        CheckAndLogError(bufV.empty(), BAD_VALUE, "no refer buffer for id %lx", id);
-
-        *referOut = bufV.front().buffer;
-        bufV.erase(bufV.begin());  // pop front (the oldest one) as new output
+        CheckAndLogError(bufV.size() < 2, BAD_VALUE, "no refer buffer pair for id %lx", id);
+
+        // Pop the oldest one which isn't shared with consumer as new output
+        auto out = bufV.begin();
+        while (out != bufV.end() && out->pinCount > 0) out++;
+        CheckAndLogError(out == bufV.end(), NO_MEMORY, "all refer buffers of %lx are pinned", id);
+        *referOut = out->buffer;
+        bufV.erase(out);
         *referIn = bufV.back().buffer;
         if (bufV.back().sequence == inSequence || inSequence < 0) {
             // Return if found required buffers or it is the 1st frame.
@@ -165,8 +170,8 @@ int32_t ShareReferBufferPool::acquireBuffer(int64_t id, CIPR::Buffer** referIn,
                     return OK;
                 }
             }
-            LOG1("%lx has no refer in seq %ld", id, inSequence);
-            return UNKNOWN_ERROR;
+            LOG1("%lx has no refer in seq %ld, use the latest one", id, inSequence);
+            return OK;
         } else if (!pair->active) {
             return OK;
         }
@@ -180,14 +185,30 @@ int32_t ShareReferBufferPool::acquireBuffer(int64_t id, CIPR::Buffer** referIn,
     int waitFrames = 3;  // wait 3 frames
     while (waitFrames-- && ret == NOT_ENOUGH_DATA) {
         ConditionLock lock(pair->bufferLock);
-        ret = findReferBuffer(&pair->mProducerBuffers, inSequence, &srcBuf);
+        ReferBuffer* referBuf = nullptr;
+        ret = findReferBuffer(&pair->mProducerBuffers, inSequence, &referBuf);
 
         if (ret == NOT_ENOUGH_DATA) {
             pair->bufferSignal.waitRelative(lock, kWaitDuration * SLOWLY_MULTIPLIER);
+        } else if (ret == OK) {
+            // Pin it so the producer doesn't overwrite it during sharing or copying
+            referBuf->pinCount++;
+            srcBuf = referBuf->buffer;
         }
     }
 
-    if (ret == OK && srcBuf) {
+    if (ret == OK && share) {
+        AutoMutex m(pair->bufferLock);
+        auto pinned = pair->mPinnedBuffers.find(outSequence);
+        if (pinned != pair->mPinnedBuffers.end()) {
+            // The out sequence is acquired again without release
+            unpinBuffer(pair, pinned->second);
+        }
+        pair->mPinnedBuffers[outSequence] = srcBuf;
+        *referIn = srcBuf;
+        LOG1("%s acquire in seq %ld (share with %s), out seq %ld", pair->consumerPgName.c_str(),
+             inSequence, pair->producerPgName.c_str(), outSequence);
+    } else if (ret == OK) {
         void* srcPtr = nullptr;
         int32_t srcSize = 0;
         srcBuf->getMemoryCpuPtr(&srcPtr);
@@ -199,13 +220,21 @@ int32_t ShareReferBufferPool::acquireBuffer(int64_t id, CIPR::Buffer** referIn,
         if (srcPtr && dstPtr) {
             MEMCPY_S(dstPtr, dstSize, srcPtr, srcSize);
         }
-        LOG1("%s acquire in seq %ld (copy from %s), out seq %ld", pair->consumerPgName.c_str(),
-             inSequence, pair->producerPgName.c_str(), outSequence);
+        LOG1("%s acquire in seq %ld (copy %d bytes from %s), out seq %ld",
+             pair->consumerPgName.c_str(), inSequence, srcSize, pair->producerPgName.c_str(),
+             outSequence);
+
+        AutoMutex m(pair->bufferLock);
+        unpinBuffer(pair, srcBuf);
+    } else {
+        // Run on the latest refer buffer of the consumer itself
+        LOGW("%s can't get in seq %ld from %s, use its own one", pair->consumerPgName.c_str(),
+             inSequence, pair->producerPgName.c_str());
     }
 
     AutoMutex m(pair->bufferLock);
     pair->busy = false;
-    return ret;
+    return OK;
 }
 
 int32_t ShareReferBufferPool::releaseBuffer(int64_t id, CIPR::Buffer* referIn,
@@ -219,6 +248,8 @@ int32_t ShareReferBufferPool::releaseBuffer(int64_t id, CIPR::Buffer* referIn,
     AutoMutex m(pair->bufferLock);
     std::vector<ReferBuffer>& bufV =
         (id == pair->producerId) ? pair->mProducerBuffers : pair->mConsumerBuffers;
+    if (id == pair->consumerId) releasePin(pair, outSequence);
+
     if (outSequence < bufV.back().sequence) {
         // Drop old data (in reprocessing case)
         ReferBuffer referBuf = {-1, referOut};
@@ -232,6 +263,27 @@ int32_t ShareReferBufferPool::releaseBuffer(int64_t id, CIPR::Buffer* referIn,
     return OK;
 }
 
+int32_t ShareReferBufferPool::cancelBuffer(int64_t id, CIPR::Buffer* referOut,
+                                           int64_t outSequence) {
+    CheckAndLogError(!referOut, BAD_VALUE, "nullptr refer out buf for cancel");
+
+    AutoMutex l(mPairLock);
+    UserPair* pair = findUserPair(id);
+    CheckAndLogError(!pair, UNKNOWN_ERROR, "Can't find id %lx", id);
+
+    AutoMutex m(pair->bufferLock);
+    std::vector<ReferBuffer>& bufV =
+        (id == pair->producerId) ? pair->mProducerBuffers : pair->mConsumerBuffers;
+    if (id == pair->consumerId) releasePin(pair, outSequence);
+
+    // The output isn't written completely, so reuse it as output first
+    ReferBuffer referBuf = {-1, referOut};
+    bufV.insert(bufV.begin(), referBuf);
+    LOG1("%lx cancel out seq %ld", id, outSequence);
+
+    return OK;
+}
+
 ShareReferBufferPool::UserPair* ShareReferBufferPool::findUserPair(int64_t id) {
     for (auto pair : mUserPairs) {
         if (pair->consumerId == id || pair->producerId == id) {
@@ -242,7 +294,7 @@ ShareReferBufferPool::UserPair* ShareReferBufferPool::findUserPair(int64_t id) {
 }
 
 int ShareReferBufferPool::findReferBuffer(std::vector<ReferBuffer>* bufV, int64_t sequence,
-                                          CIPR::Buffer** out) {
+                                          ReferBuffer** out) {
     CheckAndLogError(!bufV, BAD_VALUE, "nullptr buffers");
     CheckAndLogError(!out, BAD_VALUE, "nullptr out buffer");
 
@@ -250,7 +302,7 @@ int ShareReferBufferPool::findReferBuffer(std::vector<ReferBuffer>* bufV, int64_
 
     for (auto item = bufV->rbegin(); item != bufV->rend(); item++) {
         if (item->sequence <= sequence) {
-            *out = item->buffer;
+            *out = &(*item);
             LOG2("%s: find seq %ld for required seq %ld", __func__, item->sequence, sequence);
             return OK;
         }
@@ -260,4 +312,24 @@ int ShareReferBufferPool::findReferBuffer(std::vector<ReferBuffer>* bufV, int64_
     return UNKNOWN_ERROR;
 }
 
+// Need to hold bufferLock of the pair
+void ShareReferBufferPool::releasePin(UserPair* pair, int64_t outSequence) {
+    auto pinned = pair->mPinnedBuffers.find(outSequence);
+    if (pinned == pair->mPinnedBuffers.end()) return;
+
+    unpinBuffer(pair, pinned->second);
+    pair->mPinnedBuffers.erase(pinned);
+}
+
+// Need to hold bufferLock of the pair
+void ShareReferBufferPool::unpinBuffer(UserPair* pair, CIPR::Buffer* buffer) {
+    for (auto& item : pair->mProducerBuffers) {
+        if (item.buffer == buffer && item.pinCount > 0) {
+            item.pinCount--;
+            return;
+        }
+    }
+    LOGW("%s: buffer %p isn't pinned in %s", __func__, buffer, pair->producerPgName.c_str());
+}
+
 }  // namespace icamera
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -29,7 +30,11 @@ namespace icamera {
  * \class ShareReferBufferPool
  *
  * \brief This is a version reference buffer/payload memory sharing between PGs, which is used to
- *        copy tnr reference frame/parameter from video pipe to still pipe.
+ *        share tnr reference frame/parameter from video pipe to still pipe.
+ *
+ * The consumer either copies the producer's buffer to its own, or shares it without copy. The
+ * shared buffer is pinned in the producer queue, so the producer doesn't reuse it as output
+ * until the consumer releases the frame.
  */
 class ShareReferBufferPool {
  public:
@@ -53,20 +58,31 @@ class ShareReferBufferPool {
     /**
      * Cosumer can identify out sequence in acquireBuffer()
      * to copy from producer queue in case it can't find refer-in buffer in its own queue.
+     * If share is true, the producer's buffer is returned as referIn instead of copying, and
+     * it's pinned until releaseBuffer() or cancelBuffer() of the same out sequence.
+     * If the required refer-in buffer isn't found, the latest one of the queue is returned.
+     * Nothing is acquired if it fails, and referIn/referOut aren't touched.
      */
     int32_t acquireBuffer(int64_t id, CIPR::Buffer** referIn, CIPR::Buffer** referOut,
-                          int64_t outSequence = -1);
+                          int64_t outSequence = -1, bool share = false);
     int32_t releaseBuffer(int64_t owner, CIPR::Buffer* referIn, CIPR::Buffer* referOut,
                           int64_t outSequence);
+    /**
+     * Return the buffers of an aborted frame: the pin is released and referOut is queued
+     * without valid data.
+     */
+    int32_t cancelBuffer(int64_t id, CIPR::Buffer* referOut, int64_t outSequence);
 
  private:
     struct ReferBuffer {
         int64_t sequence;
         CIPR::Buffer* buffer;
+        int32_t pinCount;  // The consumer frames which share it
 
         ReferBuffer(int64_t seq = -1, CIPR::Buffer* buf = nullptr) {
             sequence = seq;
             buffer = buf;
+            pinCount = 0;
         }
     };
 
@@ -84,11 +100,15 @@ class ShareReferBufferPool {
         // Sort sequence in ascending order
         std::vector<ReferBuffer> mProducerBuffers;
         std::vector<ReferBuffer> mConsumerBuffers;
+        // Consumer out sequence -> the producer buffer pinned for it
+        std::map<int64_t, CIPR::Buffer*> mPinnedBuffers;
     };
 
  private:
     UserPair* findUserPair(int64_t id);
-    int findReferBuffer(std::vector<ReferBuffer>* bufV, int64_t sequence, CIPR::Buffer** out);
+    int findReferBuffer(std::vector<ReferBuffer>* bufV, int64_t sequence, ReferBuffer** out);
+    void releasePin(UserPair* pair, int64_t outSequence);
+    void unpinBuffer(UserPair* pair, CIPR::Buffer* buffer);
 
  private:
     static const nsecs_t kWaitDuration = 33000000;  // 33ms
@@ -191,6 +191,7 @@ void EvcpManager::runEvcpL(const camera_buffer_t& buffer) {
     void* pBuf = (buffer.s.memType == V4L2_MEMORY_DMABUF) ?
                      CameraBuffer::mapDmaBufferAddr(buffer.dmafd, size) :
                      buffer.addr;
+    CheckAndLogError(!pBuf, VOID_VALUE, "@%s, failed to map the buffer", __func__);
 
     bool ret = mEvcp->runEvcpFrame(pBuf, size);
 
@@ -27,6 +27,7 @@
 #include "SyncManager.h"
 // FRAME_SYNC_E
 #include "iutils/CameraLog.h"
+#include "iutils/DmaBufMapCache.h"
 
 namespace icamera {
 
@@ -173,6 +174,8 @@ void CameraHal::deviceClose(int cameraId) {
 
         mCameraShm.CameraDeviceClose(cameraId);
     }
+    // Drop the dma buffer mappings of the closed device
+    DmaBufMapCache::clear();
 }
 
 void CameraHal::deviceCallbackRegister(int cameraId, const camera_callback_ops_t* callback) {
@@ -22,6 +22,7 @@
 #include "PlatformData.h"
 #include "iutils/CameraDump.h"
 #include "iutils/CameraLog.h"
+#include "iutils/LatencyStats.h"
 
 /**
  * This is the wrapper to the CameraHal Class to provide the HAL interface
@@ -326,6 +327,14 @@ int get_frame_size(int camera_id, int format, int width, int height, int field,
     return frameSize;
 }
 
+int camera_get_latency_histograms(int camera_id, camera_latency_histogram_t* histograms,
+                                  int count, bool reset) {
+    HAL_TRACE_CALL(2);
+    CheckCameraId(camera_id, BAD_VALUE);
+
+    return LatencyStats::query(camera_id, histograms, count, reset);
+}
+
 #ifdef LINUX_BUILD
 // Create the HAL instance from here
 __attribute__((constructor)) void initCameraHAL() {
@@ -345,6 +354,8 @@ __attribute__((destructor)) void deinitCameraHAL() {
         delete gCameraHal;
         gCameraHal = nullptr;
     }
+    // Write the dumps still queued by the async dump writer
+    CameraDump::flushDumps();
 }
 #endif
 
@@ -101,6 +101,7 @@ static void load_camera_hal_library() {
     GET_FUNC_CALL(cameraSetParameters, camera_set_parameters);
     GET_FUNC_CALL(cameraGetParameters, camera_get_parameters);
     GET_FUNC_CALL(getHalFrameSize, get_frame_size);
+    GET_FUNC_CALL(cameraGetLatencyHistograms, camera_get_latency_histograms);
 }
 
 static void close_camera_hal_library() {
@@ -202,6 +203,12 @@ int get_frame_size(int camera_id, int format, int width, int height, int field,
     return gCameraHalAdaptor.getHalFrameSize(camera_id, format, width, height, field, bpp);
 }
 
+int camera_get_latency_histograms(int camera_id, camera_latency_histogram_t* histograms,
+                                  int count, bool reset) {
+    CheckFuncCall(gCameraHalAdaptor.cameraGetLatencyHistograms);
+    return gCameraHalAdaptor.cameraGetLatencyHistograms(camera_id, histograms, count, reset);
+}
+
 __attribute__((constructor)) void initHalAdaptor() {
     Log::setDebugLevel();
     load_camera_hal_library();
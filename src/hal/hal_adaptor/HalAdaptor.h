@@ -46,6 +46,8 @@ struct HalApiHandle {
     _DEF_HAL_FUNC(int, cameraGetParameters, int camera_id, Parameters& param, int64_t sequence);
     _DEF_HAL_FUNC(int, getHalFrameSize, int camera_id, int format, int width, int height,
                   int field, int* bpp);
+    _DEF_HAL_FUNC(int, cameraGetLatencyHistograms, int camera_id,
+                  camera_latency_histogram_t* histograms, int count, bool reset);
 };
 }  // namespace icamera
 }  // extern "C"
@@ -68,6 +68,17 @@ int ICBMThread::processFrame(const camera_buffer_t& inBuffer, const camera_buffe
                         CameraBuffer::mapDmaBufferAddr(outBuffer.dmafd, outBuffer.s.size) :
                         outBuffer.addr;
 
+    if (!pInBuf || !pOutBuf) {
+        LOGE("%s, failed to map the buffers, in %p, out %p", __func__, pInBuf, pOutBuf);
+        if (pInBuf && inBuffer.s.memType == V4L2_MEMORY_DMABUF) {
+            CameraBuffer::unmapDmaBufferAddr(pInBuf, inBuffer.s.size);
+        }
+        if (pOutBuf && outBuffer.s.memType == V4L2_MEMORY_DMABUF) {
+            CameraBuffer::unmapDmaBufferAddr(pOutBuf, outBuffer.s.size);
+        }
+        return NO_MEMORY;
+    }
+
     request.inII.bufAddr = pInBuf;
     request.outII.bufAddr = pOutBuf;
     auto ret = mIntelICBM->processFrame(request);
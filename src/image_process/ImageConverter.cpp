@@ -23,6 +23,7 @@
 #include "iutils/Utils.h"
 #include "iutils/Errors.h"
 #include "ImageConverter.h"
+#include "ImageKernels.h"
 
 namespace icamera {
 namespace ImageConverter {
@@ -245,83 +246,11 @@ void trimConvertNV12ToNV21(int width, int height, int srcStride, void* src, void
     }
 
     // Convert UV to VU
+    const ImageKernels& kernels = getImageKernels();
     pSrc = (unsigned char*)src + srcStride * height;
     pDst = (unsigned char*)dst + width * height;
     for (int j = 0; j < height / 2; j++) {
-        if (width >= 16) {
-            const uint32_t* ptr0 = (const uint32_t*)(pSrc);
-            uint32_t* ptr1 = (uint32_t*)(pDst);
-            int bNotLastLine = ((j + 1) == (height / 2)) ? 0 : 1;
-            int width_16 = (width + 15 * bNotLastLine) & ~0xf;
-            if ((((uint64_t)(pSrc)) & 0xf) == 0 &&
-                (((uint64_t)(pDst)) & 0xf) == 0) {  // 16 bytes aligned for both src and dest
-                __asm__ volatile("movl       %0,  %%eax      \n\t"
-                                 "movl       %1,  %%edx      \n\t"
-                                 "movl       %2,  %%ecx      \n\t"
-                                 "1:     \n\t"
-                                 "movdqa (%%eax), %%xmm1     \n\t"
-                                 "movdqa  %%xmm1, %%xmm0     \n\t"
-                                 "psllw       $8, %%xmm1     \n\t"
-                                 "psrlw       $8, %%xmm0     \n\t"
-                                 "por     %%xmm0, %%xmm1     \n\t"
-                                 "movdqa  %%xmm1, (%%edx)    \n\t"
-                                 "add        $16, %%eax      \n\t"
-                                 "add        $16, %%edx      \n\t"
-                                 "sub        $16, %%ecx      \n\t"
-                                 "jnz   1b \n\t"
-                                 : "+m"(ptr0), "+m"(ptr1), "+m"(width_16)
-                                 :
-                                 : "eax", "ecx", "edx", "xmm0", "xmm1");
-            } else {  // either src or dest is not 16-bytes aligned
-                __asm__ volatile("movl       %0,  %%eax      \n\t"
-                                 "movl       %1,  %%edx      \n\t"
-                                 "movl       %2,  %%ecx      \n\t"
-                                 "1:     \n\t"
-                                 "lddqu  (%%eax), %%xmm1     \n\t"
-                                 "movdqa  %%xmm1, %%xmm0     \n\t"
-                                 "psllw       $8, %%xmm1     \n\t"
-                                 "psrlw       $8, %%xmm0     \n\t"
-                                 "por     %%xmm0, %%xmm1     \n\t"
-                                 "movdqu  %%xmm1, (%%edx)    \n\t"
-                                 "add        $16, %%eax      \n\t"
-                                 "add        $16, %%edx      \n\t"
-                                 "sub        $16, %%ecx      \n\t"
-                                 "jnz   1b \n\t"
-                                 : "+m"(ptr0), "+m"(ptr1), "+m"(width_16)
-                                 :
-                                 : "eax", "ecx", "edx", "xmm0", "xmm1");
-            }
-
-            // process remaining data of less than 16 bytes of last row
-            for (int i = width_16; i < width; i += 2) {
-                pDst[i] = pSrc[i + 1];
-                pDst[i + 1] = pSrc[i];
-            }
-        } else if ((((uint64_t)(pSrc)) & 0x3) == 0 &&
-                   (((uint64_t)(pDst)) & 0x3) == 0) {  // 4 bytes aligned for both src and dest
-            const uint32_t* ptr0 = (const uint32_t*)(pSrc);
-            uint32_t* ptr1 = (uint32_t*)(pDst);
-            int width_4 = width & ~3;
-            for (int i = 0; i < width_4; i += 4) {
-                uint32_t data0 = *ptr0++;
-                uint32_t data1 = (data0 >> 8) & 0x00ff00ff;
-                uint32_t data2 = (data0 << 8) & 0xff00ff00;
-                *ptr1++ = data1 | data2;
-            }
-            // process remaining data of less than 4 bytes at end of each row
-            for (int i = width_4; i < width; i += 2) {
-                pDst[i] = pSrc[i + 1];
-                pDst[i + 1] = pSrc[i];
-            }
-        } else {
-            unsigned const char* ptr0 = pSrc;
-            unsigned char* ptr1 = pDst;
-            for (int i = 0; i < width; i += 2) {
-                *ptr1++ = ptr0[1];
-                *ptr1++ = ptr0[0];
-                ptr0 += 2;
-            }
-        }
+        kernels.swapPairs(pSrc, pDst, width);
         pDst += width;
         pSrc += srcStride;
     }
@@ -356,13 +285,12 @@ void convertNV12ToYV12(int width, int height, int srcStride, void* src, void* ds
     }
 
     // deinterlace the UV data
+    const ImageKernels& kernels = getImageKernels();
     int halfHeight = height / 2;
     int halfWidth = width / 2;
     for (int i = 0; i < halfHeight; ++i) {
-        for (int j = 0; j < halfWidth; ++j) {
-            dstPtrV[j] = srcPtr[j * 2 + 1];
-            dstPtrU[j] = srcPtr[j * 2];
-        }
+        kernels.extractEvery2(srcPtr, dstPtrV, halfWidth, 1);
+        kernels.extractEvery2(srcPtr, dstPtrU, halfWidth, 0);
         srcPtr += srcStride;
         dstPtrV += cStride;
         dstPtrU += cStride;
@@ -398,11 +326,10 @@ void align16ConvertNV12ToYV12(int width, int height, int srcStride, void* src, v
     }
 
     // deinterlace the UV data
+    const ImageKernels& kernels = getImageKernels();
     for (int i = 0; i < height / 2; ++i) {
-        for (int j = 0; j < width / 2; ++j) {
-            dstPtrV[j] = srcPtr[j * 2 + 1];
-            dstPtrU[j] = srcPtr[j * 2];
-        }
+        kernels.extractEvery2(srcPtr, dstPtrV, width / 2, 1);
+        kernels.extractEvery2(srcPtr, dstPtrU, width / 2, 0);
         srcPtr += srcStride;
         dstPtrV += cStride;
         dstPtrU += cStride;
@@ -420,24 +347,19 @@ void YUY2ToP411(int width, int height, int stride, void* src, void* dst) {
     unsigned char* dstPtrU = (unsigned char*)dst + ySize;
     unsigned char* dstPtrV = (unsigned char*)dst + ySize + cSize;
 
+    const ImageKernels& kernels = getImageKernels();
     for (int i = 0; i < height; i++) {
         // The first line of the source
         // Copy first Y Plane first
-        for (int j = 0; j < width; j++) {
-            dstPtr[j] = srcPtr[j * 2];
-        }
+        kernels.extractEvery2(srcPtr, dstPtr, width, 0);
 
         if (i & 1) {
             // Copy the V plane
-            for (int k = 0; k < wHalf; k++) {
-                dstPtrV[k] = srcPtr[k * 4 + 3];
-            }
+            kernels.extractEvery4(srcPtr, dstPtrV, wHalf, 3);
             dstPtrV = dstPtrV + wHalf;
         } else {
             // Copy the U plane
-            for (int k = 0; k < wHalf; k++) {
-                dstPtrU[k] = srcPtr[k * 4 + 1];
-            }
+            kernels.extractEvery4(srcPtr, dstPtrU, wHalf, 1);
             dstPtrU = dstPtrU + wHalf;
         }
 
@@ -448,7 +370,8 @@ void YUY2ToP411(int width, int height, int stride, void* src, void* dst) {
 
 // P411's Y, U, V are separated. But the NV12's U and V are interleaved.
 void NV12ToP411Separate(int width, int height, int stride, void* srcY, void* srcUV, void* dst) {
-    int i, j, p, q;
+    int i, p, q;
+    const ImageKernels& kernels = getImageKernels();
     unsigned char* psrcY = (unsigned char*)srcY;
     unsigned char* pdstY = (unsigned char*)dst;
     unsigned char *pdstU, *pdstV;
@@ -467,15 +390,11 @@ void NV12ToP411Separate(int width, int height, int stride, void* srcY, void* src
     pdstV = pdstU + width * height / 4;
     p = q = 0;
     for (i = 0; i < height / 2; i++) {
-        for (j = 0; j < width; j++) {
-            if (j % 2 == 0) {
-                pdstU[p] = (psrcUV[i * stride + j] & 0xFF);
-                p++;
-            } else {
-                pdstV[q] = (psrcUV[i * stride + j] & 0xFF);
-                q++;
-            }
-        }
+        // even bytes: (width + 1) / 2, odd bytes: width / 2
+        kernels.extractEvery2(psrcUV + i * stride, pdstU + p, (width + 1) / 2, 0);
+        kernels.extractEvery2(psrcUV + i * stride, pdstV + q, width / 2, 1);
+        p += (width + 1) / 2;
+        q += width / 2;
     }
 }
 
@@ -487,7 +406,8 @@ void NV12ToP411(int width, int height, int stride, void* src, void* dst) {
 
 // P411's Y, U, V are separated. But the NV21's U and V are interleaved.
 void NV21ToP411Separate(int width, int height, int stride, void* srcY, void* srcUV, void* dst) {
-    int i, j, p, q;
+    int i, p, q;
+    const ImageKernels& kernels = getImageKernels();
     unsigned char* psrcY = (unsigned char*)srcY;
     unsigned char* pdstY = (unsigned char*)dst;
     unsigned char *pdstU, *pdstV;
@@ -506,15 +426,11 @@ void NV21ToP411Separate(int width, int height, int stride, void* srcY, void* src
     pdstV = pdstU + width * height / 4;
     p = q = 0;
     for (i = 0; i < height / 2; i++) {
-        for (j = 0; j < width; j++) {
-            if ((j & 1) == 0) {
-                pdstV[p] = (psrcUV[i * stride + j] & 0xFF);
-                p++;
-            } else {
-                pdstU[q] = (psrcUV[i * stride + j] & 0xFF);
-                q++;
-            }
-        }
+        // even bytes: (width + 1) / 2, odd bytes: width / 2
+        kernels.extractEvery2(psrcUV + i * stride, pdstV + p, (width + 1) / 2, 0);
+        kernels.extractEvery2(psrcUV + i * stride, pdstU + q, width / 2, 1);
+        p += (width + 1) / 2;
+        q += width / 2;
     }
 }
 
@@ -528,7 +444,8 @@ void NV21ToP411(int width, int height, int stride, void* src, void* dst) {
 // about IMC3 detail, please refer to http://www.fourcc.org/yuv.php
 // But the NV12's U and V are interleaved.
 void NV12ToIMC3(int width, int height, int stride, void* srcY, void* srcUV, void* dst) {
-    int i, j, p, q;
+    int i, p, q;
+    const ImageKernels& kernels = getImageKernels();
     unsigned char *pdstU, *pdstV;
     unsigned char* psrcUV;
 
@@ -540,17 +457,10 @@ void NV12ToIMC3(int width, int height, int stride, void* srcY, void* srcUV, void
     pdstV = pdstU + stride * height / 2;
     p = q = 0;
     for (i = 0; i < height / 2; i++) {
-        for (j = 0; j < width; j++) {
-            if (j % 2 == 0) {
-                pdstU[p] = (psrcUV[i * stride + j] & 0xFF);
-                p++;
-            } else {
-                pdstV[q] = (psrcUV[i * stride + j] & 0xFF);
-                q++;
-            }
-        }
-        p += stride - width / 2;
-        q += stride - width / 2;
+        kernels.extractEvery2(psrcUV + i * stride, pdstU + p, (width + 1) / 2, 0);
+        kernels.extractEvery2(psrcUV + i * stride, pdstV + q, width / 2, 1);
+        p += (width + 1) / 2 + stride - width / 2;
+        q += width / 2 + stride - width / 2;
     }
 }
 
@@ -558,7 +468,8 @@ void NV12ToIMC3(int width, int height, int stride, void* srcY, void* srcUV, void
 // IMC's V is before U
 // But the NV12's U and V are interleaved.
 void NV12ToIMC1(int width, int height, int stride, void* srcY, void* srcUV, void* dst) {
-    int i, j, p, q;
+    int i, p, q;
+    const ImageKernels& kernels = getImageKernels();
     unsigned char *pdstU, *pdstV;
     unsigned char* psrcUV;
 
@@ -570,17 +481,10 @@ void NV12ToIMC1(int width, int height, int stride, void* srcY, void* srcUV, void
     pdstU = pdstV + stride * height / 2;
     p = q = 0;
     for (i = 0; i < height / 2; i++) {
-        for (j = 0; j < width; j++) {
-            if (j % 2 == 0) {
-                pdstU[p] = (psrcUV[i * stride + j] & 0xFF);
-                p++;
-            } else {
-                pdstV[q] = (psrcUV[i * stride + j] & 0xFF);
-                q++;
-            }
-        }
-        p += stride - width / 2;
-        q += stride - width / 2;
+        kernels.extractEvery2(psrcUV + i * stride, pdstU + p, (width + 1) / 2, 0);
+        kernels.extractEvery2(psrcUV + i * stride, pdstV + q, width / 2, 1);
+        p += (width + 1) / 2 + stride - width / 2;
+        q += width / 2 + stride - width / 2;
     }
 }
 
@@ -650,24 +554,19 @@ void convertYUYVToYV12(int width, int height, int srcStride, int dstStride, void
     unsigned char* dstPtrV = (unsigned char*)dst + ySize;
     unsigned char* dstPtrU = (unsigned char*)dst + ySize + cSize;
 
+    const ImageKernels& kernels = getImageKernels();
     for (int i = 0; i < height; i++) {
         // The first line of the source
         // Copy first Y Plane first
-        for (int j = 0; j < width; j++) {
-            dstPtr[j] = srcPtr[j * 2];
-        }
+        kernels.extractEvery2(srcPtr, dstPtr, width, 0);
 
         if (i & 1) {
             // Copy the V plane
-            for (int k = 0; k < wHalf; k++) {
-                dstPtrV[k] = srcPtr[k * 4 + 3];
-            }
+            kernels.extractEvery4(srcPtr, dstPtrV, wHalf, 3);
             dstPtrV = dstPtrV + ALIGN_16(dstStride >> 1);
         } else {
             // Copy the U plane
-            for (int k = 0; k < wHalf; k++) {
-                dstPtrU[k] = srcPtr[k * 4 + 1];
-            }
+            kernels.extractEvery4(srcPtr, dstPtrU, wHalf, 1);
             dstPtrU = dstPtrU + ALIGN_16(dstStride >> 1);
         }
 
@@ -679,27 +578,20 @@ void convertYUYVToYV12(int width, int height, int srcStride, int dstStride, void
 // covert YUYV(YUY2, YUV422 format) to NV21 (Y plane, interlaced VU bytes)
 void convertYUYVToNV21(int width, int height, int srcStride, void* src, void* dst) {
     int ySize = width * height;
-    int u_counter = 1, v_counter = 0;
 
     unsigned char* srcPtr = (unsigned char*)src;
     unsigned char* dstPtr = (unsigned char*)dst;
     unsigned char* dstPtrUV = (unsigned char*)dst + ySize;
 
+    const ImageKernels& kernels = getImageKernels();
     for (int i = 0; i < height; i++) {
         // The first line of the source
         // Copy first Y Plane first
-        for (int j = 0; j < width * 2; j++) {
-            if (j % 2 == 0) dstPtr[j / 2] = srcPtr[j];
-            if (i % 2) {
-                if ((j % 4) == 3) {
-                    dstPtrUV[v_counter] = srcPtr[j];  // V plane
-                    v_counter += 2;
-                }
-                if ((j % 4) == 1) {
-                    dstPtrUV[u_counter] = srcPtr[j];  // U plane
-                    u_counter += 2;
-                }
-            }
+        kernels.extractEvery2(srcPtr, dstPtr, width, 0);
+        if (i % 2) {
+            // VU of the odd lines
+            kernels.yuyvToVU(srcPtr, dstPtrUV, width / 2);
+            dstPtrUV += width;
         }
 
         srcPtr = srcPtr + srcStride * 2;
@@ -0,0 +1,620 @@
+/*
+ * Copyright (C) 2023 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG ImageKernels
+
+#include "ImageKernels.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAS_X86_SIMD
+#endif
+
+#include "iutils/CameraLog.h"
+
+namespace icamera {
+
+/*
+ * Scalar reference kernels, the SIMD kernels use them for the tails.
+ */
+static void extractEvery2C(const uint8_t* src, uint8_t* dst, int n, int phase) {
+    for (int i = 0; i < n; i++) dst[i] = src[2 * i + phase];
+}
+
+static void extractEvery4C(const uint8_t* src, uint8_t* dst, int n, int phase) {
+    for (int i = 0; i < n; i++) dst[i] = src[4 * i + phase];
+}
+
+static void swapPairsC(const uint8_t* src, uint8_t* dst, int bytes) {
+    for (int i = 0; i + 1 < bytes; i += 2) {
+        uint8_t first = src[i];
+        dst[i] = src[i + 1];
+        dst[i + 1] = first;
+    }
+}
+
+static void yuyvToVUC(const uint8_t* src, uint8_t* dst, int pairs) {
+    for (int i = 0; i < pairs; i++) {
+        dst[2 * i] = src[4 * i + 3];
+        dst[2 * i + 1] = src[4 * i + 1];
+    }
+}
+
+static void bilinearRange(const uint8_t* row0, const uint8_t* row1, const int32_t* xOffset,
+                          const int32_t* xFrac, int neighbor, int fy, int shift, uint8_t* dst,
+                          int dstStep, int start, int end) {
+    const uint32_t one = 1u << shift;
+    for (int i = start; i < end; i++) {
+        const uint32_t fx = xFrac[i];
+        const uint32_t h0 = (row0[xOffset[i]] * (one - fx) + row0[xOffset[i] + neighbor] * fx) >>
+                            shift;
+        const uint32_t h1 = (row1[xOffset[i]] * (one - fx) + row1[xOffset[i] + neighbor] * fx) >>
+                            shift;
+        dst[i * dstStep] = (h0 * (one - fy) + h1 * fy) >> shift;
+    }
+}
+
+// The scalar version interpolates all the outputs, simdCount is only for the SIMD ones
+static void bilinearRowC(const uint8_t* row0, const uint8_t* row1, const int32_t* xOffset,
+                         const int32_t* xFrac, int neighbor, int fy, int shift, uint8_t* dst,
+                         int dstStep, int n, int /*simdCount*/) {
+    bilinearRange(row0, row1, xOffset, xFrac, neighbor, fy, shift, dst, dstStep, 0, n);
+}
+
+static void temporalBlendRowC(const uint8_t* cur, const uint8_t* ref, uint8_t* dst,
+                              uint8_t* dst2, int n, int strength, int floor, int slope) {
+    for (int i = 0; i < n; i++) {
+        const int c = cur[i];
+        const int diff = std::max(abs(ref[i] - c) - floor, 0);
+        const int w = std::max(strength - diff * slope, 0);
+        const uint8_t out = c + (((ref[i] - c) * w + 64) >> 7);
+        dst[i] = out;
+        if (dst2) dst2[i] = out;
+    }
+}
+
+/*
+ * The color conversions of SwImageConverter, the 10-bit RGB is from/to one bayer block.
+ */
+static const int kRgbToYuvCoeff[3][3] = {{257, 504, 98}, {-148, -291, 439}, {439, -368, -71}};
+static const int kRgbToYuvOffset[3] = {16, 128, 128};
+
+static void rgbToYuvRowC(const uint16_t* r, const uint16_t* gr, const uint16_t* gb,
+                         const uint16_t* b, uint8_t* y, uint8_t* u, uint8_t* v, int n) {
+    uint8_t* dst[3] = {y, u, v};
+    for (int i = 0; i < n; i++) {
+        const int g = (gr[i] + gb[i]) / 2;
+        for (int c = 0; c < 3; c++) {
+            int out = (kRgbToYuvCoeff[c][0] * r[i] + kRgbToYuvCoeff[c][1] * g +
+                       kRgbToYuvCoeff[c][2] * b[i]) / 4000 + kRgbToYuvOffset[c];
+            dst[c][i] = std::min(std::max(out, 0), 255);
+        }
+    }
+}
+
+static void yuvToRgbRowC(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint16_t* r,
+                         uint16_t* g, uint16_t* b, int n) {
+    for (int i = 0; i < n; i++) {
+        const int ypp = 9535 * (y[i] - 16);
+        const int up = u[i] - 128;
+        const int vp = v[i] - 128;
+        r[i] = std::min(std::max((ypp + 13074 * vp) >> 11, 0), 1023);
+        g[i] = std::min(std::max((ypp - 6660 * vp - 3203 * up) >> 11, 0), 1023);
+        b[i] = std::min(std::max((ypp + 16531 * up) >> 11, 0), 1023);
+    }
+}
+
+#ifdef HAS_X86_SIMD
+/*
+ * SSE4.1 kernels
+ */
+__attribute__((target("sse4.1"))) static void extractEvery2Sse41(const uint8_t* src,
+                                                                 uint8_t* dst, int n, int phase) {
+    const __m128i mask = _mm_set1_epi16(0xff);
+    const __m128i count = _mm_cvtsi32_si128(phase * 8);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i + 16));
+        a = _mm_and_si128(_mm_srl_epi16(a, count), mask);
+        b = _mm_and_si128(_mm_srl_epi16(b, count), mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(a, b));
+    }
+    extractEvery2C(src + 2 * i, dst + i, n - i, phase);
+}
+
+__attribute__((target("sse4.1"))) static void extractEvery4Sse41(const uint8_t* src,
+                                                                 uint8_t* dst, int n, int phase) {
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128i count = _mm_cvtsi32_si128(phase * 8);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i* s = reinterpret_cast<const __m128i*>(src + 4 * i);
+        __m128i a = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128(s), count), mask);
+        __m128i b = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128(s + 1), count), mask);
+        __m128i c = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128(s + 2), count), mask);
+        __m128i d = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128(s + 3), count), mask);
+        __m128i out = _mm_packus_epi16(_mm_packus_epi32(a, b), _mm_packus_epi32(c, d));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), out);
+    }
+    extractEvery4C(src + 4 * i, dst + i, n - i, phase);
+}
+
+__attribute__((target("sse4.1"))) static void swapPairsSse41(const uint8_t* src, uint8_t* dst,
+                                                             int bytes) {
+    const __m128i shuffle = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    int i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_shuffle_epi8(a, shuffle));
+    }
+    swapPairsC(src + i, dst + i, bytes - i);
+}
+
+__attribute__((target("sse4.1"))) static void yuyvToVUSse41(const uint8_t* src, uint8_t* dst,
+                                                            int pairs) {
+    const __m128i shuffle =
+        _mm_setr_epi8(3, 1, 7, 5, 11, 9, 15, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+    int i = 0;
+    for (; i + 8 <= pairs; i += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i + 16));
+        __m128i out = _mm_unpacklo_epi64(_mm_shuffle_epi8(a, shuffle), _mm_shuffle_epi8(b, shuffle));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i), out);
+    }
+    yuyvToVUC(src + 4 * i, dst + 2 * i, pairs - i);
+}
+
+__attribute__((target("sse4.1"))) static void bilinearRowSse41(
+    const uint8_t* row0, const uint8_t* row1, const int32_t* xOffset, const int32_t* xFrac,
+    int neighbor, int fy, int shift, uint8_t* dst, int dstStep, int n, int simdCount) {
+    const __m128i one = _mm_set1_epi32(1 << shift);
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128i shiftCount = _mm_cvtsi32_si128(shift);
+    const __m128i neighborCount = _mm_cvtsi32_si128(neighbor * 8);
+    const __m128i wy1 = _mm_set1_epi32(fy);
+    const __m128i wy0 = _mm_sub_epi32(one, wy1);
+
+    int i = 0;
+    for (; i + 4 <= simdCount; i += 4) {
+        int32_t v0[4], v1[4];
+        for (int k = 0; k < 4; k++) {
+            memcpy(&v0[k], row0 + xOffset[i + k], sizeof(int32_t));
+            memcpy(&v1[k], row1 + xOffset[i + k], sizeof(int32_t));
+        }
+        __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v0));
+        __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v1));
+        __m128i wx1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xFrac + i));
+        __m128i wx0 = _mm_sub_epi32(one, wx1);
+
+        __m128i a = _mm_and_si128(p0, mask);
+        __m128i b = _mm_and_si128(_mm_srl_epi32(p0, neighborCount), mask);
+        __m128i h0 = _mm_srl_epi32(
+            _mm_add_epi32(_mm_mullo_epi32(a, wx0), _mm_mullo_epi32(b, wx1)), shiftCount);
+        a = _mm_and_si128(p1, mask);
+        b = _mm_and_si128(_mm_srl_epi32(p1, neighborCount), mask);
+        __m128i h1 = _mm_srl_epi32(
+            _mm_add_epi32(_mm_mullo_epi32(a, wx0), _mm_mullo_epi32(b, wx1)), shiftCount);
+        __m128i out = _mm_srl_epi32(
+            _mm_add_epi32(_mm_mullo_epi32(h0, wy0), _mm_mullo_epi32(h1, wy1)), shiftCount);
+
+        out = _mm_packus_epi16(_mm_packus_epi32(out, out), out);
+        uint32_t bytes = _mm_cvtsi128_si32(out);
+        if (dstStep == 1) {
+            memcpy(dst + i, &bytes, sizeof(bytes));
+        } else {
+            for (int k = 0; k < 4; k++) dst[(i + k) * dstStep] = (bytes >> (k * 8)) & 0xff;
+        }
+    }
+    bilinearRange(row0, row1, xOffset, xFrac, neighbor, fy, shift, dst, dstStep, i, n);
+}
+
+__attribute__((target("sse4.1"))) static void temporalBlendRowSse41(
+    const uint8_t* cur, const uint8_t* ref, uint8_t* dst, uint8_t* dst2, int n, int strength,
+    int floor, int slope) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i floorVec = _mm_set1_epi8(static_cast<char>(floor));
+    const __m128i strengthVec = _mm_set1_epi16(strength);
+    const __m128i slopeVec = _mm_set1_epi16(slope);
+    const __m128i round = _mm_set1_epi16(64);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + i));
+        __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ref + i));
+        __m128i diff = _mm_or_si128(_mm_subs_epu8(c, r), _mm_subs_epu8(r, c));
+        diff = _mm_subs_epu8(diff, floorVec);
+
+        // The products stay in 16 bits: diff * slope <= 65025, |ref - cur| * w <= 32640
+        __m128i wLo = _mm_subs_epu16(strengthVec,
+                                     _mm_mullo_epi16(_mm_unpacklo_epi8(diff, zero), slopeVec));
+        __m128i wHi = _mm_subs_epu16(strengthVec,
+                                     _mm_mullo_epi16(_mm_unpackhi_epi8(diff, zero), slopeVec));
+        __m128i cLo = _mm_unpacklo_epi8(c, zero);
+        __m128i cHi = _mm_unpackhi_epi8(c, zero);
+        __m128i lo = _mm_mullo_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(r, zero), cLo), wLo);
+        __m128i hi = _mm_mullo_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(r, zero), cHi), wHi);
+        lo = _mm_add_epi16(cLo, _mm_srai_epi16(_mm_add_epi16(lo, round), 7));
+        hi = _mm_add_epi16(cHi, _mm_srai_epi16(_mm_add_epi16(hi, round), 7));
+
+        __m128i out = _mm_packus_epi16(lo, hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), out);
+        if (dst2) _mm_storeu_si128(reinterpret_cast<__m128i*>(dst2 + i), out);
+    }
+    temporalBlendRowC(cur + i, ref + i, dst + i, dst2 ? dst2 + i : nullptr, n - i, strength,
+                      floor, slope);
+}
+
+// The numerators are exact in double, and a correctly rounded quotient which isn't an
+// integer never crosses one, so the truncation matches the integer division of the C version.
+__attribute__((target("sse4.1"))) static void rgbToYuvRowSse41(
+    const uint16_t* r, const uint16_t* gr, const uint16_t* gb, const uint16_t* b, uint8_t* y,
+    uint8_t* u, uint8_t* v, int n) {
+    const __m128d divisor = _mm_set1_pd(4000.0);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi32(255);
+    uint8_t* dst[3] = {y, u, v};
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i vr = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(r + i)));
+        __m128i vgr =
+            _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(gr + i)));
+        __m128i vgb =
+            _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(gb + i)));
+        __m128i vb = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(b + i)));
+        __m128i vg = _mm_srli_epi32(_mm_add_epi32(vgr, vgb), 1);
+
+        for (int c = 0; c < 3; c++) {
+            __m128i num = _mm_add_epi32(
+                _mm_add_epi32(_mm_mullo_epi32(vr, _mm_set1_epi32(kRgbToYuvCoeff[c][0])),
+                              _mm_mullo_epi32(vg, _mm_set1_epi32(kRgbToYuvCoeff[c][1]))),
+                _mm_mullo_epi32(vb, _mm_set1_epi32(kRgbToYuvCoeff[c][2])));
+            __m128d lo = _mm_div_pd(_mm_cvtepi32_pd(num), divisor);
+            __m128d hi = _mm_div_pd(_mm_cvtepi32_pd(_mm_srli_si128(num, 8)), divisor);
+            __m128i out = _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+            out = _mm_add_epi32(out, _mm_set1_epi32(kRgbToYuvOffset[c]));
+            out = _mm_min_epi32(_mm_max_epi32(out, zero), max);
+
+            out = _mm_packus_epi16(_mm_packus_epi32(out, out), out);
+            int32_t bytes = _mm_cvtsi128_si32(out);
+            memcpy(dst[c] + i, &bytes, sizeof(bytes));
+        }
+    }
+    rgbToYuvRowC(r + i, gr + i, gb + i, b + i, y + i, u + i, v + i, n - i);
+}
+
+__attribute__((target("sse4.1"))) static void yuvToRgbRowSse41(
+    const uint8_t* y, const uint8_t* u, const uint8_t* v, uint16_t* r, uint16_t* g, uint16_t* b,
+    int n) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi32(1023);
+    uint16_t* dst[3] = {r, g, b};
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32_t y4, u4, v4;
+        memcpy(&y4, y + i, sizeof(y4));
+        memcpy(&u4, u + i, sizeof(u4));
+        memcpy(&v4, v + i, sizeof(v4));
+        __m128i vy = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(y4));
+        __m128i vu = _mm_sub_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(u4)), _mm_set1_epi32(128));
+        __m128i vv = _mm_sub_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(v4)), _mm_set1_epi32(128));
+        __m128i ypp = _mm_mullo_epi32(_mm_sub_epi32(vy, _mm_set1_epi32(16)), _mm_set1_epi32(9535));
+
+        __m128i out[3];
+        out[0] = _mm_add_epi32(ypp, _mm_mullo_epi32(vv, _mm_set1_epi32(13074)));
+        out[1] = _mm_sub_epi32(_mm_sub_epi32(ypp, _mm_mullo_epi32(vv, _mm_set1_epi32(6660))),
+                               _mm_mullo_epi32(vu, _mm_set1_epi32(3203)));
+        out[2] = _mm_add_epi32(ypp, _mm_mullo_epi32(vu, _mm_set1_epi32(16531)));
+
+        for (int c = 0; c < 3; c++) {
+            __m128i val = _mm_min_epi32(_mm_max_epi32(_mm_srai_epi32(out[c], 11), zero), max);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst[c] + i), _mm_packus_epi32(val, val));
+        }
+    }
+    yuvToRgbRowC(y + i, u + i, v + i, r + i, g + i, b + i, n - i);
+}
+
+/*
+ * AVX2 kernels
+ */
+__attribute__((target("avx2"))) static void extractEvery2Avx2(const uint8_t* src, uint8_t* dst,
+                                                              int n, int phase) {
+    const __m256i mask = _mm256_set1_epi16(0xff);
+    const __m128i count = _mm_cvtsi32_si128(phase * 8);
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i + 32));
+        a = _mm256_and_si256(_mm256_srl_epi16(a, count), mask);
+        b = _mm256_and_si256(_mm256_srl_epi16(b, count), mask);
+        // packus works in 128-bit lanes, restore the qword order
+        __m256i out = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), out);
+    }
+    extractEvery2C(src + 2 * i, dst + i, n - i, phase);
+}
+
+__attribute__((target("avx2"))) static void extractEvery4Avx2(const uint8_t* src, uint8_t* dst,
+                                                              int n, int phase) {
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    const __m128i count = _mm_cvtsi32_si128(phase * 8);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i* s = reinterpret_cast<const __m256i*>(src + 4 * i);
+        __m256i a = _mm256_and_si256(_mm256_srl_epi32(_mm256_loadu_si256(s), count), mask);
+        __m256i b = _mm256_and_si256(_mm256_srl_epi32(_mm256_loadu_si256(s + 1), count), mask);
+        __m256i c = _mm256_and_si256(_mm256_srl_epi32(_mm256_loadu_si256(s + 2), count), mask);
+        __m256i d = _mm256_and_si256(_mm256_srl_epi32(_mm256_loadu_si256(s + 3), count), mask);
+        __m256i out =
+            _mm256_packus_epi16(_mm256_packus_epi32(a, b), _mm256_packus_epi32(c, d));
+        out = _mm256_permutevar8x32_epi32(out, order);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), out);
+    }
+    extractEvery4C(src + 4 * i, dst + i, n - i, phase);
+}
+
+__attribute__((target("avx2"))) static void swapPairsAvx2(const uint8_t* src, uint8_t* dst,
+                                                          int bytes) {
+    const __m256i shuffle =
+        _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14, 1, 0, 3, 2, 5, 4,
+                         7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    int i = 0;
+    for (; i + 32 <= bytes; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_shuffle_epi8(a, shuffle));
+    }
+    swapPairsC(src + i, dst + i, bytes - i);
+}
+
+__attribute__((target("avx2"))) static void yuyvToVUAvx2(const uint8_t* src, uint8_t* dst,
+                                                         int pairs) {
+    const __m256i shuffle =
+        _mm256_setr_epi8(3, 1, 7, 5, 11, 9, 15, 13, -1, -1, -1, -1, -1, -1, -1, -1, 3, 1, 7, 5,
+                         11, 9, 15, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+    int i = 0;
+    for (; i + 16 <= pairs; i += 16) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 4 * i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 4 * i + 32));
+        __m256i out = _mm256_unpacklo_epi64(_mm256_shuffle_epi8(a, shuffle),
+                                            _mm256_shuffle_epi8(b, shuffle));
+        out = _mm256_permute4x64_epi64(out, 0xd8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i), out);
+    }
+    yuyvToVUC(src + 4 * i, dst + 2 * i, pairs - i);
+}
+
+__attribute__((target("avx2"))) static void bilinearRowAvx2(
+    const uint8_t* row0, const uint8_t* row1, const int32_t* xOffset, const int32_t* xFrac,
+    int neighbor, int fy, int shift, uint8_t* dst, int dstStep, int n, int simdCount) {
+    const __m256i one = _mm256_set1_epi32(1 << shift);
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    const __m128i shiftCount = _mm_cvtsi32_si128(shift);
+    const __m128i neighborCount = _mm_cvtsi32_si128(neighbor * 8);
+    const __m256i wy1 = _mm256_set1_epi32(fy);
+    const __m256i wy0 = _mm256_sub_epi32(one, wy1);
+    const __m256i order = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+    const int* base0 = reinterpret_cast<const int*>(row0);
+    const int* base1 = reinterpret_cast<const int*>(row1);
+
+    int i = 0;
+    for (; i + 8 <= simdCount; i += 8) {
+        __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xOffset + i));
+        __m256i p0 = _mm256_i32gather_epi32(base0, idx, 1);
+        __m256i p1 = _mm256_i32gather_epi32(base1, idx, 1);
+        __m256i wx1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xFrac + i));
+        __m256i wx0 = _mm256_sub_epi32(one, wx1);
+
+        __m256i a = _mm256_and_si256(p0, mask);
+        __m256i b = _mm256_and_si256(_mm256_srl_epi32(p0, neighborCount), mask);
+        __m256i h0 = _mm256_srl_epi32(
+            _mm256_add_epi32(_mm256_mullo_epi32(a, wx0), _mm256_mullo_epi32(b, wx1)), shiftCount);
+        a = _mm256_and_si256(p1, mask);
+        b = _mm256_and_si256(_mm256_srl_epi32(p1, neighborCount), mask);
+        __m256i h1 = _mm256_srl_epi32(
+            _mm256_add_epi32(_mm256_mullo_epi32(a, wx0), _mm256_mullo_epi32(b, wx1)), shiftCount);
+        __m256i out = _mm256_srl_epi32(
+            _mm256_add_epi32(_mm256_mullo_epi32(h0, wy0), _mm256_mullo_epi32(h1, wy1)),
+            shiftCount);
+
+        // Pack the 8 results to bytes in dword 0 and 4, then move them together
+        out = _mm256_packus_epi16(_mm256_packus_epi32(out, out), out);
+        out = _mm256_permutevar8x32_epi32(out, order);
+        uint64_t bytes = _mm_cvtsi128_si64(_mm256_castsi256_si128(out));
+        if (dstStep == 1) {
+            memcpy(dst + i, &bytes, sizeof(bytes));
+        } else {
+            for (int k = 0; k < 8; k++) dst[(i + k) * dstStep] = (bytes >> (k * 8)) & 0xff;
+        }
+    }
+    bilinearRange(row0, row1, xOffset, xFrac, neighbor, fy, shift, dst, dstStep, i, n);
+}
+
+__attribute__((target("avx2"))) static void temporalBlendRowAvx2(
+    const uint8_t* cur, const uint8_t* ref, uint8_t* dst, uint8_t* dst2, int n, int strength,
+    int floor, int slope) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i floorVec = _mm256_set1_epi8(static_cast<char>(floor));
+    const __m256i strengthVec = _mm256_set1_epi16(strength);
+    const __m256i slopeVec = _mm256_set1_epi16(slope);
+    const __m256i round = _mm256_set1_epi16(64);
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cur + i));
+        __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ref + i));
+        __m256i diff = _mm256_or_si256(_mm256_subs_epu8(c, r), _mm256_subs_epu8(r, c));
+        diff = _mm256_subs_epu8(diff, floorVec);
+
+        // unpack and packus both work in 128-bit lanes, so the byte order is kept
+        __m256i wLo = _mm256_subs_epu16(
+            strengthVec, _mm256_mullo_epi16(_mm256_unpacklo_epi8(diff, zero), slopeVec));
+        __m256i wHi = _mm256_subs_epu16(
+            strengthVec, _mm256_mullo_epi16(_mm256_unpackhi_epi8(diff, zero), slopeVec));
+        __m256i cLo = _mm256_unpacklo_epi8(c, zero);
+        __m256i cHi = _mm256_unpackhi_epi8(c, zero);
+        __m256i lo =
+            _mm256_mullo_epi16(_mm256_sub_epi16(_mm256_unpacklo_epi8(r, zero), cLo), wLo);
+        __m256i hi =
+            _mm256_mullo_epi16(_mm256_sub_epi16(_mm256_unpackhi_epi8(r, zero), cHi), wHi);
+        lo = _mm256_add_epi16(cLo, _mm256_srai_epi16(_mm256_add_epi16(lo, round), 7));
+        hi = _mm256_add_epi16(cHi, _mm256_srai_epi16(_mm256_add_epi16(hi, round), 7));
+
+        __m256i out = _mm256_packus_epi16(lo, hi);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), out);
+        if (dst2) _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst2 + i), out);
+    }
+    temporalBlendRowC(cur + i, ref + i, dst + i, dst2 ? dst2 + i : nullptr, n - i, strength,
+                      floor, slope);
+}
+__attribute__((target("avx2"))) static void rgbToYuvRowAvx2(
+    const uint16_t* r, const uint16_t* gr, const uint16_t* gb, const uint16_t* b, uint8_t* y,
+    uint8_t* u, uint8_t* v, int n) {
+    const __m256d divisor = _mm256_set1_pd(4000.0);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi32(255);
+    const __m256i order = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+    uint8_t* dst[3] = {y, u, v};
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i vr =
+            _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(r + i)));
+        __m256i vgr =
+            _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(gr + i)));
+        __m256i vgb =
+            _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(gb + i)));
+        __m256i vb =
+            _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        __m256i vg = _mm256_srli_epi32(_mm256_add_epi32(vgr, vgb), 1);
+
+        for (int c = 0; c < 3; c++) {
+            __m256i num = _mm256_add_epi32(
+                _mm256_add_epi32(
+                    _mm256_mullo_epi32(vr, _mm256_set1_epi32(kRgbToYuvCoeff[c][0])),
+                    _mm256_mullo_epi32(vg, _mm256_set1_epi32(kRgbToYuvCoeff[c][1]))),
+                _mm256_mullo_epi32(vb, _mm256_set1_epi32(kRgbToYuvCoeff[c][2])));
+            __m256d lo = _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(num)), divisor);
+            __m256d hi =
+                _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(num, 1)), divisor);
+            __m256i out = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvttpd_epi32(lo)),
+                                                  _mm256_cvttpd_epi32(hi), 1);
+            out = _mm256_add_epi32(out, _mm256_set1_epi32(kRgbToYuvOffset[c]));
+            out = _mm256_min_epi32(_mm256_max_epi32(out, zero), max);
+
+            out = _mm256_packus_epi16(_mm256_packus_epi32(out, out), out);
+            out = _mm256_permutevar8x32_epi32(out, order);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst[c] + i), _mm256_castsi256_si128(out));
+        }
+    }
+    rgbToYuvRowC(r + i, gr + i, gb + i, b + i, y + i, u + i, v + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void yuvToRgbRowAvx2(
+    const uint8_t* y, const uint8_t* u, const uint8_t* v, uint16_t* r, uint16_t* g, uint16_t* b,
+    int n) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi32(1023);
+    uint16_t* dst[3] = {r, g, b};
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i vy =
+            _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + i)));
+        __m256i vu =
+            _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + i)));
+        __m256i vv =
+            _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + i)));
+        __m256i ypp = _mm256_mullo_epi32(_mm256_sub_epi32(vy, _mm256_set1_epi32(16)),
+                                         _mm256_set1_epi32(9535));
+        vu = _mm256_sub_epi32(vu, _mm256_set1_epi32(128));
+        vv = _mm256_sub_epi32(vv, _mm256_set1_epi32(128));
+
+        __m256i out[3];
+        out[0] = _mm256_add_epi32(ypp, _mm256_mullo_epi32(vv, _mm256_set1_epi32(13074)));
+        out[1] = _mm256_sub_epi32(
+            _mm256_sub_epi32(ypp, _mm256_mullo_epi32(vv, _mm256_set1_epi32(6660))),
+            _mm256_mullo_epi32(vu, _mm256_set1_epi32(3203)));
+        out[2] = _mm256_add_epi32(ypp, _mm256_mullo_epi32(vu, _mm256_set1_epi32(16531)));
+
+        for (int c = 0; c < 3; c++) {
+            __m256i val =
+                _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(out[c], 11), zero), max);
+            // packus works in 128-bit lanes, move the 2 valid qwords together
+            val = _mm256_permute4x64_epi64(_mm256_packus_epi32(val, val), 0x08);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst[c] + i), _mm256_castsi256_si128(val));
+        }
+    }
+    yuvToRgbRowC(y + i, u + i, v + i, r + i, g + i, b + i, n - i);
+}
+#endif
+
+static const ImageKernels kScalarKernels = {
+    ImageKernels::LEVEL_SCALAR, extractEvery2C,    extractEvery4C, swapPairsC,   yuyvToVUC,
+    bilinearRowC,               temporalBlendRowC, rgbToYuvRowC,   yuvToRgbRowC,
+};
+
+#ifdef HAS_X86_SIMD
+static const ImageKernels kSse41Kernels = {
+    ImageKernels::LEVEL_SSE41, extractEvery2Sse41, extractEvery4Sse41,    swapPairsSse41,
+    yuyvToVUSse41,             bilinearRowSse41,   temporalBlendRowSse41, rgbToYuvRowSse41,
+    yuvToRgbRowSse41,
+};
+
+static const ImageKernels kAvx2Kernels = {
+    ImageKernels::LEVEL_AVX2, extractEvery2Avx2, extractEvery4Avx2,    swapPairsAvx2,
+    yuyvToVUAvx2,             bilinearRowAvx2,   temporalBlendRowAvx2, rgbToYuvRowAvx2,
+    yuvToRgbRowAvx2,
+};
+#endif
+
+static ImageKernels::Level getCpuLevel() {
+#ifdef HAS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return ImageKernels::LEVEL_AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return ImageKernels::LEVEL_SSE41;
+#endif
+    return ImageKernels::LEVEL_SCALAR;
+}
+
+const ImageKernels& getImageKernels(ImageKernels::Level level) {
+    static const ImageKernels::Level cpuLevel = getCpuLevel();
+    if (level > cpuLevel) return kScalarKernels;
+
+#ifdef HAS_X86_SIMD
+    if (level == ImageKernels::LEVEL_AVX2) return kAvx2Kernels;
+    if (level == ImageKernels::LEVEL_SSE41) return kSse41Kernels;
+#endif
+    return kScalarKernels;
+}
+
+static const ImageKernels& selectImageKernels() {
+    const ImageKernels& kernels = getImageKernels(getCpuLevel());
+    LOG1("%s, use image kernels of level %d", __func__, kernels.level);
+    return kernels;
+}
+
+const ImageKernels& getImageKernels() {
+    static const ImageKernels& kernels = selectImageKernels();
+    return kernels;
+}
+
+}  // namespace icamera
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2023 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace icamera {
+
+/**
+ * Row kernels shared by ImageConverter, ImageScalerCore, SwImageConverter and CpuTNR.
+ *
+ * Each kernel has a scalar reference and SSE4.1/AVX2 versions which produce exactly
+ * the same output, the best one supported by the CPU is selected once at runtime.
+ */
+struct ImageKernels {
+    enum Level {
+        LEVEL_SCALAR = 0,
+        LEVEL_SSE41,
+        LEVEL_AVX2,
+    };
+
+    Level level;
+
+    // dst[i] = src[2 * i + phase], i < n
+    void (*extractEvery2)(const uint8_t* src, uint8_t* dst, int n, int phase);
+    // dst[i] = src[4 * i + phase], i < n
+    void (*extractEvery4)(const uint8_t* src, uint8_t* dst, int n, int phase);
+    // Swap the 2 bytes of each pair (UV <-> VU), bytes must be even
+    void (*swapPairs)(const uint8_t* src, uint8_t* dst, int bytes);
+    // YUYV to interleaved VU: dst[2 * i] = src[4 * i + 3], dst[2 * i + 1] = src[4 * i + 1]
+    void (*yuyvToVU)(const uint8_t* src, uint8_t* dst, int pairs);
+
+    /**
+     * Bilinear interpolation of one output row, with fixed point weights of "shift" bits.
+     *
+     * For output i, with a = row[xOffset[i]] and b = row[xOffset[i] + neighbor]:
+     *   h(row) = (a * ((1 << shift) - xFrac[i]) + b * xFrac[i]) >> shift
+     *   dst[i * dstStep] = (h(row0) * ((1 << shift) - fy) + h(row1) * fy) >> shift
+     *
+     * The SIMD versions read up to 4 bytes from row + xOffset[i], they are only used for
+     * the first simdCount outputs, the caller makes sure these reads stay in the buffer.
+     */
+    void (*bilinearRow)(const uint8_t* row0, const uint8_t* row1, const int32_t* xOffset,
+                        const int32_t* xFrac, int neighbor, int fy, int shift, uint8_t* dst,
+                        int dstStep, int n, int simdCount);
+
+    /**
+     * Motion adaptive temporal blending of n bytes, the weight of ref is in Q7:
+     *   w = max(strength - max(|cur[i] - ref[i]| - floor, 0) * slope, 0)
+     *   dst[i] = cur[i] + (((ref[i] - cur[i]) * w + 64) >> 7)
+     * strength MUST NOT exceed 128, floor and slope MUST NOT exceed 255.
+     * The output is also written to dst2 if it isn't nullptr.
+     */
+    void (*temporalBlendRow)(const uint8_t* cur, const uint8_t* ref, uint8_t* dst, uint8_t* dst2,
+                             int n, int strength, int floor, int slope);
+
+    /**
+     * Convert n bayer blocks of 10-bit RGB to YUV, G is the average of gr and gb.
+     * Same result as SwImageConverter::RGB2YUV().
+     */
+    void (*rgbToYuvRow)(const uint16_t* r, const uint16_t* gr, const uint16_t* gb,
+                        const uint16_t* b, uint8_t* y, uint8_t* u, uint8_t* v, int n);
+
+    /**
+     * Convert n YUV pixels to 10-bit RGB, same result as SwImageConverter::YUV2RGB().
+     */
+    void (*yuvToRgbRow)(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint16_t* r,
+                        uint16_t* g, uint16_t* b, int n);
+};
+
+/**
+ * Get the kernels for the best level supported by the CPU.
+ */
+const ImageKernels& getImageKernels();
+
+/**
+ * Get the kernels of one level, for comparing the SIMD versions with the scalar reference.
+ * The scalar kernels are returned if the level isn't supported.
+ */
+const ImageKernels& getImageKernels(ImageKernels::Level level);
+
+}  // namespace icamera
@@ -22,6 +22,7 @@
 #include "iutils/Utils.h"
 #include "iutils/CameraLog.h"
 #include "ImageScalerCore.h"
+#include "ImageKernels.h"
 
 #define RESOLUTION_VGA_WIDTH 640
 #define RESOLUTION_VGA_HEIGHT 480
@@ -33,6 +34,13 @@
 
 namespace icamera {
 
+// Count of the leading outputs whose 4 bytes SIMD reads at row + xOffset stay inside rowSize
+static int getSimdCount(const int32_t* xOffset, int n, int rowSize) {
+    int count = 0;
+    while (count < n && xOffset[count] + 4 <= rowSize) count++;
+    return count;
+}
+
 void ImageScalerCore::downScaleImage(
     void* src, void* dest, int dest_w, int dest_h, int dest_stride, int src_w, int src_h,
     int src_stride,
@@ -253,9 +261,8 @@ void ImageScalerCore::downScaleAndCropNv12Image(
     int r_skip = src_w < proper_source_width ? 0 : (src_w - proper_source_width - l_skip);
     int skip = l_skip + r_skip;
 
-    int i, j, x1, y1, x2, y2;
-    unsigned int val_1, val_2;
-    int dx, dy;
+    int i, j, x1, y1, y2;
+    int dy;
     int src_Y_data = src_stride * (src_h + src_skip_lines_bottom + (src_skip_lines_top >> 1));
     int dest_Y_data = dest_stride * dest_h;
     int width, height;
@@ -265,61 +272,46 @@ void ImageScalerCore::downScaleAndCropNv12Image(
     }
     const int scaling_w = ((src_w - skip) << 8) / dest_w;
     const int scaling_h = (src_h << 8) / dest_h;
-    dx = 0;
-    dy = 0;
+    width = dest_w >> 1;
+    height = dest_h >> 1;
+
+    // The horizontal positions are the same for every row, so compute them once
+    std::unique_ptr<int32_t[]> xFrac(new int32_t[dest_w]);
+    std::unique_ptr<int32_t[]> yOffset(new int32_t[dest_w]);
+    std::unique_ptr<int32_t[]> uvOffset(new int32_t[width]);
+    for (j = 0; j < dest_w; j++) {
+        x1 = j * scaling_w;
+        xFrac[j] = x1 & 0xff;
+        yOffset[j] = (x1 >> 8) + l_skip;
+        if (j < width) uvOffset[j] = ((x1 >> 8) + l_skip / 2) << 1;
+    }
+    const ImageKernels& kernels = getImageKernels();
+    const int ySimdCount = getSimdCount(yOffset.get(), dest_w, src_stride);
+    // V is one byte after U, so its reads end one byte later
+    const int uvSimdCount = getSimdCount(uvOffset.get(), width, src_stride - 1);
+
     // get Y data
     for (i = 0; i < dest_h; i++) {
         y1 = i * scaling_h;
         dy = y1 & 0xff;
         y2 = y1 >> 8;
-        for (j = 0; j < dest_w; j++) {
-            x1 = j * scaling_w;
-            dx = x1 & 0xff;
-            x2 = (x1 >> 8) + l_skip;
-            val_1 = ((unsigned int)src[y2 * src_stride + x2] * (256 - dx) +
-                     (unsigned int)src[y2 * src_stride + x2 + 1] * dx) >>
-                    8;
-            val_2 = ((unsigned int)src[(y2 + 1) * src_stride + x2] * (256 - dx) +
-                     (unsigned int)src[(y2 + 1) * src_stride + x2 + 1] * dx) >>
-                    8;
-            dest[i * dest_stride + j] = MIN(((val_1 * (256 - dy) + val_2 * dy) >> 8), 0xff);
-        }
+        const unsigned char* row = src + y2 * src_stride;
+        kernels.bilinearRow(row, row + src_stride, yOffset.get(), xFrac.get(), 1, dy, 8,
+                            dest + i * dest_stride, 1, dest_w, ySimdCount);
     }
-    i = 0;
-    j = 0;
-    width = dest_w >> 1;
-    height = dest_h >> 1;
     // get UV data
     for (i = 0; i < height; i++) {
         y1 = i * scaling_h;
         dy = y1 & 0xff;
         y2 = y1 >> 8;
-        for (j = 0; j < width; j++) {
-            x1 = j * scaling_w;
-            dx = x1 & 0xff;
-            x2 = (x1 >> 8) + l_skip / 2;
-            // fill U data
-            val_1 = ((unsigned int)src[y2 * src_stride + (x2 << 1) + src_Y_data] * (256 - dx) +
-                     (unsigned int)src[y2 * src_stride + ((x2 + 1) << 1) + src_Y_data] * dx) >>
-                    8;
-            val_2 =
-                ((unsigned int)src[(y2 + 1) * src_stride + (x2 << 1) + src_Y_data] * (256 - dx) +
-                 (unsigned int)src[(y2 + 1) * src_stride + ((x2 + 1) << 1) + src_Y_data] * dx) >>
-                8;
-            dest[i * dest_stride + (j << 1) + dest_Y_data] =
-                MIN(((val_1 * (256 - dy) + val_2 * dy) >> 8), 0xff);
-            // fill V data
-            val_1 = ((unsigned int)src[y2 * src_stride + (x2 << 1) + 1 + src_Y_data] * (256 - dx) +
-                     (unsigned int)src[y2 * src_stride + ((x2 + 1) << 1) + 1 + src_Y_data] * dx) >>
-                    8;
-            val_2 = ((unsigned int)src[(y2 + 1) * src_stride + (x2 << 1) + 1 + src_Y_data] *
-                         (256 - dx) +
-                     (unsigned int)src[(y2 + 1) * src_stride + ((x2 + 1) << 1) + 1 + src_Y_data] *
-                         dx) >>
-                    8;
-            dest[i * dest_stride + (j << 1) + 1 + dest_Y_data] =
-                MIN(((val_1 * (256 - dy) + val_2 * dy) >> 8), 0xff);
-        }
+        const unsigned char* row = src + y2 * src_stride + src_Y_data;
+        unsigned char* uvDest = dest + i * dest_stride + dest_Y_data;
+        // fill U data
+        kernels.bilinearRow(row, row + src_stride, uvOffset.get(), xFrac.get(), 2, dy, 8, uvDest,
+                            2, width, uvSimdCount);
+        // fill V data
+        kernels.bilinearRow(row + 1, row + src_stride + 1, uvOffset.get(), xFrac.get(), 2, dy, 8,
+                            uvDest + 1, 2, width, uvSimdCount);
     }
 }
 
@@ -946,8 +938,6 @@ void ImageScalerCore::cropComposeUpscaleNV12_bl(void* src, unsigned int srcH,
                                                 unsigned int dstStride, unsigned int dstCropLeft,
                                                 unsigned int dstCropTop, unsigned int dstCropW,
                                                 unsigned int dstCropH) {
-    static const int BILINEAR = 1;
-    static const unsigned int FP_1 = 1 << MFP;         // Fixed point 1.0
     static const unsigned int FRACT = (1 << MFP) - 1;  // Fractional part mask
     unsigned int dx, dy, sx, sy;
     unsigned char* s = (unsigned char*)src;
@@ -969,25 +959,21 @@ void ImageScalerCore::cropComposeUpscaleNV12_bl(void* src, unsigned int srcH,
     dy0 = dstCropTop;
     dx1 = dstCropLeft + dstCropW;
     dy1 = dstCropTop + dstCropH;
+
+    // The horizontal positions and fractions are the same for every row
+    std::unique_ptr<int32_t[]> xOffset(new int32_t[dstCropW]);
+    std::unique_ptr<int32_t[]> xFrac(new int32_t[dstCropW]);
+    for (dx = 0, sx = sx0; dx < dstCropW; dx++, sx += sxd) {
+        xOffset[dx] = sx >> MFP;
+        xFrac[dx] = sx & FRACT;  // Fractional part
+    }
+    const ImageKernels& kernels = getImageKernels();
+    const int simdCount = getSimdCount(xOffset.get(), dstCropW, srcStride);
     for (dy = dy0, sy = sy0; dy < dy1; dy++, sy += syd) {
-        for (dx = dx0, sx = sx0; dx < dx1; dx++, sx += sxd) {
-            unsigned int sxi = sx >> MFP;
-            unsigned int syi = sy >> MFP;
-            unsigned int s0 = s[srcStride * syi + sxi];
-            if (BILINEAR) {
-                unsigned int fx = sx & FRACT;  // Fractional part
-                unsigned int fy = sy & FRACT;
-                unsigned int fx1 = FP_1 - fx;  // 1 - fractional part
-                unsigned int fy1 = FP_1 - fy;
-                unsigned int s1 = s[srcStride * syi + sxi + 1];
-                unsigned int s2 = s[srcStride * (syi + 1) + sxi];
-                unsigned int s3 = s[srcStride * (syi + 1) + sxi + 1];
-                unsigned int s4 = (s0 * fx1 + s1 * fx) >> MFP;
-                unsigned int s5 = (s2 * fx1 + s3 * fx) >> MFP;
-                s0 = (s4 * fy1 + s5 * fy) >> MFP;
-            }
-            d[dstStride * dy + dx] = s0;
-        }
+        unsigned int syi = sy >> MFP;
+        const unsigned char* row = s + srcStride * syi;
+        kernels.bilinearRow(row, row + srcStride, xOffset.get(), xFrac.get(), 1, sy & FRACT, MFP,
+                            d + dstStride * dy + dx0, 1, dstCropW, simdCount);
     }
 
     // Upscale chrominance
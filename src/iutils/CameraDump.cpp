@@ -19,6 +19,7 @@
 #include "iutils/CameraDump.h"
 
 #include <dirent.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <math.h>
 #include <stdio.h>
@@ -26,7 +27,9 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -45,6 +48,9 @@ using std::string;
 namespace icamera {
 
 Thread* gDumpThread = nullptr;
+// Created by setDumpLevel() once the dumps are written asynchronously, kept until exit
+std::atomic<CameraDump::DumpWriter*> gDumpWriter(nullptr);
+Mutex gDumpWriterLock;
 
 int gDumpType = 0;
 int gDumpFormat = 0;
@@ -52,6 +58,8 @@ uint32_t gDumpSkipNum = 0;
 uint32_t gDumpRangeMin = 0;
 uint32_t gDumpRangeMax = 0;
 int gDumpFrequency = 1;
+// The max memory of the pending dumps in MB, 0 means writing the files synchronously.
+int gDumpMaxMemory = 256;
 char gDumpPath[50];
 bool gDumpRangeEnabled = false;
 static const char* ModuleName[] = {"na",  // not available
@@ -72,6 +80,7 @@ void CameraDump::setDumpLevel(void) {
     const char* PROP_CAMERA_HAL_DUMP_SKIP_NUM = "cameraDumpSkipNum";
     const char* PROP_CAMERA_HAL_DUMP_RANGE = "cameraDumpRange";
     const char* PROP_CAMERA_HAL_DUMP_FREQUENCY = "cameraDumpFrequency";
+    const char* PROP_CAMERA_HAL_DUMP_MAX_MEMORY = "cameraDumpMaxMemory";
 
     // dump, it's used to dump images or some parameters to a file.
     char* dumpType = getenv(PROP_CAMERA_HAL_DUMP);
@@ -127,6 +136,22 @@ void CameraDump::setDumpLevel(void) {
         LOG1("Dump frequency is %d", gDumpFrequency);
     }
 
+    char* cameraDumpMaxMemory = getenv(PROP_CAMERA_HAL_DUMP_MAX_MEMORY);
+    if (cameraDumpMaxMemory) {
+        gDumpMaxMemory = strtoul(cameraDumpMaxMemory, nullptr, 0);
+        LOG1("Dump max memory is %d MB", gDumpMaxMemory);
+    }
+
+    // Also called by the DumpThread, so the writer is started when dumps are enabled at runtime
+    if (gDumpType && gDumpMaxMemory > 0) {
+        AutoMutex lock(gDumpWriterLock);
+        if (!gDumpWriter) {
+            DumpWriter* writer = new DumpWriter();
+            writer->run("DumpWriter", PRIORITY_BACKGROUND);
+            gDumpWriter = writer;
+        }
+    }
+
     // the PG dump is implemented in libiacss
     if (gDumpType & DUMP_PSYS_PG) {
         const char* PROP_CAMERA_CSS_DEBUG = "camera_css_debug";
@@ -178,6 +203,12 @@ void CameraDump::writeData(const void* data, int size, const char* fileName) {
     CheckAndLogError((data == nullptr || size == 0 || fileName == nullptr), VOID_VALUE,
                      "Nothing needs to be dumped");
 
+    DumpWriter* writer = gDumpWriter;
+    if (writer && gDumpMaxMemory > 0) {
+        writer->queueData(data, size, fileName, static_cast<size_t>(gDumpMaxMemory) * 1024 * 1024);
+        return;
+    }
+
     FILE* fp = fopen(fileName, "w+");
     CheckAndLogError(fp == nullptr, VOID_VALUE, "open dump file %s failed", fileName);
 
@@ -187,6 +218,16 @@ void CameraDump::writeData(const void* data, int size, const char* fileName) {
     fclose(fp);
 }
 
+void CameraDump::flushDumps(void) {
+    DumpWriter* writer = gDumpWriter;
+    if (writer) writer->flush();
+}
+
+uint32_t CameraDump::getDroppedDumpCount(void) {
+    DumpWriter* writer = gDumpWriter;
+    return writer ? writer->getDroppedCount() : 0;
+}
+
 static string getNamePrefix(int cameraId, ModuleType_t type, Port port, int sUsage = 0) {
     const char* dumpPath = CameraDump::getDumpPath();
     const char* sensorName = PlatformData::getSensorName(cameraId);
@@ -215,15 +256,15 @@ static string getNamePrefix(int cameraId, ModuleType_t type, Port port, int sUsa
 static string getAiqSettingAppendix(int cameraId, int64_t sequence) {
     char settingAppendix[MAX_NAME_LEN] = {'\0'};
 
-    AiqResult* aiqResults =
-        const_cast<AiqResult*>(AiqResultStorage::getInstance(cameraId)->getAiqResult(sequence));
-    if (aiqResults == nullptr) {
+    AiqResultStorage::AiqResultRef aiqResultRef =
+        AiqResultStorage::getInstance(cameraId)->getAiqResultRef(sequence);
+    if (!aiqResultRef) {
         LOGW("%s: no result for sequence %ld! use the latest instead", __func__, sequence);
-        aiqResults =
-            const_cast<AiqResult*>(AiqResultStorage::getInstance(cameraId)->getAiqResult());
-        CheckAndLogError((aiqResults == nullptr), string(settingAppendix),
+        aiqResultRef = AiqResultStorage::getInstance(cameraId)->getAiqResultRef();
+        CheckAndLogError(!aiqResultRef, string(settingAppendix),
                          "Cannot find available aiq result.");
     }
+    AiqResult* aiqResults = const_cast<AiqResult*>(aiqResultRef.get());
 
     ia_aiq_exposure_sensor_parameters* sensorExposure =
         aiqResults->mAeResults.exposures[0].sensor_exposure;
@@ -416,6 +457,8 @@ void CameraDump::dumpImage(int cameraId, const shared_ptr<CameraBuffer>& camBuff
     void* pBuf = mapper.getUserPtr();
     LOG1("@%s, fd:%d, buffersize:%d, buf:%p, memoryType:%d, fileName:%s", __func__, fd, bufferSize,
          pBuf, memoryType, fileName.c_str());
+    CheckAndLogError(!pBuf, VOID_VALUE, "@%s, failed to map the buffer", __func__);
+    // Only the copy is done here, the file is written by the dump writer thread
     writeData(pBuf, bufferSize, fileName.c_str());
 }
 
@@ -520,6 +563,132 @@ bool DumpThread::threadLoop() {
 
     return true;
 }
+
+// Keep a few buffers of the written dumps, the frames of one stream have the same size.
+static const size_t kMaxFreeDumpBuffers = 4;
+
+DumpWriter::DumpWriter()
+        : mPendingBytes(0),
+          mExiting(false),
+          mDroppedCount(0),
+          mReportedDropCount(0) {}
+
+DumpWriter::~DumpWriter() {
+    // The thread may exit between two loops once requested, so drain the jobs before it
+    flush();
+    requestExit();
+    requestExitAndWait();
+}
+
+void DumpWriter::requestExit() {
+    AutoMutex lock(mLock);
+    mExiting = true;
+    Thread::requestExit();
+    mJobCondition.signal();
+}
+
+bool DumpWriter::queueData(const void* data, int size, const char* fileName, size_t maxMemory) {
+    DumpJob job;
+    {
+        AutoMutex lock(mLock);
+        if (mPendingBytes + size > maxMemory) {
+            mDroppedCount++;
+            LOG1("%s, drop %s, pending %zu bytes", __func__, fileName, mPendingBytes);
+            return false;
+        }
+        // Reserve the memory before copying, so the copy is done without the lock
+        mPendingBytes += size;
+        job.data = allocBuffer(size);
+    }
+
+    job.fileName = fileName;
+    const char* src = static_cast<const char*>(data);
+    job.data.assign(src, src + size);
+
+    AutoMutex lock(mLock);
+    mPendingJobs.push_back(std::move(job));
+    mJobCondition.signal();
+    return true;
+}
+
+std::vector<char> DumpWriter::allocBuffer(size_t size) {
+    for (auto it = mFreeBuffers.begin(); it != mFreeBuffers.end(); ++it) {
+        if (it->capacity() >= size) {
+            std::vector<char> buffer = std::move(*it);
+            mFreeBuffers.erase(it);
+            return buffer;
+        }
+    }
+
+    return std::vector<char>();
+}
+
+void DumpWriter::flush() {
+    ConditionLock lock(mLock);
+    // The bytes are reserved before the data is copied, so a dump still being queued counts
+    while (mPendingBytes > 0) {
+        mIdleCondition.wait(lock);
+    }
+}
+
+uint32_t DumpWriter::getDroppedCount() const {
+    AutoMutex lock(mLock);
+    return mDroppedCount;
+}
+
+void DumpWriter::writeFile(const DumpJob& job) {
+    int fd = open(job.fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    CheckAndLogError(fd < 0, VOID_VALUE, "open dump file %s failed", job.fileName.c_str());
+
+    LOG1("Write data to file:%s", job.fileName.c_str());
+    const char* data = job.data.data();
+    size_t left = job.data.size();
+    while (left > 0) {
+        ssize_t ret = write(fd, data, left);
+        if (ret < 0 && errno == EINTR) continue;
+        if (ret <= 0) {
+            LOGW("Error writing %zu bytes to %s", job.data.size(), job.fileName.c_str());
+            break;
+        }
+        data += ret;
+        left -= ret;
+    }
+    close(fd);
+}
+
+bool DumpWriter::threadLoop() {
+    ConditionLock lock(mLock);
+    while (mPendingJobs.empty() && !mExiting) {
+        mJobCondition.wait(lock);
+    }
+
+    while (!mPendingJobs.empty()) {
+        // Take all the pending jobs at once, the callers are not blocked while writing
+        std::deque<DumpJob> jobs;
+        jobs.swap(mPendingJobs);
+        uint32_t dropped = mDroppedCount - mReportedDropCount;
+        mReportedDropCount = mDroppedCount;
+        lock.unlock();
+
+        if (dropped > 0) {
+            LOGW("%u dumps dropped, consider a larger cameraDumpMaxMemory", dropped);
+        }
+        for (auto& job : jobs) {
+            writeFile(job);
+        }
+
+        lock.lock();
+        for (auto& job : jobs) {
+            mPendingBytes -= job.data.size();
+            if (mFreeBuffers.size() < kMaxFreeDumpBuffers) {
+                mFreeBuffers.push_back(std::move(job.data));
+            }
+        }
+    }
+    mIdleCondition.broadcast();
+
+    return !mExiting;
+}
 }  // namespace CameraDump
 
 }  // namespace icamera
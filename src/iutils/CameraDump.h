@@ -19,6 +19,7 @@
 #include <linux/v4l2-subdev.h>
 #include <string.h>
 
+#include <deque>
 #include <string>
 #include <vector>
 
@@ -149,7 +150,19 @@ void setDumpLevel(void);
 void setDumpThread(void);
 bool isDumpTypeEnable(int dumpType);
 bool isDumpFormatEnable(int dumpFormat);
+/**
+ * Queue the data to be written to fileName by the dump writer thread, the data is copied
+ * so it can be released once the function returns.
+ */
 void writeData(const void* data, int size, const char* fileName);
+/**
+ * Wait until all the queued dumps are written.
+ */
+void flushDumps(void);
+/**
+ * The number of dumps dropped since the pending dumps exceeded cameraDumpMaxMemory.
+ */
+uint32_t getDroppedDumpCount(void);
 const char* getDumpPath(void);
 /**
  * Dump image according to CameraBuffer properties
@@ -169,6 +182,44 @@ public:
     bool threadLoop();
 };
 
+/**
+ * DumpWriter writes the dump files on its own thread, so the pipeline threads never wait
+ * for the file system. The pending dumps are bounded by cameraDumpMaxMemory (in MB), a dump
+ * which doesn't fit is dropped and counted instead of stalling the caller.
+ * Like the DumpThread it's started once by setDumpLevel() and lives until the process exits.
+ */
+class DumpWriter : public Thread {
+public:
+    DumpWriter();
+    ~DumpWriter();
+
+    bool queueData(const void* data, int size, const char* fileName, size_t maxMemory);
+    void flush();
+    uint32_t getDroppedCount() const;
+
+    bool threadLoop();
+    void requestExit();
+
+private:
+    struct DumpJob {
+        std::string fileName;
+        std::vector<char> data;
+    };
+
+    std::vector<char> allocBuffer(size_t size);
+    void writeFile(const DumpJob& job);
+
+    mutable Mutex mLock;  // Guard the fields below
+    Condition mJobCondition;
+    Condition mIdleCondition;
+    std::deque<DumpJob> mPendingJobs;
+    std::vector<std::vector<char>> mFreeBuffers;  // Recycled to avoid page faults per dump
+    size_t mPendingBytes;  // Reserved by queueData() until the file is written
+    bool mExiting;
+    uint32_t mDroppedCount;
+    uint32_t mReportedDropCount;
+};
+
 }  // namespace CameraDump
 
 }  // namespace icamera
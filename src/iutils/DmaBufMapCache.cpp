@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG DmaBufMapCache
+
+#include "iutils/DmaBufMapCache.h"
+
+#include <errno.h>
+#include <linux/dma-buf.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <list>
+
+#include "iutils/CameraLog.h"
+#include "iutils/Errors.h"
+#include "iutils/Thread.h"
+#include "iutils/Utils.h"
+
+namespace icamera {
+namespace DmaBufMapCache {
+
+static const int kDefaultCacheSize = 32;
+static const int kDefaultCacheSizeMb = 256;
+
+struct Mapping {
+    dev_t dev;
+    ino_t ino;
+    unsigned int size;
+    int fd;  // Duplicated to end the CPU access and keep the key valid
+    void* addr;
+    int refCount;
+};
+
+static Mutex sLock;
+// The most recently used mapping is at the front
+static std::list<Mapping> sMappings;
+static uint64_t sCachedBytes = 0;
+static uint64_t sHits = 0;
+static uint64_t sMisses = 0;
+
+static int getCacheSize() {
+    static const int sCacheSize = [] {
+        const char* size = getenv("cameraDmaBufMapCacheSize");
+        return size ? static_cast<int>(strtol(size, nullptr, 0)) : kDefaultCacheSize;
+    }();
+    return sCacheSize;
+}
+
+// The cached mappings keep the dma buffers alive with the duplicated fds, so the memory held
+// by the cache is bounded too.
+static uint64_t getCacheBytes() {
+    static const uint64_t sCacheBytes = [] {
+        const char* size = getenv("cameraDmaBufMapCacheMb");
+        int sizeMb = size ? static_cast<int>(strtol(size, nullptr, 0)) : kDefaultCacheSizeMb;
+        return static_cast<uint64_t>(sizeMb > 0 ? sizeMb : 0) << 20;
+    }();
+    return sCacheBytes;
+}
+
+// Must be called with sLock
+static bool hasRoomLocked(unsigned int size) {
+    return sMappings.size() < static_cast<size_t>(getCacheSize()) &&
+           sCachedBytes + size <= getCacheBytes();
+}
+
+static void syncDmaBuf(int fd, uint64_t flags) {
+    struct dma_buf_sync sync = {flags | DMA_BUF_SYNC_RW};
+    if (::ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync) < 0) {
+        LOG2("%s: sync fd %d failed: %s", __func__, fd, strerror(errno));
+    }
+}
+
+static void releaseMapping(const Mapping& mapping) {
+    munmap(mapping.addr, mapping.size);
+    ::close(mapping.fd);
+    sCachedBytes -= mapping.size;
+}
+
+/**
+ * Unmap the least recently used mappings which aren't in use, until the cache has room for
+ * one more mapping of `size` bytes. Must be called with sLock.
+ */
+static void evictLocked(unsigned int size) {
+    auto it = sMappings.end();
+    while (it != sMappings.begin() && !hasRoomLocked(size)) {
+        --it;
+        if (it->refCount > 0) continue;
+
+        LOG2("%s: unmap %p, size %u", __func__, it->addr, it->size);
+        releaseMapping(*it);
+        it = sMappings.erase(it);
+    }
+}
+
+void* map(int fd, unsigned int size) {
+    CheckAndLogError(fd < 0 || !size, nullptr, "%s, fd:0x%x, size:%u", __func__, fd, size);
+
+    struct stat st;
+    if (getCacheSize() <= 0 || ::fstat(fd, &st) < 0) {
+        void* addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        return (addr == MAP_FAILED) ? nullptr : addr;
+    }
+
+    AutoMutex l(sLock);
+    for (auto it = sMappings.begin(); it != sMappings.end(); ++it) {
+        if (it->dev == st.st_dev && it->ino == st.st_ino && it->size == size) {
+            sHits++;
+            it->refCount++;
+            sMappings.splice(sMappings.begin(), sMappings, it);
+            syncDmaBuf(fd, DMA_BUF_SYNC_START);
+            return it->addr;
+        }
+    }
+
+    sMisses++;
+    void* addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    CheckAndLogError(addr == MAP_FAILED, nullptr, "%s, mmap fd %d failed: %s", __func__, fd,
+                     strerror(errno));
+
+    evictLocked(size);
+    int dupFd = hasRoomLocked(size) ? ::dup(fd) : -1;
+    if (dupFd < 0) {
+        // The mappings in use fill the cache, the address is unmapped directly by unmap().
+        LOG2("%s: cache is full, don't cache the mapping of fd %d", __func__, fd);
+        return addr;
+    }
+
+    Mapping mapping = {st.st_dev, st.st_ino, size, dupFd, addr, 1};
+    sMappings.push_front(mapping);
+    sCachedBytes += size;
+    syncDmaBuf(fd, DMA_BUF_SYNC_START);
+    return addr;
+}
+
+void unmap(void* addr, unsigned int size) {
+    CheckAndLogError(addr == nullptr || !size, VOID_VALUE, "%s, addr:%p, size:%u", __func__,
+                     addr, size);
+
+    {
+        AutoMutex l(sLock);
+        for (auto& mapping : sMappings) {
+            if (mapping.addr == addr) {
+                syncDmaBuf(mapping.fd, DMA_BUF_SYNC_END);
+                mapping.refCount--;
+                return;
+            }
+        }
+    }
+
+    munmap(addr, size);
+}
+
+void clear() {
+    AutoMutex l(sLock);
+    LOG1("%s: hits %lu, misses %lu, %zu mappings (%lu bytes) cached", __func__, sHits, sMisses,
+         sMappings.size(), sCachedBytes);
+
+    for (auto it = sMappings.begin(); it != sMappings.end();) {
+        if (it->refCount > 0) {
+            ++it;
+            continue;
+        }
+        releaseMapping(*it);
+        it = sMappings.erase(it);
+    }
+}
+
+void getStats(uint64_t* hits, uint64_t* misses) {
+    AutoMutex l(sLock);
+    if (hits) *hits = sHits;
+    if (misses) *misses = sMisses;
+}
+
+}  // namespace DmaBufMapCache
+}  // namespace icamera
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace icamera {
+
+/**
+ * DmaBufMapCache keeps the CPU mappings of the dma buffers alive across the accesses, so the
+ * buffers which are mapped every frame are only mmapped once.
+ *
+ * The mappings are keyed by the inode of the dma buffer and the mapping size, so the different
+ * fds of one buffer share the mapping. Every access is bracketed by DMA_BUF_IOCTL_SYNC instead
+ * of remapping. The least recently used mappings which aren't in use are unmapped when the
+ * cache is full, the cache size is set by cameraDmaBufMapCacheSize (the number of the
+ * mappings, 0 to disable the cache) and cameraDmaBufMapCacheMb (the total size of the
+ * mappings in MB, 256 by default).
+ */
+namespace DmaBufMapCache {
+
+/**
+ * Map the dma buffer for CPU access, return nullptr if it fails.
+ * The address MUST be released by unmap().
+ */
+void* map(int fd, unsigned int size);
+
+/**
+ * Finish the CPU access of the address returned by map().
+ */
+void unmap(void* addr, unsigned int size);
+
+/**
+ * Unmap all the mappings which aren't in use, and log the hit/miss statistics.
+ */
+void clear();
+
+void getStats(uint64_t* hits, uint64_t* misses);
+
+}  // namespace DmaBufMapCache
+
+}  // namespace icamera
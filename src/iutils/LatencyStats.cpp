@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG LatencyStats
+
+#include "iutils/LatencyStats.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+
+#include "PlatformData.h"
+#include "iutils/CameraLog.h"
+#include "iutils/Errors.h"
+#include "iutils/Thread.h"
+
+namespace icamera {
+namespace LatencyStats {
+
+static const int kMaxShards = 8;        // The recording threads share the shards beyond it
+static const int kMaxStreamSlots = 8;   // Including the slot of stream -1
+static const int kInvalidStreamId = INT_MIN;
+static const int64_t kDefaultLogInterval = 30;  // In seconds
+
+static const char* kStageName[LATENCY_STAGE_MAX] = {
+    "sof-isys", "sof-psys-task", "pg-iterate", "isp-adapt", "aiq-run", "request", "sensor-ctrl",
+    "frame-sync", "frame-sync-drop",
+};
+
+struct alignas(64) Shard {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> totalUs;
+    std::atomic<uint64_t> maxUs;
+    std::atomic<uint64_t> buckets[CAMERA_LATENCY_BUCKET_NUM];
+};
+
+struct Histogram {
+    Shard shards[kMaxShards];
+};
+
+struct CameraLatency {
+    std::atomic<int> streamIds[kMaxStreamSlots];
+    Histogram histograms[kMaxStreamSlots][LATENCY_STAGE_MAX];
+};
+
+// Allocated when the camera records the first sample, and never released
+static std::atomic<CameraLatency*> sCameraLatency[MAX_CAMERA_NUMBER];
+static std::atomic<int> sNextShard(0);
+
+static int64_t getLogInterval() {
+    static const int64_t sLogInterval = [] {
+        const char* interval = getenv("cameraLatencyLogInterval");
+        return interval ? static_cast<int64_t>(strtol(interval, nullptr, 0)) : kDefaultLogInterval;
+    }();
+    return sLogInterval;
+}
+
+static int getShardIndex() {
+    static thread_local int sShard = sNextShard.fetch_add(1, std::memory_order_relaxed) % kMaxShards;
+    return sShard;
+}
+
+static void logHistograms();
+
+/**
+ * Log the histograms periodically, so the recording threads never do it.
+ */
+class LogThread : public Thread {
+ public:
+    explicit LogThread(int64_t interval) : mInterval(interval) {}
+
+    bool threadLoop() {
+        sleep(mInterval);
+        logHistograms();
+        return true;
+    }
+
+ private:
+    int64_t mInterval;
+};
+
+static void startLogThread() {
+    int64_t interval = getLogInterval();
+    if (interval <= 0 || !Log::isDebugLevelEnable(CAMERA_DEBUG_LOG_LEVEL1)) return;
+
+    // Never stopped, like the dump thread, it only reads the counters
+    Thread* thread = new LogThread(interval);
+    thread->run("LatencyLog", PRIORITY_BACKGROUND);
+}
+
+static CameraLatency* getCameraLatency(int cameraId, bool create) {
+    CameraLatency* latency = sCameraLatency[cameraId].load(std::memory_order_acquire);
+    if (latency || !create) return latency;
+
+    CameraLatency* newLatency = new CameraLatency();
+    for (int i = 0; i < kMaxStreamSlots; i++) {
+        newLatency->streamIds[i].store(kInvalidStreamId, std::memory_order_relaxed);
+    }
+    if (!sCameraLatency[cameraId].compare_exchange_strong(latency, newLatency,
+                                                          std::memory_order_acq_rel)) {
+        // Another thread created it first
+        delete newLatency;
+        return latency;
+    }
+
+    static std::once_flag sLogThreadOnce;
+    std::call_once(sLogThreadOnce, startLogThread);
+    return newLatency;
+}
+
+static int getStreamSlot(CameraLatency* latency, int streamId) {
+    for (int i = 0; i < kMaxStreamSlots; i++) {
+        int id = latency->streamIds[i].load(std::memory_order_acquire);
+        if (id == streamId) return i;
+        if (id == kInvalidStreamId) {
+            if (latency->streamIds[i].compare_exchange_strong(id, streamId,
+                                                              std::memory_order_acq_rel) ||
+                id == streamId) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+static int getBucketIndex(uint64_t us) {
+    int index = 0;
+    uint64_t bound = CAMERA_LATENCY_BUCKET_BASE_US;
+    while (index < CAMERA_LATENCY_BUCKET_NUM - 1 && us >= bound) {
+        bound <<= 1;
+        index++;
+    }
+    return index;
+}
+
+static void collect(Histogram* histogram, bool reset, camera_latency_histogram_t* result) {
+    for (auto& shard : histogram->shards) {
+        if (reset) {
+            result->count += shard.count.exchange(0, std::memory_order_relaxed);
+            result->total_us += shard.totalUs.exchange(0, std::memory_order_relaxed);
+            result->max_us = std::max(result->max_us,
+                                      shard.maxUs.exchange(0, std::memory_order_relaxed));
+        } else {
+            result->count += shard.count.load(std::memory_order_relaxed);
+            result->total_us += shard.totalUs.load(std::memory_order_relaxed);
+            result->max_us = std::max(result->max_us, shard.maxUs.load(std::memory_order_relaxed));
+        }
+        for (int i = 0; i < CAMERA_LATENCY_BUCKET_NUM; i++) {
+            result->buckets[i] += reset ? shard.buckets[i].exchange(0, std::memory_order_relaxed)
+                                        : shard.buckets[i].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+static void logHistograms() {
+    camera_latency_histogram_t histograms[kMaxStreamSlots * LATENCY_STAGE_MAX];
+    for (int cameraId = 0; cameraId < MAX_CAMERA_NUMBER; cameraId++) {
+        int num = query(cameraId, histograms, ARRAY_SIZE(histograms), false);
+        for (int i = 0; i < num; i++) {
+            const camera_latency_histogram_t& h = histograms[i];
+            std::string buckets;
+            for (int j = 0; j < CAMERA_LATENCY_BUCKET_NUM; j++) {
+                buckets += " " + std::to_string(h.buckets[j]);
+            }
+            LOG1("<id%d>stream %d %s: count %lu, avg %lu us, max %lu us, buckets:%s", cameraId,
+                 h.stream_id, kStageName[h.stage], h.count, h.count ? h.total_us / h.count : 0,
+                 h.max_us, buckets.c_str());
+        }
+    }
+}
+
+void record(int cameraId, int streamId, camera_latency_stage_t stage, nsecs_t latency) {
+    if (cameraId < 0 || cameraId >= MAX_CAMERA_NUMBER || stage < 0 || stage >= LATENCY_STAGE_MAX)
+        return;
+
+    CameraLatency* cameraLatency = getCameraLatency(cameraId, true);
+    int slot = getStreamSlot(cameraLatency, streamId);
+    if (slot < 0) return;
+
+    uint64_t us = latency > 0 ? latency / 1000 : 0;
+    Shard& shard = cameraLatency->histograms[slot][stage].shards[getShardIndex()];
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+    shard.totalUs.fetch_add(us, std::memory_order_relaxed);
+    shard.buckets[getBucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t maxUs = shard.maxUs.load(std::memory_order_relaxed);
+    while (us > maxUs &&
+           !shard.maxUs.compare_exchange_weak(maxUs, us, std::memory_order_relaxed)) {
+    }
+}
+
+int query(int cameraId, camera_latency_histogram_t* histograms, int count, bool reset) {
+    CheckAndLogError(cameraId < 0 || cameraId >= MAX_CAMERA_NUMBER, BAD_VALUE,
+                     "invalid camera id %d", cameraId);
+    CheckAndLogError(!histograms || count < 0, BAD_VALUE, "invalid histograms");
+
+    CameraLatency* cameraLatency = getCameraLatency(cameraId, false);
+    if (!cameraLatency) return 0;
+
+    int num = 0;
+    for (int slot = 0; slot < kMaxStreamSlots && num < count; slot++) {
+        int streamId = cameraLatency->streamIds[slot].load(std::memory_order_acquire);
+        if (streamId == kInvalidStreamId) break;
+
+        for (int stage = 0; stage < LATENCY_STAGE_MAX && num < count; stage++) {
+            camera_latency_histogram_t& result = histograms[num];
+            CLEAR(result);
+            result.stage = stage;
+            result.stream_id = streamId;
+            collect(&cameraLatency->histograms[slot][stage], reset, &result);
+            if (result.count > 0) num++;
+        }
+    }
+
+    return num;
+}
+
+}  // namespace LatencyStats
+}  // namespace icamera
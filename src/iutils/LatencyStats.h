@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "ICamera.h"
+#include "iutils/Utils.h"
+
+namespace icamera {
+
+/**
+ * LatencyStats keeps the always-on latency histograms of the pipeline stages per camera and
+ * per stream.
+ *
+ * record() is lock free: every recording thread is bound to its own shard of the counters,
+ * and the shards are only summed up when the histograms are queried.
+ * The histograms are logged every cameraLatencyLogInterval seconds (0 to disable) by a
+ * background thread, which is only started at debug level 1.
+ */
+namespace LatencyStats {
+
+/**
+ * Add one latency sample, streamId is -1 if the stage isn't bound to a stream.
+ */
+void record(int cameraId, int streamId, camera_latency_stage_t stage, nsecs_t latency);
+
+/**
+ * Fill the non-empty histograms of the camera, return the number of them.
+ */
+int query(int cameraId, camera_latency_histogram_t* histograms, int count, bool reset);
+
+/**
+ * Record the time from its creation to its destruction.
+ */
+class ScopedLatency {
+ public:
+    ScopedLatency(int cameraId, int streamId, camera_latency_stage_t stage)
+            : mCameraId(cameraId),
+              mStreamId(streamId),
+              mStage(stage),
+              mStartTime(CameraUtils::systemTime()) {}
+    ~ScopedLatency() {
+        record(mCameraId, mStreamId, mStage, CameraUtils::systemTime() - mStartTime);
+    }
+
+ private:
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+    int mCameraId;
+    int mStreamId;
+    camera_latency_stage_t mStage;
+    nsecs_t mStartTime;
+};
+
+}  // namespace LatencyStats
+
+}  // namespace icamera
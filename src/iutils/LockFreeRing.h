@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace icamera {
+
+/**
+ * LockFreeRing is a bounded ring buffer with lock-free multi-producer push.
+ *
+ * Each cell carries a sequence number which tells whether it is free for the
+ * producer at the same position or ready for the consumer, so producers only
+ * contend on one atomic increment and never on a mutex.
+ *
+ * Consumer side (empty/front/pop) must be called by one thread at a time, the
+ * caller is responsible for serializing consumers.
+ * clear() must not run concurrently with any other operation.
+ */
+template <typename T>
+class LockFreeRing {
+ public:
+    static const size_t kDefaultCapacity = 64;
+
+    explicit LockFreeRing(size_t capacity = kDefaultCapacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+
+        mMask = size - 1;
+        mCells.reset(new Cell[size]);
+        reset();
+    }
+
+    /**
+     * Push one item, safe to be called from several threads concurrently.
+     *
+     * \return false if the ring is full.
+     */
+    bool push(const T& item) {
+        size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+        Cell* cell = nullptr;
+        while (true) {
+            cell = &mCells[pos & mMask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (dif == 0) {
+                if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->data = item;
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+        return mCells[pos & mMask].seq.load(std::memory_order_acquire) != pos + 1;
+    }
+
+    /**
+     * Peek the oldest item, the ring MUST NOT be empty.
+     */
+    T& front() { return mCells[mDequeuePos.load(std::memory_order_relaxed) & mMask].data; }
+
+    /**
+     * Remove the oldest item, the ring MUST NOT be empty.
+     */
+    void pop() {
+        size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+        Cell& cell = mCells[pos & mMask];
+        cell.data = T();
+        cell.seq.store(pos + mMask + 1, std::memory_order_release);
+        mDequeuePos.store(pos + 1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Approximate item count, exact only when there is no concurrent push.
+     */
+    size_t size() const {
+        return mEnqueuePos.load(std::memory_order_relaxed) -
+               mDequeuePos.load(std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return mMask + 1; }
+
+    void clear() {
+        for (size_t i = 0; i <= mMask; i++) mCells[i].data = T();
+        reset();
+    }
+
+ private:
+    LockFreeRing(const LockFreeRing&) = delete;
+    LockFreeRing& operator=(const LockFreeRing&) = delete;
+
+    void reset() {
+        for (size_t i = 0; i <= mMask; i++) mCells[i].seq.store(i, std::memory_order_relaxed);
+        mEnqueuePos.store(0, std::memory_order_relaxed);
+        mDequeuePos.store(0, std::memory_order_relaxed);
+    }
+
+    struct Cell {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> mCells;
+    size_t mMask;
+    // Producers and consumer live on different cache lines to avoid false sharing.
+    alignas(64) std::atomic<size_t> mEnqueuePos;
+    alignas(64) std::atomic<size_t> mDequeuePos;
+};
+
+}  // namespace icamera
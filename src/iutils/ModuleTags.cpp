@@ -73,14 +73,17 @@ const char* tagNames[] = {
     "CameraShm",
     "CameraStream",
     "Camera_PolicyManager",
+    "CaptureReactor",
     "CaptureUnit",
     "ColorConverter",
+    "CpuTNR",
     "CsiMetaDevice",
     "Customized3A",
     "CustomizedAic",
     "CvfPrivacyChecker",
     "DLCClient",
     "DeviceBase",
+    "DmaBufMapCache",
     "Dvs",
     "EXIFMaker",
     "EXIFMetaData",
@@ -116,6 +119,7 @@ const char* tagNames[] = {
     "IPCIntelPGParam",
     "IPC_FACE_DETECTION",
     "IPC_GRAPH_CONFIG",
+    "ImageKernels",
     "ImageProcessorCore",
     "ImageScalerCore",
     "Intel3AParameter",
@@ -146,6 +150,7 @@ const char* tagNames[] = {
     "IspParamAdaptor",
     "JpegEncoderCore",
     "JpegMaker",
+    "LatencyStats",
     "LensHw",
     "LensManager",
     "LiveTuning",
@@ -208,6 +213,8 @@ const char* tagNames[] = {
     "V4l2_subdevice_cc",
     "V4l2_video_node_cc",
     "VendorTags",
+    "VirtualIpu",
+    "WorkerPool",
     "camera_metadata_tests",
     "icamera_metadata_base",
     "metadata_test",
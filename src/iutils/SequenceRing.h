@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace icamera {
+
+/**
+ * SequenceRing keeps the latest kSize items written by one writer thread, each tagged with
+ * the sequence id it's published with, and lets any thread read them without lock.
+ *
+ * Every slot publishes its sequence id atomically after the item is filled, and a sequence id
+ * indexed table gives the slot of one sequence directly. The readers which hold an item for a
+ * while pin its slot with Ref, and the writer never recycles a pinned slot: when all the slots
+ * are pinned, the item is written into a spare slot which is never published, so it's dropped
+ * and the readers get the nearest older one.
+ *
+ * acquire()/pending()/publish()/get() are for the writer thread only, getRef() is for any
+ * thread.
+ */
+template <typename T, int kSize>
+class SequenceRing {
+ public:
+    /**
+     * \class Ref
+     *
+     * Keep one item pinned in the ring until it's destroyed or reassigned.
+     */
+    class Ref {
+     public:
+        Ref() : mReaders(nullptr), mItem(nullptr) {}
+        Ref(Ref&& other) : mReaders(other.mReaders), mItem(other.mItem) {
+            other.mReaders = nullptr;
+            other.mItem = nullptr;
+        }
+        Ref& operator=(Ref&& other) {
+            if (this != &other) {
+                release();
+                mReaders = other.mReaders;
+                mItem = other.mItem;
+                other.mReaders = nullptr;
+                other.mItem = nullptr;
+            }
+            return *this;
+        }
+        ~Ref() { release(); }
+
+        const T* get() const { return mItem; }
+        const T* operator->() const { return mItem; }
+        explicit operator bool() const { return mItem != nullptr; }
+
+     private:
+        friend class SequenceRing;
+        Ref(std::atomic<int>* readers, const T* item) : mReaders(readers), mItem(item) {}
+        Ref(const Ref&) = delete;
+        Ref& operator=(const Ref&) = delete;
+
+        void release() {
+            if (mReaders) mReaders->fetch_sub(1, std::memory_order_release);
+            mReaders = nullptr;
+            mItem = nullptr;
+        }
+
+        std::atomic<int>* mReaders;
+        const T* mItem;
+    };
+
+    // The index of the spare slot, which is used when all the others are pinned
+    static const int kSpareIndex = kSize;
+
+    /**
+     * \param create: creates one item, it's called kSize + 1 times and the items are owned by
+     *                the ring.
+     */
+    template <typename Creator>
+    explicit SequenceRing(Creator create) : mCurrentIndex(-1), mAcquiredIndex(-1) {
+        for (int i = 0; i <= kSize; i++) mItems[i] = create();
+        for (int i = 0; i < kSize; i++) {
+            mSequences[i].store(-1, std::memory_order_relaxed);
+            mReaders[i].store(0, std::memory_order_relaxed);
+            mSequenceToIndex[i].store(-1, std::memory_order_relaxed);
+        }
+    }
+
+    ~SequenceRing() {
+        for (int i = 0; i <= kSize; i++) delete mItems[i];
+    }
+
+    /**
+     * Get the item to be written for the next sequence id, it's unpublished until publish().
+     */
+    T* acquire() {
+        int index = (mCurrentIndex.load(std::memory_order_relaxed) + 1) % kSize;
+
+        for (int i = 0; i < kSize; i++) {
+            // Unpublish the slot before checking its readers, then a reader either sees the
+            // slot pinned by itself or fails to validate the sequence id.
+            int64_t sequence = mSequences[index].exchange(-1);
+            if (mReaders[index].load() == 0) break;
+
+            // The slot is pinned, keep its item and try the next one.
+            mSequences[index].store(sequence);
+            if (i == kSize - 1) {
+                index = kSpareIndex;
+                break;
+            }
+            index = (index + 1) % kSize;
+        }
+
+        mAcquiredIndex = index;
+        return mItems[index];
+    }
+
+    // The item acquired and not published yet, acquire one if there isn't
+    T* pending() {
+        if (mAcquiredIndex < 0) acquire();
+        return mItems[mAcquiredIndex];
+    }
+
+    /**
+     * Publish the pending item with the sequence id.
+     *
+     * \return false if it's dropped since all the slots were pinned when it was acquired.
+     */
+    bool publish(int64_t sequence) {
+        int index = mAcquiredIndex;
+        if (index < 0) {
+            pending();
+            index = mAcquiredIndex;
+        }
+        mAcquiredIndex = -1;
+        if (index == kSpareIndex) return false;
+
+        mSequences[index].store(sequence, std::memory_order_release);
+        if (sequence >= 0) {
+            mSequenceToIndex[sequence % kSize].store(index, std::memory_order_release);
+        }
+        mCurrentIndex.store(index, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Get the item of the sequence id without pinning it, only for the writer thread since
+     * the item may be overwritten by the next acquire().
+     *
+     * Sequence id -1 means the latest one, and the nearest older item is returned if the
+     * sequence id isn't found.
+     */
+    T* get(int64_t sequence = -1) const {
+        int index = find(sequence);
+        return (index < 0) ? nullptr : mItems[index];
+    }
+
+    /**
+     * Get the item like get(), and pin it in the ring until the returned Ref is released.
+     */
+    Ref getRef(int64_t sequence = -1) {
+        for (int i = 0; i < kSize; i++) {
+            int index = find(sequence);
+            if (index < 0) break;
+
+            int64_t itemSequence = mSequences[index].load();
+            mReaders[index].fetch_add(1);
+            // Validate the slot after pinning it, it may be recycled by the writer in between.
+            if (mSequences[index].load() == itemSequence &&
+                (itemSequence >= 0 || mCurrentIndex.load() == -1)) {
+                return Ref(&mReaders[index], mItems[index]);
+            }
+            mReaders[index].fetch_sub(1);
+        }
+
+        return Ref();
+    }
+
+ private:
+    SequenceRing(const SequenceRing&) = delete;
+    SequenceRing& operator=(const SequenceRing&) = delete;
+
+    /**
+     * Return the slot of the item with the given sequence id, or the nearest older one.
+     * For sequence id -1, return the latest one.
+     */
+    int find(int64_t sequence) const {
+        int current = mCurrentIndex.load(std::memory_order_acquire);
+        // Sequence id -1 means the latest one. If nothing is published yet, just return the
+        // first one in this case.
+        if (sequence == -1) return (current == -1) ? 0 : current;
+        if (sequence < 0) return -1;
+
+        int index = mSequenceToIndex[sequence % kSize].load(std::memory_order_acquire);
+        if (index >= 0 && mSequences[index].load(std::memory_order_acquire) == sequence) {
+            return index;
+        }
+
+        // The sequence id is skipped or isn't ready yet, search the nearest older item. The
+        // slots aren't in order since the pinned ones are skipped, so check all of them.
+        index = -1;
+        int64_t nearest = -1;
+        for (int i = 0; i < kSize; i++) {
+            int64_t tmpSequence = mSequences[i].load(std::memory_order_acquire);
+            if (tmpSequence > nearest && tmpSequence <= sequence) {
+                nearest = tmpSequence;
+                index = i;
+            }
+        }
+
+        return index;
+    }
+
+    std::atomic<int> mCurrentIndex;
+    int mAcquiredIndex;  // Only used by the writer
+    T* mItems[kSize + 1];
+    // The published sequence id of each slot, -1 if the slot is being written
+    std::atomic<int64_t> mSequences[kSize];
+    // The number of Ref which pin each slot
+    std::atomic<int> mReaders[kSize];
+    // The slot of the latest sequence id which is equal to the index modulo kSize
+    std::atomic<int> mSequenceToIndex[kSize];
+};
+
+}  // namespace icamera
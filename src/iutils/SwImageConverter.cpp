@@ -18,9 +18,14 @@
 
 #include "SwImageConverter.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "CameraLog.h"
 #include "Errors.h"
 #include "Utils.h"
+#include "WorkerPool.h"
+#include "image_process/ImageKernels.h"
 
 namespace icamera {
 
@@ -180,28 +185,28 @@ void SwImageConverter::convertBayerBlock(unsigned int x, unsigned int y, unsigne
             out_buf[(y + 1) * dstStride + x + 1] = (R >> 2);
             break;
         case V4L2_PIX_FMT_SRGGB10:
-            *((unsigned short*)out_buf + y * dstStride + x) = R;
-            *((unsigned short*)out_buf + y * dstStride + x + 1) = Gr;
-            *((unsigned short*)out_buf + (y + 1) * dstStride + x) = Gb;
-            *((unsigned short*)out_buf + (y + 1) * dstStride + x + 1) = B;
+            *((unsigned short*)out_buf + y * (dstStride / 2) + x) = R;
+            *((unsigned short*)out_buf + y * (dstStride / 2) + x + 1) = Gr;
+            *((unsigned short*)out_buf + (y + 1) * (dstStride / 2) + x) = Gb;
+            *((unsigned short*)out_buf + (y + 1) * (dstStride / 2) + x + 1) = B;
             break;
         case V4L2_PIX_FMT_SGRBG10:
-            *((unsigned short*)out_buf + y * dstStride + x) = Gr;
-            *((unsigned short*)out_buf + y * dstStride + x + 1) = R;
-            *((unsigned short*)out_buf + (y + 1) * dstStride + x) = B;
-            *((unsigned short*)out_buf + (y + 1) * dstStride + x + 1) = Gb;
+            *((unsigned short*)out_buf + y * (dstStride / 2) + x) = Gr;
+            *((unsigned short*)out_buf + y * (dstStride / 2) + x + 1) = R;
+            *((unsigned short*)out_buf + (y + 1) * (dstStride / 2) + x) = B;
+            *((unsigned short*)out_buf + (y + 1) * (dstStride / 2) + x + 1) = Gb;
             break;
         case V4L2_PIX_FMT_SGBRG10:
-            *((unsigned short*)out_buf + y * dstStride + x) = Gb;
-            *((unsigned short*)out_buf + y * dstStride + x + 1) = B;
-            *((unsigned short*)out_buf + (y + 1) * dstStride + x) = R;
-            *((unsigned short*)out_buf + (y + 1) * dstStride + x + 1) = Gr;
+            *((unsigned short*)out_buf + y * (dstStride / 2) + x) = Gb;
+            *((unsigned short*)out_buf + y * (dstStride / 2) + x + 1) = B;
+            *((unsigned short*)out_buf + (y + 1) * (dstStride / 2) + x) = R;
+            *((unsigned short*)out_buf + (y + 1) * (dstStride / 2) + x + 1) = Gr;
             break;
         case V4L2_PIX_FMT_SBGGR10:
-            *((unsigned short*)out_buf + y * dstStride + x) = B;
-            *((unsigned short*)out_buf + y * dstStride + x + 1) = Gb;
-            *((unsigned short*)out_buf + (y + 1) * dstStride + x) = Gr;
-            *((unsigned short*)out_buf + (y + 1) * dstStride + x + 1) = R;
+            *((unsigned short*)out_buf + y * (dstStride / 2) + x) = B;
+            *((unsigned short*)out_buf + y * (dstStride / 2) + x + 1) = Gb;
+            *((unsigned short*)out_buf + (y + 1) * (dstStride / 2) + x) = Gr;
+            *((unsigned short*)out_buf + (y + 1) * (dstStride / 2) + x + 1) = R;
             break;
         case V4L2_PIX_FMT_NV12:
             Ybase = out_buf;
@@ -383,37 +388,374 @@ void SwImageConverter::convertYuvBlock(unsigned int x, unsigned int y, unsigned
             break;
         case V4L2_PIX_FMT_SRGGB10:
             YUV2RGB(Y[0], U[0], V[0], &R, &G, &B);
-            *((unsigned short*)out_buf + y * dstStride + x) = R;
-            *((unsigned short*)out_buf + y * dstStride + x + 1) = G;
-            *((unsigned short*)out_buf + (y + 1) * dstStride + x) = G;
-            *((unsigned short*)out_buf + (y + 1) * dstStride + x + 1) = B;
+            *((unsigned short*)out_buf + y * (dstStride / 2) + x) = R;
+            *((unsigned short*)out_buf + y * (dstStride / 2) + x + 1) = G;
+            *((unsigned short*)out_buf + (y + 1) * (dstStride / 2) + x) = G;
+            *((unsigned short*)out_buf + (y + 1) * (dstStride / 2) + x + 1) = B;
             break;
         case V4L2_PIX_FMT_SGRBG10:
             YUV2RGB(Y[0], U[0], V[0], &R, &G, &B);
-            *((unsigned short*)out_buf + y * dstStride + x) = G;
-            *((unsigned short*)out_buf + y * dstStride + x + 1) = R;
-            *((unsigned short*)out_buf + (y + 1) * dstStride + x) = B;
-            *((unsigned short*)out_buf + (y + 1) * dstStride + x + 1) = G;
+            *((unsigned short*)out_buf + y * (dstStride / 2) + x) = G;
+            *((unsigned short*)out_buf + y * (dstStride / 2) + x + 1) = R;
+            *((unsigned short*)out_buf + (y + 1) * (dstStride / 2) + x) = B;
+            *((unsigned short*)out_buf + (y + 1) * (dstStride / 2) + x + 1) = G;
             break;
         case V4L2_PIX_FMT_SGBRG10:
             YUV2RGB(Y[0], U[0], V[0], &R, &G, &B);
-            *((unsigned short*)out_buf + y * dstStride + x) = G;
-            *((unsigned short*)out_buf + y * dstStride + x + 1) = B;
-            *((unsigned short*)out_buf + (y + 1) * dstStride + x) = R;
-            *((unsigned short*)out_buf + (y + 1) * dstStride + x + 1) = G;
+            *((unsigned short*)out_buf + y * (dstStride / 2) + x) = G;
+            *((unsigned short*)out_buf + y * (dstStride / 2) + x + 1) = B;
+            *((unsigned short*)out_buf + (y + 1) * (dstStride / 2) + x) = R;
+            *((unsigned short*)out_buf + (y + 1) * (dstStride / 2) + x + 1) = G;
             break;
         case V4L2_PIX_FMT_SBGGR10:
             YUV2RGB(Y[0], U[0], V[0], &R, &G, &B);
-            *((unsigned short*)out_buf + y * dstStride + x) = B;
-            *((unsigned short*)out_buf + y * dstStride + x + 1) = G;
-            *((unsigned short*)out_buf + (y + 1) * dstStride + x) = G;
-            *((unsigned short*)out_buf + (y + 1) * dstStride + x + 1) = R;
+            *((unsigned short*)out_buf + y * (dstStride / 2) + x) = B;
+            *((unsigned short*)out_buf + y * (dstStride / 2) + x + 1) = G;
+            *((unsigned short*)out_buf + (y + 1) * (dstStride / 2) + x) = G;
+            *((unsigned short*)out_buf + (y + 1) * (dstStride / 2) + x + 1) = R;
             break;
         default:
             return;
     }
 }
 
+/*
+ * convertFormat() converts one row of 2x2 blocks at a time: the source blocks are loaded into
+ * planar arrays, converted between RGB and YUV by the row kernels and stored in the destination
+ * layout. All format decisions are made once per call, and the rows are split into bands which
+ * run on the shared worker pool.
+ */
+namespace {
+
+// Bands smaller than this aren't worth a worker
+const unsigned int kMinLinePairsPerBand = 16;
+
+enum BlockKind {
+    BLOCK_NONE = 0,
+    BLOCK_BAYER8,
+    BLOCK_BAYER10,
+    BLOCK_BAYER12,
+    BLOCK_NV12,
+    BLOCK_UYVY,
+    BLOCK_YUYV,
+    BLOCK_YUV420,
+};
+
+// Color positions in a 2x2 bayer block
+enum { COLOR_R = 0, COLOR_GR, COLOR_GB, COLOR_B, COLOR_NUM };
+
+struct BlockFormat {
+    BlockKind kind;
+    int pos[COLOR_NUM];  // Position (0..3) of each color in a bayer block
+};
+
+struct ConvertContext {
+    unsigned int width;
+    unsigned int height;
+    const unsigned char* inBuf;
+    unsigned char* outBuf;
+    int srcStride;
+    int dstStride;
+    BlockFormat src;
+    BlockFormat dst;
+};
+
+// Planar values of one row of 2x2 blocks
+struct BlockRow {
+    std::vector<uint16_t> rgb[COLOR_NUM];  // 10 bits, Gr == Gb when converted from YUV
+    std::vector<uint8_t> y[4];             // Y of the 4 pixels
+    std::vector<uint8_t> u[2];             // U of the top and bottom line
+    std::vector<uint8_t> v[2];             // V of the top and bottom line
+
+    explicit BlockRow(int blocks) {
+        for (auto& plane : rgb) plane.resize(blocks);
+        for (auto& plane : y) plane.resize(blocks);
+        for (auto& plane : u) plane.resize(blocks);
+        for (auto& plane : v) plane.resize(blocks);
+    }
+};
+
+bool isBayer(BlockKind kind) {
+    return kind == BLOCK_BAYER8 || kind == BLOCK_BAYER10 || kind == BLOCK_BAYER12;
+}
+
+BlockFormat getBlockFormat(unsigned int fmt) {
+    static const int kRggb[COLOR_NUM] = {0, 1, 2, 3};
+    static const int kGrbg[COLOR_NUM] = {1, 0, 3, 2};
+    static const int kGbrg[COLOR_NUM] = {2, 3, 0, 1};
+    static const int kBggr[COLOR_NUM] = {3, 2, 1, 0};
+
+    BlockFormat format = {BLOCK_NONE, {0, 1, 2, 3}};
+    const int* pos = nullptr;
+    switch (fmt) {
+        case V4L2_PIX_FMT_SRGGB8:
+            format.kind = BLOCK_BAYER8;
+            pos = kRggb;
+            break;
+        case V4L2_PIX_FMT_SGRBG8:
+            format.kind = BLOCK_BAYER8;
+            pos = kGrbg;
+            break;
+        case V4L2_PIX_FMT_SGBRG8:
+            format.kind = BLOCK_BAYER8;
+            pos = kGbrg;
+            break;
+        case V4L2_PIX_FMT_SBGGR8:
+            format.kind = BLOCK_BAYER8;
+            pos = kBggr;
+            break;
+        case V4L2_PIX_FMT_SRGGB10:
+            format.kind = BLOCK_BAYER10;
+            pos = kRggb;
+            break;
+        case V4L2_PIX_FMT_SGRBG10:
+            format.kind = BLOCK_BAYER10;
+            pos = kGrbg;
+            break;
+        case V4L2_PIX_FMT_SGBRG10:
+            format.kind = BLOCK_BAYER10;
+            pos = kGbrg;
+            break;
+        case V4L2_PIX_FMT_SBGGR10:
+            format.kind = BLOCK_BAYER10;
+            pos = kBggr;
+            break;
+        case V4L2_PIX_FMT_SRGGB12:
+            format.kind = BLOCK_BAYER12;
+            pos = kRggb;
+            break;
+        case V4L2_PIX_FMT_SGRBG12:
+            format.kind = BLOCK_BAYER12;
+            pos = kGrbg;
+            break;
+        case V4L2_PIX_FMT_SGBRG12:
+            format.kind = BLOCK_BAYER12;
+            pos = kGbrg;
+            break;
+        case V4L2_PIX_FMT_SBGGR12:
+            format.kind = BLOCK_BAYER12;
+            pos = kBggr;
+            break;
+        case V4L2_PIX_FMT_NV12:
+            format.kind = BLOCK_NV12;
+            break;
+        case V4L2_PIX_FMT_UYVY:
+            format.kind = BLOCK_UYVY;
+            break;
+        case V4L2_PIX_FMT_YUYV:
+            format.kind = BLOCK_YUYV;
+            break;
+        case V4L2_PIX_FMT_YUV420:
+            format.kind = BLOCK_YUV420;
+            break;
+        default:
+            break;
+    }
+    if (pos) {
+        for (int i = 0; i < COLOR_NUM; i++) format.pos[i] = pos[i];
+    }
+
+    return format;
+}
+
+// Load the blocks of the line pair starting at y
+void loadBlockRow(const ConvertContext& ctx, unsigned int y, int blocks, BlockRow* row) {
+    const unsigned char* in = ctx.inBuf;
+    const int stride = ctx.srcStride;
+
+    switch (ctx.src.kind) {
+        case BLOCK_BAYER8:
+        case BLOCK_BAYER10:
+        case BLOCK_BAYER12: {
+            uint16_t* dst[4];
+            for (int c = 0; c < COLOR_NUM; c++) dst[ctx.src.pos[c]] = row->rgb[c].data();
+
+            if (ctx.src.kind == BLOCK_BAYER8) {
+                const unsigned char* line0 = in + y * stride;
+                const unsigned char* line1 = line0 + stride;
+                for (int i = 0; i < blocks; i++) {
+                    dst[0][i] = line0[i * 2] << 2;
+                    dst[1][i] = line0[i * 2 + 1] << 2;
+                    dst[2][i] = line1[i * 2] << 2;
+                    dst[3][i] = line1[i * 2 + 1] << 2;
+                }
+            } else {
+                // Normalize to 10 bits
+                const int shift = (ctx.src.kind == BLOCK_BAYER12) ? 2 : 0;
+                const unsigned short* line0 = reinterpret_cast<const unsigned short*>(in) +
+                                              y * (stride / 2);
+                const unsigned short* line1 = line0 + stride / 2;
+                for (int i = 0; i < blocks; i++) {
+                    dst[0][i] = line0[i * 2] >> shift;
+                    dst[1][i] = line0[i * 2 + 1] >> shift;
+                    dst[2][i] = line1[i * 2] >> shift;
+                    dst[3][i] = line1[i * 2 + 1] >> shift;
+                }
+            }
+            break;
+        }
+        case BLOCK_NV12: {
+            const unsigned char* line0 = in + y * stride;
+            const unsigned char* line1 = line0 + stride;
+            const unsigned char* uv = in + stride * ctx.height + y / 2 * stride;
+            for (int i = 0; i < blocks; i++) {
+                row->y[0][i] = line0[i * 2];
+                row->y[1][i] = line0[i * 2 + 1];
+                row->y[2][i] = line1[i * 2];
+                row->y[3][i] = line1[i * 2 + 1];
+                row->u[0][i] = row->u[1][i] = uv[i * 2];
+                row->v[0][i] = row->v[1][i] = uv[i * 2 + 1];
+            }
+            break;
+        }
+        case BLOCK_UYVY:
+        case BLOCK_YUYV: {
+            // Byte offsets of Y0, U, Y1, V in a macro pixel
+            const int yOff = (ctx.src.kind == BLOCK_UYVY) ? 1 : 0;
+            const int uOff = (ctx.src.kind == BLOCK_UYVY) ? 0 : 1;
+            const unsigned char* line[2] = {in + y * stride, in + (y + 1) * stride};
+            for (int l = 0; l < 2; l++) {
+                for (int i = 0; i < blocks; i++) {
+                    const unsigned char* pixel = line[l] + i * 4;
+                    row->y[l * 2][i] = pixel[yOff];
+                    row->y[l * 2 + 1][i] = pixel[yOff + 2];
+                    row->u[l][i] = pixel[uOff];
+                    row->v[l][i] = pixel[uOff + 2];
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Store the blocks of the line pair starting at y, the planes are shared by all the pixels of
+// a block when converted from another color space.
+void storeBlockRow(const ConvertContext& ctx, unsigned int y, int blocks,
+                   const uint16_t* const rgb[COLOR_NUM], const uint8_t* const yp[4],
+                   const uint8_t* const up[2], const uint8_t* const vp[2]) {
+    unsigned char* out = ctx.outBuf;
+    const int stride = ctx.dstStride;
+
+    switch (ctx.dst.kind) {
+        case BLOCK_BAYER8:
+        case BLOCK_BAYER10: {
+            const uint16_t* src[4];
+            for (int c = 0; c < COLOR_NUM; c++) src[ctx.dst.pos[c]] = rgb[c];
+
+            if (ctx.dst.kind == BLOCK_BAYER8) {
+                unsigned char* line0 = out + y * stride;
+                unsigned char* line1 = line0 + stride;
+                for (int i = 0; i < blocks; i++) {
+                    line0[i * 2] = src[0][i] >> 2;
+                    line0[i * 2 + 1] = src[1][i] >> 2;
+                    line1[i * 2] = src[2][i] >> 2;
+                    line1[i * 2 + 1] = src[3][i] >> 2;
+                }
+            } else {
+                unsigned short* line0 = reinterpret_cast<unsigned short*>(out) + y * (stride / 2);
+                unsigned short* line1 = line0 + stride / 2;
+                for (int i = 0; i < blocks; i++) {
+                    line0[i * 2] = src[0][i];
+                    line0[i * 2 + 1] = src[1][i];
+                    line1[i * 2] = src[2][i];
+                    line1[i * 2 + 1] = src[3][i];
+                }
+            }
+            break;
+        }
+        case BLOCK_NV12: {
+            unsigned char* line0 = out + y * stride;
+            unsigned char* line1 = line0 + stride;
+            unsigned char* uv = out + stride * ctx.height + y / 2 * stride;
+            for (int i = 0; i < blocks; i++) {
+                line0[i * 2] = yp[0][i];
+                line0[i * 2 + 1] = yp[1][i];
+                line1[i * 2] = yp[2][i];
+                line1[i * 2 + 1] = yp[3][i];
+                uv[i * 2] = up[0][i];
+                uv[i * 2 + 1] = vp[0][i];
+            }
+            break;
+        }
+        case BLOCK_UYVY:
+        case BLOCK_YUYV: {
+            const int yOff = (ctx.dst.kind == BLOCK_UYVY) ? 1 : 0;
+            const int uOff = (ctx.dst.kind == BLOCK_UYVY) ? 0 : 1;
+            unsigned char* line[2] = {out + y * stride, out + (y + 1) * stride};
+            for (int l = 0; l < 2; l++) {
+                for (int i = 0; i < blocks; i++) {
+                    unsigned char* pixel = line[l] + i * 4;
+                    pixel[yOff] = yp[l * 2][i];
+                    pixel[yOff + 2] = yp[l * 2 + 1][i];
+                    pixel[uOff] = up[l][i];
+                    pixel[uOff + 2] = vp[l][i];
+                }
+            }
+            break;
+        }
+        case BLOCK_YUV420: {
+            unsigned char* line0 = out + y * stride;
+            unsigned char* line1 = line0 + stride;
+            // Two chroma lines are packed in one stride
+            int cOffset = y / 4 * stride + ((y % 4 == 0) ? 0 : ctx.width / 2);
+            unsigned char* uBase = out + stride * ctx.height + cOffset;
+            unsigned char* vBase = out + stride * (ctx.height + ctx.height / 4) + cOffset;
+            for (int i = 0; i < blocks; i++) {
+                line0[i * 2] = yp[0][i];
+                line0[i * 2 + 1] = yp[1][i];
+                line1[i * 2] = yp[2][i];
+                line1[i * 2 + 1] = yp[3][i];
+                uBase[i] = (up[0][i] + up[1][i]) / 2;
+                vBase[i] = (vp[0][i] + vp[1][i]) / 2;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Convert the line pairs [firstPair, endPair)
+void convertBand(const ConvertContext& ctx, unsigned int firstPair, unsigned int endPair) {
+    const int blocks = (ctx.width + 1) / 2;
+    BlockRow row(blocks);
+    const bool srcBayer = isBayer(ctx.src.kind);
+    const bool dstBayer = isBayer(ctx.dst.kind);
+
+    const ImageKernels& kernels = getImageKernels();
+
+    // Select the planes once, they are shared by the pixels of a block after conversion
+    const uint16_t* rgb[COLOR_NUM];
+    const uint8_t* yp[4];
+    const uint8_t* up[2];
+    const uint8_t* vp[2];
+    for (int c = 0; c < COLOR_NUM; c++) rgb[c] = row.rgb[c].data();
+    for (int i = 0; i < 4; i++) yp[i] = row.y[srcBayer ? 0 : i].data();
+    for (int i = 0; i < 2; i++) {
+        up[i] = row.u[srcBayer ? 0 : i].data();
+        vp[i] = row.v[srcBayer ? 0 : i].data();
+    }
+    if (!srcBayer) rgb[COLOR_GB] = rgb[COLOR_GR];
+
+    for (unsigned int pair = firstPair; pair < endPair; pair++) {
+        unsigned int y = pair * 2;
+        loadBlockRow(ctx, y, blocks, &row);
+        if (srcBayer && !dstBayer) {
+            kernels.rgbToYuvRow(rgb[COLOR_R], rgb[COLOR_GR], rgb[COLOR_GB], rgb[COLOR_B],
+                                row.y[0].data(), row.u[0].data(), row.v[0].data(), blocks);
+        } else if (!srcBayer && dstBayer) {
+            kernels.yuvToRgbRow(row.y[0].data(), row.u[0].data(), row.v[0].data(),
+                                row.rgb[COLOR_R].data(), row.rgb[COLOR_GR].data(),
+                                row.rgb[COLOR_B].data(), blocks);
+        }
+        storeBlockRow(ctx, y, blocks, rgb, yp, up, vp);
+    }
+}
+
+}  // namespace
+
 int SwImageConverter::convertFormat(unsigned int width, unsigned int height, unsigned char* inBuf,
                                     unsigned int inLength, unsigned int srcFmt,
                                     unsigned char* outBuf, unsigned int outLength,
@@ -421,9 +763,6 @@ int SwImageConverter::convertFormat(unsigned int width, unsigned int height, uns
     CheckAndLogError((inBuf == nullptr || outBuf == nullptr), BAD_VALUE,
                      "Invalid input(%p) or output buffer(%p)", inBuf, outBuf);
 
-    unsigned int x, y;
-    unsigned short bayer_data[4];
-
     LOG2("%s srcFmt %s => dstFmt %s %dx%d", __func__, CameraUtils::format2string(srcFmt).c_str(),
          CameraUtils::format2string(dstFmt).c_str(), width, height);
 
@@ -435,28 +774,32 @@ int SwImageConverter::convertFormat(unsigned int width, unsigned int height, uns
     }
 
     // for not vector raw
-    int srcStride = CameraUtils::getStride(srcFmt, width);
-    for (y = 0; y < height; y += 2) {
-        for (x = 0; x < width; x += 2) {
-            if (CameraUtils::isRaw(srcFmt)) {
-                if (CameraUtils::getBpp(srcFmt) == 8) {
-                    bayer_data[0] = inBuf[y * srcStride + x];
-                    bayer_data[1] = inBuf[y * srcStride + x + 1];
-                    bayer_data[2] = inBuf[(y + 1) * srcStride + x];
-                    bayer_data[3] = inBuf[(y + 1) * srcStride + x + 1];
-                } else {
-                    int offset = srcStride / (CameraUtils::getBpp(srcFmt) / 8);
-                    bayer_data[0] = *((unsigned short*)inBuf + y * offset + x);
-                    bayer_data[1] = *((unsigned short*)inBuf + y * offset + x + 1);
-                    bayer_data[2] = *((unsigned short*)inBuf + (y + 1) * offset + x);
-                    bayer_data[3] = *((unsigned short*)inBuf + (y + 1) * offset + x + 1);
-                }
-                convertBayerBlock(x, y, width, height, bayer_data, outBuf, srcFmt, dstFmt);
-            } else {
-                convertYuvBlock(x, y, width, height, inBuf, outBuf, srcFmt, dstFmt);
-            }
-        }
+    ConvertContext ctx;
+    ctx.width = width;
+    ctx.height = height;
+    ctx.inBuf = inBuf;
+    ctx.outBuf = outBuf;
+    ctx.src = getBlockFormat(srcFmt);
+    ctx.dst = getBlockFormat(dstFmt);
+    if (ctx.src.kind == BLOCK_NONE || ctx.src.kind == BLOCK_YUV420 ||
+        ctx.dst.kind == BLOCK_NONE || ctx.dst.kind == BLOCK_BAYER12) {
+        LOGW("%s: conversion from %s to %s isn't supported", __func__,
+             CameraUtils::format2string(srcFmt).c_str(), CameraUtils::format2string(dstFmt).c_str());
+        return 0;
     }
+    ctx.srcStride = CameraUtils::getStride(srcFmt, width);
+    ctx.dstStride = CameraUtils::getStride(dstFmt, width);
+
+    // Split the line pairs into bands for the shared workers
+    const unsigned int pairs = (height + 1) / 2;
+    WorkerPool* pool = WorkerPool::getSharedPool();
+    const unsigned int bands =
+        std::max(1U, std::min(static_cast<unsigned int>(pool->getConcurrency()),
+                              pairs / kMinLinePairsPerBand));
+    pool->parallelFor(bands, [&ctx, pairs, bands](int band) {
+        convertBand(ctx, pairs * band / bands, pairs * (band + 1) / bands);
+    });
+
     return 0;
 }
 
@@ -18,6 +18,12 @@
 
 #include "Thread.h"
 
+#include <errno.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
 #include "CameraLog.h"
 #include "Errors.h"
 
@@ -28,6 +34,29 @@ int Condition::waitRelative(ConditionLock& lock, int64_t reltime) {
     return ret == std::cv_status::timeout ? TIMED_OUT : OK;
 }
 
+int FutexSignal::waitRelative(ConditionLock& lock, uint32_t key, int64_t reltime) {
+    struct timespec ts = {static_cast<time_t>(reltime / 1000000000LL),
+                          static_cast<long>(reltime % 1000000000LL)};
+
+    mWaiters.fetch_add(1, std::memory_order_seq_cst);
+    lock.unlock();
+    long ret = syscall(SYS_futex, reinterpret_cast<uint32_t*>(&mSeq), FUTEX_WAIT_PRIVATE, key,
+                       &ts, nullptr, 0);
+    int err = (ret < 0) ? errno : 0;
+    lock.lock();
+    mWaiters.fetch_sub(1, std::memory_order_seq_cst);
+
+    return err == ETIMEDOUT ? TIMED_OUT : OK;
+}
+
+void FutexSignal::wake(int count) {
+    mSeq.fetch_add(1, std::memory_order_seq_cst);
+    if (mWaiters.load(std::memory_order_seq_cst) > 0) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&mSeq), FUTEX_WAKE_PRIVATE, count,
+                nullptr, nullptr, 0);
+    }
+}
+
 Thread::Thread() : mState(NOT_STARTED), mThread(nullptr), mPriority(PRIORITY_DEFAULT) {}
 
 Thread::~Thread() {
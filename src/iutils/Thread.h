@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -81,6 +83,52 @@ class Condition {
     std::condition_variable mCondition;
 };
 
+/**
+ * FutexSignal is an event count backed by a futex word.
+ *
+ * Unlike Condition, signal() doesn't need the waiter's mutex to be held, so lock-free
+ * producers can wake up a consumer without taking any lock. To avoid losing a wakeup,
+ * the waiter must get key() BEFORE checking its wait condition, and pass the key to
+ * waitRelative(), which returns immediately if any signal happened after key().
+ */
+class FutexSignal {
+ public:
+    FutexSignal() : mSeq(0), mWaiters(0) {}
+    ~FutexSignal() {}
+
+    uint32_t key() const { return mSeq.load(std::memory_order_acquire); }
+
+    /**
+     * Wait until signaled after key was taken or timeout.
+     *
+     * \param[in] lock: It's released during waiting and re-acquired before returning.
+     * \param[in] key: The value returned by key() before checking the wait condition.
+     * \param[in] reltime: The maximum time to spend waiting.
+     *
+     * \return TIMED_OUT if it's not notified to wake up within reltime, otherwise return OK.
+     */
+    int waitRelative(ConditionLock& lock, uint32_t key, int64_t reltime);
+
+    /**
+     * Wake up one waiting thread.
+     */
+    void signal() { wake(1); }
+
+    /**
+     * Wake up all waiting threads.
+     */
+    void broadcast() { wake(INT32_MAX); }
+
+ private:
+    FutexSignal(const FutexSignal& other) = delete;
+    FutexSignal& operator=(const FutexSignal&) = delete;
+
+    void wake(int count);
+
+    std::atomic<uint32_t> mSeq;
+    std::atomic<int> mWaiters;
+};
+
 /**
  * Thread is a wrapper class to std::thread
  *
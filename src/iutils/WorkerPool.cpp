@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG WorkerPool
+
+#include "WorkerPool.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+
+#include "CameraLog.h"
+#include "Errors.h"
+
+namespace icamera {
+
+WorkerPool::WorkerPool(int workerCount, const std::string& name, int cpu)
+        : mExiting(false) {
+    LOG1("%s, %s with %d workers on cpu %d", __func__, name.c_str(), workerCount, cpu);
+
+    for (int i = 0; i < workerCount; i++) {
+        std::unique_ptr<Worker> worker(new Worker(this, cpu));
+        if (worker->run(name) != OK) {
+            LOGW("%s, failed to start worker %d", __func__, i);
+            break;
+        }
+        mWorkers.push_back(std::move(worker));
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        AutoMutex lock(mLock);
+        mExiting = true;
+        mJobCondition.broadcast();
+    }
+
+    for (auto& worker : mWorkers) {
+        worker->requestExitAndWait();
+    }
+}
+
+void WorkerPool::parallelFor(int count, const std::function<void(int)>& task) {
+    if (count <= 0) return;
+
+    if (count == 1 || mWorkers.empty()) {
+        for (int i = 0; i < count; i++) task(i);
+        return;
+    }
+
+    Job job = {&task, count, 0, count};
+    ConditionLock lock(mLock);
+    queueJob(&job);
+
+    // The caller takes part in its own job instead of sleeping.
+    while (runOneTask(&job, lock)) {
+    }
+    while (job.pendingTasks > 0) {
+        mDoneCondition.wait(lock);
+    }
+}
+
+void WorkerPool::runOnWorkers(int count, const std::function<void(int)>& task) {
+    if (count <= 0) return;
+
+    if (mWorkers.empty()) {
+        for (int i = 0; i < count; i++) task(i);
+        return;
+    }
+
+    Job job = {&task, count, 0, count};
+    ConditionLock lock(mLock);
+    queueJob(&job);
+    while (job.pendingTasks > 0) {
+        mDoneCondition.wait(lock);
+    }
+}
+
+void WorkerPool::queueJob(Job* job) {
+    mJobs.push_back(job);
+    if (mWorkers.size() == 1) {
+        mJobCondition.signal();
+    } else {
+        mJobCondition.broadcast();
+    }
+}
+
+bool WorkerPool::runOneTask(Job* job, ConditionLock& lock) {
+    if (job->nextTask >= job->taskCount) return false;
+
+    int index = job->nextTask++;
+    // All the tasks are claimed, the job stays alive until its caller sees them done
+    if (job->nextTask == job->taskCount) mJobs.remove(job);
+    lock.unlock();
+    (*job->task)(index);
+    lock.lock();
+
+    if (--job->pendingTasks == 0) mDoneCondition.broadcast();
+    return true;
+}
+
+bool WorkerPool::Worker::threadLoop() {
+    if (mCpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (mCpu < CPU_SETSIZE) CPU_SET(mCpu, &set);
+        int ret = mCpu < CPU_SETSIZE ? pthread_setaffinity_np(pthread_self(), sizeof(set), &set)
+                                     : EINVAL;
+        if (ret != 0) LOGW("%s, failed to pin the worker to cpu %d: %d", __func__, mCpu, ret);
+        mCpu = -1;
+    }
+
+    ConditionLock lock(mPool->mLock);
+    while (!mPool->mExiting && mPool->mJobs.empty()) {
+        mPool->mJobCondition.wait(lock);
+    }
+    if (!mPool->mExiting) mPool->runOneTask(mPool->mJobs.front(), lock);
+
+    return !mPool->mExiting;
+}
+
+WorkerPool* WorkerPool::getSharedPool(const std::string& name, int workerCount, int cpu) {
+    static Mutex sLock;
+    // Never released since the users may run in any thread of the process
+    static std::map<std::string, WorkerPool*> sPools;
+
+    AutoMutex l(sLock);
+    auto it = sPools.find(name);
+    if (it != sPools.end()) return it->second;
+
+    if (workerCount < 0) {
+        workerCount = std::max(static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN)) - 1, 0);
+    }
+    WorkerPool* pool = new WorkerPool(workerCount, name, cpu);
+    sPools[name] = pool;
+    return pool;
+}
+
+}  // namespace icamera
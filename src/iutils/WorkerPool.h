@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Thread.h"
+
+namespace icamera {
+
+/**
+ * WorkerPool keeps a set of threads alive to run data parallel jobs.
+ *
+ * parallelFor() splits a job into "count" tasks which are claimed by the workers
+ * and the calling thread, and returns once all of them are done. The jobs of
+ * concurrent callers are queued, the workers run them in order while each caller
+ * runs the tasks of its own job, so one long job doesn't block the other callers.
+ *
+ * The workers can be pinned to one cpu once when they start, runOnWorkers() then runs the
+ * tasks on that cpu without changing the affinity of the caller.
+ */
+class WorkerPool {
+ public:
+    /**
+     * \param[in] workerCount: the number of worker threads, the caller of parallelFor()
+     *                         is always one more runner.
+     * \param[in] name: the name of the worker threads.
+     * \param[in] cpu: the cpu which the workers are pinned to, -1 for no affinity.
+     */
+    explicit WorkerPool(int workerCount, const std::string& name = "WorkerPool", int cpu = -1);
+    ~WorkerPool();
+
+    /**
+     * Run task(0) ... task(count - 1) concurrently and wait for all of them.
+     */
+    void parallelFor(int count, const std::function<void(int)>& task);
+
+    /**
+     * Like parallelFor(), but only the workers run the tasks, the caller just waits.
+     * The tasks run in the caller if the pool has no worker.
+     */
+    void runOnWorkers(int count, const std::function<void(int)>& task);
+
+    /**
+     * The max number of tasks running at the same time.
+     */
+    int getConcurrency() const { return static_cast<int>(mWorkers.size()) + 1; }
+
+    /**
+     * Process-wide pool of the given name, created on the first call.
+     *
+     * \param[in] name: the pool name, the users with different names don't share workers.
+     * \param[in] workerCount: the number of worker threads if the pool is created,
+     *                         -1 for the number of online cores minus one.
+     * \param[in] cpu: the cpu which the workers are pinned to if the pool is created.
+     */
+    static WorkerPool* getSharedPool(const std::string& name = "SharedWorker",
+                                     int workerCount = -1, int cpu = -1);
+
+ private:
+    WorkerPool(const WorkerPool& other) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    class Worker : public Thread {
+     public:
+        Worker(WorkerPool* pool, int cpu) : mPool(pool), mCpu(cpu) {}
+
+     private:
+        bool threadLoop() override;
+
+        WorkerPool* mPool;
+        int mCpu;  // Pinned in the first loop, then -1
+    };
+
+    struct Job {
+        const std::function<void(int)>* task;
+        int taskCount;
+        int nextTask;
+        int pendingTasks;
+    };
+
+    // Queue the job for the workers and wake them up, MUST be called with mLock held.
+    void queueJob(Job* job);
+    // Claim and run one task of the job, MUST be called with mLock held.
+    bool runOneTask(Job* job, ConditionLock& lock);
+
+ private:
+    Mutex mLock;  // Guard the fields below
+    Condition mJobCondition;
+    Condition mDoneCondition;
+    std::list<Job*> mJobs;  // The jobs with tasks not claimed yet, in the order of the calls
+    bool mExiting;
+
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+};
+
+}  // namespace icamera
@@ -18,6 +18,10 @@
 
 #include "SWJpegEncoder.h"
 
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <string>
 
 #include "ImageConverter.h"
@@ -34,12 +38,26 @@ SWJpegEncoder::SWJpegEncoder()
           mTotalWidth(0),
           mTotalHeight(0),
           mDstBuf(nullptr),
-          mCPUCoresNum(1) {
+          mCPUCoresNum(1),
+          mStride(0),
+          mFourcc(0),
+          mQuality(DEFAULT_JPEG_QUALITY) {
     LOG2("@%s, line:%d", __func__, __LINE__);
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    // The strip count can be fixed with cameraSwJpegThreads, e.g. to compare with one strip
+    const char* threads = getenv("cameraSwJpegThreads");
+    if (threads) cores = atoi(threads);
+    mCPUCoresNum = CLIP(cores > 0 ? static_cast<unsigned int>(cores) : MIN_THREAD_NUM,
+                        MAX_THREAD_NUM, MIN_THREAD_NUM);
 }
 
 SWJpegEncoder::~SWJpegEncoder() {
     LOG2("@%s, line:%d", __func__, __LINE__);
+    // Stop the workers before the codecs they use are released
+    mWorkerPool.reset();
+    for (auto& codec : mCodecs) {
+        codec->deInit();
+    }
 }
 
 std::unique_ptr<IJpegEncoder> IJpegEncoder::createJpegEncoder() {
@@ -102,7 +120,7 @@ exit:
  *  This function will decide if we need to enable the multi thread jpeg encoding.
  *  currently, we have two conditions to use the old single jpeg encoding.
  *  one is that the resolution is smaller than the 1.3M
- *  the other is that the CPU number is 1
+ *  the other is that the picture can't be split into more than one strip
  *
  *  \param width: the Jpeg width
  *  \param height: the Jpeg height
@@ -117,7 +135,7 @@ bool SWJpegEncoder::useMultiThreadEncoding(int width, int height) {
     /* more conditions could be added to here by according to the request */
     if ((width < RESOLUTION_1_3MP_WIDTH && height < RESOLUTION_1_3MP_HEIGHT))
         ret = false;
-    else if (width & 0xf)
+    else if (getStripCount(height) < 2)
         ret = false;
     else
         ret = true;
@@ -137,28 +155,26 @@ bool SWJpegEncoder::useMultiThreadEncoding(int width, int height) {
 int SWJpegEncoder::swEncode(const EncodePackage& package) {
     LOG2("@%s, line:%d, use the libjpeg to do sw jpeg encoding", __func__, __LINE__);
     int status = 0;
-    Codec encoder;
+    Codec* encoder = getCodec(0);
 
-    encoder.init();
-    encoder.setJpegQuality(package.quality);
-    status = encoder.configEncoding(package.inputWidth, package.inputHeight, package.inputStride,
-                                    static_cast<JSAMPLE*>(mDstBuf),
-                                    (package.outputSize - package.exifDataSize));
+    encoder->setJpegQuality(package.quality);
+    encoder->setRestartInterval(0);
+    status = encoder->configEncoding(package.inputWidth, package.inputHeight, package.inputStride,
+                                     static_cast<JSAMPLE*>(mDstBuf),
+                                     (package.outputSize - package.exifDataSize));
     const void* uv_buf =
         static_cast<unsigned char*>(package.inputData) + package.inputStride * package.inputHeight;
 
     if (status) goto exit;
 
-    status = encoder.doJpegEncoding(package.inputData, uv_buf, package.inputFormat);
+    status = encoder->doJpegEncoding(package.inputData, uv_buf, package.inputFormat);
     if (status) goto exit;
 
 exit:
     if (status)
         mJpegSize = -1;
     else
-        encoder.getJpegSize(&mJpegSize);
-
-    encoder.deInit();
+        encoder->getJpegSize(&mJpegSize);
 
     return (status ? -1 : 0);
 }
@@ -166,7 +182,8 @@ exit:
 /**
  * encode jpeg by calling the SWJpegEncoder which is the libjpeg wrapper
  * multi thread.
- * the thread number depends on the CPU number.
+ * the picture is split into horizontal strips which are encoded by the workers
+ * concurrently, the strip number depends on the CPU number.
  *
  * \param package: jpeg encode package
  * \return 0 if encoding was successful
@@ -174,309 +191,228 @@ exit:
  */
 int SWJpegEncoder::swEncodeMultiThread(const EncodePackage& package) {
     LOG2("@%s, line:%d, use the libjpeg to do sw jpeg encoding", __func__, __LINE__);
-    int status = 0;
+    unsigned int stripCount = getStripCount(package.inputHeight);
 
-    init(mCPUCoresNum);
-    config(package);
+    if (!mWorkerPool) {
+        mWorkerPool = std::unique_ptr<WorkerPool>(new WorkerPool(mCPUCoresNum - 1, "SWJpegWorker"));
+    }
+    stripCount = config(package, stripCount);
+    for (unsigned int i = 0; i < stripCount; i++) {
+        getCodec(i);
+    }
 
-    status = doJpegEncodingMultiThread();
-    if (status) goto exit;
+    mWorkerPool->parallelFor(stripCount, [this, stripCount](int index) {
+        encodeStrip(index, stripCount);
+    });
 
-exit:
-    mJpegSize = status ? -1 : mergeJpeg();
-    deInit();
+    int status = 0;
+    for (unsigned int i = 0; i < stripCount; i++) {
+        if (mStrips[i].dataSize <= 0) status = -1;
+    }
+    mJpegSize = status ? -1 : mergeJpeg(stripCount);
 
-    return (status ? -1 : 0);
+    return (mJpegSize < 0 ? -1 : 0);
 }
 
 /**
- * Initialize for the multi thread jpeg encoding
+ * Get the number of strips for the multi thread jpeg encoding
+ *
+ * every strip except the last one has the height of whole MCU rows.
  *
- * it will create n CodecWorkerThread by according to the thread number.
+ * \param height: the jpeg height
  */
-void SWJpegEncoder::init(unsigned int threadNum) {
-    unsigned int num = CLIP(threadNum, MAX_THREAD_NUM, MIN_THREAD_NUM);
-    LOG2("@%s, line:%d, thread number, pass:%d, real:%d", __func__, __LINE__, threadNum, num);
-
-    for (unsigned int i = 0; i < num; i++) {
-        std::shared_ptr<CodecWorkerThread> codecWorkerThread(new CodecWorkerThread);
-        mSwJpegEncoder.push_back(codecWorkerThread);
-    }
+unsigned int SWJpegEncoder::getStripCount(int height) const {
+    unsigned int mcuRows = height / NV12_MCU_SIZE;
+    return CLIP(std::min(mCPUCoresNum, mcuRows), MAX_THREAD_NUM, MIN_THREAD_NUM);
 }
 
 /**
- * deInit for the multi thread jpeg encoding
- *
- * it will release all n CodecWorkerThread
+ * Get the codec of one strip, it's created when used for the first time
+ * and kept alive for the next encodings.
  */
-void SWJpegEncoder::deInit(void) {
-    LOG2("@%s, line:%d", __func__, __LINE__);
-    for (auto& encoder : mSwJpegEncoder) {
-        encoder.reset();
+SWJpegEncoder::Codec* SWJpegEncoder::getCodec(unsigned int index) {
+    while (mCodecs.size() <= index) {
+        std::unique_ptr<Codec> codec(new Codec());
+        codec->init();
+        mCodecs.push_back(std::move(codec));
     }
 
-    mSwJpegEncoder.clear();
+    return mCodecs[index].get();
 }
 
 /**
- * configue every thread for multi thread jpeg
+ * configure every strip for multi thread jpeg
+ *
+ * The first strip is encoded in place at the beginning of the dest buffer, the
+ * others are encoded after it, in the part of the buffer matching their position
+ * in the picture, and then moved once to the end of the merged data.
+ *
+ * The strips have the height of whole MCU rows, so there may be less strips than asked
+ * for when the picture is short, the last strip takes the remaining rows.
  *
  * \param package: jpeg encode package
+ * \param stripCount: the max number of strips
+ * \return the number of strips
  */
-void SWJpegEncoder::config(const EncodePackage& package) {
+unsigned int SWJpegEncoder::config(const EncodePackage& package, unsigned int stripCount) {
     LOG2("@%s, line:%d", __func__, __LINE__);
-    std::shared_ptr<CodecWorkerThread> encThread;
-    CodecWorkerThread::CodecConfig cfg;
-
-    for (unsigned int i = 0; i < mSwJpegEncoder.size(); i++) {
-        cfg.width = package.inputWidth;
-        /*
-            for example, there are 4 threads.
-            the first 3 threads must align to 16 which is NV12_MCU_SIZE
-            but for the last thread, it doesn't have this request.
-        */
-        cfg.height = ALIGN_16(package.inputHeight / mSwJpegEncoder.size());
-        cfg.stride = package.inputStride;
+    mStride = package.inputStride;
+    mFourcc = package.inputFormat;
+    mQuality = package.quality;
+
+    const int totalBufSize = package.outputSize - package.exifDataSize;
+    const int mcuRows = (package.inputHeight + NV12_MCU_SIZE - 1) / NV12_MCU_SIZE;
+    const int stripHeight = (mcuRows + stripCount - 1) / stripCount * NV12_MCU_SIZE;
+    stripCount = (package.inputHeight + stripHeight - 1) / stripHeight;
+    const int bufSizePerLine = totalBufSize / package.inputHeight;
+    unsigned char* inData = static_cast<unsigned char*>(package.inputData);
+
+    mStrips.resize(stripCount);
+    for (unsigned int i = 0; i < stripCount; i++) {
+        StripConfig& strip = mStrips[i];
+        const int top = stripHeight * i;
+        /* the last strip takes the remaining lines and buffer */
+        const bool last = (i == stripCount - 1);
+        strip.height = last ? package.inputHeight - top : stripHeight;
         /*
          * For NV12 format, Y and UV data are independent, total size is width*height*1.5;
          * For YUYV format, Y and UV data are crossing, total size is width*height*2;
          * So the inBufY and inBufUV should be distinguished base on format.
          */
-        cfg.fourcc = package.inputFormat;
-        cfg.inBufY =
-            (cfg.fourcc == V4L2_PIX_FMT_YUYV) ?
-                static_cast<unsigned char*>(package.inputData) + cfg.stride * cfg.height * 2 * i :
-                static_cast<unsigned char*>(package.inputData) + cfg.stride * cfg.height * i;
-        cfg.inBufUV =
-            (cfg.fourcc == V4L2_PIX_FMT_NV12 || cfg.fourcc == V4L2_PIX_FMT_NV21) ?
-                (static_cast<unsigned char*>(package.inputData) +
-                 package.inputStride * package.inputHeight + cfg.stride * cfg.height * i / 2) :
-                nullptr;
-        cfg.quality = package.quality;
-        cfg.outBufSize = (package.outputSize - package.exifDataSize - DEST_BUF_OFFSET) /
-                         package.inputHeight * cfg.height;
-        cfg.outBuf = static_cast<unsigned char*>(mDstBuf) + DEST_BUF_OFFSET + cfg.outBufSize * i;
-        /* update the last thread's height */
-        if (i == mSwJpegEncoder.size() - 1) {
-            cfg.height = package.inputHeight - cfg.height * (mSwJpegEncoder.size() - 1);
-            cfg.outBufSize = package.outputSize - package.exifDataSize - DEST_BUF_OFFSET -
-                             cfg.outBufSize * (mSwJpegEncoder.size() - 1);
-        }
-
-        encThread = mSwJpegEncoder[i];
-        encThread->setConfig(cfg);
-        LOG2("@%s, line:%d, the %d picture thread cfg", __func__, __LINE__, i);
-        LOG2("@%s, line:%d, cfg.width:%d, cfg.height:%d", __func__, __LINE__, cfg.width,
-             cfg.height);
-        LOG2("@%s, line:%d, cfg.fourcc:%d, cfg.quality:%d", __func__, __LINE__, cfg.fourcc,
-             cfg.quality);
-        LOG2("@%s, line:%d, cfg.inBufY:%p, cfg.inBufUV:%p", __func__, __LINE__, cfg.inBufY,
-             cfg.inBufUV);
-        LOG2("@%s, line:%d, cfg.outBuf:%p, cfg.outBufSize:%d", __func__, __LINE__, cfg.outBuf,
-             cfg.outBufSize);
-    }
-}
-
-/**
- * the function will trigger the multi jpeg encoding
- *
- * \return 0 if encoding was successful
- * \return -1 if encoding failed
- */
-int SWJpegEncoder::doJpegEncodingMultiThread(void) {
-    LOG2("@%s, line:%d", __func__, __LINE__);
-    std::shared_ptr<CodecWorkerThread> encThread;
-    status_t status = OK;
-    std::string threadName("CamHAL_SWEncodeMultiThread");
-
-    /* run all threads */
-    for (unsigned int i = 0; i < mSwJpegEncoder.size(); i++) {
-        threadName = threadName + ":" + std::to_string(i);
-        LOG2("@%s, new sw jpeg thread name:%s", __func__, threadName.c_str());
-        encThread = mSwJpegEncoder[i];
-        status = encThread->runThread(threadName.c_str());
-        if (status != OK) {
-            ALOGE("@%s, line:%d, start jpeg thread fail, thread name:%s", __func__, __LINE__,
-                  threadName.c_str());
-            return status;
-        }
+        strip.inBufY = (mFourcc == V4L2_PIX_FMT_YUYV) ? inData + mStride * top * 2 :
+                                                        inData + mStride * top;
+        strip.inBufUV = (mFourcc == V4L2_PIX_FMT_NV12 || mFourcc == V4L2_PIX_FMT_NV21) ?
+                            inData + mStride * package.inputHeight + mStride * top / 2 :
+                            nullptr;
+        strip.outBuf = mDstBuf + bufSizePerLine * top;
+        strip.outBufSize = last ? totalBufSize - bufSizePerLine * top :
+                                  bufSizePerLine * strip.height;
+        strip.dataSize = -1;
+
+        LOG2("@%s, strip %d, height:%d, inBufY:%p, inBufUV:%p, outBuf:%p, outBufSize:%d",
+             __func__, i, strip.height, strip.inBufY, strip.inBufUV, strip.outBuf,
+             strip.outBufSize);
     }
-
-    /* wait all threads to finish */
-    for (unsigned int i = 0; i < mSwJpegEncoder.size(); i++) {
-        LOG2("@%s, the %d sw jpeg encoder thread before join!", __func__, i);
-        encThread = mSwJpegEncoder[i];
-        encThread->waitThreadFinish();
-        if (encThread->getJpegDataSize() == -1) status = UNKNOWN_ERROR;
-    }
-
-    return status;
+    return stripCount;
 }
 
 /**
- * the function will merge all jpeg pictures which are generated in multi threads
- * to one jpeg picture
+ * encode one strip, it's called by the workers
  *
- * \return int the merged jpeg size
+ * \param index: the index of the strip
+ * \param stripCount: the number of strips
  */
-int SWJpegEncoder::mergeJpeg(void) {
-#define HEADER_TOTAL_LEN 623
-#define HEADER_SOS_LEN 14
-#define HEADER_EOI_LEN 2
-#define HEADER_HEIGHT_POS 163
-#define HEADER_WIDTH_POS 165
-#define NV12_MCU_SIZE 16
-    LOG2("@%s, line:%d", __func__, __LINE__);
-    int size = HEADER_TOTAL_LEN - HEADER_SOS_LEN;
-    CodecWorkerThread::CodecConfig cfg;
-    nsecs_t startTime;
-    std::shared_ptr<CodecWorkerThread> encThread = mSwJpegEncoder.at(0);
-    if (encThread == nullptr) {
-        ALOGE("encThread is nullptr");
-        return -1;
-    }
-    encThread->getConfig(&cfg);
-
-    /* Write the JPEG header */
-    MEMCPY_S(mDstBuf, size, cfg.outBuf, size);
-
-    /* Update the width and height info */
-    mDstBuf[HEADER_HEIGHT_POS] = (mTotalHeight >> 8) & 0xFF;
-    mDstBuf[HEADER_HEIGHT_POS + 1] = mTotalHeight & 0xFF;
-    mDstBuf[HEADER_WIDTH_POS] = (mTotalWidth >> 8) & 0xFF;
-    mDstBuf[HEADER_WIDTH_POS + 1] = mTotalWidth & 0xFF;
-
-    /* Write the restarting interval */
-    if (mSwJpegEncoder.size() > 1) {
-        unsigned int MCUs = (cfg.height / NV12_MCU_SIZE) * (cfg.width / NV12_MCU_SIZE);
-        mDstBuf[size++] = 0xFF;
-        mDstBuf[size++] = 0xDD;
-        mDstBuf[size++] = 0;
-        mDstBuf[size++] = 4;
-        mDstBuf[size++] = (MCUs >> 8) & 0xFF;
-        mDstBuf[size++] = MCUs & 0xFF;
-    }
-
-    /* Write the SOS */
-    MEMCPY_S(reinterpret_cast<void*>((unsigned long)mDstBuf + size), HEADER_SOS_LEN,
-             reinterpret_cast<void*>((unsigned long)cfg.outBuf + HEADER_TOTAL_LEN - HEADER_SOS_LEN),
-             HEADER_SOS_LEN);
-    size += HEADER_SOS_LEN;
+void SWJpegEncoder::encodeStrip(unsigned int index, unsigned int stripCount) {
+    nsecs_t startTime = CameraUtils::systemTime();
+    StripConfig& strip = mStrips[index];
+    Codec* encoder = mCodecs[index].get();
 
-    /* Write coded segments */
-    for (unsigned int i = 0; i < mSwJpegEncoder.size(); i++) {
-        encThread = mSwJpegEncoder[i];
-        startTime = CameraUtils::systemTime();
-        encThread->getConfig(&cfg);
-        memmove(reinterpret_cast<void*>((unsigned long)mDstBuf + size),
-                reinterpret_cast<void*>((unsigned long)cfg.outBuf + HEADER_TOTAL_LEN),
-                (encThread->getJpegDataSize() - HEADER_TOTAL_LEN - HEADER_EOI_LEN));
-        LOG2("@%s, wr %d segments, size:%d, consume:%ums", __func__, i,
-             (encThread->getJpegDataSize() - HEADER_TOTAL_LEN - HEADER_EOI_LEN),
-             (unsigned)((CameraUtils::systemTime() - startTime) / 1000000));
-        size += (encThread->getJpegDataSize() - HEADER_TOTAL_LEN - HEADER_EOI_LEN);
-
-        if (i != (mSwJpegEncoder.size() - 1)) {
-            mDstBuf[size++] = 0xFF;
-            mDstBuf[size++] = (i & 0x7) | 0xD0;
-        }
+    encoder->setJpegQuality(mQuality);
+    /*
+     * The header of the first strip is the header of the merged jpeg, so it carries
+     * the restart interval of one strip. Every strip starts with fresh DC predictions,
+     * which is what the decoder expects after a restart marker.
+     */
+    unsigned int mcusPerRow = (mTotalWidth + NV12_MCU_SIZE - 1) / NV12_MCU_SIZE;
+    encoder->setRestartInterval(index == 0 && stripCount > 1 ?
+                                    mcusPerRow * (strip.height / NV12_MCU_SIZE) : 0);
+    int status = encoder->configEncoding(mTotalWidth, strip.height, mStride,
+                                         static_cast<JSAMPLE*>(strip.outBuf), strip.outBufSize);
+    if (status == 0) {
+        status = encoder->doJpegEncoding(strip.inBufY, strip.inBufUV, mFourcc);
     }
 
-    /* Write EOI */
-    mDstBuf[size++] = 0xFF;
-    mDstBuf[size++] = 0xD9;
-
-    return size;
-}
-
-SWJpegEncoder::CodecWorkerThread::CodecWorkerThread() : mDataSize(-1) {
-    LOG2("@%s, line:%d", __func__, __LINE__);
-    CLEAR(mCfg);
-}
+    if (status)
+        strip.dataSize = -1;
+    else
+        encoder->getJpegSize(&strip.dataSize);
 
-SWJpegEncoder::CodecWorkerThread::~CodecWorkerThread() {
-    LOG2("@%s, line:%d", __func__, __LINE__);
+    LOG2("@%s strip %d done, consume:%ums, size:%d", __func__, index,
+         (unsigned)((CameraUtils::systemTime() - startTime) / 1000000), strip.dataSize);
 }
 
 /**
- * run one thread for multi thread jpeg encoding
- *
- * \param name: the thread name
+ * Copy one line and repeat its last pixel up to the padded width
  */
-status_t SWJpegEncoder::CodecWorkerThread::runThread(const char* name) {
-    LOG2("@%s, line:%d", __func__, __LINE__);
-    return this->run(name);
+static void padLine(const unsigned char* src, int width, unsigned char* dst, int paddedWidth) {
+    MEMCPY_S(dst, paddedWidth, src, width);
+    memset(dst + width, width > 0 ? src[width - 1] : 0, paddedWidth - width);
 }
 
 /**
- * wait one thread until it has finished
+ * Find one marker segment in the header of a jpeg picture
  *
+ * \param data: the jpeg data
+ * \param size: the size of the jpeg data
+ * \param marker: the marker to find
+ * \return the offset of the marker, or -1 if not found before the scan data
  */
-void SWJpegEncoder::CodecWorkerThread::waitThreadFinish(void) {
-    LOG2("@%s, line:%d", __func__, __LINE__);
-    this->join();
-    this->requestExitAndWait();
-}
+static int findJpegMarker(const unsigned char* data, int size, unsigned char marker) {
+    const unsigned char kSoi = 0xD8;
+    const unsigned char kSos = 0xDA;
+    if (size < 2 || data[0] != 0xFF || data[1] != kSoi) return -1;
+
+    int pos = 2;
+    while (pos + 4 <= size && data[pos] == 0xFF) {
+        if (data[pos + 1] == marker) return pos;
+        if (data[pos + 1] == kSos) break;
+        pos += 2 + ((data[pos + 2] << 8) | data[pos + 3]);
+    }
 
-/**
- * get jpeg size which is done in one thread
- *
- * \return int the coded jpeg size
- */
-int SWJpegEncoder::CodecWorkerThread::getJpegDataSize(void) {
-    LOG2("@%s, line:%d", __func__, __LINE__);
-    return mDataSize;
+    return -1;
 }
 
 /**
- * the thread exe function for one jpeg thread
- * when the encoding has been done, it will return false to terminate the thread
+ * the function will merge the strips which are encoded by the workers
+ * to one jpeg picture.
  *
- * \return false
- */
-bool SWJpegEncoder::CodecWorkerThread::threadLoop() {
-    LOG2("@%s, line:%d, in CodecWorkerThread", __func__, __LINE__);
-    nsecs_t startTime = CameraUtils::systemTime();
-    int ret = swEncode();
-    LOG2("@%s one swEncode done!, consume:%ums, ret:%d", __func__,
-         (unsigned)((CameraUtils::systemTime() - startTime) / 1000000), ret);
-
-    return false;
-}
-
-/**
- * this function will call the SWJpegEncoder to encode one jpeg.
- * it's the main function of the threadLoop
+ * The first strip is already in place, its height is updated to the full picture.
+ * The scan data of the other strips are moved after it, separated by restart markers.
  *
- * \return 0 if encoding was successful
- * \return -1 if encoding failed
+ * \param stripCount: the number of strips
+ * \return int the merged jpeg size, -1 if the strips can't be parsed
  */
-int SWJpegEncoder::CodecWorkerThread::swEncode(void) {
-    LOG2("@%s, line:%d, in CodecWorkerThread", __func__, __LINE__);
-    int status = 0;
-    Codec encoder;
+int SWJpegEncoder::mergeJpeg(unsigned int stripCount) {
+    const unsigned char kSof0 = 0xC0;
+    const unsigned char kSos = 0xDA;
+    const int kEoiLen = 2;
+    LOG2("@%s, line:%d", __func__, __LINE__);
 
-    encoder.init();
-    encoder.setJpegQuality(mCfg.quality);
-    status = encoder.configEncoding(mCfg.width, mCfg.height, mCfg.stride,
-                                    static_cast<JSAMPLE*>(mCfg.outBuf), mCfg.outBufSize);
-    if (status) goto exit;
+    /* Update the height info, it's after the length and the precision of SOF0 */
+    int sofPos = findJpegMarker(mDstBuf, mStrips[0].dataSize, kSof0);
+    CheckAndLogError(sofPos < 0, -1, "@%s, no SOF0 in the first strip", __func__);
+    mDstBuf[sofPos + 5] = (mTotalHeight >> 8) & 0xFF;
+    mDstBuf[sofPos + 6] = mTotalHeight & 0xFF;
 
-    status = encoder.doJpegEncoding(mCfg.inBufY, mCfg.inBufUV, mCfg.fourcc);
-    if (status) goto exit;
+    /* Drop the EOI of the first strip */
+    int size = mStrips[0].dataSize - kEoiLen;
 
-exit:
-    if (status)
-        mDataSize = -1;
-    else
-        encoder.getJpegSize(&mDataSize);
+    /* Write coded segments */
+    for (unsigned int i = 1; i < stripCount; i++) {
+        const unsigned char* data = static_cast<unsigned char*>(mStrips[i].outBuf);
+        int sosPos = findJpegMarker(data, mStrips[i].dataSize, kSos);
+        CheckAndLogError(sosPos < 0, -1, "@%s, no SOS in strip %d", __func__, i);
+        int scanPos = sosPos + 2 + ((data[sosPos + 2] << 8) | data[sosPos + 3]);
+        int scanSize = mStrips[i].dataSize - scanPos - kEoiLen;
 
-    encoder.deInit();
+        mDstBuf[size++] = 0xFF;
+        mDstBuf[size++] = ((i - 1) & 0x7) | 0xD0;
+        // The scan data is always behind the merged data, so it's moved backwards
+        memmove(mDstBuf + size, data + scanPos, scanSize);
+        size += scanSize;
+    }
 
-    return (status ? -1 : 0);
+    /* Write EOI */
+    mDstBuf[size++] = 0xFF;
+    mDstBuf[size++] = 0xD9;
+
+    return size;
 }
 
-SWJpegEncoder::Codec::Codec() : mStride(-1), mJpegQuality(DEFAULT_JPEG_QUALITY) {
+SWJpegEncoder::Codec::Codec()
+        : mStride(-1),
+          mJpegQuality(DEFAULT_JPEG_QUALITY),
+          mRestartInterval(0) {
     LOG2("@%s", __func__);
     CLEAR(mCInfo);
     CLEAR(mJErr);
@@ -550,6 +486,7 @@ int SWJpegEncoder::Codec::configEncoding(int width, int height, int stride, void
     jpeg_set_defaults(&mCInfo);
     jpeg_set_colorspace(&mCInfo, (J_COLOR_SPACE)SUPPORTED_FORMAT);
     jpeg_set_quality(&mCInfo, mJpegQuality, TRUE);
+    mCInfo.restart_interval = mRestartInterval;
     mCInfo.raw_data_in = TRUE;
     mCInfo.dct_method = JDCT_ISLOW;
     mCInfo.comp_info[0].h_samp_factor = 2;
@@ -588,7 +525,9 @@ int SWJpegEncoder::Codec::doJpegEncoding(const void* y_buf, const void* uv_buf,
     height = mCInfo.image_height;
     srcY = (unsigned char*)y_buf;
     srcUV = (unsigned char*)uv_buf;
-    p411 = new unsigned char[width * height * 3 / 2];
+    // libjpeg reads whole MCUs, keep the padding of the last line readable
+    mP411.resize(width * height * 3 / 2 + NV12_MCU_SIZE);
+    p411 = mP411.data();
 
     switch (fourcc) {
         case V4L2_PIX_FMT_YUYV:
@@ -602,19 +541,43 @@ int SWJpegEncoder::Codec::doJpegEncoding(const void* y_buf, const void* uv_buf,
             break;
         default:
             ALOGE("%s Unsupported fourcc %d", __func__, fourcc);
-            delete[] p411;
+            // The codec is reused, so bring it back to the idle state
+            jpeg_abort_compress(&mCInfo);
             return -1;
     }
 
     data[0] = y;
     data[1] = u;
     data[2] = v;
+    const int lastCLine = std::max(height / 2 - 1, 0);
+    // Raw data mode reads whole MCUs, so the lines are padded to the MCU width
+    // by repeating the last pixel instead of reading into the next line.
+    const int alignedWidth = ALIGN(width, NV12_MCU_SIZE);
+    const bool padColumns = alignedWidth != width;
+    if (padColumns) mPadLines.resize(alignedWidth * NV12_MCU_SIZE * 2);
+
     for (i = 0; i < height; i += 16) {
-        for (j = 0; j < 16 && (i + j) < height; j++) {
-            y[j] = p411 + width * (j + i);
+        for (j = 0; j < 16; j++) {
+            // Repeat the last line for the padding lines of the last MCU row
+            int line = std::min(j + i, height - 1);
+            y[j] = p411 + width * line;
             if (j % 2 == 0) {
-                u[j / 2] = p411 + width * height + width / 2 * ((j + i) / 2);
-                v[j / 2] = p411 + width * height + width * height / 4 + width / 2 * ((j + i) / 2);
+                int cLine = std::min(line / 2, lastCLine);
+                u[j / 2] = p411 + width * height + width / 2 * cLine;
+                v[j / 2] = p411 + width * height + width * height / 4 + width / 2 * cLine;
+            }
+        }
+        if (padColumns) {
+            unsigned char* pad = mPadLines.data();
+            for (j = 0; j < 16; j++, pad += alignedWidth) {
+                padLine(y[j], width, pad, alignedWidth);
+                y[j] = pad;
+            }
+            for (j = 0; j < 8; j++, pad += alignedWidth) {
+                padLine(u[j], width / 2, pad, alignedWidth / 2);
+                u[j] = pad;
+                padLine(v[j], width / 2, pad + alignedWidth / 2, alignedWidth / 2);
+                v[j] = pad + alignedWidth / 2;
             }
         }
         jpeg_write_raw_data(&mCInfo, data, 16);
@@ -622,9 +585,6 @@ int SWJpegEncoder::Codec::doJpegEncoding(const void* y_buf, const void* uv_buf,
 
     jpeg_finish_compress(&mCInfo);
 
-    delete[] p411;
-    p411 = nullptr;
-
     return 0;
 }
 
@@ -31,12 +31,13 @@
 #include <linux/videodev2.h>
 #include <stdio.h>
 
+#include <memory>
 #include <vector>
 
 #include "IJpegEncoder.h"
 #include "iutils/Errors.h"
-#include "iutils/Thread.h"
 #include "iutils/Utils.h"
+#include "iutils/WorkerPool.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -78,58 +79,41 @@ class SWJpegEncoder : public IJpegEncoder {
     unsigned int mCPUCoresNum; /*!< use to remember the CPU Cores number */
 
  private:
+    class Codec;
+
     /**
-     * \class CodecWorkerThread
+     * \struct StripConfig
      *
-     * This class will create one thread to do one sw jpeg encoder.
-     * It will call the SWJpegEncoderWrapper directly.
+     * One horizontal strip of the picture, which is encoded by one worker.
+     * The strips are merged with restart markers, so the strip height MUST
+     * be a multiple of the MCU height except the last one.
      */
-    class CodecWorkerThread : public Thread {
-     public:
-        struct CodecConfig {
-            // input buffer configuration
-            int width;
-            int height;
-            int stride;
-            int fourcc;
-            void* inBufY;
-            void* inBufUV;
-            // output buffer configuration
-            int quality;
-            void* outBuf;
-            int outBufSize;
-        };
-
-        CodecWorkerThread();
-        ~CodecWorkerThread();
-
-        void setConfig(const CodecConfig& cfg) { mCfg = cfg; }
-        void getConfig(CodecConfig* cfg) const { *cfg = mCfg; }
-        status_t runThread(const char* name);
-        void waitThreadFinish(void);
-        int getJpegDataSize(void);
-
-     private:
-        int mDataSize;    /*!< the jpeg data size in one thread */
-        CodecConfig mCfg; /*!< the cfg in one thread */
-     private:
-        virtual bool threadLoop();
-        int swEncode(void);
+    struct StripConfig {
+        int height;
+        void* inBufY;
+        void* inBufUV;
+        void* outBuf;
+        int outBufSize;
+        int dataSize; /*!< the coded size of the strip, -1 if encoding fails */
     };
 
- private:
-    void init(unsigned int threadNum = 1);
-    void deInit(void);
-    void config(const EncodePackage& package);
-    int doJpegEncodingMultiThread(void);
-    int mergeJpeg(void);
+    unsigned int getStripCount(int height) const;
+    Codec* getCodec(unsigned int index);
+    unsigned int config(const EncodePackage& package, unsigned int stripCount);
+    void encodeStrip(unsigned int index, unsigned int stripCount);
+    int mergeJpeg(unsigned int stripCount);
 
-    std::vector<std::shared_ptr<CodecWorkerThread> > mSwJpegEncoder;
     static const unsigned int MAX_THREAD_NUM = 8; /*!< the same as max jpeg restart time */
     static const unsigned int MIN_THREAD_NUM = 1;
+    static const unsigned int NV12_MCU_SIZE = 16;
 
-    /*!< it's used to use one buffer to merge the multi jpeg data to one jpeg data */
-    static const unsigned int DEST_BUF_OFFSET = 1024;
+    /*!< the workers and the codecs are kept alive across the encodings */
+    std::unique_ptr<WorkerPool> mWorkerPool;
+    std::vector<std::unique_ptr<Codec>> mCodecs;
+    std::vector<StripConfig> mStrips;
+    int mStride;
+    int mFourcc;
+    int mQuality;
 
  private:
     /**
@@ -147,6 +131,7 @@ class SWJpegEncoder : public IJpegEncoder {
         void init(void);
         void deInit(void);
         void setJpegQuality(int quality);
+        void setRestartInterval(unsigned int mcus) { mRestartInterval = mcus; }
         int configEncoding(int width, int height, int stride, void* jpegBuf, int jpegBufSize);
         /*
             if fourcc is V4L2_PIX_FMT_NV12, y_buf and uv_buf must be passed
@@ -173,6 +158,9 @@ class SWJpegEncoder : public IJpegEncoder {
         struct jpeg_compress_struct mCInfo;
         struct jpeg_error_mgr mJErr;
         int mJpegQuality;
+        unsigned int mRestartInterval;     /*!< in MCUs, 0 means no restart marker */
+        std::vector<unsigned char> mP411;  /*!< reused across the encodings */
+        std::vector<unsigned char> mPadLines; /*!< one MCU row padded to the MCU width */
         static const unsigned int SUPPORTED_FORMAT = JCS_YCbCr;
 
         int setupJpegDestMgr(j_compress_ptr cInfo, JSAMPLE* jpegBuf, int jpegBufSize);
@@ -18,6 +18,7 @@
 
 #include <math.h>
 
+#include <atomic>
 #include <set>
 #include <memory>
 #include <vector>
@@ -76,41 +77,95 @@ ParameterGenerator::~ParameterGenerator() {}
 
 int ParameterGenerator::reset() {
     LOG1("<id%d>%s", mCameraId, __func__);
-    AutoMutex l(mParamsLock);
-    mRequestParamMap.clear();
+    {
+        AutoMutex l(mParamsLock);
+        for (auto& slot : mParamSlots) {
+            std::atomic_store(&slot, std::shared_ptr<const RequestParam>());
+        }
+    }
+
+    AutoMutex l(mResultLock);
     CLEAR(mPaCcm);
 
     return OK;
 }
 
-std::shared_ptr<RequestParam> ParameterGenerator::getRequestParamBuf() {
-    AutoMutex l(mParamsLock);
+/**
+ * Get the settings of the sequence, nullptr if they're not saved or already evicted.
+ */
+std::shared_ptr<const RequestParam> ParameterGenerator::loadParam(int64_t sequence) const {
+    std::shared_ptr<const RequestParam> requestParam =
+        std::atomic_load(&mParamSlots[sequence % kStorageSize]);
+    if (requestParam && requestParam->sequence == sequence) return requestParam;
+
+    return nullptr;
+}
 
-    if (mRequestParamMap.size() < kStorageSize) {
-        return std::make_shared<RequestParam>();
+/**
+ * Find the settings with the largest sequence which is <= sequence if nearest is true, or the
+ * settings with the smallest sequence if it's false. sequence < 0 means the latest settings.
+ */
+std::shared_ptr<const RequestParam> ParameterGenerator::findParam(int64_t sequence,
+                                                                  bool nearest) const {
+    std::shared_ptr<const RequestParam> found;
+    for (const auto& slot : mParamSlots) {
+        std::shared_ptr<const RequestParam> requestParam = std::atomic_load(&slot);
+        if (!requestParam) continue;
+
+        if (!nearest) {
+            if (!found || requestParam->sequence < found->sequence) found = requestParam;
+        } else if (sequence < 0 || requestParam->sequence <= sequence) {
+            if (!found || requestParam->sequence > found->sequence) found = requestParam;
+        }
     }
 
-    auto it = mRequestParamMap.begin();
-    std::shared_ptr<RequestParam> requestParam = it->second;
-    mRequestParamMap.erase(it->first);
+    return found;
+}
 
+std::shared_ptr<RequestParam> ParameterGenerator::allocParamL() {
+    if (mFreeParams.empty()) return std::make_shared<RequestParam>();
+
+    std::shared_ptr<RequestParam> requestParam = mFreeParams.back();
+    mFreeParams.pop_back();
     return requestParam;
 }
 
+/**
+ * Publish the settings, the evicted settings are recycled if no reader still holds them.
+ */
+void ParameterGenerator::storeParamL(std::shared_ptr<RequestParam> requestParam) {
+    std::shared_ptr<const RequestParam> evicted =
+        std::atomic_exchange(&mParamSlots[requestParam->sequence % kStorageSize],
+                             std::shared_ptr<const RequestParam>(requestParam));
+
+    if (evicted && evicted != requestParam && evicted.use_count() == 1 &&
+        mFreeParams.size() < kMaxFreeParams) {
+        mFreeParams.push_back(std::const_pointer_cast<RequestParam>(evicted));
+    }
+}
+
+std::shared_ptr<RequestParam> ParameterGenerator::getRequestParamBuf() {
+    AutoMutex l(mParamsLock);
+
+    return allocParamL();
+}
+
 int ParameterGenerator::saveParameters(int64_t sequence, long requestId,
                                        std::shared_ptr<RequestParam> requestParam) {
     CHECK_REQUEST_ID(requestId);
     CHECK_SEQUENCE(sequence);
 
     AutoMutex l(mParamsLock);
-    if (!requestParam && mRequestParamMap.empty()) return BAD_VALUE;
-
     if (!requestParam) {
-        requestParam = std::make_shared<RequestParam>();
-        requestParam->param = mRequestParamMap.rbegin()->second->param;
+        std::shared_ptr<const RequestParam> latest = findParam(-1, true);
+        if (!latest) return BAD_VALUE;
+
+        requestParam = allocParamL();
+        requestParam->param = latest->param;
     }
     requestParam->requestId = requestId;
-    mRequestParamMap[sequence] = requestParam;
+    requestParam->sequence = sequence;
+    storeParamL(requestParam);
 
     LOG2("<req%ld:seq%ld>%s", requestParam->requestId, sequence, __func__);
 
@@ -119,18 +174,21 @@ int ParameterGenerator::saveParameters(int64_t sequence, long requestId,
 
 void ParameterGenerator::updateParameters(int64_t sequence, const Parameters* param) {
     CheckAndLogError(!param, VOID_VALUE, "The param is nullptr!");
+    CheckAndLogError(sequence < 0, VOID_VALUE, "%s: error sequence %ld!", __func__, sequence);
 
     LOG2("<seq%ld>%s", sequence, __func__);
 
     AutoMutex l(mParamsLock);
-    std::shared_ptr<RequestParam> requestParam = nullptr;
-    if (mRequestParamMap.find(sequence) != mRequestParamMap.end()) {
-        requestParam = mRequestParamMap[sequence];
-    } else {
-        auto it = mRequestParamMap.begin();
-        requestParam = it->second;
-        mRequestParamMap.erase(it->first);
-    }
+    std::shared_ptr<const RequestParam> base = loadParam(sequence);
+    if (!base) base = findParam(sequence, false);
+    CheckAndLogError(!base, VOID_VALUE, "<seq%ld>no settings to update", sequence);
+
+    // The published settings are immutable, update a copy of them
+    std::shared_ptr<RequestParam> requestParam = allocParamL();
+    requestParam->requestId = base->requestId;
+    requestParam->sequence = sequence;
+    requestParam->param = base->param;
+
     int32_t userRequestId = 0;
     int ret = param->getUserRequestId(userRequestId);
     if (ret == OK) {
@@ -185,7 +243,7 @@ void ParameterGenerator::updateParameters(int64_t sequence, const Parameters* pa
     // disable stats callback for reprocessing request
     requestParam->param.setCallbackRgbs(false);
 
-    mRequestParamMap[sequence] = requestParam;
+    storeParamL(requestParam);
 }
 
 int ParameterGenerator::getParameters(int64_t sequence, Parameters* param, bool setting,
@@ -193,78 +251,51 @@ int ParameterGenerator::getParameters(int64_t sequence, Parameters* param, bool
     CheckAndLogError((param == nullptr), UNKNOWN_ERROR, "nullptr to get param!");
 
     if (setting) {
-        AutoMutex l(mParamsLock);
-        if (!mRequestParamMap.empty()) {
-            if (sequence < 0) {
-                *param = mRequestParamMap.rbegin()->second->param;
-            } else {
-                // Find nearest parameter
-                // The sequence of parameter should <= sequence
-                auto it = mRequestParamMap.upper_bound(sequence);
-                if (it == mRequestParamMap.begin()) {
-                    LOGE("Can't find settings for seq %ld", sequence);
-                } else {
-                    *param = (--it)->second->param;
-                }
-            }
+        // Find nearest parameter, the sequence of parameter should <= sequence
+        std::shared_ptr<const RequestParam> requestParam = findParam(sequence, true);
+        if (requestParam) {
+            *param = requestParam->param;
+        } else if (sequence >= 0) {
+            LOGE("Can't find settings for seq %ld", sequence);
         }
     }
 
     if (result) {
+        AutoMutex l(mResultLock);
         generateParametersL(sequence, param);
     }
     return OK;
 }
 
-int ParameterGenerator::getIspParameters(int64_t sequence, Parameters* param) {
+int ParameterGenerator::getParameters(int64_t sequence, Parameters* param, const uint32_t* tags,
+                                      size_t tagCount) {
     CheckAndLogError((param == nullptr), UNKNOWN_ERROR, "nullptr to get param!");
     CHECK_SEQUENCE(sequence);
 
-    AutoMutex l(mParamsLock);
-    if (mRequestParamMap.find(sequence) != mRequestParamMap.end()) {
-        camera_image_enhancement_t enhancement;
-        int ret = mRequestParamMap[sequence]->param.getImageEnhancement(enhancement);
-        if (ret == OK) {
-            param->setImageEnhancement(enhancement);
-        }
-        camera_edge_mode_t edgeMode;
-        ret = mRequestParamMap[sequence]->param.getEdgeMode(edgeMode);
-        if (ret == OK) {
-            param->setEdgeMode(edgeMode);
-        }
-        camera_nr_mode_t nrMode;
-        ret = mRequestParamMap[sequence]->param.getNrMode(nrMode);
-        if (ret == OK) {
-            param->setNrMode(nrMode);
-        }
-        camera_nr_level_t nrLevel;
-        ret = mRequestParamMap[sequence]->param.getNrLevel(nrLevel);
-        if (ret == OK) {
-            param->setNrLevel(nrLevel);
-        }
-        camera_video_stabilization_mode_t stabilizationMode;
-        ret = mRequestParamMap[sequence]->param.getVideoStabilizationMode(stabilizationMode);
-        if (ret == OK) {
-            param->setVideoStabilizationMode(stabilizationMode);
-        }
-        float hdrRatio;
-        ret = mRequestParamMap[sequence]->param.getHdrRatio(hdrRatio);
-        if (ret == OK) {
-            param->setHdrRatio(hdrRatio);
-        }
+    std::shared_ptr<const RequestParam> requestParam = loadParam(sequence);
+    if (!requestParam) return UNKNOWN_ERROR;
 
-        return OK;
-    }
+    ParameterHelper::copyTags(requestParam->param, tags, tagCount, param);
+    return OK;
+}
 
-    return UNKNOWN_ERROR;
+int ParameterGenerator::getIspParameters(int64_t sequence, Parameters* param) {
+    // Only the tags used by the ISP are copied
+    static const uint32_t kIspTags[] = {
+        INTEL_CONTROL_IMAGE_ENHANCEMENT, CAMERA_EDGE_MODE, INTEL_CONTROL_NR_MODE,
+        INTEL_CONTROL_NR_LEVEL, CAMERA_CONTROL_VIDEO_STABILIZATION_MODE,
+        INTEL_VENDOR_CAMERA_HDR_RATIO,
+    };
+
+    return getParameters(sequence, param, kIspTags, ARRAY_SIZE(kIspTags));
 }
 
 int ParameterGenerator::getZoomRegion(int64_t sequence, camera_zoom_region_t& region) {
     CHECK_SEQUENCE(sequence);
 
-    AutoMutex l(mParamsLock);
-    if (mRequestParamMap.find(sequence) != mRequestParamMap.end()) {
-        return mRequestParamMap[sequence]->param.getZoomRegion(&region);
+    std::shared_ptr<const RequestParam> requestParam = loadParam(sequence);
+    if (requestParam) {
+        return requestParam->param.getZoomRegion(&region);
     }
 
     return UNKNOWN_ERROR;
@@ -273,9 +304,9 @@ int ParameterGenerator::getZoomRegion(int64_t sequence, camera_zoom_region_t& re
 int ParameterGenerator::getRawOutputMode(int64_t sequence, raw_data_output_t& rawOutputMode) {
     CHECK_SEQUENCE(sequence);
 
-    AutoMutex l(mParamsLock);
-    if (mRequestParamMap.find(sequence) != mRequestParamMap.end()) {
-        return mRequestParamMap[sequence]->param.getRawDataOutput(rawOutputMode);
+    std::shared_ptr<const RequestParam> requestParam = loadParam(sequence);
+    if (requestParam) {
+        return requestParam->param.getRawDataOutput(rawOutputMode);
     }
 
     return UNKNOWN_ERROR;
@@ -284,9 +315,9 @@ int ParameterGenerator::getRawOutputMode(int64_t sequence, raw_data_output_t& ra
 int ParameterGenerator::getUserRequestId(int64_t sequence, int32_t& userRequestId) {
     CHECK_SEQUENCE(sequence);
 
-    AutoMutex l(mParamsLock);
-    if (mRequestParamMap.find(sequence) != mRequestParamMap.end()) {
-        return mRequestParamMap[sequence]->param.getUserRequestId(userRequestId);
+    std::shared_ptr<const RequestParam> requestParam = loadParam(sequence);
+    if (requestParam) {
+        return requestParam->param.getUserRequestId(userRequestId);
     }
 
     return UNKNOWN_ERROR;
@@ -295,9 +326,9 @@ int ParameterGenerator::getUserRequestId(int64_t sequence, int32_t& userRequestI
 int ParameterGenerator::getRequestId(int64_t sequence, long& requestId) {
     CHECK_SEQUENCE(sequence);
 
-    AutoMutex l(mParamsLock);
-    if (mRequestParamMap.find(sequence) != mRequestParamMap.end()) {
-        return mRequestParamMap[sequence]->requestId;
+    std::shared_ptr<const RequestParam> requestParam = loadParam(sequence);
+    if (requestParam) {
+        return requestParam->requestId;
     }
 
     LOGE("<seq%ld>Can't find requestId", sequence);
@@ -312,7 +343,9 @@ int ParameterGenerator::generateParametersL(int64_t sequence, Parameters* params
 }
 
 int ParameterGenerator::updateWithAiqResultsL(int64_t sequence, Parameters* params) {
-    const AiqResult* aiqResult = AiqResultStorage::getInstance(mCameraId)->getAiqResult(sequence);
+    AiqResultStorage::AiqResultRef aiqResultRef =
+        AiqResultStorage::getInstance(mCameraId)->getAiqResultRef(sequence);
+    const AiqResult* aiqResult = aiqResultRef.get();
     CheckAndLogError((aiqResult == nullptr), UNKNOWN_ERROR,
                      "%s Aiq result of sequence %ld does not exist", __func__, sequence);
 
@@ -16,8 +16,8 @@
 
 #pragma once
 
-#include <map>
 #include <memory>
+#include <vector>
 
 #include "Parameters.h"
 #include "iutils/Thread.h"
@@ -26,11 +26,12 @@ namespace icamera {
 
 class RequestParam {
  public:
-    RequestParam() : requestId(-1) {}
+    RequestParam() : requestId(-1), sequence(-1) {}
 
     ~RequestParam() {}
 
     long requestId;
+    int64_t sequence;
     Parameters param;
 
  private:
@@ -79,6 +80,10 @@ class ParameterGenerator {
      * \brief Get the parameters for the frame indicated by the sequence id.
      */
     int getParameters(int64_t sequence, Parameters* param, bool setting = true, bool result = true);
+    /**
+     * \brief Get only the given setting tags of the frame, instead of copying all settings.
+     */
+    int getParameters(int64_t sequence, Parameters* param, const uint32_t* tags, size_t tagCount);
     int getRequestId(int64_t predictSequence, long& requestId);
 
  private:
@@ -92,15 +97,29 @@ class ParameterGenerator {
 
     int updateCommonMetadata(Parameters* params, const AiqResult* aiqResult);
 
+    std::shared_ptr<const RequestParam> loadParam(int64_t sequence) const;
+    std::shared_ptr<const RequestParam> findParam(int64_t sequence, bool nearest) const;
+    std::shared_ptr<RequestParam> allocParamL();
+    void storeParamL(std::shared_ptr<RequestParam> requestParam);
+
  private:
     int mCameraId;
     camera_callback_ops_t* mCallback;
     static const int kStorageSize = MAX_SETTING_COUNT;
+    static const size_t kMaxFreeParams = 4;
 
-    // Guard for ParameterGenerator public API.
+    // Serialize the writers of mParamSlots, the readers don't take it.
     Mutex mParamsLock;
-    // first: sequence id, second: RequestParam data
-    std::map<int64_t, std::shared_ptr<RequestParam> > mRequestParamMap;
+    /*
+     * Slot (sequence % kStorageSize) holds the settings of the sequence. A slot is an immutable
+     * snapshot replaced as a whole by atomic shared_ptr load/store, so the PSys, 3A and result
+     * threads read the settings without contending with each other.
+     */
+    std::shared_ptr<const RequestParam> mParamSlots[kStorageSize];
+    std::vector<std::shared_ptr<RequestParam>> mFreeParams;  // Evicted and not referenced
+
+    // Guard the result generation, which updates mPaCcm.
+    Mutex mResultLock;
 
     std::unique_ptr<float[]> mTonemapCurveRed;
     std::unique_ptr<float[]> mTonemapCurveBlue;
@@ -111,4 +111,15 @@ void ParameterHelper::mergeTag(const icamera_metadata_ro_entry& entry, Parameter
     }
 }
 
+void ParameterHelper::copyTags(const Parameters& src, const uint32_t* tags, size_t tagCount,
+                               Parameters* dst) {
+    CheckAndLogError(!dst || !tags || &src == dst, VOID_VALUE, "invalid copy of tags");
+
+    AutoRLock rl(src.mData);
+    for (size_t i = 0; i < tagCount; i++) {
+        icamera_metadata_ro_entry entry = getMetadataEntry(src.mData, tags[i]);
+        if (entry.count > 0) mergeTag(entry, dst);
+    }
+}
+
 }  // end of namespace icamera
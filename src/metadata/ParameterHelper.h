@@ -62,6 +62,21 @@ class ParameterHelper {
      */
     static void mergeTag(const icamera_metadata_ro_entry& entry, Parameters* dst);
 
+    /**
+     * \brief Copy only the given tags from src to dst, the tags src doesn't have are skipped.
+     *
+     * It's much cheaper than copying the whole parameters when the caller uses a few tags.
+     *
+     * \param[in] Parameters src: the source parameter.
+     * \param[in] const uint32_t* tags: the tags to be copied.
+     * \param[in] size_t tagCount: the number of tags.
+     * \param[out] Parameters dst: the parameter to be updated.
+     *
+     * \return void
+     */
+    static void copyTags(const Parameters& src, const uint32_t* tags, size_t tagCount,
+                         Parameters* dst);
+
     /**
      * \brief Copy metadata from parameter buffer.
      *
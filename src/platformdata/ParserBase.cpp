@@ -19,6 +19,7 @@
 
 #include <expat.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include <memory>
 #include <string>
@@ -27,6 +28,7 @@
 #include "iutils/CameraLog.h"
 #include "iutils/Errors.h"
 #include "iutils/Utils.h"
+#include "platformdata/PlatformData.h"
 
 namespace icamera {
 
@@ -27,7 +27,12 @@
 
 #pragma once
 
-#include "PlatformData.h"
+#include <string>
+#include <vector>
+
+#include "iutils/CameraLog.h"
+#include "iutils/Errors.h"
+#include "iutils/Utils.h"
 
 namespace icamera {
 
@@ -1033,6 +1033,11 @@ int PlatformData::getDevNameByType(int cameraId, VideoNodeType videoNodeType, st
         if (videoNodeType == nd.videoNodeType) {
             string tmpDevName;
             CameraUtils::getDeviceName(nd.name.c_str(), tmpDevName, isSubDev);
+            if (tmpDevName.empty()) {
+                // No sysfs entry for the virtual IPU, the media graph knows the node as well
+                MediaControl* mediaCtl = MediaControl::getInstance();
+                if (mediaCtl) tmpDevName = mediaCtl->getEntityDevName(nd.name.c_str());
+            }
             if (!tmpDevName.empty()) {
                 devName = tmpDevName;
                 LOG2("@%s, Found DevName. cameraId: %d, get video node: %s, devname: %s", __func__,
@@ -29,12 +29,17 @@ namespace icamera {
 GraphConfigManager::GraphConfigManager(int32_t cameraId)
         : mGcConfigured(false),
           mCameraId(cameraId),
-          mMcId(-1) {}
+          mMcId(-1),
+          mGraphCacheHits(0),
+          mGraphCacheMisses(0) {}
 
 GraphConfigManager::~GraphConfigManager() {
+    LOG1("<id%d> graph cache hits %u, misses %u", mCameraId, mGraphCacheHits, mGraphCacheMisses);
+
     mGraphConfigMap.clear();
     mGcConfigured = false;
-    releaseHalStream(&mHalStreamVec);
+    mHalStreamVec.clear();
+    clearGraphCache();
 }
 
 void GraphConfigManager::releaseHalStream(std::vector<HalStream*>* halStreamVec) {
@@ -151,9 +156,20 @@ status_t GraphConfigManager::configStreams(const stream_config_t* streamList) {
                                                           configModes);
     CheckAndLogError(ret != OK, ret, "%s, get ConfigMode failed %d", __func__, ret);
 
+    std::vector<int32_t> key;
+    createCacheKey(streamList, &key);
+    if (useCachedGraph(key)) {
+        LOG1("<id%d> %s, use the cached graph, hits %u, misses %u", mCameraId, __func__,
+             mGraphCacheHits, mGraphCacheMisses);
+        dumpStreamConfig();
+        mGcConfigured = true;
+        return OK;
+    }
+    mGraphCacheMisses++;
+
     // Convert the stream_t to HalStream
     // Use the stream list with descending order to find graph settings.
-    releaseHalStream(&mHalStreamVec);
+    mHalStreamVec.clear();
     ret = createHalStreamVector(configModes[0], streamList, &mHalStreamVec);
     CheckAndLogError(ret != OK, ret, "%s, create hal stream failed %d", __func__, ret);
 
@@ -168,21 +184,105 @@ status_t GraphConfigManager::configStreams(const stream_config_t* streamList) {
         std::shared_ptr<GraphConfig> graphConfig = std::make_shared<GraphConfig>(mCameraId, mode);
         CheckAndLogError(!graphConfig, UNKNOWN_ERROR, "%s, Failed to create graphConfig", __func__);
         ret = graphConfig->configStreams(mHalStreamVec);
-        CheckWarning(ret != OK, ret, "%s, Failed to configure graph: real ConfigMode %x", __func__,
-                     mode);
+        if (ret != OK) {
+            LOGW("%s, Failed to configure graph: real ConfigMode %x", __func__, mode);
+            // Not cached, release the HalStreams here.
+            mGraphConfigMap.clear();
+            releaseHalStream(&mHalStreamVec);
+            return ret;
+        }
 
         int id = graphConfig->getSelectedMcId();
-        CheckAndLogError((id != -1 && mMcId != -1 && mMcId != id), UNKNOWN_ERROR,
-                         "Not support two different MC ID at same time:(%d/%d)", mMcId, id);
+        if (id != -1 && mMcId != -1 && mMcId != id) {
+            LOGE("Not support two different MC ID at same time:(%d/%d)", mMcId, id);
+            mGraphConfigMap.clear();
+            releaseHalStream(&mHalStreamVec);
+            return UNKNOWN_ERROR;
+        }
         mMcId = id;
         LOG2("%s: Add graph setting for op_mode %d", __func__, mode);
         mGraphConfigMap[mode] = graphConfig;
     }
 
+    addCachedGraph(key);
     mGcConfigured = true;
     return OK;
 }
 
+/*
+ * The key contains all the stream fields used in graph query, and the stream order
+ * is kept since the stream ids come from it.
+ */
+void GraphConfigManager::createCacheKey(const stream_config_t* streamList,
+                                        std::vector<int32_t>* key) {
+    key->clear();
+    key->push_back(streamList->operation_mode);
+    for (int i = 0; i < streamList->num_streams; i++) {
+        const stream_t& s = streamList->streams[i];
+        key->push_back(s.format);
+        key->push_back(s.width);
+        key->push_back(s.height);
+        key->push_back(s.id);
+        key->push_back(s.usage);
+        key->push_back(s.streamType);
+    }
+}
+
+/*
+ * Find the graph of key in cache, and make it as the current one if found.
+ */
+bool GraphConfigManager::useCachedGraph(const std::vector<int32_t>& key) {
+#ifdef ENABLE_SANDBOXING
+    // The sandbox keeps one graph per ConfigMode, so the cached client objects may be stale.
+    return false;
+#else
+    for (auto it = mGraphCache.begin(); it != mGraphCache.end(); ++it) {
+        if (it->key != key) continue;
+
+        mGraphCache.splice(mGraphCache.begin(), mGraphCache, it);
+        const GraphCacheEntry& entry = mGraphCache.front();
+        mHalStreamVec = entry.halStreams;
+        mGraphConfigMap = entry.graphConfigs;
+        mMcId = entry.mcId;
+        mGraphCacheHits++;
+        return true;
+    }
+
+    return false;
+#endif
+}
+
+/*
+ * Save the current graph to cache, the least recently used one is released if it's full.
+ */
+void GraphConfigManager::addCachedGraph(const std::vector<int32_t>& key) {
+#ifdef ENABLE_SANDBOXING
+    if (!mGraphCache.empty()) {
+        releaseHalStream(&mGraphCache.front().halStreams);
+        mGraphCache.clear();
+    }
+#endif
+    GraphCacheEntry entry = {key, mHalStreamVec, mGraphConfigMap, mMcId};
+    mGraphCache.push_front(entry);
+
+    while (mGraphCache.size() > kGraphCacheSize) {
+        releaseHalStream(&mGraphCache.back().halStreams);
+        mGraphCache.pop_back();
+    }
+}
+
+void GraphConfigManager::clearGraphCache() {
+    for (auto& entry : mGraphCache) {
+        releaseHalStream(&entry.halStreams);
+    }
+    mGraphCache.clear();
+}
+
+void GraphConfigManager::getGraphCacheStats(uint32_t* hits, uint32_t* misses) {
+    if (hits) *hits = mGraphCacheHits;
+    if (misses) *misses = mGraphCacheMisses;
+}
+
 std::shared_ptr<IGraphConfig> GraphConfigManager::getGraphConfig(ConfigMode configMode) {
     for (auto& gc : mGraphConfigMap) {
         if (gc.first == configMode) {
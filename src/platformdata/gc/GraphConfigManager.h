@@ -18,6 +18,8 @@
 
 #include <gcss.h>
 
+#include <list>
+#include <map>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -51,6 +53,10 @@ namespace icamera {
  * Per each request, GraphConfigManager creates GraphConfig objects based
  * on request content. These objects are owned by GCM in a pool, and passed
  * around HAL via shared pointers.
+ *
+ * The GraphConfig objects of the recent stream configurations are kept in a
+ * small LRU cache, so switching back to a known configuration (e.g. preview and
+ * recording toggling) reuses them without running the GCSS queries again.
  */
 class GraphConfigManager : public IGraphConfigManager {
  public:
@@ -63,6 +69,7 @@ class GraphConfigManager : public IGraphConfigManager {
     virtual std::shared_ptr<IGraphConfig> getGraphConfig(ConfigMode configMode);
     virtual int getSelectedMcId() { return mMcId; }
     virtual bool isGcConfigured(void) { return mGcConfigured; }
+    virtual void getGraphCacheStats(uint32_t* hits, uint32_t* misses);
 
  private:
     // Disable copy constructor and assignment operator
@@ -77,12 +84,36 @@ class GraphConfigManager : public IGraphConfigManager {
     // Debuging helpers
     void dumpStreamConfig();
 
+    /**
+     * Configured graphs of one stream configuration.
+     * It owns the HalStreams since the GraphConfig objects refer to them.
+     */
+    struct GraphCacheEntry {
+        std::vector<int32_t> key;
+        std::vector<HalStream*> halStreams;
+        std::map<ConfigMode, std::shared_ptr<GraphConfig> > graphConfigs;
+        int mcId;
+    };
+
+    static void createCacheKey(const stream_config_t* streamList, std::vector<int32_t>* key);
+    bool useCachedGraph(const std::vector<int32_t>& key);
+    void addCachedGraph(const std::vector<int32_t>& key);
+    void clearGraphCache();
+
  private:
+    static const size_t kGraphCacheSize = 4;
+
     bool mGcConfigured;
     int32_t mCameraId;
     std::map<ConfigMode, std::shared_ptr<GraphConfig> > mGraphConfigMap;
+    // Point to the HalStreams of the current configuration, owned by mGraphCache
     std::vector<HalStream*> mHalStreamVec;
     int mMcId;
+
+    // The most recently used configuration is at the front
+    std::list<GraphCacheEntry> mGraphCache;
+    uint32_t mGraphCacheHits;
+    uint32_t mGraphCacheMisses;
 };
 
 }  // namespace icamera
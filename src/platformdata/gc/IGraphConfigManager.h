@@ -33,6 +33,8 @@ class IGraphConfigManager {
     virtual int getSelectedMcId() = 0;
     virtual std::shared_ptr<IGraphConfig> getGraphConfig(ConfigMode configMode) = 0;
     virtual bool isGcConfigured(void) = 0;
+    // Hit and miss counts of the configured graph cache, for debugging and profiling
+    virtual void getGraphCacheStats(uint32_t* hits, uint32_t* misses) = 0;
     static void releaseInstance(int cameraId);
     static IGraphConfigManager* getInstance(int cameraId);
 
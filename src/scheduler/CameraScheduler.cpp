@@ -18,15 +18,38 @@
 
 #include "src/scheduler/CameraScheduler.h"
 
+#include <atomic>
 #include <map>
+#include <set>
 #include <sstream>
+#include <string>
 #include <utility>
 
 #include "iutils/CameraLog.h"
 #include "iutils/Errors.h"
+#include "iutils/WorkerPool.h"
 
 namespace icamera {
 
+// The nodes may run the default shared pool, so the parallel executors have their own one
+static const char* kSchedulerPoolName = "SchedWorker";
+
+// The nodes with a cpu hint run in one worker pinned to that cpu once, shared by the executors
+static const char* kSchedulerCpuPoolPrefix = "SchedCpu";
+
+static WorkerPool* getCpuPool(int32_t cpu) {
+    if (cpu < 0) return nullptr;
+    return WorkerPool::getSharedPool(kSchedulerCpuPoolPrefix + std::to_string(cpu), 1, cpu);
+}
+
+static bool processOnPool(ISchedulerNode* node, WorkerPool* cpuPool, int64_t tick) {
+    if (!cpuPool) return node->process(tick);
+
+    bool ret = false;
+    cpuPool->runOnWorkers(1, [&](int) { ret = node->process(tick); });
+    return ret;
+}
+
 CameraScheduler::CameraScheduler() : mTriggerCount(0) {
     mPolicy = CameraSchedulerPolicy::getInstance();
 }
@@ -53,6 +76,10 @@ int32_t CameraScheduler::createExecutors() {
     for (auto& exe : executors) {
         ExecutorGroup group;
         group.executor = std::shared_ptr<Executor>(new Executor(exe.first));
+        bool parallel = false;
+        std::map<std::string, CameraSchedulerPolicy::NodeHint> hints;
+        mPolicy->getParallelHints(exe.first, &parallel, &hints);
+        if (parallel) group.executor->setParallel(hints);
         group.triggerSource = exe.second;
         if (!group.triggerSource.empty()) {
             // Check if trigger source is one executor
@@ -122,7 +149,10 @@ std::shared_ptr<CameraScheduler::Executor> CameraScheduler::findExecutor(const c
 CameraScheduler::Executor::Executor(const char* name)
         : mName(name ? name : "unknown"),
           mActive(false),
-          mTriggerTick(0) {}
+          mTriggerTick(0),
+          mTriggered(false),
+          mParallel(false),
+          mWavesDirty(true) {}
 
 CameraScheduler::Executor::~Executor() {
     LOG1("%s: destory", getName());
@@ -132,6 +162,7 @@ CameraScheduler::Executor::~Executor() {
 void CameraScheduler::Executor::addNode(ISchedulerNode* node) {
     std::lock_guard<std::mutex> l(mNodeLock);
     mNodes.push_back(node);
+    mWavesDirty = true;
     LOG1("%s: %s added to %s, pos %d", __func__, node->getName(), getName(), mNodes.size());
 }
 
@@ -141,16 +172,26 @@ void CameraScheduler::Executor::removeNode(ISchedulerNode* node) {
         if (mNodes[i] == node) {
             LOG1("%s: %s moved from %s", __func__, node->getName(), getName());
             mNodes.erase(mNodes.begin() + i);
+            mWavesDirty = true;
             break;
         }
     }
 }
 
+void CameraScheduler::Executor::setParallel(
+    const std::map<std::string, CameraSchedulerPolicy::NodeHint>& hints) {
+    std::lock_guard<std::mutex> l(mNodeLock);
+    mParallel = true;
+    mNodeHints = hints;
+    mWavesDirty = true;
+}
+
 void CameraScheduler::Executor::trigger(int64_t tick) {
     PERF_CAMERA_ATRACE_PARAM1(getName(), tick);
     std::lock_guard<std::mutex> l(mNodeLock);
     mActive = true;
     mTriggerTick = tick;
+    mTriggered = true;
     mTriggerSignal.signal();
 }
 
@@ -164,19 +205,32 @@ void CameraScheduler::Executor::requestExit() {
 
 bool CameraScheduler::Executor::threadLoop() {
     int64_t tick = -1;
+    std::vector<std::vector<ParallelNode>> waves;
     {
         ConditionLock lock(mNodeLock);
-        int ret = mTriggerSignal.waitRelative(lock, kWaitDuration * SLOWLY_MULTIPLIER);
-        CheckWarning(ret == TIMED_OUT && !mNodes.empty(), true, "%s: wait trigger time out",
-                     getName());
+        if (!mTriggered) {
+            int ret = mTriggerSignal.waitRelative(lock, kWaitDuration * SLOWLY_MULTIPLIER);
+            CheckWarning(ret == TIMED_OUT && !mNodes.empty(), true, "%s: wait trigger time out",
+                         getName());
+        }
+        mTriggered = false;
         tick = mTriggerTick;
+        if (mParallel) {
+            if (mWavesDirty) buildWaves();
+            waves = mWaves;
+        }
     }
     if (!mActive) return false;
 
-    for (auto& node : mNodes) {
-        LOG2("%s process %d", getName(), tick);
-        bool ret = node->process(tick);
-        CheckAndLogError(!ret, true, "%s: node %s process error", getName(), node->getName());
+    if (mParallel) {
+        if (!processWaves(waves, tick)) return true;
+    } else {
+        for (auto& node : mNodes) {
+            LOG2("%s process %d", getName(), tick);
+            bool ret = node->process(tick);
+            CheckAndLogError(!ret, true, "%s: node %s process error", getName(),
+                             node->getName());
+        }
     }
 
     for (auto& listener : mListeners) {
@@ -186,4 +240,75 @@ bool CameraScheduler::Executor::threadLoop() {
     return true;
 }
 
+// Need to hold mNodeLock
+void CameraScheduler::Executor::buildWaves() {
+    mWaves.clear();
+    mWavesDirty = false;
+
+    std::set<std::string> pendingNames;
+    for (auto& node : mNodes) pendingNames.insert(node->getName());
+
+    std::vector<ISchedulerNode*> pending = mNodes;
+    while (!pending.empty()) {
+        std::vector<ParallelNode> wave;
+        std::vector<ISchedulerNode*> blocked;
+        for (auto& node : pending) {
+            auto hint = mNodeHints.find(node->getName());
+            bool ready = true;
+            if (hint != mNodeHints.end()) {
+                // The dependencies which aren't registered are ignored
+                for (auto& depend : hint->second.depends) {
+                    if (pendingNames.find(depend) != pendingNames.end()) ready = false;
+                }
+            }
+            int32_t cpu = hint != mNodeHints.end() ? hint->second.cpu : -1;
+            if (ready) {
+                wave.push_back({node, getCpuPool(cpu)});
+            } else {
+                blocked.push_back(node);
+            }
+        }
+
+        if (wave.empty()) {
+            // Circular dependencies, run the left nodes one by one in the registration order
+            LOGE("%s: circular dependencies among %zu nodes", getName(), blocked.size());
+            for (auto& node : blocked) {
+                auto hint = mNodeHints.find(node->getName());
+                int32_t cpu = hint != mNodeHints.end() ? hint->second.cpu : -1;
+                mWaves.push_back({{node, getCpuPool(cpu)}});
+            }
+            break;
+        }
+
+        for (auto& item : wave) pendingNames.erase(item.node->getName());
+        LOG1("%s: wave %zu has %zu nodes", getName(), mWaves.size(), wave.size());
+        mWaves.push_back(wave);
+        pending.swap(blocked);
+    }
+}
+
+bool CameraScheduler::Executor::processWaves(const std::vector<std::vector<ParallelNode>>& waves,
+                                             int64_t tick) {
+    for (auto& wave : waves) {
+        LOG2("%s process %d, %zu nodes", getName(), tick, wave.size());
+        if (wave.size() == 1) {
+            bool ret = processOnPool(wave[0].node, wave[0].cpuPool, tick);
+            CheckAndLogError(!ret, false, "%s: node %s process error", getName(),
+                             wave[0].node->getName());
+            continue;
+        }
+
+        std::atomic<bool> failed(false);
+        WorkerPool::getSharedPool(kSchedulerPoolName)->parallelFor(wave.size(), [&](int i) {
+            if (!processOnPool(wave[i].node, wave[i].cpuPool, tick)) {
+                LOGE("%s: node %s process error", getName(), wave[i].node->getName());
+                failed = true;
+            }
+        });
+        // The nodes depending on the failed one can't run
+        if (failed) return false;
+    }
+    return true;
+}
+
 }  // namespace icamera
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -25,6 +26,7 @@
 #include "CameraEvent.h"
 #include "CameraSchedulerPolicy.h"
 #include "ISchedulerNode.h"
+#include "iutils/WorkerPool.h"
 
 namespace icamera {
 
@@ -70,9 +72,23 @@ class CameraScheduler {
         void removeNode(ISchedulerNode* node);
         void addListener(std::shared_ptr<Executor> executor) { mListeners.push_back(executor); }
         void trigger(int64_t tick);
+        /**
+         * Run the nodes in waves instead of one by one, the nodes of one wave don't depend on
+         * each other and run concurrently in the scheduler worker pool.
+         */
+        void setParallel(const std::map<std::string, CameraSchedulerPolicy::NodeHint>& hints);
 
         const char* getName() { return mName.c_str(); }
 
+     private:
+        struct ParallelNode {
+            ISchedulerNode* node;
+            WorkerPool* cpuPool;  // The worker pinned to the cpu of the hint, or nullptr
+        };
+
+        void buildWaves();
+        bool processWaves(const std::vector<std::vector<ParallelNode>>& waves, int64_t tick);
+
      private:
         static const nsecs_t kWaitDuration = 2000000000;  // 2s
 
@@ -84,6 +100,12 @@ class CameraScheduler {
         Condition mTriggerSignal;
         bool mActive;
         int64_t mTriggerTick;
+        bool mTriggered;  // The trigger isn't processed yet, it may come before the wait
+
+        bool mParallel;
+        std::map<std::string, CameraSchedulerPolicy::NodeHint> mNodeHints;
+        std::vector<std::vector<ParallelNode>> mWaves;
+        bool mWavesDirty;  // Rebuild mWaves since the nodes are changed
 
      private:
         DISALLOW_COPY_AND_ASSIGN(Executor);
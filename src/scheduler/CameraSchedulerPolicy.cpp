@@ -98,6 +98,21 @@ int32_t CameraSchedulerPolicy::getNodeList(const char* exeName,
     return BAD_VALUE;
 }
 
+int32_t CameraSchedulerPolicy::getParallelHints(const char* exeName, bool* parallel,
+                                                std::map<std::string, NodeHint>* hints) const {
+    CheckAndLogError(!parallel || !hints, BAD_VALUE, "nullptr input");
+    CheckAndLogError(!mActiveConfig, BAD_VALUE, "No config");
+
+    for (auto& exe : mActiveConfig->exeList) {
+        if (strcmp(exe.exeName.c_str(), exeName) == 0) {
+            *parallel = exe.parallel;
+            *hints = exe.nodeHints;
+            return OK;
+        }
+    }
+    return BAD_VALUE;
+}
+
 void CameraSchedulerPolicy::checkField(CameraSchedulerPolicy* profiles, const char* name,
                                        const char** atts) {
     LOG1("@%s, name:%s", __func__, name);
@@ -144,6 +159,8 @@ void CameraSchedulerPolicy::handleExecutor(CameraSchedulerPolicy* profiles, cons
             parseXmlConvertStrings(atts[idx + 1], desc.nodeList, convertCharToString);
         } else if (strcmp(key, "trigger") == 0) {
             desc.triggerName = atts[idx + 1];
+        } else if (strcmp(key, "parallel") == 0) {
+            desc.parallel = strcmp(atts[idx + 1], "true") == 0;
         } else {
             LOGW("Invalid policy attribute: %s", key);
         }
@@ -154,11 +171,40 @@ void CameraSchedulerPolicy::handleExecutor(CameraSchedulerPolicy* profiles, cons
     profiles->mPolicyConfigs[profiles->mCurrentConfig].exeList.push_back(desc);
 }
 
+void CameraSchedulerPolicy::handleNode(CameraSchedulerPolicy* profiles, const char* name,
+                                       const char** atts) {
+    std::vector<ExecutorDesc>& exeList = profiles->mPolicyConfigs[profiles->mCurrentConfig].exeList;
+    CheckAndLogError(exeList.empty(), VOID_VALUE, "@%s, node isn't in any executor", __func__);
+
+    int idx = 0;
+    std::string nodeName;
+    NodeHint hint;
+    while (atts[idx]) {
+        const char* key = atts[idx];
+        LOG2("%s: name: %s, value: %s", __func__, atts[idx], atts[idx + 1]);
+        if (strcmp(key, "name") == 0) {
+            nodeName = atts[idx + 1];
+        } else if (strcmp(key, "depends") == 0) {
+            parseXmlConvertStrings(atts[idx + 1], hint.depends, convertCharToString);
+        } else if (strcmp(key, "cpu") == 0) {
+            hint.cpu = atoi(atts[idx + 1]);
+        } else {
+            LOGW("Invalid node attribute: %s", key);
+        }
+        idx += 2;
+    }
+
+    CheckAndLogError(nodeName.empty(), VOID_VALUE, "@%s, node without name", __func__);
+    exeList.back().nodeHints[nodeName] = hint;
+}
+
 void CameraSchedulerPolicy::handlePolicyConfig(CameraSchedulerPolicy* profiles, const char* name,
                                                const char** atts) {
     LOG2("@%s, name:%s, atts[0]:%s", __func__, name, atts[0]);
     if (strcmp(name, "pipe_executor") == 0) {
         handleExecutor(profiles, name, atts);
+    } else if (strcmp(name, "node") == 0) {
+        handleNode(profiles, name, atts);
     }
 }
 
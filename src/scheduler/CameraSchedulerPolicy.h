@@ -16,15 +16,24 @@
 
 #pragma once
 
+#include <map>
 #include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "ParserBase.h"
+#include "iutils/Thread.h"
 
 namespace icamera {
 
+/**
+ * The executors of one config are the pipe_executor elements in pipe_scheduler_profiles.xml:
+ *   <pipe_executor name="exe" nodes="a,b,c" trigger="source" parallel="true">
+ *       <node name="c" depends="a,b" cpu="2"/>
+ *   </pipe_executor>
+ * parallel, and the node elements which are only used by the parallel executors, are optional.
+ */
 class CameraSchedulerPolicy : public ParserBase {
  public:
     static CameraSchedulerPolicy* getInstance();
@@ -36,10 +45,23 @@ class CameraSchedulerPolicy : public ParserBase {
     ~CameraSchedulerPolicy();
 
  public:
+    struct NodeHint {
+        std::vector<std::string> depends;  // The nodes of the same executor run before it
+        int32_t cpu;                       // The cpu to run it on, -1 for any one
+
+        NodeHint() : cpu(-1) {}
+    };
+
     int32_t setConfig(uint32_t graphId);
     // Return <exeName, trigger source name>
     int32_t getExecutors(std::map<const char*, const char*>* executors) const;
     int32_t getNodeList(const char* exeName, std::vector<std::string>* nodeList) const;
+    /**
+     * The nodes of the parallel executor run concurrently unless they depend on each other,
+     * and hints are <node name, hint> of the nodes which have the node element in xml.
+     */
+    int32_t getParallelHints(const char* exeName, bool* parallel,
+                             std::map<std::string, NodeHint>* hints) const;
 
     void startParseElement(void* userData, const char* name, const char** atts);
     void endParseElement(void* userData, const char* name);
@@ -49,6 +71,10 @@ class CameraSchedulerPolicy : public ParserBase {
         std::string exeName;
         std::string triggerName;
         std::vector<std::string> nodeList;
+        bool parallel;
+        std::map<std::string, NodeHint> nodeHints;
+
+        ExecutorDesc() : parallel(false) {}
     };
 
     struct PolicyConfigDesc {
@@ -67,6 +93,7 @@ class CameraSchedulerPolicy : public ParserBase {
     void checkField(CameraSchedulerPolicy* profiles, const char* name, const char** atts);
     void handlePolicyConfig(CameraSchedulerPolicy* profiles, const char* name, const char** atts);
     void handleExecutor(CameraSchedulerPolicy* profiles, const char* name, const char** atts);
+    void handleNode(CameraSchedulerPolicy* profiles, const char* name, const char** atts);
 
  private:
     enum DataField {
@@ -74,7 +74,7 @@ MediaControl* MediaControl::getMediaControlInstance() {
         fileName.append(std::to_string(i));
 
         struct stat fileStat = {};
-        int ret = stat(fileName.c_str(), &fileStat);
+        int ret = SysCall::getInstance()->stat(fileName.c_str(), &fileStat);
         if (ret != 0) {
             LOG1("%s: There is no file %s", __func__, fileName.c_str());
             continue;
@@ -182,6 +182,15 @@ int MediaControl::getEntityIdByName(const char* name) {
     return entity->info.id;
 }
 
+std::string MediaControl::getEntityDevName(const char* name) {
+    MediaEntity* entity = getEntityByName(name);
+    if (!entity) {
+        return std::string();
+    }
+
+    return entity->devname;
+}
+
 int MediaControl::resetAllLinks() {
     LOG1("@%s", __func__);
 
@@ -484,7 +493,7 @@ int MediaControl::getDevnameFromSysfs(MediaEntity* entity) {
         return -EINVAL;
     }
 
-    ret = readlink(sysName, target, MAX_TARGET_NAME);
+    ret = SysCall::getInstance()->readlink(sysName, target, MAX_TARGET_NAME);
     if (ret <= 0) {
         LOGE("readlink sysName %s failed ret %d.", sysName, ret);
         return -EINVAL;
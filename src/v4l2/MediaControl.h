@@ -235,6 +235,13 @@ class MediaControl {
      */
     int getEntityIdByName(const char* name);
 
+    /**
+     * \brief Get the device node name of the entity, e.g. /dev/v4l-subdev3
+     *
+     * \return empty string if the entity has no device node
+     */
+    std::string getEntityDevName(const char* name);
+
     /**
      * \brief Get VCM I2C bus address
      *
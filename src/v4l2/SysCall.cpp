@@ -18,6 +18,7 @@
 
 #include "SysCall.h"
 
+#include "VirtualIpu.h"
 #include "iutils/CameraLog.h"
 
 namespace icamera {
@@ -31,8 +32,9 @@ Mutex SysCall::sLock;
 /*static*/ SysCall* SysCall::getInstance() {
     AutoMutex lock(sLock);
     if (!sIsInitialized) {
-        // Use real sys call as default
-        sInstance = new SysCall();
+        // Use the virtual IPU if it's configured, otherwise the real sys call as default
+        sInstance = VirtualIpu::createInstance();
+        if (!sInstance) sInstance = new SysCall();
         sIsInitialized = true;
     }
     return sInstance;
@@ -74,6 +76,14 @@ int SysCall::munmap(void* addr, size_t len) {
     return ::munmap(addr, len);
 }
 
+int SysCall::stat(const char* pathname, struct stat* buf) {
+    return ::stat(pathname, buf);
+}
+
+ssize_t SysCall::readlink(const char* pathname, char* buf, size_t bufsiz) {
+    return ::readlink(pathname, buf, bufsiz);
+}
+
 int SysCall::ioctl(int fd, int request, struct media_device_info* arg) {
     return ioctl(fd, request, reinterpret_cast<void*>(arg));
 }
@@ -156,6 +166,34 @@ int SysCall::ioctl(int fd, int request, struct v4l2_exportbuffer* arg) {
     return ioctl(fd, request, reinterpret_cast<void*>(arg));
 }
 
+int SysCall::ioctl(int fd, int request, struct v4l2_selection* arg) {
+    return ioctl(fd, request, reinterpret_cast<void*>(arg));
+}
+
+int SysCall::ioctl(int fd, int request, struct ipu_psys_capability* arg) {
+    return ioctl(fd, request, reinterpret_cast<void*>(arg));
+}
+
+int SysCall::ioctl(int fd, int request, struct ipu_psys_manifest* arg) {
+    return ioctl(fd, request, reinterpret_cast<void*>(arg));
+}
+
+int SysCall::ioctl(int fd, int request, struct ipu_psys_buffer* arg) {
+    return ioctl(fd, request, reinterpret_cast<void*>(arg));
+}
+
+int SysCall::ioctl(int fd, int request, struct ipu_psys_command* arg) {
+    return ioctl(fd, request, reinterpret_cast<void*>(arg));
+}
+
+int SysCall::ioctl(int fd, int request, struct ipu_psys_event* arg) {
+    return ioctl(fd, request, reinterpret_cast<void*>(arg));
+}
+
+int SysCall::ioctl(int fd, int request, int arg) {
+    return ioctl(fd, request, reinterpret_cast<void*>(static_cast<intptr_t>(arg)));
+}
+
 int SysCall::ioctl(int fd, int request, void* arg) {
     int ret = 0;
     do {
@@ -30,6 +30,13 @@
 
 #include "iutils/Thread.h"
 
+// The PSys structs are defined in modules/ia_cipr/include/ipu-psys.h
+struct ipu_psys_capability;
+struct ipu_psys_manifest;
+struct ipu_psys_buffer;
+struct ipu_psys_command;
+struct ipu_psys_event;
+
 namespace icamera {
 
 class SysCall {
@@ -42,6 +49,8 @@ class SysCall {
     virtual int close(int fd);
     virtual void* mmap(void* addr, size_t len, int prot, int flag, int filedes, off_t off);
     virtual int munmap(void* addr, size_t len);
+    virtual int stat(const char* pathname, struct stat* buf);
+    virtual ssize_t readlink(const char* pathname, char* buf, size_t bufsiz);
 
     virtual int ioctl(int fd, int request, struct media_device_info* arg);
     virtual int ioctl(int fd, int request, struct media_link_desc* arg);
@@ -67,15 +76,25 @@ class SysCall {
     virtual int ioctl(int fd, int request, struct v4l2_event_subscription* arg);
     virtual int ioctl(int fd, int request, struct v4l2_event* arg);
     virtual int ioctl(int fd, int request, struct v4l2_exportbuffer* arg);
+    virtual int ioctl(int fd, int request, struct v4l2_selection* arg);
+    virtual int ioctl(int fd, int request, struct ipu_psys_capability* arg);
+    virtual int ioctl(int fd, int request, struct ipu_psys_manifest* arg);
+    virtual int ioctl(int fd, int request, struct ipu_psys_buffer* arg);
+    virtual int ioctl(int fd, int request, struct ipu_psys_command* arg);
+    virtual int ioctl(int fd, int request, struct ipu_psys_event* arg);
+    // For the requests whose argument is a value, e.g. the fd of IPU_IOC_MAPBUF
+    virtual int ioctl(int fd, int request, int arg);
 
     virtual int poll(struct pollfd* pfd, nfds_t nfds, int timeout);
 
     static SysCall* getInstance();
     static void updateInstance(SysCall* newSysCall);
 
- private:
-    int ioctl(int fd, int request, void* arg);
+ protected:
+    // All the typed ioctls end up here, the backends only need to override it
+    virtual int ioctl(int fd, int request, void* arg);
 
+ private:
     SysCall& operator=(const SysCall&);  // Don't call me
 
     static bool sIsInitialized;
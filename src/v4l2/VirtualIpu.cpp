@@ -0,0 +1,1186 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG VirtualIpu
+
+#include "VirtualIpu.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/sysmacros.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "MediaControl.h"
+#include "iutils/CameraLog.h"
+#include "iutils/Errors.h"
+
+namespace icamera {
+
+static const char* kMediaDevName = "/dev/media0";
+static const char* kPsysDevName = "/dev/ipu-psys0";
+static const char* kSysCharPrefix = "/sys/dev/char/";
+static const int kDefaultFps = 30;
+static const int64_t kDefaultPsysCommandTime = 5000000;  // 5ms
+static const size_t kMaxPendingEvents = 32;
+static const int64_t kIdleWaitTime = 100000000;  // 100ms
+static const int64_t kPollRetryTime = 1000000;   // 1ms
+
+VirtualIpu* VirtualIpu::createInstance() {
+    const char* graphFile = getenv("cameraVirtualIpu");
+    if (!graphFile) return nullptr;
+
+    VirtualIpu* ipu = new VirtualIpu();
+    if (ipu->loadGraph(graphFile) != OK) {
+        LOGE("Failed to load the virtual IPU graph %s, use the real sys call", graphFile);
+        delete ipu;
+        return nullptr;
+    }
+
+    ipu->mFrameThread->run("VirtualIpuFrame", PRIORITY_URGENT_AUDIO);
+    ipu->mPsysThread->run("VirtualIpuPsys", PRIORITY_URGENT_AUDIO);
+    LOG1("%s: virtual IPU with %zu entities and %zu links", __func__, ipu->mEntities.size(),
+         ipu->mLinks.size());
+    return ipu;
+}
+
+VirtualIpu::VirtualIpu()
+        : mFrameThread(new FrameThread(this)),
+          mFrameInterval(1000000000LL / kDefaultFps),
+          mNextFrameTime(0),
+          mSequence(0),
+          mStreamingCount(0),
+          mPsysThread(new PsysThread(this)),
+          mPsysCommandTime(kDefaultPsysCommandTime),
+          mPsysDoneTime(0) {
+    const char* fps = getenv("cameraVirtualIpuFps");
+    if (fps && atoi(fps) > 0) mFrameInterval = 1000000000LL / atoi(fps);
+
+    const char* psysTime = getenv("cameraVirtualIpuPsysUs");
+    if (psysTime && atoi(psysTime) >= 0) mPsysCommandTime = atoi(psysTime) * 1000LL;
+
+    const char* frameFile = getenv("cameraVirtualIpuFrameFile");
+    if (frameFile) {
+        std::ifstream file(frameFile, std::ios::binary);
+        mFrameData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        if (mFrameData.empty()) LOGW("Failed to read the virtual IPU frame file %s", frameFile);
+    }
+}
+
+VirtualIpu::~VirtualIpu() {
+    mFrameThread->requestExit();
+    mPsysThread->requestExit();
+    {
+        AutoMutex l(mLock);
+        mStreamChanged.broadcast();
+        mPsysQueued.broadcast();
+    }
+    mFrameThread->requestExitAndWait();
+    delete mFrameThread;
+    mPsysThread->requestExitAndWait();
+    delete mPsysThread;
+
+    for (auto& entity : mEntities) {
+        releaseBuffers(&entity);
+    }
+    for (auto& file : mFiles) {
+        ::close(file.first);
+    }
+}
+
+int VirtualIpu::loadGraph(const char* fileName) {
+    std::ifstream graph(fileName);
+    CheckAndLogError(!graph.is_open(), BAD_VALUE, "Failed to open %s", fileName);
+
+    static const struct {
+        const char* name;
+        EntityType type;
+    } kEntityTypes[] = {
+        {"subdev", ENTITY_SUBDEV},
+        {"sensor", ENTITY_SENSOR},
+        {"video", ENTITY_VIDEO},
+        {"video-mplane", ENTITY_VIDEO_MPLANE},
+    };
+
+    int videoCount = 0;
+    int subdevCount = 0;
+    std::string line;
+    while (std::getline(graph, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        std::vector<std::string> fields;
+        std::stringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, '|')) {
+            fields.push_back(field);
+        }
+
+        if (fields[0] == "entity" && fields.size() == 4) {
+            Entity entity = {};
+            entity.id = mEntities.size() + 1;
+            entity.name = fields[1];
+            entity.memory = V4L2_MEMORY_MMAP;
+
+            size_t i = 0;
+            for (; i < ARRAY_SIZE(kEntityTypes); i++) {
+                if (fields[2] == kEntityTypes[i].name) break;
+            }
+            CheckAndLogError(i == ARRAY_SIZE(kEntityTypes), BAD_VALUE, "Unknown entity type: %s",
+                             line.c_str());
+            entity.type = kEntityTypes[i].type;
+
+            for (char pad : fields[3]) {
+                CheckAndLogError(pad != 'i' && pad != 'o', BAD_VALUE, "Invalid pads: %s",
+                                 line.c_str());
+                entity.padFlags.push_back(pad == 'i' ? MEDIA_PAD_FL_SINK : MEDIA_PAD_FL_SOURCE);
+            }
+
+            if (entity.type == ENTITY_VIDEO || entity.type == ENTITY_VIDEO_MPLANE) {
+                entity.devName = "/dev/video" + std::to_string(videoCount++);
+                entity.format.type = (entity.type == ENTITY_VIDEO)
+                                         ? V4L2_BUF_TYPE_VIDEO_CAPTURE
+                                         : V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+            } else {
+                entity.devName = "/dev/v4l-subdev" + std::to_string(subdevCount++);
+            }
+            mEntities.push_back(entity);
+        } else if (fields[0] == "link" && fields.size() == 6) {
+            Link link = {};
+            for (auto& entity : mEntities) {
+                if (entity.name == fields[1]) link.source = entity.id;
+                if (entity.name == fields[3]) link.sink = entity.id;
+            }
+            link.sourcePad = strtoul(fields[2].c_str(), nullptr, 0);
+            link.sinkPad = strtoul(fields[4].c_str(), nullptr, 0);
+            link.flags = strtoul(fields[5].c_str(), nullptr, 0);
+
+            Entity* source = getEntityById(link.source);
+            Entity* sink = getEntityById(link.sink);
+            CheckAndLogError(!source || !sink || link.sourcePad >= source->padFlags.size() ||
+                                 link.sinkPad >= sink->padFlags.size(),
+                             BAD_VALUE, "Invalid link: %s", line.c_str());
+            mLinks.push_back(link);
+        } else {
+            LOGE("Invalid line in %s: %s", fileName, line.c_str());
+            return BAD_VALUE;
+        }
+    }
+
+    CheckAndLogError(mEntities.empty(), BAD_VALUE, "No entity in %s", fileName);
+    return OK;
+}
+
+VirtualIpu::Entity* VirtualIpu::getEntityById(uint32_t id) {
+    if (id == 0 || id > mEntities.size()) return nullptr;
+
+    return &mEntities[id - 1];
+}
+
+VirtualIpu::Entity* VirtualIpu::getEntityByPath(const char* pathname) {
+    for (auto& entity : mEntities) {
+        if (entity.devName == pathname) return &entity;
+    }
+
+    return nullptr;
+}
+
+VirtualIpu::File* VirtualIpu::getFile(int fd) {
+    auto it = mFiles.find(fd);
+    return (it == mFiles.end()) ? nullptr : &it->second;
+}
+
+short VirtualIpu::getFileEvents(const File& file, short events) {
+    short revents = 0;
+    if ((events & POLLPRI) && !file.pendingEvents.empty()) revents |= POLLPRI;
+    if ((events & (POLLIN | POLLRDNORM)) && !file.psysEvents.empty()) {
+        revents |= POLLIN | POLLRDNORM;
+    }
+
+    const Entity* entity = file.entity;
+    if (entity && (entity->type == ENTITY_VIDEO || entity->type == ENTITY_VIDEO_MPLANE) &&
+        (events & (POLLIN | POLLRDNORM))) {
+        // The same as vb2, polling the buffers of an idle queue is an error
+        if (!entity->streaming) {
+            revents |= POLLERR;
+        } else if (!entity->doneBuffers.empty()) {
+            revents |= POLLIN | POLLRDNORM;
+        }
+    }
+
+    return revents;
+}
+
+void VirtualIpu::updateReadiness(int fd, File* file) {
+    bool ready = !file->pendingEvents.empty() || !file->psysEvents.empty() ||
+                 (file->entity && !file->entity->doneBuffers.empty());
+    if (ready == file->signaled) return;
+
+    uint64_t value = 1;
+    ssize_t ret = ready ? ::write(fd, &value, sizeof(value)) : ::read(fd, &value, sizeof(value));
+    if (ret != sizeof(value)) LOGW("Failed to update the eventfd %d: %s", fd, strerror(errno));
+    file->signaled = ready;
+}
+
+void VirtualIpu::updateReadiness(Entity* entity) {
+    for (auto& file : mFiles) {
+        if (file.second.entity == entity) updateReadiness(file.first, &file.second);
+    }
+}
+
+int VirtualIpu::open(const char* pathname, int flags) {
+    AutoMutex l(mLock);
+
+    Entity* entity = getEntityByPath(pathname);
+    bool psys = strcmp(pathname, kPsysDevName) == 0;
+    if (!entity && !psys && strcmp(pathname, kMediaDevName) != 0) {
+        return SysCall::open(pathname, flags);
+    }
+
+    int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fd < 0) return fd;
+
+    File& file = mFiles[fd];
+    file.entity = entity;
+    file.psys = psys;
+    file.flags = flags;
+    file.signaled = false;
+    file.eventSequence = 0;
+    LOG1("%s: %s is opened as %d", __func__, pathname, fd);
+    return fd;
+}
+
+int VirtualIpu::close(int fd) {
+    AutoMutex l(mLock);
+
+    File* file = getFile(fd);
+    if (!file) return SysCall::close(fd);
+
+    Entity* entity = file->entity;
+    if (file->psys) cancelPsysCommands(fd, nullptr);
+    mFiles.erase(fd);
+
+    // Release the queue along with the last file of the video node
+    if (entity && (entity->type == ENTITY_VIDEO || entity->type == ENTITY_VIDEO_MPLANE)) {
+        bool opened = false;
+        for (auto& it : mFiles) {
+            if (it.second.entity == entity) opened = true;
+        }
+        if (!opened) {
+            stopStreaming(entity);
+            releaseBuffers(entity);
+        }
+    }
+
+    return ::close(fd);
+}
+
+void* VirtualIpu::mmap(void* addr, size_t len, int prot, int flag, int filedes, off_t off) {
+    AutoMutex l(mLock);
+
+    File* file = getFile(filedes);
+    if (!file) return SysCall::mmap(addr, len, prot, flag, filedes, off);
+
+    Entity* entity = file->entity;
+    size_t index = off / getpagesize();
+    if (!entity || entity->memory != V4L2_MEMORY_MMAP || index >= entity->buffers.size() ||
+        len > entity->buffers[index].length) {
+        errno = EINVAL;
+        return MAP_FAILED;
+    }
+
+    return ::mmap(addr, len, prot, flag, entity->buffers[index].memFd, 0);
+}
+
+int VirtualIpu::stat(const char* pathname, struct stat* buf) {
+    uint32_t minor = 0;
+    {
+        AutoMutex l(mLock);
+        Entity* entity = getEntityByPath(pathname);
+        if (!entity && strcmp(pathname, kMediaDevName) != 0) return SysCall::stat(pathname, buf);
+        if (entity) minor = entity->id;
+    }
+
+    memset(buf, 0, sizeof(*buf));
+    buf->st_mode = S_IFCHR | 0660;
+    buf->st_rdev = makedev(kMajor, minor);
+    return 0;
+}
+
+ssize_t VirtualIpu::readlink(const char* pathname, char* buf, size_t bufsiz) {
+    unsigned int major = 0, minor = 0;
+    std::string path = pathname;
+    if (path.compare(0, strlen(kSysCharPrefix), kSysCharPrefix) != 0 ||
+        sscanf(pathname + strlen(kSysCharPrefix), "%u:%u", &major, &minor) != 2 ||
+        major != kMajor) {
+        return SysCall::readlink(pathname, buf, bufsiz);
+    }
+
+    std::string target;
+    {
+        AutoMutex l(mLock);
+        Entity* entity = getEntityById(minor);
+        if (!entity) return SysCall::readlink(pathname, buf, bufsiz);
+
+        // The same layout as the real sysfs, the device name is the last component
+        target = "../../devices/virtual/video4linux/" +
+                 entity->devName.substr(entity->devName.rfind('/') + 1);
+    }
+
+    size_t len = std::min(bufsiz, target.size());
+    memcpy(buf, target.c_str(), len);
+    return len;
+}
+
+int VirtualIpu::poll(struct pollfd* pfd, nfds_t nfds, int timeout) {
+    std::vector<bool> isVirtual(nfds);
+    bool hasVirtualFd = false;
+    {
+        AutoMutex l(mLock);
+        for (nfds_t i = 0; i < nfds; i++) {
+            isVirtual[i] = getFile(pfd[i].fd) != nullptr;
+            hasVirtualFd |= isVirtual[i];
+        }
+    }
+    if (!hasVirtualFd) return SysCall::poll(pfd, nfds, timeout);
+
+    int64_t deadline = (timeout < 0) ? -1 : CameraUtils::systemTime() + timeout * 1000000LL;
+    std::vector<short> events(nfds);
+    while (true) {
+        bool ready = false;
+        {
+            AutoMutex l(mLock);
+            for (nfds_t i = 0; i < nfds; i++) {
+                File* file = isVirtual[i] ? getFile(pfd[i].fd) : nullptr;
+                if (file && getFileEvents(*file, pfd[i].events)) ready = true;
+            }
+        }
+
+        int waitTime = -1;
+        if (ready) {
+            waitTime = 0;
+        } else if (deadline >= 0) {
+            waitTime = std::max<int64_t>(0, (deadline - CameraUtils::systemTime()) / 1000000);
+        }
+
+        // The eventfds of the virtual nodes are readable when anything is pending
+        for (nfds_t i = 0; i < nfds; i++) {
+            events[i] = pfd[i].events;
+            if (isVirtual[i]) pfd[i].events = POLLIN;
+        }
+        int ret = SysCall::poll(pfd, nfds, waitTime);
+        for (nfds_t i = 0; i < nfds; i++) {
+            pfd[i].events = events[i];
+        }
+        if (ret < 0) return ret;
+
+        ConditionLock lock(mLock);
+        int count = 0;
+        for (nfds_t i = 0; i < nfds; i++) {
+            if (isVirtual[i]) {
+                File* file = getFile(pfd[i].fd);
+                pfd[i].revents = file ? getFileEvents(*file, pfd[i].events) : POLLNVAL;
+            }
+            if (pfd[i].revents) count++;
+        }
+        if (count > 0) return count;
+        if (deadline >= 0 && CameraUtils::systemTime() >= deadline) return 0;
+
+        // Only the events not polled are pending, wait for the next frame
+        mFrameDone.waitRelative(lock, kPollRetryTime);
+    }
+}
+
+int VirtualIpu::ioctl(int fd, int request, void* arg) {
+    ConditionLock lock(mLock);
+
+    File* file = getFile(fd);
+    if (!file) {
+        lock.unlock();
+        return SysCall::ioctl(fd, request, arg);
+    }
+
+    int ret = -ENOTTY;
+    switch (static_cast<uint32_t>(request)) {
+        case VIDIOC_SUBSCRIBE_EVENT:
+        case VIDIOC_UNSUBSCRIBE_EVENT:
+        case VIDIOC_DQEVENT:
+            ret = eventIoctl(fd, file, request, arg);
+            break;
+        case VIDIOC_S_CTRL:
+        case VIDIOC_G_CTRL:
+        case VIDIOC_S_EXT_CTRLS:
+        case VIDIOC_G_EXT_CTRLS:
+        case VIDIOC_TRY_EXT_CTRLS:
+        case VIDIOC_QUERYCTRL:
+        case VIDIOC_QUERYMENU:
+            if (file->entity) ret = controlIoctl(file->entity, request, arg);
+            break;
+        default:
+            if (file->psys) {
+                ret = psysIoctl(fd, file, request, arg);
+            } else if (!file->entity) {
+                ret = mediaIoctl(request, arg);
+            } else if (file->entity->type == ENTITY_VIDEO ||
+                       file->entity->type == ENTITY_VIDEO_MPLANE) {
+                ret = videoIoctl(file->entity, file, lock, request, arg);
+            } else {
+                ret = subdevIoctl(file->entity, request, arg);
+            }
+            break;
+    }
+
+    if (ret < 0) {
+        LOG2("%s: ioctl 0x%x on %d failed: %d", __func__, request, fd, ret);
+        errno = -ret;
+        return -1;
+    }
+    return ret;
+}
+
+int VirtualIpu::mediaIoctl(int request, void* arg) {
+    switch (static_cast<uint32_t>(request)) {
+        case MEDIA_IOC_DEVICE_INFO: {
+            struct media_device_info* info = static_cast<struct media_device_info*>(arg);
+            memset(info, 0, sizeof(*info));
+            snprintf(info->driver, sizeof(info->driver), "%s", MEDIA_DRIVER_NAME);
+            snprintf(info->model, sizeof(info->model), "Virtual IPU");
+            snprintf(info->bus_info, sizeof(info->bus_info), "virtual");
+            return 0;
+        }
+        case MEDIA_IOC_ENUM_ENTITIES: {
+            struct media_entity_desc* desc = static_cast<struct media_entity_desc*>(arg);
+            Entity* entity = (desc->id & MEDIA_ENT_ID_FLAG_NEXT)
+                                 ? getEntityById((desc->id & ~MEDIA_ENT_ID_FLAG_NEXT) + 1)
+                                 : getEntityById(desc->id);
+            if (!entity) return -EINVAL;
+
+            static const uint32_t kMediaTypes[] = {
+                MEDIA_ENT_T_V4L2_SUBDEV,
+                MEDIA_ENT_T_V4L2_SUBDEV_SENSOR,
+                MEDIA_ENT_T_DEVNODE_V4L,
+                MEDIA_ENT_T_DEVNODE_V4L,
+            };
+            memset(desc, 0, sizeof(*desc));
+            desc->id = entity->id;
+            snprintf(desc->name, sizeof(desc->name), "%s", entity->name.c_str());
+            desc->type = kMediaTypes[entity->type];
+            desc->pads = entity->padFlags.size();
+            for (auto& link : mLinks) {
+                if (link.source == entity->id) desc->links++;
+            }
+            desc->v4l.major = kMajor;
+            desc->v4l.minor = entity->id;
+            return 0;
+        }
+        case MEDIA_IOC_ENUM_LINKS: {
+            struct media_links_enum* links = static_cast<struct media_links_enum*>(arg);
+            Entity* entity = getEntityById(links->entity);
+            if (!entity) return -EINVAL;
+
+            if (links->pads) {
+                for (uint32_t i = 0; i < entity->padFlags.size(); i++) {
+                    memset(&links->pads[i], 0, sizeof(links->pads[i]));
+                    links->pads[i].entity = entity->id;
+                    links->pads[i].index = i;
+                    links->pads[i].flags = entity->padFlags[i];
+                }
+            }
+            if (links->links) {
+                // Only the outbound links are enumerated, the same as the kernel
+                uint32_t num = 0;
+                for (auto& link : mLinks) {
+                    if (link.source != entity->id) continue;
+
+                    struct media_link_desc& desc = links->links[num++];
+                    memset(&desc, 0, sizeof(desc));
+                    desc.source.entity = link.source;
+                    desc.source.index = link.sourcePad;
+                    desc.source.flags = MEDIA_PAD_FL_SOURCE;
+                    desc.sink.entity = link.sink;
+                    desc.sink.index = link.sinkPad;
+                    desc.sink.flags = MEDIA_PAD_FL_SINK;
+                    desc.flags = link.flags;
+                }
+            }
+            return 0;
+        }
+        case MEDIA_IOC_SETUP_LINK: {
+            struct media_link_desc* desc = static_cast<struct media_link_desc*>(arg);
+            for (auto& link : mLinks) {
+                if (link.source != desc->source.entity || link.sourcePad != desc->source.index ||
+                    link.sink != desc->sink.entity || link.sinkPad != desc->sink.index) {
+                    continue;
+                }
+                if ((link.flags & MEDIA_LNK_FL_IMMUTABLE) &&
+                    ((link.flags ^ desc->flags) & MEDIA_LNK_FL_ENABLED)) {
+                    return -EINVAL;
+                }
+                link.flags = (link.flags & ~MEDIA_LNK_FL_ENABLED) |
+                             (desc->flags & MEDIA_LNK_FL_ENABLED);
+                return 0;
+            }
+            return -EINVAL;
+        }
+        default:
+            return -ENOTTY;
+    }
+}
+
+int VirtualIpu::subdevIoctl(Entity* entity, int request, void* arg) {
+    switch (static_cast<uint32_t>(request)) {
+        case VIDIOC_SUBDEV_S_FMT:
+        case VIDIOC_SUBDEV_G_FMT: {
+            struct v4l2_subdev_format* format = static_cast<struct v4l2_subdev_format*>(arg);
+            if (format->pad >= entity->padFlags.size()) return -EINVAL;
+
+            uint64_t key = (static_cast<uint64_t>(format->pad) << 32) | format->stream;
+            if (static_cast<uint32_t>(request) == VIDIOC_SUBDEV_S_FMT) {
+                entity->formats[key] = format->format;
+            } else if (entity->formats.find(key) != entity->formats.end()) {
+                format->format = entity->formats[key];
+            } else {
+                memset(&format->format, 0, sizeof(format->format));
+            }
+            return 0;
+        }
+        case VIDIOC_SUBDEV_S_SELECTION:
+        case VIDIOC_SUBDEV_G_SELECTION: {
+            struct v4l2_subdev_selection* sel = static_cast<struct v4l2_subdev_selection*>(arg);
+            if (sel->pad >= entity->padFlags.size()) return -EINVAL;
+
+            uint64_t key = (static_cast<uint64_t>(sel->pad) << 32) | sel->target;
+            if (static_cast<uint32_t>(request) == VIDIOC_SUBDEV_S_SELECTION) {
+                entity->selections[key] = sel->r;
+            } else if (entity->selections.find(key) != entity->selections.end()) {
+                sel->r = entity->selections[key];
+            } else {
+                memset(&sel->r, 0, sizeof(sel->r));
+            }
+            return 0;
+        }
+        case VIDIOC_SUBDEV_S_ROUTING: {
+            // The routes are updated one by one, so merge them into the routing table
+            struct v4l2_subdev_routing* routing = static_cast<struct v4l2_subdev_routing*>(arg);
+            for (uint32_t i = 0; i < routing->num_routes; i++) {
+                const struct v4l2_subdev_route& route = routing->routes[i];
+                auto it = std::find_if(entity->routes.begin(), entity->routes.end(),
+                                       [&route](const struct v4l2_subdev_route& r) {
+                                           return r.sink_pad == route.sink_pad &&
+                                                  r.sink_stream == route.sink_stream &&
+                                                  r.source_pad == route.source_pad &&
+                                                  r.source_stream == route.source_stream;
+                                       });
+                if (it != entity->routes.end()) {
+                    *it = route;
+                } else {
+                    entity->routes.push_back(route);
+                }
+            }
+            return 0;
+        }
+        case VIDIOC_SUBDEV_G_ROUTING: {
+            struct v4l2_subdev_routing* routing = static_cast<struct v4l2_subdev_routing*>(arg);
+            if (routing->num_routes < entity->routes.size()) {
+                routing->num_routes = entity->routes.size();
+                return -ENOSPC;
+            }
+            std::copy(entity->routes.begin(), entity->routes.end(), routing->routes);
+            routing->num_routes = entity->routes.size();
+            return 0;
+        }
+        default:
+            return -ENOTTY;
+    }
+}
+
+int VirtualIpu::controlIoctl(Entity* entity, int request, void* arg) {
+    switch (static_cast<uint32_t>(request)) {
+        case VIDIOC_S_CTRL: {
+            struct v4l2_control* control = static_cast<struct v4l2_control*>(arg);
+            entity->controls[control->id] = control->value;
+            return 0;
+        }
+        case VIDIOC_G_CTRL: {
+            struct v4l2_control* control = static_cast<struct v4l2_control*>(arg);
+            control->value = entity->controls[control->id];
+            return 0;
+        }
+        case VIDIOC_S_EXT_CTRLS:
+        case VIDIOC_G_EXT_CTRLS:
+        case VIDIOC_TRY_EXT_CTRLS: {
+            struct v4l2_ext_controls* controls = static_cast<struct v4l2_ext_controls*>(arg);
+            for (uint32_t i = 0; i < controls->count; i++) {
+                struct v4l2_ext_control& control = controls->controls[i];
+                // The payload controls aren't kept
+                if (control.size > 0) continue;
+
+                if (static_cast<uint32_t>(request) == VIDIOC_S_EXT_CTRLS) {
+                    entity->controls[control.id] = control.value;
+                } else if (static_cast<uint32_t>(request) == VIDIOC_G_EXT_CTRLS) {
+                    control.value = entity->controls[control.id];
+                }
+            }
+            return 0;
+        }
+        case VIDIOC_QUERYCTRL: {
+            struct v4l2_queryctrl* query = static_cast<struct v4l2_queryctrl*>(arg);
+            // The controls can't be enumerated, every queried one is a 16 bits integer
+            if (query->id & V4L2_CTRL_FLAG_NEXT_CTRL) return -EINVAL;
+
+            uint32_t id = query->id;
+            memset(query, 0, sizeof(*query));
+            query->id = id;
+            query->type = V4L2_CTRL_TYPE_INTEGER;
+            snprintf(reinterpret_cast<char*>(query->name), sizeof(query->name), "Virtual 0x%x",
+                     id);
+            query->minimum = 0;
+            query->maximum = UINT16_MAX;
+            query->step = 1;
+            query->default_value = entity->controls[id];
+            return 0;
+        }
+        default:
+            return -EINVAL;
+    }
+}
+
+int VirtualIpu::eventIoctl(int fd, File* file, int request, void* arg) {
+    switch (static_cast<uint32_t>(request)) {
+        case VIDIOC_SUBSCRIBE_EVENT: {
+            struct v4l2_event_subscription* sub = static_cast<struct v4l2_event_subscription*>(arg);
+            file->events.insert(sub->type);
+            return 0;
+        }
+        case VIDIOC_UNSUBSCRIBE_EVENT: {
+            struct v4l2_event_subscription* sub = static_cast<struct v4l2_event_subscription*>(arg);
+            if (sub->type == V4L2_EVENT_ALL) {
+                file->events.clear();
+            } else {
+                file->events.erase(sub->type);
+            }
+            auto& pending = file->pendingEvents;
+            pending.erase(std::remove_if(pending.begin(), pending.end(),
+                                         [file](const struct v4l2_event& event) {
+                                             return file->events.count(event.type) == 0;
+                                         }),
+                          pending.end());
+            updateReadiness(fd, file);
+            return 0;
+        }
+        case VIDIOC_DQEVENT: {
+            if (file->pendingEvents.empty()) return -ENOENT;
+
+            struct v4l2_event* event = static_cast<struct v4l2_event*>(arg);
+            *event = file->pendingEvents.front();
+            file->pendingEvents.pop_front();
+            event->pending = file->pendingEvents.size();
+            updateReadiness(fd, file);
+            return 0;
+        }
+        default:
+            return -ENOTTY;
+    }
+}
+
+int VirtualIpu::videoIoctl(Entity* entity, File* file, ConditionLock& lock, int request,
+                           void* arg) {
+    const bool mplane = entity->type == ENTITY_VIDEO_MPLANE;
+    const uint32_t bufType = entity->format.type;
+
+    switch (static_cast<uint32_t>(request)) {
+        case VIDIOC_QUERYCAP: {
+            struct v4l2_capability* cap = static_cast<struct v4l2_capability*>(arg);
+            memset(cap, 0, sizeof(*cap));
+            snprintf(reinterpret_cast<char*>(cap->driver), sizeof(cap->driver), "%s",
+                     MEDIA_DRIVER_NAME);
+            snprintf(reinterpret_cast<char*>(cap->card), sizeof(cap->card), "%s",
+                     entity->name.c_str());
+            snprintf(reinterpret_cast<char*>(cap->bus_info), sizeof(cap->bus_info), "virtual");
+            cap->device_caps =
+                (mplane ? V4L2_CAP_VIDEO_CAPTURE_MPLANE : V4L2_CAP_VIDEO_CAPTURE) |
+                V4L2_CAP_STREAMING;
+            cap->capabilities = cap->device_caps | V4L2_CAP_DEVICE_CAPS;
+            return 0;
+        }
+        case VIDIOC_G_FMT: {
+            struct v4l2_format* format = static_cast<struct v4l2_format*>(arg);
+            if (format->type != bufType) return -EINVAL;
+
+            *format = entity->format;
+            return 0;
+        }
+        case VIDIOC_S_FMT:
+        case VIDIOC_TRY_FMT: {
+            struct v4l2_format* format = static_cast<struct v4l2_format*>(arg);
+            if (format->type != bufType) return -EINVAL;
+            if (static_cast<uint32_t>(request) == VIDIOC_S_FMT && !entity->buffers.empty()) {
+                return -EBUSY;
+            }
+
+            int ret = setVideoFormat(entity, format);
+            if (ret == 0 && static_cast<uint32_t>(request) == VIDIOC_S_FMT) {
+                entity->format = *format;
+            }
+            return ret;
+        }
+        case VIDIOC_S_SELECTION:
+        case VIDIOC_G_SELECTION:
+            // No scaler or cropper in the video nodes, the selections are accepted as they are
+            return 0;
+        case VIDIOC_REQBUFS:
+            return requestBuffers(entity, static_cast<struct v4l2_requestbuffers*>(arg));
+        case VIDIOC_QUERYBUF: {
+            struct v4l2_buffer* buf = static_cast<struct v4l2_buffer*>(arg);
+            if (buf->type != bufType || buf->index >= entity->buffers.size()) return -EINVAL;
+
+            return fillBuffer(*entity, buf->index, buf);
+        }
+        case VIDIOC_QBUF: {
+            struct v4l2_buffer* buf = static_cast<struct v4l2_buffer*>(arg);
+            if (buf->type != bufType || buf->memory != entity->memory ||
+                buf->index >= entity->buffers.size() || (mplane && (!buf->m.planes ||
+                                                                    buf->length < 1))) {
+                return -EINVAL;
+            }
+
+            VideoBuffer& buffer = entity->buffers[buf->index];
+            if (buffer.queued) return -EINVAL;
+
+            if (entity->memory == V4L2_MEMORY_USERPTR) {
+                buffer.userPtr = mplane ? buf->m.planes[0].m.userptr : buf->m.userptr;
+                uint32_t length = mplane ? buf->m.planes[0].length : buf->length;
+                if (length > 0) buffer.length = length;
+            } else if (entity->memory == V4L2_MEMORY_DMABUF) {
+                buffer.dmaFd = mplane ? buf->m.planes[0].m.fd : buf->m.fd;
+                uint32_t length = mplane ? buf->m.planes[0].length : buf->length;
+                if (length > 0) buffer.length = length;
+            }
+            buffer.queued = true;
+            entity->queuedBuffers.push_back(buf->index);
+            return fillBuffer(*entity, buf->index, buf);
+        }
+        case VIDIOC_DQBUF: {
+            struct v4l2_buffer* buf = static_cast<struct v4l2_buffer*>(arg);
+            if (buf->type != bufType || (mplane && (!buf->m.planes || buf->length < 1))) {
+                return -EINVAL;
+            }
+
+            while (entity->doneBuffers.empty()) {
+                if (!entity->streaming) return -EINVAL;
+                if (file->flags & O_NONBLOCK) return -EAGAIN;
+                mFrameDone.wait(lock);
+            }
+
+            uint32_t index = entity->doneBuffers.front();
+            entity->doneBuffers.pop_front();
+            entity->buffers[index].queued = false;
+            updateReadiness(entity);
+            return fillBuffer(*entity, index, buf);
+        }
+        case VIDIOC_STREAMON: {
+            enum v4l2_buf_type* type = static_cast<enum v4l2_buf_type*>(arg);
+            if (static_cast<uint32_t>(*type) != bufType || entity->buffers.empty()) return -EINVAL;
+            if (entity->streaming) return 0;
+
+            entity->streaming = true;
+            if (mStreamingCount++ == 0) {
+                mSequence = 0;
+                mNextFrameTime = CameraUtils::systemTime() + mFrameInterval;
+                mStreamChanged.broadcast();
+            }
+            LOG1("%s: %s stream on", __func__, entity->name.c_str());
+            return 0;
+        }
+        case VIDIOC_STREAMOFF: {
+            enum v4l2_buf_type* type = static_cast<enum v4l2_buf_type*>(arg);
+            if (static_cast<uint32_t>(*type) != bufType) return -EINVAL;
+
+            stopStreaming(entity);
+            LOG1("%s: %s stream off", __func__, entity->name.c_str());
+            return 0;
+        }
+        case VIDIOC_EXPBUF: {
+            struct v4l2_exportbuffer* exp = static_cast<struct v4l2_exportbuffer*>(arg);
+            if (exp->type != bufType || entity->memory != V4L2_MEMORY_MMAP ||
+                exp->index >= entity->buffers.size() || exp->plane > 0) {
+                return -EINVAL;
+            }
+
+            int cmd = (exp->flags & O_CLOEXEC) ? F_DUPFD_CLOEXEC : F_DUPFD;
+            int fd = fcntl(entity->buffers[exp->index].memFd, cmd, 0);
+            if (fd < 0) return -errno;
+
+            exp->fd = fd;
+            return 0;
+        }
+        default:
+            return -ENOTTY;
+    }
+}
+
+int VirtualIpu::psysIoctl(int fd, File* file, int request, void* arg) {
+    switch (static_cast<uint32_t>(request)) {
+        case IPU_IOC_QUERYCAP: {
+            struct ipu_psys_capability* cap = static_cast<struct ipu_psys_capability*>(arg);
+            memset(cap, 0, sizeof(*cap));
+            cap->version = 1;
+            snprintf(reinterpret_cast<char*>(cap->driver), sizeof(cap->driver), "%s",
+                     "ipu-psys-virtual");
+            snprintf(reinterpret_cast<char*>(cap->dev_model), sizeof(cap->dev_model), "%s",
+                     "virtual");
+            // No PG manifest is provided
+            cap->pg_count = 0;
+            return 0;
+        }
+        case IPU_IOC_GET_MANIFEST:
+            return -ENOENT;
+        case IPU_IOC_GETBUF: {
+            struct ipu_psys_buffer* buf = static_cast<struct ipu_psys_buffer*>(arg);
+            if (!(buf->flags & IPU_BUFFER_FLAG_USERPTR) || !buf->base.userptr) return -EINVAL;
+
+            // The emulated PSys never touches the buffers, so an eventfd is enough as the handle
+            int handle = eventfd(0, EFD_CLOEXEC);
+            if (handle < 0) return -errno;
+            buf->base.reserved = 0;
+            buf->base.fd = handle;
+            buf->flags &= ~IPU_BUFFER_FLAG_USERPTR;
+            buf->flags |= IPU_BUFFER_FLAG_DMA_HANDLE;
+            return 0;
+        }
+        case IPU_IOC_MAPBUF: {
+            int bufFd = static_cast<int>(reinterpret_cast<intptr_t>(arg));
+            if (bufFd < 0) return -EBADF;
+            mPsysMappedFds.insert(bufFd);
+            return 0;
+        }
+        case IPU_IOC_UNMAPBUF: {
+            int bufFd = static_cast<int>(reinterpret_cast<intptr_t>(arg));
+            return (mPsysMappedFds.erase(bufFd) > 0) ? 0 : -EINVAL;
+        }
+        case IPU_IOC_QCMD: {
+            const struct ipu_psys_command* cmd = static_cast<struct ipu_psys_command*>(arg);
+            if (cmd->bufcount > 0 && !cmd->buffers) return -EINVAL;
+
+            PsysCommand command = {fd, cmd->issue_id, cmd->user_token};
+            mPsysCommands.push_back(command);
+            mPsysQueued.signal();
+            return 0;
+        }
+        case IPU_IOC_CMD_CANCEL:
+            return (cancelPsysCommands(fd, static_cast<struct ipu_psys_command*>(arg)) > 0)
+                       ? 0
+                       : -ENOENT;
+        case IPU_IOC_DQEVENT: {
+            if (file->psysEvents.empty()) return -EAGAIN;
+
+            *static_cast<struct ipu_psys_event*>(arg) = file->psysEvents.front();
+            file->psysEvents.pop_front();
+            updateReadiness(fd, file);
+            return 0;
+        }
+        default:
+            return -ENOTTY;
+    }
+}
+
+int VirtualIpu::setVideoFormat(Entity* entity, struct v4l2_format* format) {
+    uint32_t pixelFormat, width, height;
+    if (entity->type == ENTITY_VIDEO_MPLANE) {
+        pixelFormat = format->fmt.pix_mp.pixelformat;
+        width = format->fmt.pix_mp.width;
+        height = format->fmt.pix_mp.height;
+    } else {
+        pixelFormat = format->fmt.pix.pixelformat;
+        width = format->fmt.pix.width;
+        height = format->fmt.pix.height;
+    }
+    if (width == 0 || height == 0) return -EINVAL;
+
+    int stride = CameraUtils::getStride(pixelFormat, width);
+    int size = CameraUtils::getFrameSize(pixelFormat, width, height);
+    if (stride <= 0 || size <= 0) {
+        // Unknown format, assume 16 bits per pixel
+        stride = width * 2;
+        size = stride * height;
+    }
+
+    if (entity->type == ENTITY_VIDEO_MPLANE) {
+        struct v4l2_pix_format_mplane& pix = format->fmt.pix_mp;
+        pix.field = V4L2_FIELD_NONE;
+        pix.num_planes = 1;
+        pix.plane_fmt[0].bytesperline = std::max<uint32_t>(pix.plane_fmt[0].bytesperline, stride);
+        pix.plane_fmt[0].sizeimage = std::max<uint32_t>(pix.plane_fmt[0].sizeimage, size);
+    } else {
+        struct v4l2_pix_format& pix = format->fmt.pix;
+        pix.field = V4L2_FIELD_NONE;
+        pix.bytesperline = std::max<uint32_t>(pix.bytesperline, stride);
+        pix.sizeimage = std::max<uint32_t>(pix.sizeimage, size);
+    }
+    return 0;
+}
+
+int VirtualIpu::requestBuffers(Entity* entity, struct v4l2_requestbuffers* req) {
+    if (req->type != entity->format.type ||
+        (req->memory != V4L2_MEMORY_MMAP && req->memory != V4L2_MEMORY_USERPTR &&
+         req->memory != V4L2_MEMORY_DMABUF)) {
+        return -EINVAL;
+    }
+    if (entity->streaming) return -EBUSY;
+
+    releaseBuffers(entity);
+    entity->memory = req->memory;
+    if (req->count == 0) return 0;
+
+    uint32_t length = (entity->type == ENTITY_VIDEO_MPLANE)
+                          ? entity->format.fmt.pix_mp.plane_fmt[0].sizeimage
+                          : entity->format.fmt.pix.sizeimage;
+    if (length == 0) return -EINVAL;
+
+    req->count = std::min<uint32_t>(req->count, VIDEO_MAX_FRAME);
+    for (uint32_t i = 0; i < req->count; i++) {
+        VideoBuffer buffer = {};
+        buffer.memFd = -1;
+        buffer.dmaFd = -1;
+        buffer.length = length;
+        entity->buffers.push_back(buffer);
+
+        if (req->memory != V4L2_MEMORY_MMAP) continue;
+
+        // The memfds are real dma-buf alike fds, which can be mapped and exported
+        VideoBuffer& mmapBuffer = entity->buffers.back();
+        mmapBuffer.memFd = memfd_create("virtual-ipu", MFD_CLOEXEC);
+        if (mmapBuffer.memFd < 0 || ftruncate(mmapBuffer.memFd, length) != 0) {
+            LOGE("Failed to allocate the virtual buffer %u: %s", i, strerror(errno));
+            releaseBuffers(entity);
+            return -ENOMEM;
+        }
+        mmapBuffer.addr =
+            ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, mmapBuffer.memFd, 0);
+        if (mmapBuffer.addr == MAP_FAILED) {
+            mmapBuffer.addr = nullptr;
+            releaseBuffers(entity);
+            return -ENOMEM;
+        }
+    }
+
+    LOG1("%s: %u buffers of %u bytes for %s", __func__, req->count, length, entity->name.c_str());
+    return 0;
+}
+
+int VirtualIpu::fillBuffer(const Entity& entity, uint32_t index, struct v4l2_buffer* buf) {
+    const VideoBuffer& buffer = entity.buffers[index];
+    const uint32_t offset = index * getpagesize();
+
+    buf->index = index;
+    buf->memory = entity.memory;
+    buf->field = V4L2_FIELD_NONE;
+    buf->flags = V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC | (buffer.queued ? V4L2_BUF_FLAG_QUEUED : 0);
+    buf->timestamp = buffer.timestamp;
+    buf->sequence = buffer.sequence;
+
+    if (entity.type == ENTITY_VIDEO_MPLANE) {
+        if (!buf->m.planes || buf->length < 1) return -EINVAL;
+
+        struct v4l2_plane& plane = buf->m.planes[0];
+        buf->length = 1;
+        plane.length = buffer.length;
+        plane.bytesused = buffer.length;
+        if (entity.memory == V4L2_MEMORY_MMAP) {
+            plane.m.mem_offset = offset;
+        } else if (entity.memory == V4L2_MEMORY_USERPTR) {
+            plane.m.userptr = buffer.userPtr;
+        } else {
+            plane.m.fd = buffer.dmaFd;
+        }
+    } else {
+        buf->length = buffer.length;
+        buf->bytesused = buffer.length;
+        if (entity.memory == V4L2_MEMORY_MMAP) {
+            buf->m.offset = offset;
+        } else if (entity.memory == V4L2_MEMORY_USERPTR) {
+            buf->m.userptr = buffer.userPtr;
+        } else {
+            buf->m.fd = buffer.dmaFd;
+        }
+    }
+    return 0;
+}
+
+void VirtualIpu::stopStreaming(Entity* entity) {
+    if (entity->streaming) {
+        entity->streaming = false;
+        mStreamingCount--;
+    }
+
+    entity->queuedBuffers.clear();
+    entity->doneBuffers.clear();
+    for (auto& buffer : entity->buffers) {
+        buffer.queued = false;
+    }
+    updateReadiness(entity);
+    mFrameDone.broadcast();
+}
+
+void VirtualIpu::releaseBuffers(Entity* entity) {
+    for (auto& buffer : entity->buffers) {
+        if (buffer.addr) ::munmap(buffer.addr, buffer.length);
+        if (buffer.memFd >= 0) ::close(buffer.memFd);
+    }
+    entity->buffers.clear();
+    entity->queuedBuffers.clear();
+    entity->doneBuffers.clear();
+}
+
+bool VirtualIpu::frameLoop() {
+    ConditionLock lock(mLock);
+    if (mFrameThread->isExiting()) return false;
+
+    if (mStreamingCount == 0) {
+        mStreamChanged.waitRelative(lock, kIdleWaitTime);
+        return true;
+    }
+
+    int64_t now = CameraUtils::systemTime();
+    if (now < mNextFrameTime) {
+        mStreamChanged.waitRelative(lock, mNextFrameTime - now);
+        return true;
+    }
+
+    produceFrame();
+
+    // Keep the frame rate, but don't catch up the frames missed in a stall
+    mNextFrameTime += mFrameInterval;
+    if (mNextFrameTime < now) mNextFrameTime = now + mFrameInterval;
+    return true;
+}
+
+void VirtualIpu::produceFrame() {
+    uint32_t sequence = mSequence++;
+    struct timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    for (auto& it : mFiles) {
+        File& file = it.second;
+        if (file.events.count(V4L2_EVENT_FRAME_SYNC) == 0) continue;
+
+        // Drop the oldest one as the kernel does when the queue is full
+        if (file.pendingEvents.size() >= kMaxPendingEvents) file.pendingEvents.pop_front();
+
+        struct v4l2_event event = {};
+        event.type = V4L2_EVENT_FRAME_SYNC;
+        event.u.frame_sync.frame_sequence = sequence;
+        event.sequence = file.eventSequence++;
+        event.timestamp = now;
+        file.pendingEvents.push_back(event);
+        updateReadiness(it.first, &file);
+    }
+
+    for (auto& entity : mEntities) {
+        if (!entity.streaming || entity.queuedBuffers.empty()) continue;
+
+        uint32_t index = entity.queuedBuffers.front();
+        entity.queuedBuffers.pop_front();
+
+        VideoBuffer& buffer = entity.buffers[index];
+        buffer.timestamp.tv_sec = now.tv_sec;
+        buffer.timestamp.tv_usec = now.tv_nsec / 1000;
+        buffer.sequence = sequence;
+        writeFrame(&buffer);
+
+        entity.doneBuffers.push_back(index);
+        updateReadiness(&entity);
+    }
+
+    mFrameDone.broadcast();
+}
+
+void VirtualIpu::writeFrame(VideoBuffer* buffer) {
+    if (mFrameData.empty()) return;
+
+    size_t size = std::min<size_t>(buffer->length, mFrameData.size());
+    if (buffer->addr) {
+        MEMCPY_S(buffer->addr, buffer->length, mFrameData.data(), size);
+    } else if (buffer->userPtr) {
+        MEMCPY_S(reinterpret_cast<void*>(buffer->userPtr), buffer->length, mFrameData.data(),
+                 size);
+    } else if (buffer->dmaFd >= 0) {
+        void* addr = ::mmap(nullptr, size, PROT_WRITE, MAP_SHARED, buffer->dmaFd, 0);
+        if (addr == MAP_FAILED) return;
+
+        MEMCPY_S(addr, size, mFrameData.data(), size);
+        ::munmap(addr, size);
+    }
+}
+
+bool VirtualIpu::psysLoop() {
+    ConditionLock lock(mLock);
+    if (mPsysThread->isExiting()) return false;
+
+    if (mPsysCommands.empty()) {
+        mPsysQueued.waitRelative(lock, kIdleWaitTime);
+        return true;
+    }
+
+    // The PSys runs one command at a time, the same as the hardware
+    int64_t now = CameraUtils::systemTime();
+    if (mPsysDoneTime == 0) mPsysDoneTime = now + mPsysCommandTime;
+    if (now < mPsysDoneTime) {
+        mPsysQueued.waitRelative(lock, mPsysDoneTime - now);
+        return true;
+    }
+
+    PsysCommand command = mPsysCommands.front();
+    mPsysCommands.pop_front();
+    mPsysDoneTime = 0;
+
+    // The fd may be closed while the command is running
+    File* file = getFile(command.fd);
+    if (file) {
+        struct ipu_psys_event event = {};
+        event.type = IPU_PSYS_EVENT_TYPE_CMD_COMPLETE;
+        event.user_token = command.token;
+        event.issue_id = command.issueId;
+        file->psysEvents.push_back(event);
+        updateReadiness(command.fd, file);
+    }
+    mFrameDone.broadcast();
+    return true;
+}
+
+int VirtualIpu::cancelPsysCommands(int fd, const struct ipu_psys_command* cmd) {
+    int count = 0;
+    for (auto it = mPsysCommands.begin(); it != mPsysCommands.end();) {
+        if (it->fd != fd ||
+            (cmd && (it->issueId != cmd->issue_id || it->token != cmd->user_token))) {
+            ++it;
+            continue;
+        }
+
+        // Restart the timing of the next one if the running command is canceled
+        if (it == mPsysCommands.begin()) mPsysDoneTime = 0;
+        it = mPsysCommands.erase(it);
+        count++;
+    }
+
+    if (count > 0) mPsysQueued.signal();
+    return count;
+}
+
+}  // namespace icamera
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "SysCall.h"
+#include "iutils/Thread.h"
+#include "modules/ia_cipr/include/ipu-psys.h"
+#include "iutils/Utils.h"
+
+namespace icamera {
+
+/**
+ * \class VirtualIpu
+ *
+ * VirtualIpu is an in-process IPU backend behind SysCall, which runs the whole capture
+ * pipeline without the IPU hardware, e.g. for the end-to-end throughput benchmarks.
+ *
+ * It's enabled by setting cameraVirtualIpu to the media graph file, whose lines are:
+ *   entity|<name>|<subdev, sensor, video or video-mplane>|<pads, 'i' for sink, 'o' for source>
+ *   link|<source entity>|<source pad>|<sink entity>|<sink pad>|<media link flags>
+ * The graph is exposed as /dev/media0, /dev/videoX and /dev/v4l-subdevX, and the fds of the
+ * virtual nodes are eventfds which are readable when the node has buffers or events pending.
+ *
+ * The streaming video nodes complete one queued buffer per frame at cameraVirtualIpuFps (30 by
+ * default), and V4L2_EVENT_FRAME_SYNC is sent to the subscribers at the start of each frame.
+ * The buffers are filled with the content of cameraVirtualIpuFrameFile if it's set.
+ * The subdev formats, selections, routes and controls are kept and returned as they are set.
+ *
+ * /dev/ipu-psys0 is emulated as well for CIPR: the buffers are mapped as they are, and the
+ * queued commands are completed one by one in cameraVirtualIpuPsysUs each (5000 by default),
+ * with IPU_PSYS_EVENT_TYPE_CMD_COMPLETE sent to the fd which queued them. No PG manifest is
+ * provided, so the PG libraries can't run on it, only the command flow is emulated.
+ */
+class VirtualIpu : public SysCall {
+ public:
+    /**
+     * Create the virtual IPU if cameraVirtualIpu is set, nullptr otherwise.
+     */
+    static VirtualIpu* createInstance();
+    virtual ~VirtualIpu();
+
+    virtual int open(const char* pathname, int flags);
+    virtual int close(int fd);
+    virtual void* mmap(void* addr, size_t len, int prot, int flag, int filedes, off_t off);
+    virtual int stat(const char* pathname, struct stat* buf);
+    virtual ssize_t readlink(const char* pathname, char* buf, size_t bufsiz);
+    virtual int poll(struct pollfd* pfd, nfds_t nfds, int timeout);
+
+    using SysCall::ioctl;
+
+ protected:
+    virtual int ioctl(int fd, int request, void* arg);
+
+ private:
+    VirtualIpu();
+    DISALLOW_COPY_AND_ASSIGN(VirtualIpu);
+
+    enum EntityType {
+        ENTITY_SUBDEV = 0,
+        ENTITY_SENSOR,
+        ENTITY_VIDEO,
+        ENTITY_VIDEO_MPLANE,
+    };
+
+    struct VideoBuffer {
+        int memFd;  // Backs the MMAP buffer, -1 for USERPTR and DMABUF
+        void* addr;
+        uint32_t length;
+        unsigned long userPtr;
+        int dmaFd;
+        struct timeval timestamp;
+        uint32_t sequence;
+        bool queued;
+    };
+
+    struct Entity {
+        uint32_t id;
+        std::string name;
+        EntityType type;
+        std::vector<uint32_t> padFlags;
+        std::string devName;
+
+        // Subdev state, the keys are made of pad and stream
+        std::map<uint64_t, struct v4l2_mbus_framefmt> formats;
+        std::map<uint64_t, struct v4l2_rect> selections;
+        std::vector<struct v4l2_subdev_route> routes;
+        std::map<uint32_t, int32_t> controls;
+
+        // Video node state
+        struct v4l2_format format;
+        uint32_t memory;
+        std::vector<VideoBuffer> buffers;
+        std::deque<uint32_t> queuedBuffers;
+        std::deque<uint32_t> doneBuffers;
+        bool streaming;
+    };
+
+    struct Link {
+        uint32_t source;
+        uint32_t sourcePad;
+        uint32_t sink;
+        uint32_t sinkPad;
+        uint32_t flags;
+    };
+
+    struct File {
+        Entity* entity;  // nullptr for the media device and the PSys
+        bool psys;
+        int flags;
+        bool signaled;   // If the eventfd is readable
+        std::set<uint32_t> events;
+        std::deque<struct v4l2_event> pendingEvents;
+        uint32_t eventSequence;
+        std::deque<struct ipu_psys_event> psysEvents;
+    };
+
+    struct PsysCommand {
+        int fd;
+        uint64_t issueId;
+        uint64_t token;
+    };
+
+    class FrameThread : public Thread {
+     public:
+        explicit FrameThread(VirtualIpu* ipu) : mIpu(ipu) {}
+        virtual bool threadLoop() { return mIpu->frameLoop(); }
+
+     private:
+        VirtualIpu* mIpu;
+    };
+
+    class PsysThread : public Thread {
+     public:
+        explicit PsysThread(VirtualIpu* ipu) : mIpu(ipu) {}
+        virtual bool threadLoop() { return mIpu->psysLoop(); }
+
+     private:
+        VirtualIpu* mIpu;
+    };
+
+    int loadGraph(const char* fileName);
+    Entity* getEntityById(uint32_t id);
+    Entity* getEntityByPath(const char* pathname);
+    File* getFile(int fd);
+    short getFileEvents(const File& file, short events);
+    void updateReadiness(Entity* entity);
+    void updateReadiness(int fd, File* file);
+
+    int mediaIoctl(int request, void* arg);
+    int subdevIoctl(Entity* entity, int request, void* arg);
+    int controlIoctl(Entity* entity, int request, void* arg);
+    int eventIoctl(int fd, File* file, int request, void* arg);
+    int videoIoctl(Entity* entity, File* file, ConditionLock& lock, int request, void* arg);
+    int psysIoctl(int fd, File* file, int request, void* arg);
+    int setVideoFormat(Entity* entity, struct v4l2_format* format);
+    int requestBuffers(Entity* entity, struct v4l2_requestbuffers* req);
+    int fillBuffer(const Entity& entity, uint32_t index, struct v4l2_buffer* buf);
+    void stopStreaming(Entity* entity);
+    void releaseBuffers(Entity* entity);
+
+    bool frameLoop();
+    void produceFrame();
+    void writeFrame(VideoBuffer* buffer);
+
+    bool psysLoop();
+    // Cancel the queued commands of the fd, all of them if cmd is nullptr
+    int cancelPsysCommands(int fd, const struct ipu_psys_command* cmd);
+
+ private:
+    static const uint32_t kMajor = 81;  // The char device major of video4linux
+
+    Mutex mLock;
+    // Signaled when the buffers or PSys commands are done or the streams stopped
+    Condition mFrameDone;
+    Condition mStreamChanged;
+    std::vector<Entity> mEntities;
+    std::vector<Link> mLinks;
+    std::map<int, File> mFiles;
+
+    FrameThread* mFrameThread;
+    int64_t mFrameInterval;  // In ns
+    int64_t mNextFrameTime;
+    uint32_t mSequence;
+    int mStreamingCount;
+    std::vector<char> mFrameData;
+
+    PsysThread* mPsysThread;
+    Condition mPsysQueued;
+    std::deque<PsysCommand> mPsysCommands;  // The head one is running if mPsysDoneTime > 0
+    std::set<int> mPsysMappedFds;
+    int64_t mPsysCommandTime;  // In ns
+    int64_t mPsysDoneTime;
+};
+
+}  // namespace icamera
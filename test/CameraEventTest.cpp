@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "CameraEvent.h"
+#include "TestUtils.h"
+
+using namespace icamera;
+
+class CountingListener : public EventListener {
+ public:
+    CountingListener() : mCount(0), mLastSequence(-1), mOrdered(true), mBlockUs(0) {}
+
+    void handleEvent(EventData eventData) {
+        if (eventData.data.frame.sequence <= mLastSequence) mOrdered = false;
+        mLastSequence = eventData.data.frame.sequence;
+        if (mBlockUs > 0) std::this_thread::sleep_for(std::chrono::microseconds(mBlockUs));
+        mCount++;
+    }
+
+    std::atomic<int> mCount;
+    int64_t mLastSequence;
+    bool mOrdered;
+    int mBlockUs;
+};
+
+// Remove itself, or another listener, from inside its own delivery
+class RemovingListener : public EventListener {
+ public:
+    RemovingListener(EventSource* source, EventListener* target)
+            : mSource(source), mTarget(target), mCount(0) {}
+
+    void handleEvent(EventData eventData) {
+        mCount++;
+        mSource->removeListener(EVENT_ISYS_FRAME, mTarget ? mTarget : this);
+    }
+
+    EventSource* mSource;
+    EventListener* mTarget;
+    int mCount;
+};
+
+static EventData frameEvent(int64_t sequence) {
+    EventData data;
+    data.type = EVENT_ISYS_FRAME;
+    data.data.frame.sequence = sequence;
+    return data;
+}
+
+static void testRegisterRemove() {
+    EventSource source;
+    CountingListener a, b;
+
+    source.registerListener(EVENT_ISYS_FRAME, &a);
+    source.registerListener(EVENT_ISYS_FRAME, &a);  // Duplicated registration is ignored
+    source.registerListener(EVENT_ISYS_SOF, &b);
+    source.notifyListeners(frameEvent(0));
+    CHECK_EQ(a.mCount.load(), 1);
+    CHECK_EQ(b.mCount.load(), 0);
+
+    source.removeListener(EVENT_ISYS_FRAME, &a);
+    source.removeListener(EVENT_ISYS_FRAME, &a);  // Unknown listener is ignored
+    source.notifyListeners(frameEvent(1));
+    CHECK_EQ(a.mCount.load(), 1);
+    source.removeListener(EVENT_ISYS_SOF, &b);
+}
+
+static void testNestedRemove() {
+    EventSource source;
+    CountingListener other;
+    RemovingListener self(&source, nullptr);
+    RemovingListener remover(&source, &other);
+
+    // Removing from inside a delivery of the same source must not wait for itself
+    source.registerListener(EVENT_ISYS_FRAME, &self);
+    source.registerListener(EVENT_ISYS_FRAME, &remover);
+    source.registerListener(EVENT_ISYS_FRAME, &other);
+    source.notifyListeners(frameEvent(0));
+    source.notifyListeners(frameEvent(1));
+
+    CHECK_EQ(self.mCount, 1);
+    // The running snapshot still holds "other", it's only gone for the next notification
+    CHECK_EQ(other.mCount.load(), 1);
+    source.removeListener(EVENT_ISYS_FRAME, &remover);
+}
+
+/**
+ * removeListener() must return only after the deliveries to the listener finished, so the
+ * listener can be destroyed right after it.
+ */
+static void testRemoveWaitsForDelivery() {
+    EventSource source;
+    CountingListener slow;
+    slow.mBlockUs = 50000;
+    source.registerListener(EVENT_ISYS_FRAME, &slow);
+
+    std::thread notifier([&source]() { source.notifyListeners(frameEvent(0)); });
+    while (slow.mLastSequence < 0) std::this_thread::yield();
+
+    int64_t start = test::nowUs();
+    source.removeListener(EVENT_ISYS_FRAME, &slow);
+    int64_t waited = test::nowUs() - start;
+    CHECK_EQ(slow.mCount.load(), 1);
+    CHECK_TRUE(waited > 10000);
+    notifier.join();
+}
+
+static void testAsyncDelivery() {
+    const int kEvents = 1000;
+    EventSource source;
+    CountingListener async, sync;
+    async.setAsyncDelivery(true);
+    async.mBlockUs = 10;
+    source.registerListener(EVENT_ISYS_FRAME, &async);
+    source.registerListener(EVENT_ISYS_FRAME, &sync);
+
+    for (int i = 0; i < kEvents; i++) source.notifyListeners(frameEvent(i));
+    CHECK_EQ(sync.mCount.load(), kEvents);
+    while (async.mCount.load() < kEvents) std::this_thread::yield();
+    CHECK_TRUE(async.mOrdered);
+
+    // The pending events of a removed async listener are dropped
+    for (int i = kEvents; i < 2 * kEvents; i++) source.notifyListeners(frameEvent(i));
+    source.removeListener(EVENT_ISYS_FRAME, &async);
+    int count = async.mCount.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    CHECK_EQ(async.mCount.load(), count);
+    CHECK_TRUE(async.mOrdered);
+    source.removeListener(EVENT_ISYS_FRAME, &sync);
+}
+
+// Notify from several threads while listeners come and go
+static void benchNotifyWithUpdates() {
+    const int kNotifiers = 3;
+    const int kEvents = 100000;
+    EventSource source;
+    CountingListener stable;
+    source.registerListener(EVENT_ISYS_FRAME, &stable);
+
+    std::atomic<bool> done(false);
+    std::thread updater([&]() {
+        int updates = 0;
+        while (!done) {
+            CountingListener transient;
+            source.registerListener(EVENT_ISYS_FRAME, &transient);
+            source.removeListener(EVENT_ISYS_FRAME, &transient);
+            updates++;
+        }
+        printf("listener updates during the benchmark: %d\n", updates);
+    });
+
+    int64_t start = test::nowUs();
+    std::vector<std::thread> notifiers;
+    for (int n = 0; n < kNotifiers; n++) {
+        notifiers.emplace_back([&source]() {
+            for (int i = 0; i < kEvents; i++) source.notifyListeners(frameEvent(i));
+        });
+    }
+    for (auto& t : notifiers) t.join();
+    int64_t elapsed = test::nowUs() - start;
+    done = true;
+    updater.join();
+
+    CHECK_EQ(stable.mCount.load(), kNotifiers * kEvents);
+    REPORT_BENCH("notifyListeners 3 threads with updates", kNotifiers * kEvents, elapsed);
+    source.removeListener(EVENT_ISYS_FRAME, &stable);
+}
+
+int main() {
+    testRegisterRemove();
+    testNestedRemove();
+    testRemoveWaitsForDelivery();
+    testAsyncDelivery();
+    benchNotifyWithUpdates();
+    return test::finish("CameraEventTest");
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The scheduler headers have the log macros in their templates
+#define LOG_TAG Scheduler
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "TestUtils.h"
+#include "src/scheduler/CameraScheduler.h"
+
+using namespace icamera;
+
+/**
+ * The graph ids of test/config/pipe_scheduler_profiles.xml, which has the same nodes in
+ * one executor: isa, bb, stats and still. bb and stats depend on isa.
+ */
+static const int32_t kSequentialGraph = 1;
+static const int32_t kParallelGraph = 2;
+static const int32_t kPinnedGraph = 3;
+
+static const int kWorkUs = 1000;  // The time of one node for one frame
+static const int kBenchFrames = 200;
+static const int kFrameTimeoutMs = 2000;
+
+// Count the nodes done for each frame, the test waits for all of them before the next trigger
+class FrameTracker {
+ public:
+    explicit FrameTracker(int nodeCount) : mNodeCount(nodeCount), mTick(-1), mDone(0) {}
+
+    void start(int64_t tick) {
+        std::lock_guard<std::mutex> l(mLock);
+        mTick = tick;
+        mDone = 0;
+    }
+
+    void nodeDone(int64_t tick) {
+        std::lock_guard<std::mutex> l(mLock);
+        if (tick == mTick && ++mDone == mNodeCount) mCondition.notify_all();
+    }
+
+    bool wait() {
+        std::unique_lock<std::mutex> l(mLock);
+        return mCondition.wait_for(l, std::chrono::milliseconds(kFrameTimeoutMs),
+                                   [this]() { return mDone == mNodeCount; });
+    }
+
+ private:
+    const int mNodeCount;
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    int64_t mTick;
+    int mDone;
+};
+
+// A node which works for kWorkUs, it checks that its dependency processed the frame before it
+class SyntheticNode : public ISchedulerNode {
+ public:
+    SyntheticNode(const char* name, FrameTracker* tracker, SyntheticNode* depend = nullptr)
+            : ISchedulerNode(name),
+              mTracker(tracker),
+              mDepend(depend),
+              mLastTick(-1),
+              mOrderErrors(0),
+              mLastCpu(-1) {}
+
+    bool process(int64_t triggerId) override {
+        if (mDepend && mDepend->mLastTick != triggerId) mOrderErrors++;
+
+        int64_t end = test::nowUs() + kWorkUs;
+        while (test::nowUs() < end) {
+        }
+
+        mLastCpu = sched_getcpu();
+        mLastTick = triggerId;
+        mTracker->nodeDone(triggerId);
+        return true;
+    }
+
+    int orderErrors() const { return mOrderErrors; }
+    int lastCpu() const { return mLastCpu; }
+
+ private:
+    FrameTracker* mTracker;
+    SyntheticNode* mDepend;
+    std::atomic<int64_t> mLastTick;
+    std::atomic<int> mOrderErrors;
+    std::atomic<int> mLastCpu;
+};
+
+struct SyntheticPipe {
+    FrameTracker tracker;
+    SyntheticNode isa;
+    SyntheticNode bb;
+    SyntheticNode stats;
+    SyntheticNode still;
+
+    SyntheticPipe()
+            : tracker(4),
+              isa("isa", &tracker),
+              bb("bb", &tracker, &isa),
+              stats("stats", &tracker, &isa),
+              still("still", &tracker) {}
+
+    std::vector<SyntheticNode*> nodes() { return {&isa, &bb, &stats, &still}; }
+};
+
+/**
+ * Run the frames on the graph one after another, return the average latency of one frame
+ * from the trigger to the last node done, or -1 if a frame isn't done.
+ */
+static int64_t runFrames(int32_t graphId, int frames, SyntheticPipe* pipe) {
+    CameraScheduler scheduler;
+    CHECK_EQ(scheduler.configurate(graphId), OK);
+    for (auto node : pipe->nodes()) CHECK_EQ(scheduler.registerNode(node), OK);
+
+    int64_t start = test::nowUs();
+    for (int64_t tick = 1; tick <= frames; tick++) {
+        pipe->tracker.start(tick);
+        scheduler.executeNode("", tick);
+        if (!pipe->tracker.wait()) {
+            fprintf(stderr, "graph %d: frame %lld isn't done\n", graphId,
+                    static_cast<long long>(tick));
+            return -1;
+        }
+    }
+    int64_t elapsed = test::nowUs() - start;
+
+    for (auto node : pipe->nodes()) {
+        CHECK_EQ(node->orderErrors(), 0);
+        scheduler.unregisterNode(node);
+    }
+    return elapsed / frames;
+}
+
+static void testSequential() {
+    SyntheticPipe pipe;
+    CHECK_TRUE(runFrames(kSequentialGraph, 5, &pipe) >= 4 * kWorkUs);
+}
+
+static void testParallel() {
+    SyntheticPipe pipe;
+    CHECK_TRUE(runFrames(kParallelGraph, 5, &pipe) > 0);
+}
+
+// The node with the cpu hint runs on that cpu, if the test may run on it
+static void testPinned() {
+    cpu_set_t set;
+    pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+
+    SyntheticPipe pipe;
+    CHECK_TRUE(runFrames(kPinnedGraph, 5, &pipe) > 0);
+    if (CPU_ISSET(0, &set)) {
+        CHECK_EQ(pipe.still.lastCpu(), 0);
+    } else {
+        printf("cpu 0 isn't allowed, skip the affinity check\n");
+    }
+}
+
+/**
+ * The frame latency of the same nodes in one executor, run one by one or in the waves of
+ * their dependencies. The waves only help with more than one cpu.
+ */
+static void benchFrameLatency() {
+    SyntheticPipe sequentialPipe;
+    int64_t sequential = runFrames(kSequentialGraph, kBenchFrames, &sequentialPipe);
+    REPORT_BENCH("scheduler frame, sequential", kBenchFrames, sequential * kBenchFrames);
+
+    SyntheticPipe parallelPipe;
+    int64_t parallel = runFrames(kParallelGraph, kBenchFrames, &parallelPipe);
+    REPORT_BENCH("scheduler frame, parallel waves", kBenchFrames, parallel * kBenchFrames);
+    printf("frame latency: sequential %lld us, parallel %lld us\n",
+           static_cast<long long>(sequential), static_cast<long long>(parallel));
+
+    SyntheticPipe pinnedPipe;
+    int64_t pinned = runFrames(kPinnedGraph, kBenchFrames, &pinnedPipe);
+    REPORT_BENCH("scheduler frame, parallel pinned", kBenchFrames, pinned * kBenchFrames);
+
+    CHECK_TRUE(sequential > 0 && parallel > 0 && pinned > 0);
+}
+
+int main() {
+    testSequential();
+    testParallel();
+    testPinned();
+    benchFrameLatency();
+    return test::finish("CameraSchedulerTest");
+}
@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "TestUtils.h"
+#include "core/CaptureReactor.h"
+#include "iutils/Errors.h"
+#include "v4l2/SysCall.h"
+
+using namespace icamera;
+
+static const int kTimeoutMs = 200;
+static const int kWaitMs = 2000;
+static const int kBenchClients = 4;
+static const int kBenchFrames = 2000;
+
+/**
+ * The video nodes are pipes: the test writes the frame timestamp to the write end as the
+ * buffer done, and closes it for a device error (EPOLLHUP).
+ */
+class PipeSysCall : public SysCall {
+ public:
+    int open(const char* pathname, int flags) override {
+        int fds[2];
+        if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0) return -1;
+        std::lock_guard<std::mutex> l(mLock);
+        mWriters[fds[0]] = fds[1];
+        return fds[0];
+    }
+
+    int close(int fd) override {
+        closeWriter(fd);
+        return ::close(fd);
+    }
+
+    int stat(const char* pathname, struct stat* buf) override {
+        memset(buf, 0, sizeof(*buf));
+        buf->st_mode = S_IFCHR | 0666;
+        return 0;
+    }
+
+    void signal(int fd) {
+        int64_t now = test::nowUs();
+        int writer = -1;
+        {
+            std::lock_guard<std::mutex> l(mLock);
+            writer = mWriters[fd];
+        }
+        if (write(writer, &now, sizeof(now)) != sizeof(now)) {
+            fprintf(stderr, "can't signal fd %d\n", fd);
+        }
+    }
+
+    void closeWriter(int fd) {
+        std::lock_guard<std::mutex> l(mLock);
+        auto it = mWriters.find(fd);
+        if (it == mWriters.end()) return;
+        ::close(it->second);
+        mWriters.erase(it);
+    }
+
+ private:
+    std::mutex mLock;
+    std::map<int, int> mWriters;  // The read end to the write end
+};
+
+static PipeSysCall* gSysCall = nullptr;
+
+// Read the timestamps like the dequeue of CaptureUnit, and count the callbacks
+class TestClient : public CaptureReactor::Client {
+ public:
+    TestClient() : mFrames(0), mErrors(0), mTimeouts(0), mLatencyUs(0) {}
+
+    void onDeviceReady(V4L2Device* device) override {
+        int64_t sent = 0;
+        ssize_t ret = read(device->Fd(), &sent, sizeof(sent));
+        std::lock_guard<std::mutex> l(mLock);
+        if (ret == sizeof(sent)) {
+            mLatencyUs += test::nowUs() - sent;
+            mFrames++;
+        } else if (ret == 0) {
+            mErrors++;  // The write end is closed
+        }
+        mCondition.notify_all();
+    }
+
+    void onDeviceTimeout() override {
+        std::lock_guard<std::mutex> l(mLock);
+        mTimeouts++;
+        mCondition.notify_all();
+    }
+
+    bool waitFrames(int frames) {
+        std::unique_lock<std::mutex> l(mLock);
+        return mCondition.wait_for(l, std::chrono::milliseconds(kWaitMs),
+                                   [&]() { return mFrames >= frames; });
+    }
+
+    bool waitTimeouts(int timeouts) {
+        std::unique_lock<std::mutex> l(mLock);
+        return mCondition.wait_for(l, std::chrono::milliseconds(kWaitMs),
+                                   [&]() { return mTimeouts >= timeouts; });
+    }
+
+    int frames() {
+        std::lock_guard<std::mutex> l(mLock);
+        return mFrames;
+    }
+    int errors() {
+        std::lock_guard<std::mutex> l(mLock);
+        return mErrors;
+    }
+    int timeouts() {
+        std::lock_guard<std::mutex> l(mLock);
+        return mTimeouts;
+    }
+    int64_t latencyUs() {
+        std::lock_guard<std::mutex> l(mLock);
+        return mLatencyUs;
+    }
+
+ private:
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    int mFrames;
+    int mErrors;
+    int mTimeouts;
+    int64_t mLatencyUs;
+};
+
+static std::unique_ptr<V4L2Device> openDevice(const char* name) {
+    std::unique_ptr<V4L2Device> device(new V4L2Device(name));
+    CHECK_EQ(device->Open(O_RDWR | O_NONBLOCK), 0);
+    return device;
+}
+
+// The client is only added with a device to wait on
+static void testAddClient(CaptureReactor* reactor) {
+    TestClient client;
+    CHECK_EQ(reactor->addClient(&client, {}, kTimeoutMs), BAD_VALUE);
+
+    V4L2Device closed("/dev/video-closed");
+    CHECK_TRUE(reactor->addClient(&client, {&closed}, kTimeoutMs) != OK);
+
+    // Nothing is left of the failed one
+    std::unique_ptr<V4L2Device> device = openDevice("/dev/video-add");
+    CHECK_EQ(reactor->addClient(&client, {device.get()}, kTimeoutMs), OK);
+    CHECK_EQ(reactor->addClient(&client, {device.get()}, kTimeoutMs), INVALID_OPERATION);
+    gSysCall->signal(device->Fd());
+    CHECK_TRUE(client.waitFrames(1));
+    reactor->removeClient(&client);
+}
+
+// One callback per buffer, the device is waited again after the callback
+static void testReady(CaptureReactor* reactor) {
+    TestClient client;
+    std::unique_ptr<V4L2Device> device = openDevice("/dev/video-ready");
+    CHECK_EQ(reactor->addClient(&client, {device.get()}, kTimeoutMs), OK);
+
+    for (int i = 1; i <= 10; i++) {
+        gSysCall->signal(device->Fd());
+        CHECK_TRUE(client.waitFrames(i));
+    }
+    CHECK_EQ(client.frames(), 10);
+    CHECK_EQ(client.timeouts(), 0);
+    reactor->removeClient(&client);
+}
+
+/**
+ * The device with an error is reported once per tick instead of spinning, and it doesn't
+ * block the other device of the client. The client gets the timeout when the other device
+ * stops too, and the other device is still waited on after the timeout.
+ */
+static void testError(CaptureReactor* reactor) {
+    TestClient client;
+    std::unique_ptr<V4L2Device> broken = openDevice("/dev/video-broken");
+    std::unique_ptr<V4L2Device> device = openDevice("/dev/video-good");
+    CHECK_EQ(reactor->addClient(&client, {broken.get(), device.get()}, kTimeoutMs), OK);
+
+    gSysCall->closeWriter(broken->Fd());
+    int frames = 0;
+    int64_t end = test::nowUs() + 500000;
+    while (test::nowUs() < end) {
+        gSysCall->signal(device->Fd());
+        CHECK_TRUE(client.waitFrames(++frames));
+        usleep(10000);
+    }
+    // The error is reported again after each tick of 100ms
+    int errors = client.errors();
+    CHECK_TRUE(errors >= 2 && errors <= 8);
+    CHECK_EQ(client.timeouts(), 0);
+
+    CHECK_TRUE(client.waitTimeouts(1));
+    gSysCall->signal(device->Fd());
+    CHECK_TRUE(client.waitFrames(frames + 1));
+    reactor->removeClient(&client);
+}
+
+/**
+ * The latency from the buffer done to its callback, with the devices of kBenchClients
+ * cameras done at the same time: all of them in the reactor thread, or one poll thread per
+ * camera like CaptureUnit without the reactor.
+ */
+static void benchLatency(CaptureReactor* reactor) {
+    std::vector<std::unique_ptr<TestClient>> clients;
+    std::vector<std::unique_ptr<V4L2Device>> devices;
+    for (int i = 0; i < kBenchClients; i++) {
+        clients.push_back(std::unique_ptr<TestClient>(new TestClient()));
+        devices.push_back(openDevice("/dev/video-bench"));
+        reactor->addClient(clients[i].get(), {devices[i].get()}, kWaitMs);
+    }
+
+    int64_t start = test::nowUs();
+    for (int frame = 1; frame <= kBenchFrames; frame++) {
+        for (auto& device : devices) gSysCall->signal(device->Fd());
+        for (auto& client : clients) CHECK_TRUE(client->waitFrames(frame));
+    }
+    int64_t elapsed = test::nowUs() - start;
+    int64_t latency = 0;
+    for (int i = 0; i < kBenchClients; i++) {
+        latency += clients[i]->latencyUs();
+        reactor->removeClient(clients[i].get());
+    }
+    REPORT_BENCH("capture frames, reactor", kBenchFrames, elapsed);
+    printf("reactor: %.1f us from buffer done to callback\n",
+           static_cast<double>(latency) / (kBenchFrames * kBenchClients));
+
+    clients.clear();
+    std::atomic<bool> exiting(false);
+    std::vector<std::thread> pollThreads;
+    for (int i = 0; i < kBenchClients; i++) {
+        clients.push_back(std::unique_ptr<TestClient>(new TestClient()));
+        pollThreads.emplace_back([&, i]() {
+            struct pollfd pfd = {devices[i]->Fd(), POLLIN | POLLPRI | POLLERR, 0};
+            while (!exiting) {
+                if (poll(&pfd, 1, 100) > 0) clients[i]->onDeviceReady(devices[i].get());
+            }
+        });
+    }
+
+    start = test::nowUs();
+    for (int frame = 1; frame <= kBenchFrames; frame++) {
+        for (auto& device : devices) gSysCall->signal(device->Fd());
+        for (auto& client : clients) CHECK_TRUE(client->waitFrames(frame));
+    }
+    elapsed = test::nowUs() - start;
+    exiting = true;
+    for (auto& thread : pollThreads) thread.join();
+    latency = 0;
+    for (auto& client : clients) latency += client->latencyUs();
+    REPORT_BENCH("capture frames, poll thread per camera", kBenchFrames, elapsed);
+    printf("poll threads: %.1f us from buffer done to callback\n",
+           static_cast<double>(latency) / (kBenchFrames * kBenchClients));
+}
+
+int main() {
+    gSysCall = new PipeSysCall();
+    SysCall::updateInstance(gSysCall);
+    setenv("cameraCaptureReactor", "1", 1);
+    CaptureReactor* reactor = CaptureReactor::getInstance();
+    CHECK_TRUE(reactor != nullptr);
+    if (!reactor) return test::finish("CaptureReactorTest");
+
+    testAddClient(reactor);
+    testReady(reactor);
+    testError(reactor);
+    benchLatency(reactor);
+    return test::finish("CaptureReactorTest");
+}
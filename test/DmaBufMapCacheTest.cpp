@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "TestUtils.h"
+#include "iutils/DmaBufMapCache.h"
+
+using namespace icamera;
+
+// Set before the first map(), the cache reads them once
+static const int kCacheSize = 4;
+static const int kCacheMb = 16;
+static const unsigned int kSmallSize = 64 * 1024;
+static const unsigned int kLargeSize = 10 << 20;
+static const unsigned int kBenchSize = 8 << 20;
+static const int kBenchRounds = 200;
+
+// memfds stand for the dma buffers, the sync ioctls just fail on them
+static int createBuffer(unsigned int size) {
+    int fd = memfd_create("dmabuf-test", MFD_CLOEXEC);
+    if (fd >= 0 && ftruncate(fd, size) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+struct Stats {
+    Stats() { DmaBufMapCache::getStats(&hits, &misses); }
+    uint64_t hits;
+    uint64_t misses;
+};
+
+// The fds of one buffer share the mapping, and the data written through it stays there
+static void testSharedByFds() {
+    DmaBufMapCache::clear();
+    int fd = createBuffer(kSmallSize);
+    int other = dup(fd);
+    CHECK_TRUE(fd >= 0 && other >= 0);
+    Stats before;
+
+    char* addr = static_cast<char*>(DmaBufMapCache::map(fd, kSmallSize));
+    CHECK_TRUE(addr != nullptr);
+    strcpy(addr, "cached");
+    DmaBufMapCache::unmap(addr, kSmallSize);
+
+    char* again = static_cast<char*>(DmaBufMapCache::map(other, kSmallSize));
+    CHECK_TRUE(again == addr);
+    CHECK_TRUE(strcmp(again, "cached") == 0);
+    DmaBufMapCache::unmap(again, kSmallSize);
+
+    // A different size of the same buffer is another mapping
+    void* half = DmaBufMapCache::map(fd, kSmallSize / 2);
+    CHECK_TRUE(half != nullptr && half != addr);
+    DmaBufMapCache::unmap(half, kSmallSize / 2);
+
+    Stats after;
+    CHECK_EQ(after.hits - before.hits, 1u);
+    CHECK_EQ(after.misses - before.misses, 2u);
+
+    // The cache keeps the buffer alive after the fds are closed
+    close(fd);
+    close(other);
+    DmaBufMapCache::clear();
+}
+
+// The least recently used mapping is evicted when the count limit is reached
+static void testEvictByCount() {
+    DmaBufMapCache::clear();
+    std::vector<int> fds;
+    for (int i = 0; i < kCacheSize + 1; i++) fds.push_back(createBuffer(kSmallSize));
+
+    for (int fd : fds) DmaBufMapCache::unmap(DmaBufMapCache::map(fd, kSmallSize), kSmallSize);
+
+    Stats before;
+    // The last ones are still cached, the first one was evicted
+    DmaBufMapCache::unmap(DmaBufMapCache::map(fds.back(), kSmallSize), kSmallSize);
+    Stats hit;
+    CHECK_EQ(hit.hits - before.hits, 1u);
+    DmaBufMapCache::unmap(DmaBufMapCache::map(fds.front(), kSmallSize), kSmallSize);
+    Stats miss;
+    CHECK_EQ(miss.misses - hit.misses, 1u);
+
+    for (int fd : fds) close(fd);
+    DmaBufMapCache::clear();
+}
+
+// The byte limit evicts too, and the mappings in use are never evicted
+static void testEvictByBytes() {
+    DmaBufMapCache::clear();
+    int a = createBuffer(kLargeSize);
+    int b = createBuffer(kLargeSize);
+    CHECK_TRUE(a >= 0 && b >= 0);
+
+    char* addrA = static_cast<char*>(DmaBufMapCache::map(a, kLargeSize));
+    CHECK_TRUE(addrA != nullptr);
+    addrA[kLargeSize - 1] = 'a';
+
+    // a is in use, so b isn't cached but still mapped, and unmapped directly
+    char* addrB = static_cast<char*>(DmaBufMapCache::map(b, kLargeSize));
+    CHECK_TRUE(addrB != nullptr && addrB != addrA);
+    addrB[kLargeSize - 1] = 'b';
+    DmaBufMapCache::unmap(addrB, kLargeSize);
+    CHECK_EQ(addrA[kLargeSize - 1], 'a');
+    DmaBufMapCache::unmap(addrA, kLargeSize);
+
+    Stats before;
+    // a is released now, mapping b evicts it since both don't fit in kCacheMb
+    addrB = static_cast<char*>(DmaBufMapCache::map(b, kLargeSize));
+    CHECK_EQ(addrB[kLargeSize - 1], 'b');
+    DmaBufMapCache::unmap(addrB, kLargeSize);
+    addrA = static_cast<char*>(DmaBufMapCache::map(a, kLargeSize));
+    CHECK_EQ(addrA[kLargeSize - 1], 'a');
+    DmaBufMapCache::unmap(addrA, kLargeSize);
+    Stats after;
+    CHECK_EQ(after.hits - before.hits, 0u);
+    CHECK_EQ(after.misses - before.misses, 2u);
+
+    close(a);
+    close(b);
+    DmaBufMapCache::clear();
+}
+
+// Map a frame sized buffer and touch every page, as the SW post processing does per frame
+static void benchMapFrame() {
+    DmaBufMapCache::clear();
+    int fd = createBuffer(kBenchSize);
+    CHECK_TRUE(fd >= 0);
+    const long pageSize = sysconf(_SC_PAGESIZE);
+
+    int64_t start = test::nowUs();
+    for (int i = 0; i < kBenchRounds; i++) {
+        void* addr = mmap(nullptr, kBenchSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        for (unsigned int off = 0; off < kBenchSize; off += pageSize) {
+            static_cast<char*>(addr)[off] = i;
+        }
+        munmap(addr, kBenchSize);
+    }
+    REPORT_BENCH("mmap 8MB frame every access", kBenchRounds, test::nowUs() - start);
+
+    start = test::nowUs();
+    for (int i = 0; i < kBenchRounds; i++) {
+        void* addr = DmaBufMapCache::map(fd, kBenchSize);
+        for (unsigned int off = 0; off < kBenchSize; off += pageSize) {
+            static_cast<char*>(addr)[off] = i;
+        }
+        DmaBufMapCache::unmap(addr, kBenchSize);
+    }
+    REPORT_BENCH("DmaBufMapCache 8MB frame", kBenchRounds, test::nowUs() - start);
+
+    close(fd);
+    DmaBufMapCache::clear();
+}
+
+int main() {
+    setenv("cameraDmaBufMapCacheSize", std::to_string(kCacheSize).c_str(), 1);
+    setenv("cameraDmaBufMapCacheMb", std::to_string(kCacheMb).c_str(), 1);
+
+    testSharedByFds();
+    testEvictByCount();
+    testEvictByBytes();
+    benchMapFrame();
+    return test::finish("DmaBufMapCacheTest");
+}
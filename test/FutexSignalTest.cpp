@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "TestUtils.h"
+#include "iutils/Errors.h"
+#include "iutils/Thread.h"
+
+using namespace icamera;
+
+static const int64_t kMsToNs = 1000000LL;
+
+static void testTimeout() {
+    FutexSignal signal;
+    Mutex lock;
+    ConditionLock l(lock);
+
+    int64_t start = test::nowUs();
+    int ret = signal.waitRelative(l, signal.key(), 20 * kMsToNs);
+    int64_t elapsed = test::nowUs() - start;
+
+    CHECK_EQ(ret, TIMED_OUT);
+    CHECK_TRUE(elapsed >= 15000);
+    CHECK_TRUE(l.owns_lock());
+}
+
+// A signal between key() and waitRelative() must not be lost
+static void testSignalBeforeWait() {
+    FutexSignal signal;
+    Mutex lock;
+    ConditionLock l(lock);
+
+    uint32_t key = signal.key();
+    signal.signal();
+
+    int64_t start = test::nowUs();
+    int ret = signal.waitRelative(l, key, 1000 * kMsToNs);
+    CHECK_EQ(ret, OK);
+    CHECK_TRUE(test::nowUs() - start < 500000);
+}
+
+// The signaling thread doesn't take the waiter's lock, like the lock-free producers
+static void testWakeup() {
+    FutexSignal signal;
+    Mutex lock;
+    std::atomic<bool> ready(false);
+
+    std::thread producer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ready = true;
+        signal.signal();
+    });
+
+    ConditionLock l(lock);
+    int ret = OK;
+    while (!ready && ret == OK) {
+        uint32_t key = signal.key();
+        if (ready) break;
+        ret = signal.waitRelative(l, key, 2000 * kMsToNs);
+    }
+    producer.join();
+
+    CHECK_EQ(ret, OK);
+    CHECK_TRUE(ready);
+}
+
+static void testBroadcast() {
+    const int kWaiterCount = 4;
+    FutexSignal signal;
+    Mutex lock;
+    std::atomic<bool> go(false);
+    std::atomic<int> woken(0);
+    std::vector<std::thread> waiters;
+
+    for (int i = 0; i < kWaiterCount; i++) {
+        waiters.emplace_back([&]() {
+            ConditionLock l(lock);
+            while (!go) {
+                uint32_t key = signal.key();
+                if (go) break;
+                if (signal.waitRelative(l, key, 2000 * kMsToNs) == TIMED_OUT) return;
+            }
+            woken++;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    go = true;
+    signal.broadcast();
+    for (auto& t : waiters) t.join();
+
+    CHECK_EQ(woken.load(), kWaiterCount);
+}
+
+// Round trip latency of one signal between two threads
+static void benchPingPong() {
+    const int kRounds = 20000;
+    FutexSignal ping, pong;
+    Mutex pingLock, pongLock;
+    std::atomic<int> pingCount(0), pongCount(0);
+
+    std::thread peer([&]() {
+        ConditionLock l(pingLock);
+        for (int i = 1; i <= kRounds; i++) {
+            while (pingCount.load() < i) {
+                uint32_t key = ping.key();
+                if (pingCount.load() >= i) break;
+                ping.waitRelative(l, key, 1000 * kMsToNs);
+            }
+            pongCount = i;
+            pong.signal();
+        }
+    });
+
+    int64_t start = test::nowUs();
+    ConditionLock l(pongLock);
+    for (int i = 1; i <= kRounds; i++) {
+        pingCount = i;
+        ping.signal();
+        while (pongCount.load() < i) {
+            uint32_t key = pong.key();
+            if (pongCount.load() >= i) break;
+            pong.waitRelative(l, key, 1000 * kMsToNs);
+        }
+    }
+    int64_t elapsed = test::nowUs() - start;
+    peer.join();
+
+    CHECK_EQ(pongCount.load(), kRounds);
+    REPORT_BENCH("FutexSignal ping-pong round trips", kRounds, elapsed);
+}
+
+int main() {
+    testTimeout();
+    testSignalBeforeWait();
+    testWakeup();
+    testBroadcast();
+    benchPingPong();
+    return test::finish("FutexSignalTest");
+}
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "TestUtils.h"
+#include "modules/sandboxing/IPCShmRef.h"
+
+using namespace icamera;
+
+static const int kRegionCount = 2;
+static const uint32_t kRegionSize = 1 << 20;
+// The payloads of one PG encode, like the terminals of a video PG
+static const int kPayloadCount = 8;
+static const uint32_t kPayloadSize = 64 * 1024;
+static const int kRoundTrips = 20000;
+
+/**
+ * The same shared memory is mapped twice, at different addresses, like the client and the
+ * server processes do. Each side numbers the regions in the same registration order.
+ */
+struct SharedRegions {
+    SharedRegions() {
+        for (int i = 0; i < kRegionCount; i++) {
+            int fd = memfd_create("ipc-shm-ref-test", MFD_CLOEXEC);
+            if (fd < 0 || ftruncate(fd, kRegionSize) != 0) {
+                if (fd >= 0) close(fd);
+                client[i] = server[i] = {0, 0};
+                continue;
+            }
+            void* c = mmap(nullptr, kRegionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            void* s = mmap(nullptr, kRegionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            client[i] = {reinterpret_cast<uintptr_t>(c), kRegionSize};
+            server[i] = {reinterpret_cast<uintptr_t>(s), kRegionSize};
+        }
+    }
+    ~SharedRegions() {
+        for (int i = 0; i < kRegionCount; i++) {
+            if (client[i].addr) munmap(reinterpret_cast<void*>(client[i].addr), kRegionSize);
+            if (server[i].addr) munmap(reinterpret_cast<void*>(server[i].addr), kRegionSize);
+        }
+    }
+    bool valid() const {
+        for (int i = 0; i < kRegionCount; i++) {
+            if (!client[i].addr || !server[i].addr || client[i].addr == server[i].addr)
+                return false;
+        }
+        return true;
+    }
+    char* clientAddr(int region, uint32_t offset) {
+        return reinterpret_cast<char*>(client[region].addr) + offset;
+    }
+
+    ipc_shm_region client[kRegionCount];
+    ipc_shm_region server[kRegionCount];
+};
+
+// A reference made by the client points to the same data through the server mapping
+static void testRoundTrip() {
+    SharedRegions regions;
+    CHECK_TRUE(regions.valid());
+
+    char* data = regions.clientAddr(1, 4096);
+    strcpy(data, "payload");
+    ipc_shm_ref ref;
+    CHECK_TRUE(ipcShmRefFromAddr(regions.client, kRegionCount, data, 8, &ref));
+    CHECK_EQ(ref.region, 1);
+    CHECK_EQ(ref.offset, 4096u);
+    CHECK_EQ(ref.size, 8u);
+
+    char* resolved = static_cast<char*>(ipcShmRefToAddr(regions.server, kRegionCount, ref));
+    CHECK_TRUE(resolved != nullptr && resolved != data);
+    CHECK_TRUE(resolved && strcmp(resolved, "payload") == 0);
+
+    // The data which ends exactly at the region end is valid
+    data = regions.clientAddr(0, kRegionSize - 16);
+    CHECK_TRUE(ipcShmRefFromAddr(regions.client, kRegionCount, data, 16, &ref));
+    CHECK_TRUE(ipcShmRefToAddr(regions.server, kRegionCount, ref) != nullptr);
+}
+
+static void testNoData() {
+    SharedRegions regions;
+    ipc_shm_ref ref = {0, 1, 1};
+    CHECK_TRUE(ipcShmRefFromAddr(regions.client, kRegionCount, nullptr, 16, &ref));
+    CHECK_EQ(ref.region, -1);
+    CHECK_TRUE(ipcShmRefToAddr(regions.server, kRegionCount, ref) == nullptr);
+
+    CHECK_TRUE(ipcShmRefFromAddr(regions.client, kRegionCount, regions.clientAddr(0, 0), 0,
+                                 &ref));
+    CHECK_EQ(ref.region, -1);
+}
+
+// The client can only reference the registered regions
+static void testOutOfRegion() {
+    SharedRegions regions;
+    char local[16];
+    ipc_shm_ref ref;
+    CHECK_TRUE(!ipcShmRefFromAddr(regions.client, kRegionCount, local, sizeof(local), &ref));
+    // Straddling the region end
+    CHECK_TRUE(!ipcShmRefFromAddr(regions.client, kRegionCount,
+                                  regions.clientAddr(0, kRegionSize - 8), 16, &ref));
+    CHECK_TRUE(!ipcShmRefFromAddr(regions.client, kRegionCount, regions.clientAddr(0, 0),
+                                  kRegionSize + 1, &ref));
+}
+
+// The server rejects the references a broken or hostile client makes up
+static void testForgedRef() {
+    SharedRegions regions;
+    ipc_shm_ref ref = {kRegionCount, 0, 16};
+    CHECK_TRUE(ipcShmRefToAddr(regions.server, kRegionCount, ref) == nullptr);
+    ref = {-2, 0, 16};
+    CHECK_TRUE(ipcShmRefToAddr(regions.server, kRegionCount, ref) == nullptr);
+    ref = {0, kRegionSize - 8, 16};
+    CHECK_TRUE(ipcShmRefToAddr(regions.server, kRegionCount, ref) == nullptr);
+    // The offset plus size overflows 32 bits
+    ref = {0, 0xFFFFFFF0u, 0x20};
+    CHECK_TRUE(ipcShmRefToAddr(regions.server, kRegionCount, ref) == nullptr);
+    ref = {0, 0, kRegionSize + 1};
+    CHECK_TRUE(ipcShmRefToAddr(regions.server, kRegionCount, ref) == nullptr);
+
+    // A region which isn't registered on the server side yet
+    ipc_shm_region unmapped[kRegionCount] = {regions.server[0], {0, 0}};
+    ref = {1, 0, 16};
+    CHECK_TRUE(ipcShmRefToAddr(unmapped, kRegionCount, ref) == nullptr);
+}
+
+/**
+ * A local loopback bridge: the server thread handles one message at a time, and the client
+ * blocks until it's done, like requestSync() over the algo bridge.
+ */
+class LoopbackBridge {
+ public:
+    template <typename Handler>
+    explicit LoopbackBridge(Handler handler)
+            : mPending(false), mExit(false), mServer([this, handler]() {
+                  std::unique_lock<std::mutex> l(mLock);
+                  while (true) {
+                      mCond.wait(l, [this]() { return mPending || mExit; });
+                      if (mExit) return;
+                      handler();
+                      mPending = false;
+                      mCond.notify_all();
+                  }
+              }) {}
+    ~LoopbackBridge() {
+        {
+            std::lock_guard<std::mutex> l(mLock);
+            mExit = true;
+        }
+        mCond.notify_all();
+        mServer.join();
+    }
+
+    void requestSync() {
+        std::unique_lock<std::mutex> l(mLock);
+        mPending = true;
+        mCond.notify_all();
+        mCond.wait(l, [this]() { return !mPending; });
+    }
+
+ private:
+    std::mutex mLock;
+    std::condition_variable mCond;
+    bool mPending;
+    bool mExit;
+    std::thread mServer;
+};
+
+/**
+ * One PG encode round trip with kPayloadCount payloads, which the server reads and writes.
+ * The flattened message copies the payloads into the message region and back on both sides,
+ * while the references let the server use the payloads in the registered regions in place.
+ */
+static void benchEncodeRoundTrip() {
+    SharedRegions regions;
+    CHECK_TRUE(regions.valid());
+    if (!regions.valid()) return;
+
+    // Region 0 holds the messages, the payloads are in region 1
+    std::vector<char*> payloads;
+    for (int i = 0; i < kPayloadCount; i++) {
+        payloads.push_back(regions.clientAddr(1, i * kPayloadSize));
+        memset(payloads[i], i, kPayloadSize);
+    }
+    std::vector<std::vector<char>> serverPayloads(kPayloadCount,
+                                                  std::vector<char>(kPayloadSize));
+    char* serverMsg = reinterpret_cast<char*>(regions.server[0].addr);
+    char* clientMsg = reinterpret_cast<char*>(regions.client[0].addr);
+    int errors = 0;
+
+    {
+        LoopbackBridge bridge([&]() {
+            for (int i = 0; i < kPayloadCount; i++) {
+                char* msgPayload = serverMsg + i * kPayloadSize;
+                memcpy(serverPayloads[i].data(), msgPayload, kPayloadSize);
+                serverPayloads[i][0]++;
+                memcpy(msgPayload, serverPayloads[i].data(), kPayloadSize);
+            }
+        });
+        int64_t start = test::nowUs();
+        for (int n = 0; n < kRoundTrips; n++) {
+            for (int i = 0; i < kPayloadCount; i++) {
+                memcpy(clientMsg + i * kPayloadSize, payloads[i], kPayloadSize);
+            }
+            bridge.requestSync();
+            for (int i = 0; i < kPayloadCount; i++) {
+                memcpy(payloads[i], clientMsg + i * kPayloadSize, kPayloadSize);
+            }
+        }
+        REPORT_BENCH("PG encode flattened, 8 x 64KB payloads", kRoundTrips,
+                     test::nowUs() - start);
+    }
+
+    ipc_shm_ref* clientRefs = reinterpret_cast<ipc_shm_ref*>(clientMsg);
+    const ipc_shm_ref* serverRefs = reinterpret_cast<const ipc_shm_ref*>(serverMsg);
+    {
+        LoopbackBridge bridge([&]() {
+            for (int i = 0; i < kPayloadCount; i++) {
+                char* data =
+                    static_cast<char*>(ipcShmRefToAddr(regions.server, kRegionCount,
+                                                       serverRefs[i]));
+                if (!data) {
+                    errors++;
+                    continue;
+                }
+                data[0]++;
+            }
+        });
+        int64_t start = test::nowUs();
+        for (int n = 0; n < kRoundTrips; n++) {
+            for (int i = 0; i < kPayloadCount; i++) {
+                if (!ipcShmRefFromAddr(regions.client, kRegionCount, payloads[i], kPayloadSize,
+                                       &clientRefs[i]))
+                    errors++;
+            }
+            bridge.requestSync();
+        }
+        REPORT_BENCH("PG encode with shm refs, 8 x 64KB payloads", kRoundTrips,
+                     test::nowUs() - start);
+    }
+
+    CHECK_EQ(errors, 0);
+    // Every round trip of both modes incremented the first byte of each payload
+    for (int i = 0; i < kPayloadCount; i++) {
+        CHECK_EQ(payloads[i][0], static_cast<char>(i + 2 * kRoundTrips));
+    }
+}
+
+int main() {
+    testRoundTrip();
+    testNoData();
+    testOutOfRegion();
+    testForgedRef();
+    benchEncodeRoundTrip();
+    return test::finish("IPCShmRefTest");
+}
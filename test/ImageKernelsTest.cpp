@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "ImageKernels.h"
+#include "TestUtils.h"
+#include "iutils/SwImageConverter.h"
+
+using namespace icamera;
+
+static const int kRowWidth = 1920;
+static const int kBenchRows = 2000;
+// Odd lengths make sure the scalar tails after the SIMD blocks are covered
+static const int kLengths[] = {1, 3, 7, 15, 16, 17, 31, 33, 63, 64, 65, 255, kRowWidth};
+
+static std::vector<uint8_t> randomBytes(size_t size) {
+    std::vector<uint8_t> data(size);
+    for (auto& v : data) v = static_cast<uint8_t>(rand());
+    return data;
+}
+
+static void compareCopyKernels(const ImageKernels& ref, const ImageKernels& simd) {
+    std::vector<uint8_t> src = randomBytes(4 * kRowWidth + 64);
+
+    for (int n : kLengths) {
+        for (int phase = 0; phase < 4; phase++) {
+            std::vector<uint8_t> a(n, 0), b(n, 0);
+            if (phase < 2) {
+                ref.extractEvery2(src.data(), a.data(), n, phase);
+                simd.extractEvery2(src.data(), b.data(), n, phase);
+                CHECK_TRUE(a == b);
+            }
+            ref.extractEvery4(src.data(), a.data(), n, phase);
+            simd.extractEvery4(src.data(), b.data(), n, phase);
+            CHECK_TRUE(a == b);
+        }
+
+        std::vector<uint8_t> a(2 * n, 0), b(2 * n, 0);
+        ref.swapPairs(src.data(), a.data(), 2 * n);
+        simd.swapPairs(src.data(), b.data(), 2 * n);
+        CHECK_TRUE(a == b);
+
+        ref.yuyvToVU(src.data(), a.data(), n);
+        simd.yuyvToVU(src.data(), b.data(), n);
+        CHECK_TRUE(a == b);
+    }
+}
+
+static void compareBilinear(const ImageKernels& ref, const ImageKernels& simd) {
+    // Pad the rows so that the 4 byte SIMD reads stay in the buffer for all outputs
+    std::vector<uint8_t> row0 = randomBytes(2 * kRowWidth + 8);
+    std::vector<uint8_t> row1 = randomBytes(2 * kRowWidth + 8);
+
+    for (int shift : {8, 14}) {
+        for (int neighbor : {1, 2}) {
+            for (int n : kLengths) {
+                std::vector<int32_t> xOffset(n), xFrac(n);
+                for (int i = 0; i < n; i++) {
+                    xOffset[i] = rand() % (2 * kRowWidth - neighbor);
+                    xFrac[i] = rand() % (1 << shift);
+                }
+                int fy = rand() % (1 << shift);
+                for (int dstStep : {1, 2}) {
+                    std::vector<uint8_t> a(n * dstStep, 0), b(n * dstStep, 0);
+                    ref.bilinearRow(row0.data(), row1.data(), xOffset.data(), xFrac.data(),
+                                    neighbor, fy, shift, a.data(), dstStep, n, n);
+                    simd.bilinearRow(row0.data(), row1.data(), xOffset.data(), xFrac.data(),
+                                     neighbor, fy, shift, b.data(), dstStep, n, n);
+                    CHECK_TRUE(a == b);
+                }
+            }
+        }
+    }
+}
+
+static void compareTemporalBlend(const ImageKernels& ref, const ImageKernels& simd) {
+    std::vector<uint8_t> cur = randomBytes(kRowWidth);
+    std::vector<uint8_t> prev = randomBytes(kRowWidth);
+
+    for (int n : kLengths) {
+        int strength = rand() % 129;
+        int floor = rand() % 256;
+        int slope = rand() % 256;
+        std::vector<uint8_t> a(n, 0), b(n, 0), b2(n, 0);
+        ref.temporalBlendRow(cur.data(), prev.data(), a.data(), nullptr, n, strength, floor,
+                             slope);
+        simd.temporalBlendRow(cur.data(), prev.data(), b.data(), b2.data(), n, strength, floor,
+                              slope);
+        CHECK_TRUE(a == b);
+        CHECK_TRUE(a == b2);
+    }
+}
+
+// The scalar color kernels must give the results of the SwImageConverter pixel functions
+static void checkColorReference(const ImageKernels& scalar) {
+    std::vector<uint8_t> y(256), u(256), v(256);
+    std::vector<uint16_t> r(256), g(256), b(256);
+    bool same = true;
+    for (int cu = 0; cu < 256; cu++) {
+        for (int cv = 0; cv < 256; cv++) {
+            for (int i = 0; i < 256; i++) {
+                y[i] = i;
+                u[i] = cu;
+                v[i] = cv;
+            }
+            scalar.yuvToRgbRow(y.data(), u.data(), v.data(), r.data(), g.data(), b.data(), 256);
+            for (int i = 0; i < 256; i++) {
+                unsigned short er, eg, eb;
+                SwImageConverter::YUV2RGB(i, cu, cv, &er, &eg, &eb);
+                if (r[i] != er || g[i] != eg || b[i] != eb) same = false;
+            }
+        }
+    }
+    CHECK_TRUE(same);
+
+    const int kCount = 4096;
+    std::vector<uint16_t> gr(kCount), gb(kCount);
+    r.resize(kCount);
+    b.resize(kCount);
+    y.resize(kCount);
+    u.resize(kCount);
+    v.resize(kCount);
+    same = true;
+    for (int round = 0; round < 64; round++) {
+        for (int i = 0; i < kCount; i++) {
+            r[i] = rand() & 0x3ff;
+            gr[i] = rand() & 0x3ff;
+            gb[i] = rand() & 0x3ff;
+            b[i] = rand() & 0x3ff;
+        }
+        scalar.rgbToYuvRow(r.data(), gr.data(), gb.data(), b.data(), y.data(), u.data(),
+                           v.data(), kCount);
+        for (int i = 0; i < kCount; i++) {
+            unsigned char ey, eu, ev;
+            SwImageConverter::RGB2YUV(r[i], (gr[i] + gb[i]) / 2, b[i], &ey, &eu, &ev);
+            if (y[i] != ey || u[i] != eu || v[i] != ev) same = false;
+        }
+    }
+    CHECK_TRUE(same);
+}
+
+static void compareColor(const ImageKernels& ref, const ImageKernels& simd) {
+    std::vector<uint8_t> yuv = randomBytes(3 * kRowWidth);
+    std::vector<uint16_t> rgb(4 * kRowWidth);
+    for (auto& c : rgb) c = rand() & 0x3ff;
+    const uint16_t* planes[4];
+    for (int c = 0; c < 4; c++) planes[c] = rgb.data() + c * kRowWidth;
+    const uint8_t* yp = yuv.data();
+    const uint8_t* up = yp + kRowWidth;
+    const uint8_t* vp = up + kRowWidth;
+
+    for (int n : kLengths) {
+        std::vector<uint8_t> a(3 * n, 0), b(3 * n, 0);
+        ref.rgbToYuvRow(planes[0], planes[1], planes[2], planes[3], a.data(), a.data() + n,
+                        a.data() + 2 * n, n);
+        simd.rgbToYuvRow(planes[0], planes[1], planes[2], planes[3], b.data(), b.data() + n,
+                         b.data() + 2 * n, n);
+        CHECK_TRUE(a == b);
+
+        std::vector<uint16_t> c(3 * n, 0), d(3 * n, 0);
+        ref.yuvToRgbRow(yp, up, vp, c.data(), c.data() + n, c.data() + 2 * n, n);
+        simd.yuvToRgbRow(yp, up, vp, d.data(), d.data() + n, d.data() + 2 * n, n);
+        CHECK_TRUE(c == d);
+    }
+}
+
+static void benchLevel(const ImageKernels& kernels, const std::string& levelName) {
+    std::vector<uint8_t> src = randomBytes(4 * kRowWidth + 64);
+    std::vector<uint8_t> ref = randomBytes(4 * kRowWidth + 64);
+    std::vector<uint8_t> dst(4 * kRowWidth);
+    std::vector<int32_t> xOffset(kRowWidth), xFrac(kRowWidth);
+    for (int i = 0; i < kRowWidth; i++) {
+        xOffset[i] = i * 3 / 2;
+        xFrac[i] = (i * 128) & 0xff;
+    }
+
+    int64_t start = test::nowUs();
+    for (int r = 0; r < kBenchRows; r++) kernels.swapPairs(src.data(), dst.data(), 2 * kRowWidth);
+    REPORT_BENCH(("swapPairs rows " + levelName).c_str(), kBenchRows, test::nowUs() - start);
+
+    start = test::nowUs();
+    for (int r = 0; r < kBenchRows; r++) {
+        kernels.bilinearRow(src.data(), ref.data(), xOffset.data(), xFrac.data(), 1, 100, 8,
+                            dst.data(), 1, kRowWidth, kRowWidth);
+    }
+    REPORT_BENCH(("bilinearRow rows " + levelName).c_str(), kBenchRows, test::nowUs() - start);
+
+    start = test::nowUs();
+    for (int r = 0; r < kBenchRows; r++) {
+        kernels.temporalBlendRow(src.data(), ref.data(), dst.data(), nullptr, 2 * kRowWidth, 96,
+                                 4, 8);
+    }
+    REPORT_BENCH(("temporalBlendRow rows " + levelName).c_str(), kBenchRows,
+                 test::nowUs() - start);
+
+    const uint16_t* rgb = reinterpret_cast<const uint16_t*>(src.data());
+    start = test::nowUs();
+    for (int r = 0; r < kBenchRows; r++) {
+        kernels.rgbToYuvRow(rgb, rgb + kRowWidth / 2, rgb + kRowWidth, rgb + kRowWidth * 3 / 2,
+                            dst.data(), dst.data() + kRowWidth, dst.data() + 2 * kRowWidth,
+                            kRowWidth / 2);
+    }
+    REPORT_BENCH(("rgbToYuvRow rows " + levelName).c_str(), kBenchRows, test::nowUs() - start);
+}
+
+int main() {
+    srand(1);
+    const ImageKernels& scalar = getImageKernels(ImageKernels::LEVEL_SCALAR);
+    CHECK_EQ(scalar.level, ImageKernels::LEVEL_SCALAR);
+    checkColorReference(scalar);
+    benchLevel(scalar, "scalar");
+
+    const ImageKernels::Level levels[] = {ImageKernels::LEVEL_SSE41, ImageKernels::LEVEL_AVX2};
+    const char* names[] = {"sse4.1", "avx2"};
+    for (int i = 0; i < 2; i++) {
+        const ImageKernels& simd = getImageKernels(levels[i]);
+        if (simd.level != levels[i]) {
+            printf("%s isn't supported by the CPU, skipped\n", names[i]);
+            continue;
+        }
+        compareCopyKernels(scalar, simd);
+        compareBilinear(scalar, simd);
+        compareTemporalBlend(scalar, simd);
+        compareColor(scalar, simd);
+        benchLevel(simd, names[i]);
+    }
+    CHECK_TRUE(getImageKernels().level >= ImageKernels::LEVEL_SCALAR);
+
+    return test::finish("ImageKernelsTest");
+}
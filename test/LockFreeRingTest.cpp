@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "TestUtils.h"
+#include "iutils/LockFreeRing.h"
+#include "iutils/Thread.h"
+
+using namespace icamera;
+
+static const int kProducerCount = 4;
+static const int kItemsPerProducer = 200000;
+
+static void testBasic() {
+    LockFreeRing<int> ring(5);
+    CHECK_EQ(ring.capacity(), 8u);
+    CHECK_TRUE(ring.empty());
+
+    for (int i = 0; i < 8; i++) CHECK_TRUE(ring.push(i));
+    CHECK_TRUE(!ring.push(8));
+    CHECK_EQ(ring.size(), 8u);
+
+    for (int i = 0; i < 8; i++) {
+        CHECK_TRUE(!ring.empty());
+        CHECK_EQ(ring.front(), i);
+        ring.pop();
+    }
+    CHECK_TRUE(ring.empty());
+
+    // Wrap around several times
+    for (int i = 0; i < 100; i++) {
+        CHECK_TRUE(ring.push(i));
+        CHECK_TRUE(ring.push(i + 1000));
+        CHECK_EQ(ring.front(), i);
+        ring.pop();
+        CHECK_EQ(ring.front(), i + 1000);
+        ring.pop();
+    }
+    CHECK_TRUE(ring.empty());
+
+    ring.push(1);
+    ring.push(2);
+    ring.clear();
+    CHECK_TRUE(ring.empty());
+    CHECK_EQ(ring.size(), 0u);
+    CHECK_TRUE(ring.push(3));
+    CHECK_EQ(ring.front(), 3);
+}
+
+static void testReleaseOnPop() {
+    LockFreeRing<std::shared_ptr<int>> ring(4);
+    std::shared_ptr<int> item = std::make_shared<int>(1);
+    ring.push(item);
+    CHECK_EQ(item.use_count(), 2);
+    ring.pop();
+    // The ring must not keep a popped buffer alive
+    CHECK_EQ(item.use_count(), 1);
+}
+
+/**
+ * Several producers push concurrently while one consumer pops, every item must be seen
+ * exactly once and in the order of its producer.
+ */
+static void testMultiProducer() {
+    LockFreeRing<int64_t> ring(1024);
+    std::vector<std::thread> producers;
+
+    int64_t start = test::nowUs();
+    for (int p = 0; p < kProducerCount; p++) {
+        producers.emplace_back([&ring, p]() {
+            for (int i = 0; i < kItemsPerProducer; i++) {
+                int64_t value = (static_cast<int64_t>(p) << 32) | i;
+                while (!ring.push(value)) std::this_thread::yield();
+            }
+        });
+    }
+
+    std::vector<int> next(kProducerCount, 0);
+    int64_t received = 0;
+    bool ordered = true;
+    while (received < kProducerCount * kItemsPerProducer) {
+        if (ring.empty()) {
+            std::this_thread::yield();
+            continue;
+        }
+        int64_t value = ring.front();
+        ring.pop();
+        int p = static_cast<int>(value >> 32);
+        int i = static_cast<int>(value & 0xffffffff);
+        if (p < 0 || p >= kProducerCount || next[p] != i) ordered = false;
+        if (p >= 0 && p < kProducerCount) next[p] = i + 1;
+        received++;
+    }
+    for (auto& t : producers) t.join();
+    int64_t elapsed = test::nowUs() - start;
+
+    CHECK_TRUE(ordered);
+    for (int p = 0; p < kProducerCount; p++) CHECK_EQ(next[p], kItemsPerProducer);
+    CHECK_TRUE(ring.empty());
+    REPORT_BENCH("LockFreeRing 4 producers 1 consumer", received, elapsed);
+}
+
+// The queue which BufferQueue used before the ring, as the reference of the benchmark
+static void benchMutexQueue() {
+    std::deque<int64_t> queue;
+    Mutex lock;
+    std::vector<std::thread> producers;
+
+    int64_t start = test::nowUs();
+    for (int p = 0; p < kProducerCount; p++) {
+        producers.emplace_back([&queue, &lock, p]() {
+            for (int i = 0; i < kItemsPerProducer; i++) {
+                AutoMutex l(lock);
+                queue.push_back((static_cast<int64_t>(p) << 32) | i);
+            }
+        });
+    }
+
+    int64_t received = 0;
+    while (received < kProducerCount * kItemsPerProducer) {
+        AutoMutex l(lock);
+        while (!queue.empty()) {
+            queue.pop_front();
+            received++;
+        }
+    }
+    for (auto& t : producers) t.join();
+    REPORT_BENCH("mutex deque 4 producers 1 consumer", received, test::nowUs() - start);
+}
+
+int main() {
+    testBasic();
+    testReleaseOnPop();
+    testMultiProducer();
+    benchMutexQueue();
+    return test::finish("LockFreeRingTest");
+}
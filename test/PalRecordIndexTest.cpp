@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <vector>
+
+#include "TestUtils.h"
+#include "core/PalRecordIndex.h"
+
+using namespace icamera;
+
+// The same layout as ia_pal_record_header
+struct RecordHeader {
+    uint32_t uuid;
+    uint32_t size;
+};
+
+typedef PalRecordIndex<RecordHeader> Index;
+
+// The records which IspParamAdaptor copies, the uuids are made up
+static const int kCallInfo = 101;
+static const int kBnlm = 102;
+static const int kLsc = 103;
+static const int kGdc = 104;
+static const int kBenchFrames = 3000;
+static const int kBenchBuffers = 4;
+
+struct RecordDesc {
+    int uuid;
+    uint32_t size;
+};
+
+/**
+ * A video PAL buffer with the copied records among the other kernels, the sizes are about
+ * the ones of a 1080p video pipe.
+ */
+static std::vector<RecordDesc> videoLayout() {
+    std::vector<RecordDesc> layout;
+    for (int i = 0; i < 30; i++) layout.push_back({1 + i, 256u + 64u * (i % 8)});
+    layout.insert(layout.begin() + 2, {kCallInfo, 64});
+    layout.insert(layout.begin() + 10, {kBnlm, 4096});
+    layout.insert(layout.begin() + 20, {kLsc, 40 * 1024});
+    layout.push_back({kGdc, 96 * 1024});
+    return layout;
+}
+
+static std::vector<char> createPal(const std::vector<RecordDesc>& layout, char fill) {
+    uint32_t total = 0;
+    for (auto& desc : layout) total += desc.size;
+    std::vector<char> pal(total, fill);
+    uint32_t offset = 0;
+    for (auto& desc : layout) {
+        RecordHeader header = {static_cast<uint32_t>(desc.uuid), desc.size};
+        memcpy(pal.data() + offset, &header, sizeof(header));
+        offset += desc.size;
+    }
+    return pal;
+}
+
+static int offsetIn(const std::vector<RecordDesc>& layout, int uuid) {
+    int offset = 0;
+    for (auto& desc : layout) {
+        if (desc.uuid == uuid) return offset;
+        offset += desc.size;
+    }
+    return -1;
+}
+
+// Whether the body of the record at the offset is filled with the value
+static bool recordIs(const std::vector<char>& pal, int offset, uint32_t size, char fill) {
+    for (uint32_t i = sizeof(RecordHeader); i < size; i++) {
+        if (pal[offset + i] != fill) return false;
+    }
+    return true;
+}
+
+static bool copyAll(int) {
+    return true;
+}
+
+static void testBuild() {
+    std::vector<RecordDesc> layout = videoLayout();
+    std::vector<char> pal = createPal(layout, 0);
+    Index index({kCallInfo, kBnlm, kLsc, kGdc, 999});
+    CHECK_TRUE(!index.isIndexed());
+    CHECK_TRUE(index.build(pal.data(), pal.size()));
+    CHECK_TRUE(index.isIndexed());
+    for (int uuid : {kCallInfo, kBnlm, kLsc, kGdc}) {
+        CHECK_EQ(index.offsetOf(uuid), offsetIn(layout, uuid));
+    }
+    CHECK_EQ(index.offsetOf(999), -1);
+
+    // The size of the last record goes past the end, the ones before it are still found
+    RecordHeader* last =
+        reinterpret_cast<RecordHeader*>(pal.data() + offsetIn(layout, kGdc));
+    last->size = pal.size();
+    index.reset();
+    CHECK_TRUE(!index.isIndexed());
+    CHECK_TRUE(!index.build(pal.data(), pal.size()));
+    CHECK_EQ(index.offsetOf(kLsc), offsetIn(layout, kLsc));
+    CHECK_EQ(index.offsetOf(kGdc), -1);
+
+    // A zero size can't loop forever
+    last->size = 0;
+    index.reset();
+    CHECK_TRUE(!index.build(pal.data(), pal.size()));
+}
+
+static void testCopy() {
+    std::vector<RecordDesc> layout = videoLayout();
+    std::vector<char> src = createPal(layout, 1);
+    std::vector<char> dest = createPal(layout, 0);
+    Index index({kCallInfo, kBnlm, kLsc, kGdc});
+    index.build(src.data(), src.size());
+
+    uint32_t copied = 0;
+    CHECK_EQ(index.copy(dest.data(), src.data(), 0, copyAll, &copied), 0);
+    CHECK_EQ(copied, 64u + 4096u + 40 * 1024u + 96 * 1024u);
+    for (auto& desc : layout) {
+        bool selected = desc.uuid == kCallInfo || desc.uuid == kBnlm || desc.uuid == kLsc ||
+                        desc.uuid == kGdc;
+        CHECK_TRUE(recordIs(dest, offsetIn(layout, desc.uuid), desc.size, selected ? 1 : 0));
+    }
+}
+
+// The buffer which already has the records of the same PAL output isn't copied again
+static void testSkipUnchanged() {
+    std::vector<RecordDesc> layout = videoLayout();
+    std::vector<char> src = createPal(layout, 1);
+    std::vector<char> destA = createPal(layout, 0);
+    std::vector<char> destB = createPal(layout, 0);
+    Index index({kCallInfo, kLsc});
+    index.build(src.data(), src.size());
+
+    uint32_t copied = 0;
+    index.copy(destA.data(), src.data(), 5, copyAll, &copied);
+    CHECK_EQ(copied, 64u + 40 * 1024u);
+    copied = 0;
+    index.copy(destA.data(), src.data(), 5, copyAll, &copied);
+    CHECK_EQ(copied, 0u);
+
+    // Another buffer or a new PAL output is copied
+    index.copy(destB.data(), src.data(), 5, copyAll, &copied);
+    CHECK_EQ(copied, 64u + 40 * 1024u);
+    copied = 0;
+    index.copy(destB.data(), src.data(), 6, copyAll, &copied);
+    CHECK_EQ(copied, 64u + 40 * 1024u);
+
+    // The filtered out record isn't copied, and it's copied next time
+    copied = 0;
+    index.copy(destA.data(), src.data(), 7, [](int uuid) { return uuid != kLsc; }, &copied);
+    CHECK_EQ(copied, 64u);
+    copied = 0;
+    index.copy(destA.data(), src.data(), 7, copyAll, &copied);
+    CHECK_EQ(copied, 40 * 1024u);
+
+    // The last copies are forgotten after reset, since the buffers may be allocated again
+    index.reset();
+    index.build(src.data(), src.size());
+    copied = 0;
+    index.copy(destA.data(), src.data(), 7, copyAll, &copied);
+    CHECK_EQ(copied, 64u + 40 * 1024u);
+}
+
+// The records aren't copied into a buffer of a different layout
+static void testMissingRecord() {
+    std::vector<RecordDesc> layout = videoLayout();
+    std::vector<char> src = createPal(layout, 1);
+    std::vector<RecordDesc> otherLayout = layout;
+    otherLayout.erase(otherLayout.begin());
+    std::vector<char> dest = createPal(otherLayout, 0);
+    dest.resize(src.size(), 0);
+    Index index({kCallInfo, kBnlm});
+    index.build(src.data(), src.size());
+
+    uint32_t copied = 0;
+    CHECK_EQ(index.copy(dest.data(), src.data(), 0, copyAll, &copied), 2);
+    CHECK_EQ(copied, 0u);
+    CHECK_TRUE(recordIs(dest, offsetIn(otherLayout, kBnlm), 4096, 0));
+}
+
+/**
+ * The copy of every frame before IspParamAdaptor indexed the records: the records are found
+ * by walking the headers, and they are all copied.
+ */
+static uint32_t copyByWalking(char* dest, const char* src, uint32_t size,
+                              const std::vector<int>& uuids) {
+    uint32_t copied = 0;
+    for (int uuid : uuids) {
+        uint32_t offset = 0;
+        while (offset + sizeof(RecordHeader) <= size) {
+            const RecordHeader* header = reinterpret_cast<const RecordHeader*>(src + offset);
+            if (header->size == 0) break;
+            if (static_cast<int>(header->uuid) == uuid) {
+                memcpy(dest + offset, src + offset, header->size);
+                copied += header->size;
+                break;
+            }
+            offset += header->size;
+        }
+    }
+    return copied;
+}
+
+/**
+ * The video pipe runs PAL for every other frame, the frames without PAL output get the same
+ * PAL buffer again, like IspParamAdaptor does. The bytes copied per frame are reported.
+ */
+static void benchVideoFrames() {
+    std::vector<RecordDesc> layout = videoLayout();
+    std::vector<int> uuids = {kCallInfo, kBnlm, kLsc, kGdc};
+    std::vector<char> src = createPal(layout, 1);
+    std::vector<std::vector<char>> buffers(kBenchBuffers, createPal(layout, 0));
+
+    uint64_t copied = 0;
+    int64_t start = test::nowUs();
+    for (int frame = 0; frame < kBenchFrames; frame++) {
+        int palSequence = frame / 2;
+        std::vector<char>& dest = buffers[palSequence % kBenchBuffers];
+        copied += copyByWalking(dest.data(), src.data(), src.size(), uuids);
+    }
+    int64_t elapsed = test::nowUs() - start;
+    printf("walk and copy all: %llu PAL bytes copied per frame\n",
+           static_cast<unsigned long long>(copied / kBenchFrames));
+    REPORT_BENCH("PAL record update, walk and copy all", kBenchFrames, elapsed);
+
+    Index index(uuids);
+    index.build(src.data(), src.size());
+    uint64_t indexedCopied = 0;
+    start = test::nowUs();
+    for (int frame = 0; frame < kBenchFrames; frame++) {
+        int palSequence = frame / 2;
+        std::vector<char>& dest = buffers[palSequence % kBenchBuffers];
+        uint32_t bytes = 0;
+        index.copy(dest.data(), src.data(), palSequence, copyAll, &bytes);
+        indexedCopied += bytes;
+    }
+    elapsed = test::nowUs() - start;
+    printf("indexed with skip: %llu PAL bytes copied per frame\n",
+           static_cast<unsigned long long>(indexedCopied / kBenchFrames));
+    REPORT_BENCH("PAL record update, indexed with skip", kBenchFrames, elapsed);
+
+    CHECK_EQ(indexedCopied * 2, copied);
+}
+
+int main() {
+    testBuild();
+    testCopy();
+    testSkipUnchanged();
+    testMissingRecord();
+    benchVideoFrames();
+    return test::finish("PalRecordIndexTest");
+}
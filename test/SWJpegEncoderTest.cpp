@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <memory>
+#include <vector>
+
+#include "TestUtils.h"
+#include "jpeg/sw/SWJpegEncoder.h"
+
+using namespace icamera;
+
+static const int kBenchRounds = 5;
+
+static std::vector<uint8_t> makeNv12(int width, int height) {
+    std::vector<uint8_t> image(width * height * 3 / 2);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            image[y * width + x] = static_cast<uint8_t>((x + y) / 4 + (rand() & 0xf));
+        }
+    }
+    for (size_t i = width * height; i < image.size(); i++) {
+        image[i] = static_cast<uint8_t>(128 + (i % 64) - 32);
+    }
+    return image;
+}
+
+static std::unique_ptr<IJpegEncoder> createEncoder(int threads) {
+    char value[8];
+    snprintf(value, sizeof(value), "%d", threads);
+    setenv("cameraSwJpegThreads", value, 1);
+    return IJpegEncoder::createJpegEncoder();
+}
+
+static int encode(IJpegEncoder* encoder, std::vector<uint8_t>* image, int width, int height,
+                  std::vector<uint8_t>* jpeg) {
+    jpeg->assign(image->size() + 4096, 0);
+
+    EncodePackage package;
+    package.inputWidth = width;
+    package.inputHeight = height;
+    package.inputStride = width;
+    package.inputFormat = V4L2_PIX_FMT_NV12;
+    package.inputSize = image->size();
+    package.inputData = image->data();
+    package.outputWidth = width;
+    package.outputHeight = height;
+    package.outputSize = jpeg->size();
+    package.outputData = jpeg->data();
+    package.quality = DEFAULT_JPEG_QUALITY;
+
+    if (!encoder->doJpegEncode(&package)) return -1;
+    jpeg->resize(package.encodedDataSize);
+    return package.encodedDataSize;
+}
+
+static bool decode(const std::vector<uint8_t>& jpeg, int width, int height,
+                   std::vector<uint8_t>* rgb) {
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, const_cast<uint8_t*>(jpeg.data()), jpeg.size());
+
+    bool ok = jpeg_read_header(&cinfo, TRUE) == JPEG_HEADER_OK;
+    ok = ok && static_cast<int>(cinfo.image_width) == width &&
+         static_cast<int>(cinfo.image_height) == height;
+    if (ok) {
+        jpeg_start_decompress(&cinfo);
+        rgb->resize(width * height * cinfo.output_components);
+        while (cinfo.output_scanline < cinfo.output_height) {
+            JSAMPROW row = rgb->data() + cinfo.output_scanline * width * cinfo.output_components;
+            jpeg_read_scanlines(&cinfo, &row, 1);
+        }
+        jpeg_finish_decompress(&cinfo);
+    }
+    jpeg_destroy_decompress(&cinfo);
+    return ok;
+}
+
+static int countRestartMarkers(const std::vector<uint8_t>& jpeg) {
+    int count = 0;
+    for (size_t i = 0; i + 1 < jpeg.size(); i++) {
+        if (jpeg[i] == 0xff && jpeg[i + 1] >= 0xd0 && jpeg[i + 1] <= 0xd7) count++;
+    }
+    return count;
+}
+
+/**
+ * The strips are merged with restart markers, the decoded picture must be the same as
+ * the one of the single strip encoding.
+ */
+static void testStripsMatchSingle(int width, int height) {
+    std::unique_ptr<IJpegEncoder> single = createEncoder(1);
+    std::unique_ptr<IJpegEncoder> strips = createEncoder(4);
+    std::vector<uint8_t> image = makeNv12(width, height);
+
+    std::vector<uint8_t> jpeg1, jpeg4, rgb1, rgb4;
+    CHECK_TRUE(encode(single.get(), &image, width, height, &jpeg1) > 0);
+    // Encode twice to cover the codecs and workers kept from the previous encoding
+    CHECK_TRUE(encode(strips.get(), &image, width, height, &jpeg4) > 0);
+    CHECK_TRUE(encode(strips.get(), &image, width, height, &jpeg4) > 0);
+
+    CHECK_EQ(countRestartMarkers(jpeg1), 0);
+    CHECK_TRUE(countRestartMarkers(jpeg4) > 0);
+    CHECK_TRUE(decode(jpeg1, width, height, &rgb1));
+    CHECK_TRUE(decode(jpeg4, width, height, &rgb4));
+    CHECK_TRUE(!rgb1.empty() && rgb1 == rgb4);
+}
+
+static void benchEncode(int threads, int width, int height) {
+    std::unique_ptr<IJpegEncoder> encoder = createEncoder(threads);
+    std::vector<uint8_t> image = makeNv12(width, height);
+    std::vector<uint8_t> jpeg;
+
+    int64_t start = test::nowUs();
+    for (int i = 0; i < kBenchRounds; i++) encode(encoder.get(), &image, width, height, &jpeg);
+    char name[64];
+    snprintf(name, sizeof(name), "SWJpegEncoder %dx%d %d strips", width, height, threads);
+    REPORT_BENCH(name, kBenchRounds, test::nowUs() - start);
+}
+
+int main() {
+    srand(1);
+    testStripsMatchSingle(1920, 1080);
+    testStripsMatchSingle(4000, 3000);
+    // Neither the width nor the height is a multiple of the MCU size
+    testStripsMatchSingle(1300, 970);
+
+    benchEncode(1, 4000, 3000);
+    benchEncode(4, 4000, 3000);
+    return test::finish("SWJpegEncoderTest");
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "TestUtils.h"
+#include "iutils/SequenceRing.h"
+
+using namespace icamera;
+
+static const int kRingSize = 8;
+static const int kPayloadSize = 64;
+
+// Every field holds the sequence id, so a torn or overwritten item is easy to find
+struct Item {
+    int64_t sequence;
+    int64_t payload[kPayloadSize];
+};
+
+typedef SequenceRing<Item, kRingSize> ItemRing;
+
+static Item* createItem() {
+    Item* item = new Item();
+    item->sequence = -1;
+    for (int i = 0; i < kPayloadSize; i++) item->payload[i] = -1;
+    return item;
+}
+
+static void writeItem(ItemRing* ring, int64_t sequence) {
+    Item* item = ring->acquire();
+    item->sequence = sequence;
+    for (int i = 0; i < kPayloadSize; i++) item->payload[i] = sequence;
+    ring->publish(sequence);
+}
+
+static bool isConsistent(const Item* item) {
+    for (int i = 0; i < kPayloadSize; i++) {
+        if (item->payload[i] != item->sequence) return false;
+    }
+    return true;
+}
+
+static void testLookup() {
+    ItemRing ring(createItem);
+    CHECK_TRUE(ring.get(0) == nullptr);
+    // Nothing published yet, the latest one is the first slot
+    CHECK_TRUE(ring.getRef());
+
+    for (int64_t seq = 0; seq < 20; seq++) writeItem(&ring, seq);
+    CHECK_EQ(ring.get()->sequence, 19);
+    CHECK_EQ(ring.get(15)->sequence, 15);
+    CHECK_TRUE(ring.get(5) == nullptr);  // Overwritten
+    // Not ready yet, the nearest older one is returned
+    CHECK_EQ(ring.get(30)->sequence, 19);
+
+    // Skipped sequence ids
+    writeItem(&ring, 25);
+    CHECK_EQ(ring.get(22)->sequence, 19);
+    CHECK_EQ(ring.get(25)->sequence, 25);
+    CHECK_EQ(ring.getRef(25)->sequence, 25);
+}
+
+// A pinned item is never overwritten, even when all the slots are pinned
+static void testPinnedNeverOverwritten() {
+    ItemRing ring(createItem);
+    for (int64_t seq = 0; seq < kRingSize; seq++) writeItem(&ring, seq);
+
+    ItemRing::Ref first = ring.getRef(0);
+    CHECK_TRUE(first && first->sequence == 0);
+    for (int64_t seq = kRingSize; seq < 3 * kRingSize; seq++) writeItem(&ring, seq);
+    CHECK_EQ(first->sequence, 0);
+    CHECK_TRUE(isConsistent(first.get()));
+    CHECK_EQ(ring.getRef(0)->sequence, 0);
+
+    std::vector<ItemRing::Ref> refs;
+    for (int64_t seq = 3 * kRingSize - kRingSize + 1; seq < 3 * kRingSize; seq++) {
+        refs.push_back(ring.getRef(seq));
+        CHECK_TRUE(refs.back() && refs.back()->sequence == seq);
+    }
+
+    // All slots are pinned, the new item is dropped
+    Item* spare = ring.acquire();
+    for (auto& ref : refs) CHECK_TRUE(ref.get() != spare);
+    CHECK_TRUE(first.get() != spare);
+    spare->sequence = 100;
+    CHECK_TRUE(!ring.publish(100));
+    CHECK_EQ(ring.get(100)->sequence, 3 * kRingSize - 1);
+    CHECK_EQ(first->sequence, 0);
+
+    // Released slots are recycled again
+    first = ItemRing::Ref();
+    refs.clear();
+    for (int64_t seq = 101; seq < 101 + kRingSize; seq++) writeItem(&ring, seq);
+    CHECK_EQ(ring.get(101)->sequence, 101);
+    CHECK_TRUE(ring.get(0) == nullptr);
+}
+
+/**
+ * One writer publishes the items like the 3A thread, while the readers pin random recent ones
+ * and hold them for a while. A pinned item must stay the same until it's released.
+ */
+static void stressPinWhileWriting() {
+    const int kReaders = 3;
+    const int64_t kItems = 200000;
+    ItemRing ring(createItem);
+    std::atomic<int64_t> latest(-1);
+    std::atomic<bool> done(false);
+    std::atomic<int> pinned(0), torn(0), overwritten(0), dropped(0);
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < kReaders; r++) {
+        readers.emplace_back([&, r]() {
+            unsigned int seed = r + 1;
+            std::vector<ItemRing::Ref> held;
+            std::vector<int64_t> heldSequences;
+            while (!done) {
+                int64_t newest = latest.load();
+                if (newest < 0) continue;
+                seed = seed * 1103515245 + 12345;
+                int64_t seq = newest - (seed >> 16) % (kRingSize / 2);
+                ItemRing::Ref ref = ring.getRef(seq);
+                if (!ref) continue;
+                if (!isConsistent(ref.get())) torn++;
+                pinned++;
+                // Keep up to two items pinned at the same time for a while
+                heldSequences.push_back(ref->sequence);
+                held.push_back(std::move(ref));
+                if (held.size() == 2) {
+                    for (size_t i = 0; i < held.size(); i++) {
+                        if (held[i]->sequence != heldSequences[i] || !isConsistent(held[i].get()))
+                            overwritten++;
+                    }
+                    held.clear();
+                    heldSequences.clear();
+                }
+            }
+        });
+    }
+
+    int64_t start = test::nowUs();
+    for (int64_t seq = 0; seq < kItems; seq++) {
+        Item* item = ring.acquire();
+        item->sequence = seq;
+        for (int i = 0; i < kPayloadSize; i++) item->payload[i] = seq;
+        if (ring.publish(seq)) {
+            latest = seq;
+        } else {
+            dropped++;
+        }
+    }
+    int64_t elapsed = test::nowUs() - start;
+    done = true;
+    for (auto& t : readers) t.join();
+
+    CHECK_EQ(torn.load(), 0);
+    CHECK_EQ(overwritten.load(), 0);
+    CHECK_TRUE(pinned.load() > 0);
+    // At most kReaders * 2 slots are pinned at once, but the readers may move their pins
+    // while the writer scans the slots, so a few items can be dropped.
+    CHECK_TRUE(dropped.load() < kItems / 100);
+    printf("pinned %d items, dropped %d items while writing\n", pinned.load(), dropped.load());
+    REPORT_BENCH("SequenceRing publish with 3 pinning readers", kItems, elapsed);
+}
+
+int main() {
+    testLookup();
+    testPinnedNeverOverwritten();
+    stressPinWhileWriting();
+    return test::finish("SequenceRingTest");
+}
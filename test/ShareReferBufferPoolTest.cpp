@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "PlatformData.h"
+#include "TestUtils.h"
+#include "iutils/Errors.h"
+#include "src/core/psysprocessor/ShareReferBufferPool.h"
+
+using namespace icamera;
+
+static const int kProducerBufferNum = PlatformData::kMaxRawDataNum;
+static const int kConsumerBufferNum = 2;
+static const uint32_t kSmallSize = 4096;
+// The TNR reference of a 4K NV12 frame
+static const uint32_t kFrameSize = 3840 * 2160 * 3 / 2;
+static const int kBenchCaptures = 50;
+
+/**
+ * The video PG produces the TNR reference every frame, and the still PG consumes the one of
+ * the previous sequence when a still frame is captured, like the PGs of the two pipes do.
+ * Each reference is stamped with its sequence at both ends.
+ */
+class ReferPipes {
+ public:
+    explicit ReferPipes(uint32_t size) : mPool(0), mSize(size) {
+        mProducerId = ShareReferBufferPool::constructReferId(1, 2, 3);
+        mConsumerId = ShareReferBufferPool::constructReferId(4, 2, 3);
+        mPool.setReferPair("video", mProducerId, "still", mConsumerId);
+        for (int i = 0; i < kProducerBufferNum; i++) {
+            mPool.registerReferBuffers(mProducerId, createBuffer(&mProducerBuffers));
+        }
+        for (int i = 0; i < kConsumerBufferNum; i++) {
+            mPool.registerReferBuffers(mConsumerId, createBuffer(&mConsumerBuffers));
+        }
+    }
+
+    ShareReferBufferPool* pool() { return &mPool; }
+    int64_t producerId() const { return mProducerId; }
+    int64_t consumerId() const { return mConsumerId; }
+
+    // Run the video PG for the sequence, return false if it fails to get the buffers
+    bool produce(int64_t sequence) {
+        CIPR::Buffer* in = nullptr;
+        CIPR::Buffer* out = nullptr;
+        if (mPool.acquireBuffer(mProducerId, &in, &out, sequence) != OK) return false;
+        stamp(out, sequence);
+        return mPool.releaseBuffer(mProducerId, in, out, sequence) == OK;
+    }
+
+    bool isProducerBuffer(CIPR::Buffer* buffer) const {
+        for (auto& item : mProducerBuffers) {
+            if (item.get() == buffer) return true;
+        }
+        return false;
+    }
+
+    void stamp(CIPR::Buffer* buffer, int64_t sequence) {
+        char* data = cpuPtr(buffer);
+        memcpy(data, &sequence, sizeof(sequence));
+        memcpy(data + mSize - sizeof(sequence), &sequence, sizeof(sequence));
+    }
+
+    // Return the stamped sequence, or -2 if the reference is torn
+    int64_t stampOf(CIPR::Buffer* buffer) {
+        const char* data = cpuPtr(buffer);
+        int64_t head = 0, tail = 0;
+        memcpy(&head, data, sizeof(head));
+        memcpy(&tail, data + mSize - sizeof(tail), sizeof(tail));
+        return (head == tail) ? head : -2;
+    }
+
+ private:
+    CIPR::Buffer* createBuffer(std::vector<std::unique_ptr<CIPR::Buffer>>* buffers) {
+        buffers->emplace_back(
+            new CIPR::Buffer(mSize, CIPR::MemoryFlag::AllocateCpuPtr, nullptr));
+        CIPR::Buffer* buffer = buffers->back().get();
+        stamp(buffer, -1);
+        return buffer;
+    }
+
+    static char* cpuPtr(CIPR::Buffer* buffer) {
+        void* ptr = nullptr;
+        buffer->getMemoryCpuPtr(&ptr);
+        return static_cast<char*>(ptr);
+    }
+
+    // The buffers are released after the pool
+    std::vector<std::unique_ptr<CIPR::Buffer>> mProducerBuffers;
+    std::vector<std::unique_ptr<CIPR::Buffer>> mConsumerBuffers;
+    ShareReferBufferPool mPool;
+    uint32_t mSize;
+    int64_t mProducerId;
+    int64_t mConsumerId;
+};
+
+static void testMinBufferNum() {
+    ReferPipes pipes(kSmallSize);
+    CHECK_EQ(pipes.pool()->getMinBufferNum(pipes.producerId()), kProducerBufferNum);
+    CHECK_EQ(pipes.pool()->getMinBufferNum(pipes.consumerId()), kConsumerBufferNum);
+    CHECK_EQ(pipes.pool()->getMinBufferNum(0), 0);
+}
+
+// The shared reference stays the same while the producer runs on, until it's released
+static void testShareWithoutCopy() {
+    ReferPipes pipes(kSmallSize);
+    ShareReferBufferPool* pool = pipes.pool();
+    for (int64_t seq = 0; seq < 6; seq++) CHECK_TRUE(pipes.produce(seq));
+
+    CIPR::Buffer* in = nullptr;
+    CIPR::Buffer* out = nullptr;
+    CHECK_EQ(pool->acquireBuffer(pipes.consumerId(), &in, &out, 6, true), OK);
+    CHECK_TRUE(pipes.isProducerBuffer(in));
+    CHECK_TRUE(!pipes.isProducerBuffer(out));
+    CHECK_EQ(pipes.stampOf(in), 5);
+
+    // The producer cycles its other buffers, and never writes the pinned one
+    for (int64_t seq = 6; seq < 6 + 3 * kProducerBufferNum; seq++) {
+        CHECK_TRUE(pipes.produce(seq));
+    }
+    CHECK_EQ(pipes.stampOf(in), 5);
+
+    CIPR::Buffer* shared = in;
+    CHECK_EQ(pool->releaseBuffer(pipes.consumerId(), in, out, 6), OK);
+    int64_t next = 6 + 3 * kProducerBufferNum;
+    for (int i = 0; i < kProducerBufferNum; i++) CHECK_TRUE(pipes.produce(next++));
+    // Released, so it's reused as the producer output again
+    CHECK_TRUE(pipes.stampOf(shared) != 5);
+}
+
+// Without share, the consumer gets the producer's reference in its own buffer
+static void testCopy() {
+    ReferPipes pipes(kSmallSize);
+    ShareReferBufferPool* pool = pipes.pool();
+    for (int64_t seq = 0; seq < 6; seq++) CHECK_TRUE(pipes.produce(seq));
+
+    CIPR::Buffer* in = nullptr;
+    CIPR::Buffer* out = nullptr;
+    CHECK_EQ(pool->acquireBuffer(pipes.consumerId(), &in, &out, 6, false), OK);
+    CHECK_TRUE(!pipes.isProducerBuffer(in));
+    CHECK_EQ(pipes.stampOf(in), 5);
+    CHECK_EQ(pool->releaseBuffer(pipes.consumerId(), in, out, 6), OK);
+
+    // Nothing is pinned, all the producer buffers are reused
+    for (int64_t seq = 6; seq < 6 + kProducerBufferNum; seq++) CHECK_TRUE(pipes.produce(seq));
+}
+
+// The producer reprocesses an old frame, its output is dropped and the latest one stays
+static void testProducerReprocessing() {
+    ReferPipes pipes(kSmallSize);
+    ShareReferBufferPool* pool = pipes.pool();
+    for (int64_t seq = 0; seq <= 10; seq++) CHECK_TRUE(pipes.produce(seq));
+
+    CIPR::Buffer* in = nullptr;
+    CIPR::Buffer* out = nullptr;
+    CHECK_EQ(pool->acquireBuffer(pipes.producerId(), &in, &out, 9), OK);
+    CHECK_EQ(pipes.stampOf(in), 8);
+    pipes.stamp(out, 9);
+    CHECK_EQ(pool->releaseBuffer(pipes.producerId(), in, out, 9), OK);
+
+    CHECK_EQ(pool->acquireBuffer(pipes.producerId(), &in, &out, 11), OK);
+    CHECK_EQ(pipes.stampOf(in), 10);
+    pipes.stamp(out, 11);
+    CHECK_EQ(pool->releaseBuffer(pipes.producerId(), in, out, 11), OK);
+
+    // The reprocessing of a frame which is gone runs on the latest reference
+    CHECK_EQ(pool->acquireBuffer(pipes.producerId(), &in, &out, 2), OK);
+    CHECK_EQ(pipes.stampOf(in), 11);
+    CHECK_EQ(pool->releaseBuffer(pipes.producerId(), in, out, 2), OK);
+}
+
+// A still capture which fails returns the pin, and the producer gets its buffer back
+static void testCancelReleasesPin() {
+    ReferPipes pipes(kSmallSize);
+    ShareReferBufferPool* pool = pipes.pool();
+    for (int64_t seq = 0; seq < 4; seq++) CHECK_TRUE(pipes.produce(seq));
+
+    CIPR::Buffer* in = nullptr;
+    CIPR::Buffer* out = nullptr;
+    CHECK_EQ(pool->acquireBuffer(pipes.consumerId(), &in, &out, 4, true), OK);
+    CHECK_TRUE(pipes.isProducerBuffer(in));
+    CIPR::Buffer* shared = in;
+    CHECK_EQ(pool->cancelBuffer(pipes.consumerId(), out, 4), OK);
+
+    for (int64_t seq = 4; seq < 4 + kProducerBufferNum; seq++) CHECK_TRUE(pipes.produce(seq));
+    CHECK_TRUE(pipes.stampOf(shared) != 3);
+
+    // The consumer still has both of its buffers
+    CHECK_EQ(pool->acquireBuffer(pipes.consumerId(), &in, &out, 8, true), OK);
+    CHECK_EQ(pipes.stampOf(in), 7);
+    CHECK_EQ(pool->releaseBuffer(pipes.consumerId(), in, out, 8), OK);
+}
+
+// The still capture comes before the producer is done with the reference, it waits for it
+static void testConsumerWaitsForProducer() {
+    ReferPipes pipes(kSmallSize);
+    ShareReferBufferPool* pool = pipes.pool();
+    for (int64_t seq = 0; seq < 4; seq++) CHECK_TRUE(pipes.produce(seq));
+
+    std::thread producer([&pipes]() {
+        usleep(10000);
+        pipes.produce(4);
+    });
+    CIPR::Buffer* in = nullptr;
+    CIPR::Buffer* out = nullptr;
+    CHECK_EQ(pool->acquireBuffer(pipes.consumerId(), &in, &out, 5, true), OK);
+    producer.join();
+    CHECK_TRUE(pipes.isProducerBuffer(in));
+    CHECK_EQ(pipes.stampOf(in), 4);
+    CHECK_EQ(pool->releaseBuffer(pipes.consumerId(), in, out, 5), OK);
+}
+
+/**
+ * A still capture every few video frames at 4K, the bytes copied per capture are counted from
+ * the buffers the consumer gets: the producer's one is shared, its own one is copied into.
+ */
+static void benchStillCapture(bool share) {
+    ReferPipes pipes(kFrameSize);
+    ShareReferBufferPool* pool = pipes.pool();
+    int64_t seq = 0;
+    int64_t copiedBytes = 0;
+    int64_t elapsed = 0;
+
+    for (int n = 0; n < kBenchCaptures; n++) {
+        for (int i = 0; i < 3; i++) CHECK_TRUE(pipes.produce(seq++));
+
+        CIPR::Buffer* in = nullptr;
+        CIPR::Buffer* out = nullptr;
+        int64_t start = test::nowUs();
+        int ret = pool->acquireBuffer(pipes.consumerId(), &in, &out, seq, share);
+        elapsed += test::nowUs() - start;
+        CHECK_EQ(ret, OK);
+        if (ret != OK) return;
+
+        CHECK_EQ(pipes.stampOf(in), seq - 1);
+        if (!pipes.isProducerBuffer(in)) copiedBytes += kFrameSize;
+        pool->releaseBuffer(pipes.consumerId(), in, out, seq);
+    }
+
+    printf("%s: %lld bytes copied per still capture\n", share ? "share" : "copy",
+           static_cast<long long>(copiedBytes / kBenchCaptures));
+    if (share) CHECK_EQ(copiedBytes, 0);
+    REPORT_BENCH(share ? "4K TNR refer acquire, share" : "4K TNR refer acquire, copy",
+                 kBenchCaptures, elapsed);
+}
+
+int main() {
+    testMinBufferNum();
+    testShareWithoutCopy();
+    testCopy();
+    testProducerReprocessing();
+    testCancelReleasesPin();
+    testConsumerWaitsForProducer();
+    benchStillCapture(false);
+    benchStillCapture(true);
+    return test::finish("ShareReferBufferPoolTest");
+}
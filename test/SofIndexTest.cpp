@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include "TestUtils.h"
+#include "core/SofIndex.h"
+
+using namespace icamera;
+
+// The same as MAX_BUFFER_COUNT of SyncManager
+static const int kCapacity = 10;
+static const long kFrameMs = 33;
+static const int kBenchLookups = 1000000;
+
+typedef SofIndex<kCapacity> Index;
+
+static void testEmpty() {
+    Index index;
+    CHECK_EQ(index.count(), 0);
+    CHECK_EQ(index.timestampOf(0), -1);
+    CHECK_EQ(index.findClosest(100), -1);
+}
+
+static void testLookup() {
+    Index index;
+    for (int64_t seq = 0; seq < 5; seq++) index.add(seq, 1000 + seq * kFrameMs);
+    CHECK_EQ(index.count(), 5);
+    CHECK_EQ(index.timestampOf(0), 1000);
+    CHECK_EQ(index.timestampOf(4), 1000 + 4 * kFrameMs);
+    CHECK_EQ(index.timestampOf(5), -1);
+
+    // Before the first, after the last, between two, and the earlier one of a tie
+    CHECK_EQ(index.findClosest(0), 1000);
+    CHECK_EQ(index.findClosest(5000), 1000 + 4 * kFrameMs);
+    CHECK_EQ(index.findClosest(1000 + kFrameMs + 1), 1000 + kFrameMs);
+    CHECK_EQ(index.findClosest(1000 + 2 * kFrameMs - 1), 1000 + 2 * kFrameMs);
+    CHECK_EQ(index.findClosest(1000), 1000);
+    index.add(10, 1010);
+    CHECK_EQ(index.findClosest(1005), 1000);
+
+    index.reset();
+    CHECK_EQ(index.count(), 0);
+    CHECK_EQ(index.timestampOf(0), -1);
+}
+
+// The SOF of a frame may come after the SOF of a later frame, the index stays sorted
+static void testOutOfOrder() {
+    Index index;
+    index.add(1, 1033);
+    index.add(0, 1000);
+    index.add(3, 1099);
+    index.add(2, 1066);
+    CHECK_EQ(index.timestampOf(0), 1000);
+    CHECK_EQ(index.timestampOf(2), 1066);
+    CHECK_EQ(index.findClosest(1060), 1066);
+    CHECK_EQ(index.findClosest(1040), 1033);
+}
+
+// The oldest frame is dropped when it's full
+static void testFull() {
+    Index index;
+    for (int64_t seq = 0; seq < kCapacity + 3; seq++) index.add(seq, seq * kFrameMs);
+    CHECK_EQ(index.count(), kCapacity);
+    CHECK_EQ(index.timestampOf(2), -1);
+    CHECK_EQ(index.timestampOf(3), 3 * kFrameMs);
+    CHECK_EQ(index.timestampOf(kCapacity + 2), (kCapacity + 2) * kFrameMs);
+    CHECK_EQ(index.findClosest(0), 3 * kFrameMs);
+}
+
+// The lookup before the index: the closest of all the frames by a linear scan
+static long findClosestLinear(const long* timestamps, int count, long timestampMs) {
+    long closest = -1;
+    for (int i = 0; i < count; i++) {
+        if (closest < 0 || labs(timestamps[i] - timestampMs) < labs(closest - timestampMs)) {
+            closest = timestamps[i];
+        }
+    }
+    return closest;
+}
+
+/**
+ * The lookup done for each other camera when one frame is checked, with a full index of
+ * frames 33ms apart and the frames looked up anywhere among them.
+ */
+static void benchFindClosest() {
+    Index index;
+    long timestamps[kCapacity];
+    for (int i = 0; i < kCapacity; i++) {
+        timestamps[i] = 1000 + i * kFrameMs;
+        index.add(i, timestamps[i]);
+    }
+
+    uint32_t seed = 1;
+    long sum = 0;
+    int64_t start = test::nowUs();
+    for (int i = 0; i < kBenchLookups; i++) {
+        seed = seed * 1103515245 + 12345;
+        long timestampMs = 1000 + (seed >> 16) % (kCapacity * kFrameMs);
+        sum += findClosestLinear(timestamps, kCapacity, timestampMs);
+    }
+    REPORT_BENCH("closest SOF, linear scan", kBenchLookups, test::nowUs() - start);
+
+    seed = 1;
+    long indexedSum = 0;
+    start = test::nowUs();
+    for (int i = 0; i < kBenchLookups; i++) {
+        seed = seed * 1103515245 + 12345;
+        long timestampMs = 1000 + (seed >> 16) % (kCapacity * kFrameMs);
+        indexedSum += index.findClosest(timestampMs);
+    }
+    REPORT_BENCH("closest SOF, binary search", kBenchLookups, test::nowUs() - start);
+
+    // Both pick the earlier frame of a tie
+    CHECK_EQ(sum, indexedSum);
+}
+
+int main() {
+    testEmpty();
+    testLookup();
+    testOutOfOrder();
+    testFull();
+    benchFindClosest();
+    return test::finish("SofIndexTest");
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Minimal checks for the standalone tests, each test is one executable whose exit code
+ * is the number of failed checks, so that ctest can run it without any test framework.
+ */
+
+namespace icamera {
+namespace test {
+
+inline int& failureCount() {
+    static int count = 0;
+    return count;
+}
+
+inline int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+inline int finish(const char* name) {
+    printf("%s: %s (%d failures)\n", name, failureCount() ? "FAILED" : "PASSED", failureCount());
+    return failureCount() ? 1 : 0;
+}
+
+}  // namespace test
+}  // namespace icamera
+
+#define CHECK_TRUE(cond)                                                                \
+    do {                                                                                \
+        if (!(cond)) {                                                                  \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+            icamera::test::failureCount()++;                                            \
+        }                                                                               \
+    } while (0)
+
+#define CHECK_EQ(a, b) CHECK_TRUE((a) == (b))
+
+// Print one benchmark result in the same format for all the tests
+#define REPORT_BENCH(name, count, us)                                                   \
+    printf("bench %-40s %10lld ops %10lld us %12.1f ops/s\n", name,                      \
+           static_cast<long long>(count), static_cast<long long>(us),                   \
+           (us) > 0 ? (count) * 1000000.0 / (us) : 0.0)
@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TestUtils.h"
+#include "modules/ia_cipr/include/Command.h"
+#include "modules/ia_cipr/include/Context.h"
+#include "modules/ia_cipr/include/Event.h"
+#include "v4l2/SysCall.h"
+#include "v4l2/VirtualIpu.h"
+
+using namespace icamera;
+
+static const int kFps = 120;
+static const int kPsysUs = 2000;
+static const int kFrames = 60;
+static const int kCommands = 100;
+static const int kBufferCount = 4;
+static const uint32_t kWidth = 4208;
+static const uint32_t kHeight = 3120;
+// The CPU time of the terminal encoding and the stats decoding of one PG
+static const int kEncodeUs = 1500;
+static const int kDecodeUs = 1000;
+static const int kPipelineFrames = 50;
+
+// The entities of the sample graph, in the order of the file
+static const char* kEntityNames[] = {"ov13b10 3-0036", "Intel IPU6 CSI-2 1",
+                                     "Intel IPU6 CSI2 BE SOC 4", "Intel IPU6 BE SOC capture 4"};
+
+static void testMediaGraph() {
+    SysCall* sc = SysCall::getInstance();
+    int fd = sc->open("/dev/media0", O_RDWR);
+    CHECK_TRUE(fd >= 0);
+
+    struct media_device_info info = {};
+    CHECK_EQ(sc->ioctl(fd, MEDIA_IOC_DEVICE_INFO, &info), 0);
+
+    std::vector<std::string> names;
+    struct media_entity_desc desc = {};
+    desc.id = MEDIA_ENT_ID_FLAG_NEXT;
+    while (sc->ioctl(fd, MEDIA_IOC_ENUM_ENTITIES, &desc) == 0) {
+        names.push_back(desc.name);
+        desc.id |= MEDIA_ENT_ID_FLAG_NEXT;
+    }
+    CHECK_EQ(names.size(), ARRAY_SIZE(kEntityNames));
+    for (size_t i = 0; i < names.size() && i < ARRAY_SIZE(kEntityNames); i++) {
+        CHECK_TRUE(names[i] == kEntityNames[i]);
+    }
+    CHECK_EQ(sc->close(fd), 0);
+}
+
+// Stream the capture node, the buffers must be done in order at the configured frame rate
+static void testVideoStream() {
+    SysCall* sc = SysCall::getInstance();
+    int fd = sc->open("/dev/video0", O_RDWR | O_NONBLOCK);
+    CHECK_TRUE(fd >= 0);
+
+    struct v4l2_format format = {};
+    format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    format.fmt.pix.width = kWidth;
+    format.fmt.pix.height = kHeight;
+    format.fmt.pix.pixelformat = V4L2_PIX_FMT_SGRBG10;
+    CHECK_EQ(sc->ioctl(fd, VIDIOC_S_FMT, &format), 0);
+    CHECK_TRUE(format.fmt.pix.sizeimage >= kWidth * kHeight * 2);
+
+    struct v4l2_requestbuffers req = {};
+    req.count = kBufferCount;
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = V4L2_MEMORY_MMAP;
+    CHECK_EQ(sc->ioctl(fd, VIDIOC_REQBUFS, &req), 0);
+    CHECK_EQ(req.count, static_cast<uint32_t>(kBufferCount));
+
+    for (int i = 0; i < kBufferCount; i++) {
+        struct v4l2_buffer buf = {};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        CHECK_EQ(sc->ioctl(fd, VIDIOC_QBUF, &buf), 0);
+    }
+
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    CHECK_EQ(sc->ioctl(fd, VIDIOC_STREAMON, &type), 0);
+
+    int64_t start = test::nowUs();
+    int64_t lastSequence = -1;
+    bool ordered = true;
+    for (int frame = 0; frame < kFrames; frame++) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (sc->poll(&pfd, 1, 1000) != 1) break;
+
+        struct v4l2_buffer buf = {};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        CHECK_EQ(sc->ioctl(fd, VIDIOC_DQBUF, &buf), 0);
+        if (static_cast<int64_t>(buf.sequence) <= lastSequence) ordered = false;
+        lastSequence = buf.sequence;
+        CHECK_EQ(sc->ioctl(fd, VIDIOC_QBUF, &buf), 0);
+    }
+    int64_t elapsed = test::nowUs() - start;
+
+    CHECK_TRUE(ordered);
+    CHECK_EQ(lastSequence, kFrames - 1);
+    // The frames are paced by the frame thread, not faster than the frame rate
+    CHECK_TRUE(elapsed >= (kFrames - 1) * 1000000LL / kFps);
+    REPORT_BENCH("virtual IPU frames at 120 fps", kFrames, elapsed);
+
+    CHECK_EQ(sc->ioctl(fd, VIDIOC_STREAMOFF, &type), 0);
+    CHECK_EQ(sc->close(fd), 0);
+}
+
+/**
+ * The buffers and commands of one PG, registered and configured the same way as PGCommon does.
+ * Each of the depth slots has its own PG and terminal buffers, so that one command per slot
+ * can be in flight.
+ */
+class PsysPg {
+ public:
+    PsysPg(CIPR::Context* ctx, int depth) : mCtx(ctx), mReady(true) {
+        mManifest.reset(new CIPR::Buffer(kPsysBufferSize, CIPR::MemoryFlag::AllocateCpuPtr,
+                                         nullptr));
+        mReady &= mManifest->attatchDevice(ctx) == CIPR::Result::OK;
+
+        for (int slot = 0; slot < depth; slot++) {
+            CIPR::PSysCommandConfig cfg;
+            for (int i = 0; i < kTerminals; i++) cfg.buffers.push_back(createBuffer());
+            cfg.pg = createBuffer();
+            cfg.extBuf = createExtBuffer();
+            cfg.pgManifestBuf = mManifest.get();
+            mConfigs.push_back(cfg);
+
+            mCommands.emplace_back(new CIPR::Command(cfg));
+            mReady &= mCommands.back()->isInitialized();
+        }
+    }
+
+    bool isReady() const { return mReady; }
+
+    CIPR::Result enqueue(uint64_t issueId) {
+        int slot = issueId % mCommands.size();
+        mConfigs[slot].issueID = issueId;
+        mConfigs[slot].token = issueId + 1;
+        CIPR::Result ret = mCommands[slot]->setConfig(mConfigs[slot]);
+        if (ret != CIPR::Result::OK) return ret;
+
+        return mCommands[slot]->enqueue(mCtx);
+    }
+
+ private:
+    static const int kTerminals = 3;
+    static const uint32_t kPsysBufferSize = 4096;
+
+    CIPR::Buffer* createBuffer() {
+        mBuffers.emplace_back(new CIPR::Buffer(
+            kPsysBufferSize, CIPR::MemoryFlag::AllocateCpuPtr | CIPR::MemoryFlag::NoFlush,
+            nullptr));
+        mReady &= mBuffers.back()->attatchDevice(mCtx) == CIPR::Result::OK;
+        return mBuffers.back().get();
+    }
+
+    CIPR::Buffer* createExtBuffer() {
+        mBuffers.emplace_back(
+            new CIPR::Buffer(sizeof(CIPR::ProcessGroupCommand),
+                             CIPR::MemoryFlag::AllocateCpuPtr | CIPR::MemoryFlag::PSysAPI,
+                             nullptr));
+        CIPR::Buffer* ext = mBuffers.back().get();
+        void* extPtr = nullptr;
+        mReady &= ext->attatchDevice(mCtx) == CIPR::Result::OK &&
+                  ext->getMemoryCpuPtr(&extPtr) == CIPR::Result::OK;
+        if (!extPtr) return ext;
+
+        CIPR::ProcessGroupCommand* pgCommand = static_cast<CIPR::ProcessGroupCommand*>(extPtr);
+        pgCommand->header.size = sizeof(CIPR::ProcessGroupCommand);
+        pgCommand->header.offset = sizeof(pgCommand->header);
+        pgCommand->header.version = psys_command_ext_ppg_1;
+        return ext;
+    }
+
+    CIPR::Context* mCtx;
+    bool mReady;
+    std::unique_ptr<CIPR::Buffer> mManifest;
+    std::vector<std::unique_ptr<CIPR::Buffer>> mBuffers;
+    std::vector<CIPR::PSysCommandConfig> mConfigs;
+    std::vector<std::unique_ptr<CIPR::Command>> mCommands;
+};
+
+// Wait for the next completion, which must be the one of the issue id
+static bool waitPsysCommand(CIPR::Context* ctx, CIPR::Event* event, uint64_t issueId) {
+    if (event->wait(ctx) != CIPR::Result::OK) return false;
+
+    CIPR::PSysEventConfig done = {};
+    event->getConfig(&done);
+    return done.type == IPU_PSYS_EVENT_TYPE_CMD_COMPLETE && done.commandIssueID == issueId &&
+           done.error == 0;
+}
+
+/**
+ * Run the PSys command flow of PGCommon through CIPR: the buffers are registered, the commands
+ * are queued and their completion events are waited for one by one.
+ */
+static void testPsysCommands() {
+    CIPR::Context ctx;
+    CHECK_TRUE(ctx.isInitialized());
+
+    CIPR::PSYSCapability cap = {};
+    CHECK_TRUE(ctx.getCapabilities(&cap) == CIPR::Result::OK);
+    CHECK_TRUE(strcmp(reinterpret_cast<char*>(cap.driver), "ipu-psys-virtual") == 0);
+    uint32_t manifestSize = 0;
+    CHECK_TRUE(ctx.getManifest(0, &manifestSize, nullptr) == CIPR::Result::NoEntry);
+
+    PsysPg pg(&ctx, 1);
+    CHECK_TRUE(pg.isReady());
+    CIPR::PSysEventConfig eventCfg = {};
+    eventCfg.timeout = 1000;
+    CIPR::Event event(eventCfg);
+    CHECK_TRUE(event.isInitialized());
+
+    int64_t start = test::nowUs();
+    bool matched = true;
+    for (int i = 0; i < kCommands; i++) {
+        CHECK_TRUE(pg.enqueue(i) == CIPR::Result::OK);
+        if (!waitPsysCommand(&ctx, &event, i)) matched = false;
+    }
+    int64_t elapsed = test::nowUs() - start;
+    CHECK_TRUE(matched);
+    CHECK_TRUE(elapsed >= kCommands * kPsysUs);
+    REPORT_BENCH("virtual PSys commands of 2ms", kCommands, elapsed);
+
+    // Nothing is pending after all the events are dequeued
+    eventCfg.timeout = 10;
+    CIPR::Event idle(eventCfg);
+    CHECK_TRUE(idle.wait(&ctx) == CIPR::Result::TimeOut);
+}
+
+static void busyWait(int64_t us) {
+    int64_t end = test::nowUs() + us;
+    while (test::nowUs() < end) {
+    }
+}
+
+/**
+ * One PG per frame like the video pipes, encoded before and decoded after its PSys command.
+ * With depth 1, which is what PipeLiteExecutor::runPipe() does for a single PG pipe, the CPU
+ * and the PSys take turns. With depth 2 the next frame is encoded while the PSys runs the
+ * current one, and the current one is decoded while the PSys runs the next one.
+ */
+static int64_t runPsysPipeline(int depth) {
+    CIPR::Context ctx;
+    PsysPg pg(&ctx, depth);
+    CHECK_TRUE(pg.isReady());
+    CIPR::PSysEventConfig eventCfg = {};
+    eventCfg.timeout = 1000;
+    CIPR::Event event(eventCfg);
+
+    int64_t start = test::nowUs();
+    bool matched = true;
+    for (int frame = 0; frame < kPipelineFrames + depth - 1; frame++) {
+        if (frame < kPipelineFrames) {
+            busyWait(kEncodeUs);
+            if (pg.enqueue(frame) != CIPR::Result::OK) matched = false;
+        }
+
+        int doneFrame = frame - (depth - 1);
+        if (doneFrame >= 0) {
+            if (!waitPsysCommand(&ctx, &event, doneFrame)) matched = false;
+            busyWait(kDecodeUs);
+        }
+    }
+    int64_t elapsed = test::nowUs() - start;
+    CHECK_TRUE(matched);
+
+    char name[64];
+    snprintf(name, sizeof(name), "single PG pipe frames, submit depth %d", depth);
+    REPORT_BENCH(name, kPipelineFrames, elapsed);
+    return elapsed;
+}
+
+static void benchPsysSubmitDepth() {
+    // About 4.5ms per frame with depth 1, and 2.5ms with depth 2
+    int64_t depth1 = runPsysPipeline(1);
+    int64_t depth2 = runPsysPipeline(2);
+    CHECK_TRUE(depth2 < depth1);
+}
+
+int main() {
+    setenv("cameraVirtualIpu", VIRTUAL_IPU_GRAPH, 1);
+    setenv("cameraVirtualIpuFps", std::to_string(kFps).c_str(), 1);
+    setenv("cameraVirtualIpuPsysUs", std::to_string(kPsysUs).c_str(), 1);
+    CHECK_TRUE(dynamic_cast<VirtualIpu*>(SysCall::getInstance()) != nullptr);
+
+    testMediaGraph();
+    testVideoStream();
+    testPsysCommands();
+    benchPsysSubmitDepth();
+
+    delete static_cast<VirtualIpu*>(SysCall::getInstance());
+    SysCall::updateInstance(nullptr);
+    return test::finish("VirtualIpuTest");
+}
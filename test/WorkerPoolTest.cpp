@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "TestUtils.h"
+#include "iutils/WorkerPool.h"
+
+using namespace icamera;
+
+static const int kTaskCount = 1000;
+static const int kCallers = 4;
+static const int kBenchJobs = 20000;
+
+// Every task runs exactly once before parallelFor() returns
+static void testParallelFor() {
+    WorkerPool pool(3, "TestWorker");
+    CHECK_EQ(pool.getConcurrency(), 4);
+
+    std::vector<std::atomic<int>> runs(kTaskCount);
+    for (auto& run : runs) run = 0;
+    pool.parallelFor(kTaskCount, [&](int i) { runs[i]++; });
+    for (auto& run : runs) CHECK_EQ(run.load(), 1);
+
+    // Nothing to run
+    pool.parallelFor(0, [&](int i) { runs[i]++; });
+    CHECK_EQ(runs[0].load(), 1);
+}
+
+// The callers in different threads each get their own tasks done
+static void testConcurrentCallers() {
+    WorkerPool pool(2, "TestWorker");
+    std::vector<std::vector<int>> results(kCallers, std::vector<int>(kTaskCount, 0));
+    std::vector<std::thread> callers;
+    for (int c = 0; c < kCallers; c++) {
+        callers.emplace_back([&pool, &results, c]() {
+            for (int round = 0; round < 10; round++) {
+                pool.parallelFor(kTaskCount, [&results, c](int i) { results[c][i]++; });
+            }
+        });
+    }
+    for (auto& caller : callers) caller.join();
+
+    for (auto& result : results) {
+        for (int count : result) CHECK_EQ(count, 10);
+    }
+}
+
+// A task can use the pool again, the caller runs the nested job if the workers are busy
+static void testNested() {
+    WorkerPool pool(2, "TestWorker");
+    std::atomic<int> total(0);
+    pool.parallelFor(8, [&](int) { pool.parallelFor(8, [&](int) { total++; }); });
+    CHECK_EQ(total.load(), 64);
+}
+
+// Only the workers run the tasks, a pool without worker runs them in the caller
+static void testRunOnWorkers() {
+    WorkerPool pool(2, "TestWorker");
+    std::thread::id caller = std::this_thread::get_id();
+    std::atomic<int> inCaller(0);
+    std::atomic<int> total(0);
+    pool.runOnWorkers(100, [&](int) {
+        if (std::this_thread::get_id() == caller) inCaller++;
+        total++;
+    });
+    CHECK_EQ(total.load(), 100);
+    CHECK_EQ(inCaller.load(), 0);
+
+    WorkerPool empty(0, "TestWorker");
+    empty.runOnWorkers(3, [&](int) {
+        if (std::this_thread::get_id() == caller) inCaller++;
+    });
+    CHECK_EQ(inCaller.load(), 3);
+}
+
+// The workers are pinned to the cpu once, the affinity of the caller isn't changed
+static void testPinnedWorker() {
+    cpu_set_t callerSet;
+    CHECK_EQ(pthread_getaffinity_np(pthread_self(), sizeof(callerSet), &callerSet), 0);
+    int cpu = -1;
+    for (int i = CPU_SETSIZE - 1; i >= 0; i--) {
+        if (CPU_ISSET(i, &callerSet)) {
+            cpu = i;
+            break;
+        }
+    }
+    CHECK_TRUE(cpu >= 0);
+
+    WorkerPool pool(1, "TestPinned", cpu);
+    std::atomic<int> offCpu(0);
+    for (int i = 0; i < 100; i++) {
+        pool.runOnWorkers(1, [&](int) {
+            if (sched_getcpu() != cpu) offCpu++;
+        });
+    }
+    CHECK_EQ(offCpu.load(), 0);
+
+    cpu_set_t set;
+    pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+    CHECK_TRUE(CPU_EQUAL(&set, &callerSet));
+
+    // The shared pool keeps the cpu of its creation
+    WorkerPool* shared = WorkerPool::getSharedPool("TestPinnedShared", 1, cpu);
+    CHECK_TRUE(shared == WorkerPool::getSharedPool("TestPinnedShared"));
+    shared->runOnWorkers(1, [&](int) { CHECK_EQ(sched_getcpu(), cpu); });
+}
+
+/**
+ * The cost of running one task on another cpu: the hand-off to a pinned worker versus
+ * pinning the calling thread and restoring its affinity around the task, like the
+ * scheduler did for each node of each frame.
+ */
+static void benchPinnedTask() {
+    cpu_set_t callerSet;
+    pthread_getaffinity_np(pthread_self(), sizeof(callerSet), &callerSet);
+    int cpu = 0;
+    while (cpu < CPU_SETSIZE && !CPU_ISSET(cpu, &callerSet)) cpu++;
+
+    std::atomic<int> total(0);
+    int64_t start = test::nowUs();
+    for (int i = 0; i < kBenchJobs; i++) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        total++;
+        pthread_setaffinity_np(pthread_self(), sizeof(callerSet), &callerSet);
+    }
+    REPORT_BENCH("task on cpu, setaffinity per task", kBenchJobs, test::nowUs() - start);
+
+    WorkerPool pool(1, "BenchPinned", cpu);
+    start = test::nowUs();
+    for (int i = 0; i < kBenchJobs; i++) {
+        pool.runOnWorkers(1, [&](int) { total++; });
+    }
+    REPORT_BENCH("task on cpu, pinned worker", kBenchJobs, test::nowUs() - start);
+    CHECK_EQ(total.load(), kBenchJobs * 2);
+}
+
+int main() {
+    testParallelFor();
+    testConcurrentCallers();
+    testNested();
+    testRunOnWorkers();
+    testPinnedWorker();
+    benchPinnedTask();
+    return test::finish("WorkerPoolTest");
+}
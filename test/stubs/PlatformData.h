@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2023 Intel Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/**
+ * The few PlatformData queries of the tested modules, without the platform configuration and
+ * the IPU libraries which the real one needs. Only for the tests which add this directory
+ * before the source directories.
+ */
+
+#include <string>
+
+namespace icamera {
+
+class PlatformData {
+ public:
+    // The TNR reference buffers of the producer PG
+    static const unsigned int kMaxRawDataNum = 4;
+
+    static unsigned int getMaxRawDataNum(int cameraId) { return kMaxRawDataNum; }
+
+#ifdef CAMERA_DEFAULT_CFG_PATH
+    // The directory of the test configuration files, ending with "/"
+    static std::string getCameraCfgPath() { return CAMERA_DEFAULT_CFG_PATH; }
+#endif
+};
+
+}  // namespace icamera